@@ -3,6 +3,7 @@
 #include <gloo/transform.h>
 #include <gloo/mouse_event.h>
 #include <gloo/group.h>
+#include <gloo/program_binary_cache.h>
 
 #include <cstdio>
 #include <iostream>
@@ -63,9 +64,12 @@ MyModel::~MyModel()
 
 bool MyModel::Init()
 {
-  glEnable(GL_DEPTH_TEST);
   glEnable(GL_TEXTURE_2D);
   glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+
+  // Shader programs built before are loaded from their binaries instead of compiled.
+  ProgramBinaryCache::Get().SetDirectory("shader_cache");
+
   mDebugRenderer = new DebugRenderer();
   mPhongRenderer = new PhongRenderer("../../shaders/normal_mapping_phong/vertex_shader.glsl",
                                      "../../shaders/normal_mapping_phong/fragment_shader.glsl");
@@ -190,14 +194,14 @@ void MyModel::Display()
   {
     mDebugRenderer->Bind();
     mDebugRenderer->Render(mGrid->GetMeshGroup(), M, mCamera);
-    mDebugRenderer->Render(mAxis->GetMeshGroup(), M, mCamera);
-    // mDebugRenderer->Render(mWireframeSphere->GetMeshGroup(), M, mCamera);
+    mAxis->Render(mDebugRenderer, M, mCamera);
+    // mDebugRenderer->RenderPrimitive(mWireframeSphere, M, mCamera);
 
     // M.Rotate(-0.79*blah_angle, 0, 1, 0);
     // M.Translate(-1.2f, 0.0f, 0.0f);
     // M.Rotate(blah_angle, 0, 0, 1);
     // M.Scale(0.25f, 0.25f, 0.25f);
-    // mDebugRenderer->Render(mWireframeSphere->GetMeshGroup(), M, mCamera);
+    // mDebugRenderer->RenderPrimitive(mWireframeSphere, M, mCamera);
   }
 
   glutSwapBuffers();
@@ -205,7 +209,7 @@ void MyModel::Display()
 
 void MyModel::Reshape(int w, int h)
 {
-  glViewport(0, 0, w, h);
+  GLStateCache::Get().Viewport(0, 0, w, h);
   mCamera->SetOnReshape(0, 0, w, h);
 }
 
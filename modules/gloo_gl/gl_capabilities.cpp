@@ -0,0 +1,49 @@
+#include "gl_capabilities.h"
+
+#include <algorithm>
+
+namespace gloo
+{
+
+const GLCapabilities & GLCapabilities::Get()
+{
+  static GLCapabilities capabilities;
+  return capabilities;
+}
+
+GLCapabilities::GLCapabilities()
+{
+  glGetIntegerv(GL_MAJOR_VERSION, &mMajorVersion);
+  glGetIntegerv(GL_MINOR_VERSION, &mMinorVersion);
+
+  // Core profile: one string per extension.
+  GLint numExtensions = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+
+  for (GLint i = 0; i < numExtensions; i++)
+  {
+    const GLubyte* name = glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i));
+    if (name)
+      mExtensions.emplace_back(reinterpret_cast<const char*>(name));
+  }
+  std::sort(mExtensions.begin(), mExtensions.end());
+
+  mParallelShaderCompile = GLCapabilities::HasExtension("GL_KHR_parallel_shader_compile") ||
+                           GLCapabilities::HasExtension("GL_ARB_parallel_shader_compile");
+
+  const bool gl43 = (mMajorVersion > 4) || ((mMajorVersion == 4) && (mMinorVersion >= 3));
+  const bool gl44 = (mMajorVersion > 4) || ((mMajorVersion == 4) && (mMinorVersion >= 4));
+  const bool gl45 = (mMajorVersion > 4) || ((mMajorVersion == 4) && (mMinorVersion >= 5));
+  mDirectStateAccess = gl45 || GLCapabilities::HasExtension("GL_ARB_direct_state_access");
+  mVertexAttribBinding = gl43 || GLCapabilities::HasExtension("GL_ARB_vertex_attrib_binding");
+  mVertexPulling = gl43 && GLCapabilities::HasExtension("GL_ARB_shader_draw_parameters");
+  mCopyImage = gl43 || GLCapabilities::HasExtension("GL_ARB_copy_image");
+  mBufferStorage = gl44 || GLCapabilities::HasExtension("GL_ARB_buffer_storage");
+}
+
+bool GLCapabilities::HasExtension(const std::string & name) const
+{
+  return std::binary_search(mExtensions.begin(), mExtensions.end(), name);
+}
+
+}  // namespace gloo.
@@ -0,0 +1,85 @@
+// + ======================================== +
+// |         gl-oo-interface library          |
+// |             Module: GLOO GL.             |
+// |        Author: Rodrigo Castiel, 2016.    |
+// + ======================================== +
+//
+// gloo::GLCapabilities queries once which optional features the GL context offers (extensions
+// and the limits gloo depends on), so that code paths can be chosen without asking the driver
+// again.
+//
+// Usage:
+//   const GLCapabilities & caps = GLCapabilities::Get();  // After the context is created.
+//   if (caps.HasParallelShaderCompile())
+//     ...
+//   if (caps.HasDirectStateAccess())
+//     ...
+//
+// Like gloo::GLStateCache, it assumes a single GL context.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "gloo/gl_header.h"
+
+namespace gloo
+{
+
+class GLCapabilities
+{
+public:
+  // Capabilities of the current GL context (queried on the first call).
+  static const GLCapabilities & Get();
+
+  // Whether the context exposes the extension (e.g. "GL_KHR_parallel_shader_compile").
+  bool HasExtension(const std::string & name) const;
+
+  // KHR/ARB_parallel_shader_compile: shaders compile in driver threads, and the completion of
+  // a build can be polled (GL_COMPLETION_STATUS_KHR) without blocking.
+  bool HasParallelShaderCompile() const { return mParallelShaderCompile; }
+
+  // GL 4.5 or ARB_direct_state_access: objects are created with glCreate*() and edited by name
+  // (glNamedBufferSubData(), glTextureSubImage2D(), glVertexArrayAttribFormat(), ...), without
+  // binding them first, and buffers/textures can have immutable storage.
+  bool HasDirectStateAccess() const { return mDirectStateAccess; }
+
+  // GL 4.3 or ARB_vertex_attrib_binding: the vertex format of a vertex array is separate from
+  // its buffers (glVertexAttribFormat(), glBindVertexBuffer()).
+  bool HasVertexAttribBinding() const { return mVertexAttribBinding; }
+
+  // GL 4.3 (shader storage buffers, glMultiDrawElementsIndirect()) and
+  // ARB_shader_draw_parameters (gl_DrawIDARB): vertex shaders can fetch their vertices from
+  // storage buffers, for many draws at once (see gloo::GeometryBuffer).
+  bool HasVertexPulling() const { return mVertexPulling; }
+
+  // GL 4.3 or ARB_copy_image: texels are copied between textures (glCopyImageSubData()) without
+  // a framebuffer or a draw.
+  bool HasCopyImage() const { return mCopyImage; }
+
+  // GL 4.4 or ARB_buffer_storage: buffers with immutable storage (glBufferStorage()) can stay
+  // mapped while the GPU reads them (GL_MAP_PERSISTENT_BIT), e.g. gloo::UniformRingBuffer.
+  bool HasBufferStorage() const { return mBufferStorage; }
+
+  // Getters.
+  GLint GetMajorVersion() const { return mMajorVersion; }
+  GLint GetMinorVersion() const { return mMinorVersion; }
+
+private:
+  GLCapabilities();
+  GLCapabilities(const GLCapabilities &) = delete;
+  GLCapabilities & operator=(const GLCapabilities &) = delete;
+
+  std::vector<std::string> mExtensions;  // Sorted.
+  GLint mMajorVersion { 0 };
+  GLint mMinorVersion { 0 };
+  bool mParallelShaderCompile { false };
+  bool mDirectStateAccess { false };
+  bool mVertexAttribBinding { false };
+  bool mVertexPulling { false };
+  bool mCopyImage { false };
+  bool mBufferStorage { false };
+};
+
+}  // namespace gloo.
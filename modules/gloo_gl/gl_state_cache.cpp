@@ -0,0 +1,329 @@
+#include "gl_state_cache.h"
+
+namespace gloo
+{
+
+const int GLStateCache::kMaxTextureUnits;
+const int GLStateCache::kMaxVertexBufferBindings;
+const int GLStateCache::kMaxUniformBufferBindings;
+const GLuint GLStateCache::kUnknown;
+const int GLStateCache::kNumBufferTargets;
+const int GLStateCache::kNumTextureTargets;
+const int GLStateCache::kNumCapabilities;
+
+GLStateCache & GLStateCache::Get()
+{
+  static GLStateCache cache;
+  return cache;
+}
+
+void GLStateCache::Invalidate()
+{
+  mProgram = kUnknown;
+  mVertexArray = kUnknown;
+  mActiveTexture = kUnknown;
+
+  for (GLuint & buffer : mBuffers)
+    buffer = kUnknown;
+
+  for (UniformBufferBinding & binding : mUniformBuffers)
+    binding.mBuffer = kUnknown;
+
+  GLStateCache::ForgetVertexArrayState();
+
+  for (int u = 0; u < kMaxTextureUnits; u++)
+  {
+    for (int t = 0; t < kNumTextureTargets; t++)
+      mTextures[u][t] = kUnknown;
+  }
+
+  for (GLuint & capability : mCapabilities)
+    capability = kUnknown;
+
+  mDepthFunc = kUnknown;
+  mDepthMask = kUnknown;
+  for (int i = 0; i < 3; i++)
+  {
+    mStencilFunc[i] = kUnknown;
+    mStencilOp[i] = kUnknown;
+  }
+
+  mBlendSource = kUnknown;
+  mBlendDestination = kUnknown;
+  mBlendEquation = kUnknown;
+  mCullFace = kUnknown;
+  mFrontFace = kUnknown;
+  mPolygonMode = kUnknown;
+  mViewportKnown = false;
+}
+
+// ------------------------------------------------------------------------------------------------
+// -> Bindings.
+
+void GLStateCache::BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset,
+                                   GLsizeiptr size)
+{
+  if (!GLStateCache::ChangesIndexed(target, index, buffer, offset, size))
+    return;
+
+  glBindBufferRange(target, index, buffer, offset, size);
+
+  // It binds the generic binding point of the target as well.
+  const int t = GLStateCache::GetBufferTargetIndex(target);
+  if (t >= 0)
+    mBuffers[t] = buffer;
+}
+
+void GLStateCache::BindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+  if (!GLStateCache::ChangesIndexed(target, index, buffer, 0, 0))
+    return;
+
+  glBindBufferBase(target, index, buffer);
+
+  const int t = GLStateCache::GetBufferTargetIndex(target);
+  if (t >= 0)
+    mBuffers[t] = buffer;
+}
+
+void GLStateCache::BindVertexBuffer(GLuint binding, GLuint buffer, GLintptr offset,
+                                    GLsizei stride)
+{
+  if (binding >= kMaxVertexBufferBindings)
+  {
+    mStats.mIssued++;
+    glBindVertexBuffer(binding, buffer, offset, stride);
+    return;
+  }
+
+  VertexBufferBinding & cached = mVertexBuffers[binding];
+  if ((cached.mBuffer == buffer) && (cached.mOffset == offset) && (cached.mStride == stride))
+  {
+    mStats.mSkipped++;
+    return;
+  }
+
+  cached.mBuffer = buffer;
+  cached.mOffset = offset;
+  cached.mStride = stride;
+  mStats.mIssued++;
+  glBindVertexBuffer(binding, buffer, offset, stride);
+}
+
+void GLStateCache::ForgetVertexArrayState()
+{
+  mBuffers[GLStateCache::GetBufferTargetIndex(GL_ELEMENT_ARRAY_BUFFER)] = kUnknown;
+
+  for (VertexBufferBinding & binding : mVertexBuffers)
+    binding.mBuffer = kUnknown;
+}
+
+// ------------------------------------------------------------------------------------------------
+// -> Fixed-function state.
+
+int GLStateCache::GetCapabilityIndex(GLenum capability)
+{
+  switch (capability)
+  {
+    case GL_DEPTH_TEST:          return 0;
+    case GL_BLEND:               return 1;
+    case GL_CULL_FACE:           return 2;
+    case GL_SCISSOR_TEST:        return 3;
+    case GL_STENCIL_TEST:        return 4;
+    case GL_POLYGON_OFFSET_FILL: return 5;
+    case GL_DEPTH_CLAMP:         return 6;
+    default: return -1;
+  }
+}
+
+void GLStateCache::SetCapability(GLenum capability, bool enabled)
+{
+  const int index = GLStateCache::GetCapabilityIndex(capability);
+  if ((index >= 0) && !GLStateCache::Changes(mCapabilities[index], enabled ? GL_TRUE : GL_FALSE))
+    return;
+
+  if (index < 0)
+    mStats.mIssued++;
+
+  if (enabled)
+    glEnable(capability);
+  else
+    glDisable(capability);
+}
+
+void GLStateCache::DepthFunc(GLenum function)
+{
+  if (GLStateCache::Changes(mDepthFunc, function))
+    glDepthFunc(function);
+}
+
+void GLStateCache::DepthMask(GLboolean flag)
+{
+  if (GLStateCache::Changes(mDepthMask, flag))
+    glDepthMask(flag);
+}
+
+void GLStateCache::StencilFunc(GLenum function, GLint reference, GLuint mask)
+{
+  if ((mStencilFunc[0] == function) && (mStencilFunc[1] == static_cast<GLuint>(reference)) &&
+      (mStencilFunc[2] == mask))
+  {
+    mStats.mSkipped++;
+    return;
+  }
+
+  mStencilFunc[0] = function;
+  mStencilFunc[1] = static_cast<GLuint>(reference);
+  mStencilFunc[2] = mask;
+  mStats.mIssued++;
+  glStencilFunc(function, reference, mask);
+}
+
+void GLStateCache::StencilOp(GLenum stencilFail, GLenum depthFail, GLenum depthPass)
+{
+  if ((mStencilOp[0] == stencilFail) && (mStencilOp[1] == depthFail) &&
+      (mStencilOp[2] == depthPass))
+  {
+    mStats.mSkipped++;
+    return;
+  }
+
+  mStencilOp[0] = stencilFail;
+  mStencilOp[1] = depthFail;
+  mStencilOp[2] = depthPass;
+  mStats.mIssued++;
+  glStencilOp(stencilFail, depthFail, depthPass);
+}
+
+void GLStateCache::BlendFunc(GLenum sourceFactor, GLenum destinationFactor)
+{
+  if ((mBlendSource == sourceFactor) && (mBlendDestination == destinationFactor))
+  {
+    mStats.mSkipped++;
+    return;
+  }
+
+  mBlendSource = sourceFactor;
+  mBlendDestination = destinationFactor;
+  mStats.mIssued++;
+  glBlendFunc(sourceFactor, destinationFactor);
+}
+
+void GLStateCache::BlendEquation(GLenum mode)
+{
+  if (GLStateCache::Changes(mBlendEquation, mode))
+    glBlendEquation(mode);
+}
+
+void GLStateCache::CullFace(GLenum mode)
+{
+  if (GLStateCache::Changes(mCullFace, mode))
+    glCullFace(mode);
+}
+
+void GLStateCache::FrontFace(GLenum mode)
+{
+  if (GLStateCache::Changes(mFrontFace, mode))
+    glFrontFace(mode);
+}
+
+void GLStateCache::PolygonMode(GLenum mode)
+{
+  if (GLStateCache::Changes(mPolygonMode, mode))
+    glPolygonMode(GL_FRONT_AND_BACK, mode);
+}
+
+void GLStateCache::Viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+  if (mViewportKnown && (mViewport[0] == x) && (mViewport[1] == y) &&
+      (mViewport[2] == width) && (mViewport[3] == height))
+  {
+    mStats.mSkipped++;
+    return;
+  }
+
+  mViewport[0] = x;
+  mViewport[1] = y;
+  mViewport[2] = width;
+  mViewport[3] = height;
+  mViewportKnown = true;
+  mStats.mIssued++;
+  glViewport(x, y, width, height);
+}
+
+// ------------------------------------------------------------------------------------------------
+// -> Deletion.
+// GL unbinds deleted objects from the current context, and recycles their names: the cache
+// must not believe that a new object with the same name is bound already.
+
+void GLStateCache::DeleteProgram(GLuint program)
+{
+  // A program in use is only flagged for deletion (it stays current), but its name is not
+  // reused until then either, so the cached binding remains valid.
+  mStats.mIssued++;
+  glDeleteProgram(program);
+}
+
+void GLStateCache::DeleteVertexArrays(GLsizei n, const GLuint* vertexArrays)
+{
+  for (GLsizei i = 0; i < n; i++)
+  {
+    if (vertexArrays[i] == mVertexArray)  // Reverts to vertex array 0, and its bindings.
+    {
+      mVertexArray = 0;
+      GLStateCache::ForgetVertexArrayState();
+    }
+  }
+
+  mStats.mIssued++;
+  glDeleteVertexArrays(n, vertexArrays);
+}
+
+void GLStateCache::DeleteBuffers(GLsizei n, const GLuint* buffers)
+{
+  for (GLsizei i = 0; i < n; i++)
+  {
+    for (GLuint & buffer : mBuffers)
+    {
+      if (buffer == buffers[i])
+        buffer = 0;
+    }
+
+    // GL resets the indexed bindings to it.
+    for (UniformBufferBinding & binding : mUniformBuffers)
+    {
+      if (binding.mBuffer == buffers[i])
+        binding = { 0, 0, 0 };
+    }
+
+    // Detached from the bound vertex array only.
+    for (VertexBufferBinding & binding : mVertexBuffers)
+    {
+      if (binding.mBuffer == buffers[i])
+        binding.mBuffer = kUnknown;
+    }
+  }
+
+  mStats.mIssued++;
+  glDeleteBuffers(n, buffers);
+}
+
+void GLStateCache::DeleteTextures(GLsizei n, const GLuint* textures)
+{
+  for (GLsizei i = 0; i < n; i++)
+  {
+    for (int u = 0; u < kMaxTextureUnits; u++)
+    {
+      for (int t = 0; t < kNumTextureTargets; t++)
+      {
+        if (mTextures[u][t] == textures[i])
+          mTextures[u][t] = 0;
+      }
+    }
+  }
+
+  mStats.mIssued++;
+  glDeleteTextures(n, textures);
+}
+
+}  // namespace gloo.
@@ -0,0 +1,318 @@
+// + ======================================== +
+// |         gl-oo-interface library          |
+// |             Module: GLOO GL.             |
+// |        Author: Rodrigo Castiel, 2016.    |
+// + ======================================== +
+//
+// gloo::GLStateCache shadows the OpenGL state that gloo changes most often (program, vertex
+// array, buffer bindings per target, texture bindings per unit, depth/stencil/blend/raster state
+// and viewport) and drops the calls that would set it to the value it already has. All gloo
+// classes go through it, so e.g. rendering many meshes with the same program and texture only
+// issues glUseProgram()/glBindTexture() once.
+//
+// Usage:
+//   GLStateCache & gl = GLStateCache::Get();
+//   gl.UseProgram(program);               // Instead of glUseProgram(program).
+//   gl.BindVertexArray(vao);
+//   gl.BindTexture(GL_TEXTURE0, GL_TEXTURE_2D, texture);
+//   gl.Enable(GL_DEPTH_TEST);
+//   ...
+//   gl.DeleteBuffers(1, &buffer);         // Instead of glDeleteBuffers() (names are recycled).
+//
+//   const GLStateCache::Stats & stats = gl.GetStats();  // Issued vs. skipped calls.
+//   gl.ResetStats();                                     // E.g. once per frame.
+//
+// The cache assumes a single GL context, used by one thread. It starts with all state unknown
+// (the first call of each kind is always issued). Code that changes the same state with raw GL
+// calls must call Invalidate() afterwards, or the cache will skip calls it should not.
+//
+// The element array buffer and vertex buffer bindings (glBindVertexBuffer()) belong to the bound
+// vertex array: they are forgotten whenever the vertex array changes. Indexed bindings
+// (glBindBufferRange(), glBindBufferBase()) update the generic binding of their target, as GL
+// does; those of GL_UNIFORM_BUFFER are cached too (buffer, offset and size), so a renderer can
+// re-bind its uniform blocks before each draw and only pay for the ones another renderer moved.
+
+#pragma once
+
+#include <cstdint>
+
+#include "gloo/gl_header.h"
+
+namespace gloo
+{
+
+class GLStateCache
+{
+public:
+  static const int kMaxTextureUnits = 32;
+  static const int kMaxVertexBufferBindings = 16;  // GL_MAX_VERTEX_ATTRIB_BINDINGS is >= 16.
+  static const int kMaxUniformBufferBindings = 36;  // GL_MAX_UNIFORM_BUFFER_BINDINGS is >= 36.
+
+  struct Stats
+  {
+    uint64_t mIssued { 0 };   // GL calls that reached the driver.
+    uint64_t mSkipped { 0 };  // Redundant calls that were dropped.
+  };
+
+  // Cache of the current GL context, shared by the library.
+  static GLStateCache & Get();
+
+  // Forgets all state (the next call of each kind is issued).
+  void Invalidate();
+
+  // Bindings.
+  void UseProgram(GLuint program);
+  void BindVertexArray(GLuint vertexArray);
+  void BindBuffer(GLenum target, GLuint buffer);
+  void BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset,
+                       GLsizeiptr size);
+  void BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+  void BindVertexBuffer(GLuint binding, GLuint buffer, GLintptr offset, GLsizei stride);
+  void ActiveTexture(GLenum unit);                               // unit = GL_TEXTURE0 + i.
+  void BindTexture(GLenum unit, GLenum target, GLuint texture);  // Activates unit if needed.
+
+  // Fixed-function state.
+  void Enable(GLenum capability);
+  void Disable(GLenum capability);
+  void DepthFunc(GLenum function);
+  void DepthMask(GLboolean flag);
+  void StencilFunc(GLenum function, GLint reference, GLuint mask);
+  void StencilOp(GLenum stencilFail, GLenum depthFail, GLenum depthPass);
+  void BlendFunc(GLenum sourceFactor, GLenum destinationFactor);
+  void BlendEquation(GLenum mode);
+  void CullFace(GLenum mode);
+  void FrontFace(GLenum mode);
+  void PolygonMode(GLenum mode);  // Of both faces (GL_FRONT_AND_BACK).
+  void Viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+  // Deletes the objects and forgets the bindings to them.
+  void DeleteProgram(GLuint program);
+  void DeleteVertexArrays(GLsizei n, const GLuint* vertexArrays);
+  void DeleteBuffers(GLsizei n, const GLuint* buffers);
+  void DeleteTextures(GLsizei n, const GLuint* textures);
+
+  // Getters.
+  const Stats & GetStats() const { return mStats; }
+  bool GetViewport(GLint viewport[4]) const;  // False if the viewport is not known.
+  void ResetStats() { mStats = Stats(); }
+
+private:
+  static const GLuint kUnknown = 0xFFFFFFFF;  // State not known (any value issues the call).
+  static const int kNumBufferTargets = 10;
+  static const int kNumTextureTargets = 4;
+  static const int kNumCapabilities = 7;
+
+  GLStateCache() { GLStateCache::Invalidate(); }
+  GLStateCache(const GLStateCache &) = delete;
+  GLStateCache & operator=(const GLStateCache &) = delete;
+
+  // Indices into the tables below, or -1 for targets/capabilities that are not cached.
+  static int GetBufferTargetIndex(GLenum target);
+  static int GetTextureTargetIndex(GLenum target);
+  static int GetCapabilityIndex(GLenum capability);
+
+  void SetCapability(GLenum capability, bool enabled);
+
+  // Forgets the bindings stored in the vertex array (when another one is bound).
+  void ForgetVertexArrayState();
+
+  // Counts a call, and returns whether it must be issued.
+  bool Changes(GLuint & cached, GLuint value);
+  bool ChangesIndexed(GLenum target, GLuint index, GLuint buffer, GLintptr offset,
+                      GLsizeiptr size);
+
+  GLuint mProgram;
+  GLuint mVertexArray;
+  GLuint mBuffers[kNumBufferTargets];
+  GLuint mActiveTexture;
+  GLuint mTextures[kMaxTextureUnits][kNumTextureTargets];
+
+  struct VertexBufferBinding
+  {
+    GLuint mBuffer;  // kUnknown if not known.
+    GLintptr mOffset;
+    GLsizei mStride;
+  };
+  VertexBufferBinding mVertexBuffers[kMaxVertexBufferBindings];  // Of the bound vertex array.
+
+  struct UniformBufferBinding
+  {
+    GLuint mBuffer;  // kUnknown if not known.
+    GLintptr mOffset;
+    GLsizeiptr mSize;  // 0 for glBindBufferBase() (the whole buffer).
+  };
+  UniformBufferBinding mUniformBuffers[kMaxUniformBufferBindings];
+
+  GLuint mCapabilities[kNumCapabilities];  // GL_TRUE, GL_FALSE or kUnknown.
+  GLuint mDepthFunc;
+  GLuint mDepthMask;
+  GLuint mStencilFunc[3];  // Function, reference and mask.
+  GLuint mStencilOp[3];    // Stencil fail, depth fail and depth pass.
+  GLuint mBlendSource;
+  GLuint mBlendDestination;
+  GLuint mBlendEquation;
+  GLuint mCullFace;
+  GLuint mFrontFace;
+  GLuint mPolygonMode;
+  GLint mViewport[4];
+  bool mViewportKnown;
+
+  Stats mStats;
+};
+
+// =========== IMPLEMENTATION OF INLINE METHODS ===================================================
+
+inline
+bool GLStateCache::Changes(GLuint & cached, GLuint value)
+{
+  if (cached == value)
+  {
+    mStats.mSkipped++;
+    return false;
+  }
+
+  cached = value;
+  mStats.mIssued++;
+  return true;
+}
+
+inline
+bool GLStateCache::ChangesIndexed(GLenum target, GLuint index, GLuint buffer, GLintptr offset,
+                                  GLsizeiptr size)
+{
+  if ((target == GL_UNIFORM_BUFFER) && (index < kMaxUniformBufferBindings))
+  {
+    UniformBufferBinding & cached = mUniformBuffers[index];
+    if ((cached.mBuffer == buffer) && (cached.mOffset == offset) && (cached.mSize == size))
+    {
+      mStats.mSkipped++;
+      return false;
+    }
+
+    cached.mBuffer = buffer;
+    cached.mOffset = offset;
+    cached.mSize = size;
+  }
+
+  mStats.mIssued++;
+  return true;
+}
+
+inline
+int GLStateCache::GetBufferTargetIndex(GLenum target)
+{
+  switch (target)
+  {
+    case GL_ARRAY_BUFFER:         return 0;
+    case GL_ELEMENT_ARRAY_BUFFER: return 1;
+    case GL_UNIFORM_BUFFER:       return 2;
+    case GL_COPY_READ_BUFFER:     return 3;
+    case GL_COPY_WRITE_BUFFER:    return 4;
+    case GL_PIXEL_PACK_BUFFER:    return 5;
+    case GL_PIXEL_UNPACK_BUFFER:  return 6;
+    case GL_TEXTURE_BUFFER:       return 7;
+    case GL_DRAW_INDIRECT_BUFFER: return 8;
+#ifdef GL_SHADER_STORAGE_BUFFER
+    case GL_SHADER_STORAGE_BUFFER: return 9;
+#endif
+    default: return -1;
+  }
+}
+
+inline
+int GLStateCache::GetTextureTargetIndex(GLenum target)
+{
+  switch (target)
+  {
+    case GL_TEXTURE_2D:       return 0;
+    case GL_TEXTURE_CUBE_MAP: return 1;
+    case GL_TEXTURE_2D_ARRAY: return 2;
+    case GL_TEXTURE_3D:       return 3;
+    default: return -1;
+  }
+}
+
+inline
+void GLStateCache::UseProgram(GLuint program)
+{
+  if (GLStateCache::Changes(mProgram, program))
+    glUseProgram(program);
+}
+
+inline
+void GLStateCache::BindVertexArray(GLuint vertexArray)
+{
+  if (GLStateCache::Changes(mVertexArray, vertexArray))
+  {
+    glBindVertexArray(vertexArray);
+    GLStateCache::ForgetVertexArrayState();
+  }
+}
+
+inline
+void GLStateCache::BindBuffer(GLenum target, GLuint buffer)
+{
+  const int index = GLStateCache::GetBufferTargetIndex(target);
+  if (index < 0)
+  {
+    mStats.mIssued++;
+    glBindBuffer(target, buffer);
+  }
+  else if (GLStateCache::Changes(mBuffers[index], buffer))
+  {
+    glBindBuffer(target, buffer);
+  }
+}
+
+inline
+void GLStateCache::ActiveTexture(GLenum unit)
+{
+  if (GLStateCache::Changes(mActiveTexture, unit))
+    glActiveTexture(unit);
+}
+
+inline
+void GLStateCache::BindTexture(GLenum unit, GLenum target, GLuint texture)
+{
+  const int u = static_cast<int>(unit) - GL_TEXTURE0;
+  const int t = GLStateCache::GetTextureTargetIndex(target);
+  if ((u < 0) || (u >= kMaxTextureUnits) || (t < 0))
+  {
+    GLStateCache::ActiveTexture(unit);
+    mStats.mIssued++;
+    glBindTexture(target, texture);
+  }
+  else if (mTextures[u][t] != texture)
+  {
+    GLStateCache::ActiveTexture(unit);
+    GLStateCache::Changes(mTextures[u][t], texture);
+    glBindTexture(target, texture);
+  }
+  else
+  {
+    mStats.mSkipped++;
+  }
+}
+
+inline
+bool GLStateCache::GetViewport(GLint viewport[4]) const
+{
+  for (int i = 0; i < 4; i++)
+    viewport[i] = mViewport[i];
+
+  return mViewportKnown;
+}
+
+inline
+void GLStateCache::Enable(GLenum capability)
+{
+  GLStateCache::SetCapability(capability, true);
+}
+
+inline
+void GLStateCache::Disable(GLenum capability)
+{
+  GLStateCache::SetCapability(capability, false);
+}
+
+}  // namespace gloo.
@@ -0,0 +1,243 @@
+#include "job_system.h"
+
+#include <iostream>
+
+namespace gloo
+{
+
+const uint32_t JobSystem::kMaxJobsPerWorker;
+const size_t JobSystem::kMaxJobSize;
+const unsigned JobSystem::kSplitQueueSize;
+
+namespace
+{
+
+const int kNumSpins = 64;  // Failed searches for jobs before a worker goes to sleep.
+
+// The system (if any) the calling thread works for, and its index there.
+thread_local const JobSystem* tJobSystem = nullptr;
+thread_local int tWorkerIndex = -1;
+
+uint32_t XorShift(uint32_t & state)
+{
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+}  // namespace.
+
+// ------------------------------------------------------------------------------------------------
+// -> Construction.
+
+JobSystem::JobSystem(unsigned numWorkers)
+{
+  if (numWorkers == 0)
+    numWorkers = std::max(1u, std::thread::hardware_concurrency());
+
+  for (unsigned w = 0; w < numWorkers; w++)
+  {
+    std::unique_ptr<Worker> worker(new Worker());
+    worker->mJobs.reset(new Job[kMaxJobsPerWorker]);
+    worker->mRandom = 2654435769u * (w + 1);  // Any non-zero seed.
+    mWorkers.push_back(std::move(worker));
+  }
+
+  // The calling thread is worker 0, unless it already works for another system.
+  if (!tJobSystem)
+  {
+    tJobSystem = this;
+    tWorkerIndex = 0;
+  }
+
+  for (unsigned w = 1; w < numWorkers; w++)
+    mWorkers[w]->mThread = std::thread(&JobSystem::WorkerLoop, this, static_cast<int>(w));
+}
+
+JobSystem::~JobSystem()
+{
+  {
+    std::lock_guard<std::mutex> lock(mSleepMutex);
+    mStopping = true;
+  }
+  mWakeUp.notify_all();
+
+  for (std::unique_ptr<Worker> & worker : mWorkers)
+  {
+    if (worker->mThread.joinable())
+      worker->mThread.join();
+  }
+
+  if (tJobSystem == this)
+  {
+    tJobSystem = nullptr;
+    tWorkerIndex = -1;
+  }
+}
+
+JobSystem & JobSystem::InitializeDefault(unsigned numWorkers)
+{
+  static JobSystem system(numWorkers);
+  return system;
+}
+
+JobSystem & JobSystem::GetDefault()
+{
+  JobSystem & system = JobSystem::InitializeDefault();
+
+  // Its jobs would silently run serially on this thread.
+  static std::atomic<bool> sWarned { false };
+  if ((system.GetWorkerIndex() < 0) && !sWarned.exchange(true))
+  {
+    std::cerr << "WARNING JobSystem::GetDefault: called from a thread that is not a worker, "
+              << "its jobs run serially (call JobSystem::InitializeDefault() from the main "
+              << "thread first).\n";
+  }
+
+  return system;
+}
+
+int JobSystem::GetWorkerIndex() const
+{
+  return (tJobSystem == this) ? tWorkerIndex : -1;
+}
+
+// ------------------------------------------------------------------------------------------------
+// -> Scheduling.
+
+JobSystem::Job* JobSystem::AllocateJob(int worker)
+{
+  // Slots are handed out in order, skipping those still in flight (e.g. a long job that is
+  // running further up this very stack).
+  Worker & owner = *mWorkers[worker];
+  for (uint32_t k = 0; k < kMaxJobsPerWorker; k++)
+  {
+    Job* job = &owner.mJobs[owner.mNextJob & (kMaxJobsPerWorker - 1)];
+    owner.mNextJob++;
+    if (!job->mBusy.load(std::memory_order_acquire))
+    {
+      job->mBusy.store(true, std::memory_order_relaxed);
+      return job;
+    }
+  }
+
+  return nullptr;
+}
+
+void JobSystem::Submit(int worker, Job* job)
+{
+  if (!mWorkers[worker]->mQueue.Push(job))  // Full: run it right away instead.
+  {
+    JobSystem::Execute(job);
+    return;
+  }
+
+  // Pairs with the fence of a worker going to sleep: either it sees this job, or this thread
+  // sees it sleeping (and the notification cannot be lost, since it is sent under the lock).
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (mNumSleeping.load(std::memory_order_relaxed) > 0)
+  {
+    std::lock_guard<std::mutex> lock(mSleepMutex);
+    mWakeUp.notify_one();
+  }
+}
+
+void JobSystem::Execute(Job* job)
+{
+  JobCounter* counter = job->mCounter;
+  job->mRun(job);
+
+  // The slot may be reused as soon as it is released, so the counter was read before.
+  job->mBusy.store(false, std::memory_order_release);
+  counter->mValue.fetch_sub(1, std::memory_order_release);
+}
+
+JobSystem::Job* JobSystem::FindJob(int worker)
+{
+  Worker & self = *mWorkers[worker];
+  Job* job = nullptr;
+  if (self.mQueue.Pop(&job))
+    return job;
+
+  // Steal from the other workers, starting at a random one.
+  const uint32_t numWorkers = static_cast<uint32_t>(mWorkers.size());
+  const uint32_t first = XorShift(self.mRandom) % numWorkers;
+  for (uint32_t k = 0; k < numWorkers; k++)
+  {
+    const uint32_t victim = (first + k) % numWorkers;
+    if ((victim != static_cast<uint32_t>(worker)) && mWorkers[victim]->mQueue.Steal(&job))
+      return job;
+  }
+
+  return nullptr;
+}
+
+void JobSystem::Wait(JobCounter & counter)
+{
+  const int worker = JobSystem::GetWorkerIndex();
+  while (counter.mValue.load(std::memory_order_acquire) > 0)
+  {
+    Job* job = (worker >= 0) ? JobSystem::FindJob(worker) : nullptr;
+    if (job)
+      JobSystem::Execute(job);
+    else
+      std::this_thread::yield();
+  }
+}
+
+bool JobSystem::ShouldSplit() const
+{
+  const int worker = JobSystem::GetWorkerIndex();
+  return (worker >= 0) && (mWorkers.size() > 1) &&
+         (mWorkers[worker]->mQueue.GetSize() < kSplitQueueSize);
+}
+
+bool JobSystem::HasQueuedJobs() const
+{
+  for (const std::unique_ptr<Worker> & worker : mWorkers)
+  {
+    if (worker->mQueue.GetSize() > 0)
+      return true;
+  }
+  return false;
+}
+
+// ------------------------------------------------------------------------------------------------
+// -> Workers.
+
+void JobSystem::WorkerLoop(int worker)
+{
+  tJobSystem = this;
+  tWorkerIndex = worker;
+
+  int numFailures = 0;
+  while (true)
+  {
+    Job* job = JobSystem::FindJob(worker);
+    if (job)
+    {
+      JobSystem::Execute(job);
+      numFailures = 0;
+      continue;
+    }
+
+    if (++numFailures < kNumSpins)
+    {
+      std::this_thread::yield();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(mSleepMutex);
+    mNumSleeping.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    mWakeUp.wait(lock, [this]() { return mStopping || JobSystem::HasQueuedJobs(); });
+    mNumSleeping.fetch_sub(1, std::memory_order_relaxed);
+
+    if (mStopping)
+      return;
+    numFailures = 0;
+  }
+}
+
+}  // namespace gloo.
@@ -0,0 +1,284 @@
+// + ======================================== +
+// |         gl-oo-interface library          |
+// |            Module: GLOO Jobs.            |
+// |        Author: Rodrigo Castiel, 2016.    |
+// + ======================================== +
+//
+// gloo::JobSystem is a work-stealing thread pool, and the engine of all parallel work in the
+// library (BVH and octree builds, scene graph updates, ...). Each worker owns a deque of jobs
+// (gloo::WorkStealingDeque): it runs its own jobs newest first and, when it runs out of them,
+// steals the oldest jobs of a random worker. Idle workers sleep until new jobs are queued.
+//
+// A job is a function object (typically a lambda capturing by reference) stored inside the
+// job itself, and jobs come from a fixed pool per worker: running a job never allocates.
+// Dependencies are expressed with counters (gloo::JobCounter): Run() increments a counter,
+// which is decremented when the job finishes, and Wait() returns once it reaches zero. Waiting
+// threads run other jobs in the meantime, so jobs may themselves run and wait for other jobs.
+//
+// Usage:
+//   JobSystem::InitializeDefault();              // Once, from the main thread, at startup.
+//   JobSystem & jobs = JobSystem::GetDefault();  // One worker per hardware thread.
+//
+//   JobCounter counter;
+//   jobs.Run(counter, [&]() { BuildLeft(); });
+//   jobs.Run(counter, [&]() { BuildRight(); });
+//   jobs.Wait(counter);                          // Both are done (and their side effects seen).
+//
+//   // Splits [0, count) into ranges of at least 1024 elements, only as much as idle workers
+//   // can take.
+//   jobs.ParallelFor(count, 1024, [&](uint32_t begin, uint32_t end)
+//   {
+//     for (uint32_t i = begin; i < end; i++)
+//       out[i] = Process(in[i]);
+//   });
+//
+//   // Fixed split into (at most) numChunks chunks, for per-chunk partial results.
+//   jobs.ParallelChunks(numChunks, count, 1 << 15, [&](uint32_t begin, uint32_t end,
+//                                                      unsigned chunk) { ... });
+//
+// The thread that creates a JobSystem is worker 0 (it runs jobs while it waits); the others are
+// background threads. Threads that are not workers may use the system as well, but their jobs
+// run right away on the calling thread, as do the jobs of a worker that already has
+// kMaxJobsPerWorker jobs in flight. Counters must outlive the Wait() on them. The default
+// system is created by InitializeDefault(), or else by the first GetDefault(): whichever thread
+// that is becomes its worker 0, so InitializeDefault() should be called from the main thread.
+// GetDefault() warns (once) when a thread that is not a worker gets the default system.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "work_stealing_deque.h"
+
+namespace gloo
+{
+
+// Number of unfinished jobs of a group.
+class JobCounter
+{
+public:
+  JobCounter() { }
+  ~JobCounter() { }
+
+  bool IsDone() const { return mValue.load(std::memory_order_acquire) == 0; }
+
+private:
+  JobCounter(const JobCounter &) = delete;
+  JobCounter & operator=(const JobCounter &) = delete;
+
+  std::atomic<int> mValue { 0 };
+
+  friend class JobSystem;
+};
+
+class JobSystem
+{
+public:
+  static const uint32_t kMaxJobsPerWorker = 1024;  // Jobs in flight created by one worker.
+  static const size_t kMaxJobSize = 96;            // Bytes available for a function object.
+
+  // numWorkers = 0 creates one worker per hardware thread (the calling thread included).
+  explicit JobSystem(unsigned numWorkers = 0);
+  ~JobSystem();
+
+  // Creates the system shared by the library, with the calling thread as worker 0. Later
+  // calls (and numWorkers) have no effect.
+  static JobSystem & InitializeDefault(unsigned numWorkers = 0);
+
+  // System shared by the library, created by the first call unless InitializeDefault() was.
+  static JobSystem & GetDefault();
+
+  // Queues function() and increments the counter, which is decremented when it finishes.
+  template <class Function>
+  void Run(JobCounter & counter, const Function & function);
+
+  // Runs other jobs until the counter reaches zero.
+  void Wait(JobCounter & counter);
+
+  // Calls function(begin, end) over ranges that cover [0, count), and returns when all are
+  // done. Ranges are split in halves while they are larger than minGrainSize and the queue of
+  // the worker is (nearly) empty, so the grain adapts to the load of the other workers.
+  template <class Function>
+  void ParallelFor(uint32_t count, uint32_t minGrainSize, const Function & function);
+
+  // Calls function(begin, end, chunk) over at most numChunks chunks of at least minChunkSize
+  // elements. The split only depends on the arguments, so chunk indices (in [0, numChunks))
+  // can address per-chunk partial results deterministically.
+  template <class Function>
+  void ParallelChunks(unsigned numChunks, uint32_t count, uint32_t minChunkSize,
+                      const Function & function);
+
+  // Getters.
+  unsigned GetNumWorkers() const { return static_cast<unsigned>(mWorkers.size()); }
+
+  // numThreads if it is not zero, GetNumWorkers() otherwise.
+  unsigned GetNumThreads(unsigned numThreads) const;
+
+  // Index of the calling thread in [0, GetNumWorkers()), or -1 if it is not a worker.
+  int GetWorkerIndex() const;
+
+private:
+  static const unsigned kSplitQueueSize = 2;  // ParallelFor stops splitting at this many jobs.
+
+  struct Job
+  {
+    void (*mRun)(Job* job);          // Calls and destroys the function object in mData.
+    JobCounter* mCounter;
+    std::atomic<bool> mBusy { false };  // Queued or running: the slot cannot be reused.
+    alignas(16) unsigned char mData[kMaxJobSize];
+  };
+
+  struct Worker
+  {
+    WorkStealingDeque<Job*, kMaxJobsPerWorker> mQueue;
+    std::unique_ptr<Job[]> mJobs;    // Pool, used as a ring buffer.
+    uint32_t mNextJob { 0 };
+    uint32_t mRandom { 0 };          // State of the victim selection.
+    std::thread mThread;
+  };
+
+  JobSystem(const JobSystem &) = delete;
+  JobSystem & operator=(const JobSystem &) = delete;
+
+  template <class Function>
+  static void RunFunction(Job* job);
+
+  template <class Function>
+  void SplitRange(JobCounter & counter, uint32_t begin, uint32_t end, uint32_t grainSize,
+                  const Function & function);
+
+  // Returns a free job from the pool of the worker, or nullptr if all of them are in flight.
+  Job* AllocateJob(int worker);
+
+  // Queues a job of the calling worker and wakes up a sleeping worker, if any.
+  void Submit(int worker, Job* job);
+
+  void Execute(Job* job);
+
+  // Own jobs first, then stolen ones. nullptr if none was found.
+  Job* FindJob(int worker);
+
+  bool ShouldSplit() const;
+  bool HasQueuedJobs() const;
+
+  void WorkerLoop(int worker);
+
+  std::vector<std::unique_ptr<Worker>> mWorkers;
+
+  std::mutex mSleepMutex;
+  std::condition_variable mWakeUp;
+  std::atomic<int> mNumSleeping { 0 };
+  bool mStopping { false };           // Guarded by mSleepMutex.
+};
+
+// =========== IMPLEMENTATION OF INLINE METHODS ===================================================
+
+inline
+unsigned JobSystem::GetNumThreads(unsigned numThreads) const
+{
+  return (numThreads > 0) ? numThreads : JobSystem::GetNumWorkers();
+}
+
+template <class Function>
+void JobSystem::RunFunction(Job* job)
+{
+  Function* function = reinterpret_cast<Function*>(job->mData);
+  (*function)();
+  function->~Function();
+}
+
+template <class Function>
+void JobSystem::Run(JobCounter & counter, const Function & function)
+{
+  static_assert(sizeof(Function) <= kMaxJobSize,
+                "JobSystem::Run: function object too large (capture by reference instead).");
+  static_assert(alignof(Function) <= 16, "JobSystem::Run: function object over-aligned.");
+
+  const int worker = JobSystem::GetWorkerIndex();
+  Job* job = (worker >= 0) ? JobSystem::AllocateJob(worker) : nullptr;
+  if (!job)  // Not a worker, or too many jobs in flight: run it right away.
+  {
+    function();
+    return;
+  }
+
+  new (job->mData) Function(function);
+  job->mRun = &JobSystem::RunFunction<Function>;
+  job->mCounter = &counter;
+
+  counter.mValue.fetch_add(1, std::memory_order_relaxed);
+  JobSystem::Submit(worker, job);
+}
+
+template <class Function>
+void JobSystem::SplitRange(JobCounter & counter, uint32_t begin, uint32_t end,
+                           uint32_t grainSize, const Function & function)
+{
+  // Lazy binary splitting: the upper half is offered to other workers only while this worker
+  // has (almost) nothing queued, i.e. while some worker may be looking for work.
+  while ((end - begin > grainSize) && JobSystem::ShouldSplit())
+  {
+    const uint32_t middle = begin + (end - begin) / 2;
+    auto RunUpperHalf = [this, &counter, middle, end, grainSize, &function]()
+    {
+      JobSystem::SplitRange(counter, middle, end, grainSize, function);
+    };
+    JobSystem::Run(counter, RunUpperHalf);
+    end = middle;
+  }
+
+  function(begin, end);
+}
+
+template <class Function>
+void JobSystem::ParallelFor(uint32_t count, uint32_t minGrainSize, const Function & function)
+{
+  if (count == 0)
+    return;
+
+  // A few ranges per worker at most, so that splitting never costs more than the work itself.
+  const uint32_t grainSize = std::max(std::max(minGrainSize, 1u),
+                                      count / (8 * JobSystem::GetNumWorkers()));
+
+  JobCounter counter;
+  JobSystem::SplitRange(counter, 0, count, grainSize, function);
+  JobSystem::Wait(counter);
+}
+
+template <class Function>
+void JobSystem::ParallelChunks(unsigned numChunks, uint32_t count, uint32_t minChunkSize,
+                               const Function & function)
+{
+  numChunks = std::max(1u, std::min(numChunks, count / std::max(minChunkSize, 1u)));
+  if (numChunks == 1)
+  {
+    function(0u, count, 0u);
+    return;
+  }
+
+  JobCounter counter;
+  for (unsigned c = 1; c < numChunks; c++)
+  {
+    auto RunChunk = [&function, count, numChunks, c]()
+    {
+      const uint32_t begin = static_cast<uint32_t>(uint64_t(count) * c / numChunks);
+      const uint32_t end = static_cast<uint32_t>(uint64_t(count) * (c + 1) / numChunks);
+      function(begin, end, c);
+    };
+    JobSystem::Run(counter, RunChunk);
+  }
+
+  function(0u, static_cast<uint32_t>(uint64_t(count) / numChunks), 0u);
+  JobSystem::Wait(counter);
+}
+
+}  // namespace gloo.
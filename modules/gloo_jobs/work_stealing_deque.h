@@ -0,0 +1,138 @@
+// + ======================================== +
+// |         gl-oo-interface library          |
+// |            Module: GLOO Jobs.            |
+// |        Author: Rodrigo Castiel, 2016.    |
+// + ======================================== +
+//
+// gloo::WorkStealingDeque is a Chase-Lev deque of fixed capacity (a ring buffer that never
+// grows, so it never allocates). Its owner thread pushes and pops items at the bottom (LIFO,
+// which keeps the most recent -- and cache-hot -- work local), while any other thread may
+// steal items from the top (FIFO, which hands out the oldest and usually largest pieces of
+// work). Push and Pop are wait-free; Steal is lock-free.
+//
+// Usage (T must be trivially copyable, typically a pointer):
+//   WorkStealingDeque<Job*, 1024> queue;
+//   queue.Push(job);                      // Owner thread only. False if the deque is full.
+//   Job* job = nullptr;
+//   if (queue.Pop(&job)) { ... }          // Owner thread only.
+//   if (queue.Steal(&job)) { ... }        // Any thread.
+//
+// The memory orderings follow N. M. Le et al., "Correct and Efficient Work-Stealing for Weak
+// Memory Models" (PPoPP 2013).
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace gloo
+{
+
+template <class T, uint32_t Capacity>
+class WorkStealingDeque
+{
+  static_assert((Capacity > 0) && ((Capacity & (Capacity - 1)) == 0),
+                "WorkStealingDeque: the capacity must be a power of two.");
+
+public:
+  WorkStealingDeque() { }
+  ~WorkStealingDeque() { }
+
+  // Owner thread only.
+  bool Push(T item);
+  bool Pop(T* item);
+
+  // Any thread. Fails if the deque is empty or if another thread took the same item.
+  bool Steal(T* item);
+
+  // Number of items (only an estimate when read by threads other than the owner).
+  uint32_t GetSize() const;
+
+private:
+  WorkStealingDeque(const WorkStealingDeque &) = delete;
+  WorkStealingDeque & operator=(const WorkStealingDeque &) = delete;
+
+  static const uint32_t kMask = Capacity - 1;
+
+  // Thieves take from the top and the owner works at the bottom: they live on separate cache
+  // lines, so that pushes and pops do not slow down (and are not slowed down by) steals.
+  std::atomic<int64_t> mTop { 0 };
+  char mPadding0[64 - sizeof(std::atomic<int64_t>)];
+  std::atomic<int64_t> mBottom { 0 };
+  char mPadding1[64 - sizeof(std::atomic<int64_t>)];
+  std::atomic<T> mItems[Capacity];
+};
+
+// =========== IMPLEMENTATION OF INLINE METHODS ===================================================
+
+template <class T, uint32_t Capacity>
+inline
+bool WorkStealingDeque<T, Capacity>::Push(T item)
+{
+  const int64_t bottom = mBottom.load(std::memory_order_relaxed);
+  const int64_t top = mTop.load(std::memory_order_acquire);
+  if (bottom - top >= static_cast<int64_t>(Capacity))
+    return false;
+
+  mItems[bottom & kMask].store(item, std::memory_order_relaxed);
+  mBottom.store(bottom + 1, std::memory_order_release);  // Publishes the item to thieves.
+  return true;
+}
+
+template <class T, uint32_t Capacity>
+inline
+bool WorkStealingDeque<T, Capacity>::Pop(T* item)
+{
+  // Reserve the bottom item first, then check whether a thief got there.
+  const int64_t bottom = mBottom.load(std::memory_order_relaxed) - 1;
+  mBottom.store(bottom, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t top = mTop.load(std::memory_order_relaxed);
+
+  if (top > bottom)  // Empty.
+  {
+    mBottom.store(bottom + 1, std::memory_order_relaxed);
+    return false;
+  }
+
+  *item = mItems[bottom & kMask].load(std::memory_order_relaxed);
+  if (top < bottom)  // More than one item left: no thief can reach this one.
+    return true;
+
+  // Last item: race the thieves for it.
+  const bool won = mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                                std::memory_order_relaxed);
+  mBottom.store(bottom + 1, std::memory_order_relaxed);
+  return won;
+}
+
+template <class T, uint32_t Capacity>
+inline
+bool WorkStealingDeque<T, Capacity>::Steal(T* item)
+{
+  int64_t top = mTop.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  const int64_t bottom = mBottom.load(std::memory_order_acquire);
+  if (top >= bottom)
+    return false;
+
+  // The item must be read before the top is claimed: once it is, the owner may overwrite it.
+  const T stolen = mItems[top & kMask].load(std::memory_order_relaxed);
+  if (!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                    std::memory_order_relaxed))
+    return false;
+
+  *item = stolen;
+  return true;
+}
+
+template <class T, uint32_t Capacity>
+inline
+uint32_t WorkStealingDeque<T, Capacity>::GetSize() const
+{
+  const int64_t size = mBottom.load(std::memory_order_relaxed) -
+                       mTop.load(std::memory_order_relaxed);
+  return (size > 0) ? static_cast<uint32_t>(size) : 0;
+}
+
+}  // namespace gloo.
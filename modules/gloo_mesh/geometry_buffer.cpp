@@ -0,0 +1,147 @@
+#include "geometry_buffer.h"
+
+#include <iostream>
+
+namespace gloo
+{
+
+const int GeometryBuffer::kMaxAttributes;
+
+GeometryBuffer::~GeometryBuffer()
+{
+  GLStateCache & gl = GLStateCache::Get();
+  gl.DeleteBuffers(1, &mVertexBuffer);
+  gl.DeleteBuffers(1, &mElementBuffer);
+}
+
+bool GeometryBuffer::Load()
+{
+  const GLsizeiptr vertexSize = mFloatCapacity * sizeof(GLfloat);
+  const GLsizeiptr elementSize = mElementCapacity * sizeof(GLuint);
+  mDirectStateAccess = GLCapabilities::Get().HasDirectStateAccess();
+
+  if (mDirectStateAccess)
+  {
+    glCreateBuffers(1, &mVertexBuffer);
+    glCreateBuffers(1, &mElementBuffer);
+    glNamedBufferStorage(mVertexBuffer, vertexSize, nullptr, GL_DYNAMIC_STORAGE_BIT);
+    glNamedBufferStorage(mElementBuffer, elementSize, nullptr, GL_DYNAMIC_STORAGE_BIT);
+  }
+  else
+  {
+    // The element buffer is allocated through GL_COPY_WRITE_BUFFER: binding it to
+    // GL_ELEMENT_ARRAY_BUFFER would attach it to the bound vertex array.
+    GLStateCache & gl = GLStateCache::Get();
+    glGenBuffers(1, &mVertexBuffer);
+    glGenBuffers(1, &mElementBuffer);
+    gl.BindBuffer(GL_SHADER_STORAGE_BUFFER, mVertexBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, vertexSize, nullptr, GL_STATIC_DRAW);
+    gl.BindBuffer(GL_COPY_WRITE_BUFFER, mElementBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, elementSize, nullptr, GL_STATIC_DRAW);
+  }
+
+  mNumFloats = 0;
+  mNumElements = 0;
+  mRanges.clear();
+  return (mVertexBuffer != 0) && (mElementBuffer != 0);
+}
+
+int GeometryBuffer::Add(StorageFormat format, const std::vector<GLuint> & attribList,
+                        const std::vector<GLint> & locations, const GLfloat* vertices,
+                        GLuint numVertices, const GLuint* indices, GLuint numElements)
+{
+  if (attribList.size() != locations.size())
+  {
+    std::cerr << "ERROR: one shader location per vertex attribute is required." << std::endl;
+    return -1;
+  }
+
+  GLuint vertexSize = 0;
+  for (GLuint attribSize : attribList)
+    vertexSize += attribSize;
+
+  const GLuint numFloats = vertexSize * numVertices;
+  if ((mNumFloats + numFloats > mFloatCapacity) || (mNumElements + numElements > mElementCapacity))
+  {
+    std::cerr << "ERROR: geometry buffer is full." << std::endl;
+    return -1;
+  }
+
+  Range range;
+  range.mFirstElement = mNumElements;
+  range.mNumElements = numElements;
+  range.mFirstFloat = mNumFloats;
+
+  for (int a = 0; a < kMaxAttributes; a++)
+  {
+    range.mAttribOffset[a] = -1;
+    range.mAttribStride[a] = 0;
+  }
+
+  // Same arrangements as MeshGroup<Interleave> and MeshGroup<Batch>.
+  GLuint offset = 0;
+  for (size_t j = 0; j < attribList.size(); j++)
+  {
+    const GLint loc = locations[j];
+    if ((loc >= 0) && (loc < kMaxAttributes) && (attribList[j] > 0))
+    {
+      if (format == Interleave)
+      {
+        range.mAttribOffset[loc] = offset;
+        range.mAttribStride[loc] = vertexSize;
+      }
+      else
+      {
+        range.mAttribOffset[loc] = offset * numVertices;
+        range.mAttribStride[loc] = attribList[j];
+      }
+    }
+    else if (loc >= kMaxAttributes)
+    {
+      std::cerr << "ERROR: vertex pulling supports locations up to " << kMaxAttributes - 1
+                << " (got " << loc << ")." << std::endl;
+    }
+
+    offset += attribList[j];
+  }
+
+  GeometryBuffer::Upload(mVertexBuffer, GL_SHADER_STORAGE_BUFFER, mNumFloats * sizeof(GLfloat),
+                         numFloats * sizeof(GLfloat), vertices);
+
+  if (indices)  // Element array provided.
+  {
+    GeometryBuffer::Upload(mElementBuffer, GL_COPY_WRITE_BUFFER, mNumElements * sizeof(GLuint),
+                           numElements * sizeof(GLuint), indices);
+  }
+  else  // Element array wasn't provided -- build it up.
+  {
+    std::vector<GLuint> elementsBuffer(numElements);
+
+    for (GLuint i = 0; i < numElements; i++)
+      elementsBuffer[i] = i;
+
+    GeometryBuffer::Upload(mElementBuffer, GL_COPY_WRITE_BUFFER, mNumElements * sizeof(GLuint),
+                           numElements * sizeof(GLuint), elementsBuffer.data());
+  }
+
+  mNumFloats += numFloats;
+  mNumElements += numElements;
+  mRanges.push_back(range);
+  return static_cast<int>(mRanges.size()) - 1;
+}
+
+void GeometryBuffer::Upload(GLuint buffer, GLenum target, GLintptr offset, GLsizeiptr size,
+                            const GLvoid* data)
+{
+  if (mDirectStateAccess)
+  {
+    glNamedBufferSubData(buffer, offset, size, data);
+  }
+  else
+  {
+    GLStateCache::Get().BindBuffer(target, buffer);
+    glBufferSubData(target, offset, size, data);
+  }
+}
+
+}  // namespace gloo.
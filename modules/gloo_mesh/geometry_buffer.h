@@ -0,0 +1,100 @@
+// + ======================================== +
+// |         gl-oo-interface library          |
+// |            Module: GLOO Mesh.            |
+// |        Author: Rodrigo Castiel, 2016.    |
+// + ======================================== +
+//
+// gloo::GeometryBuffer keeps the vertices of many meshes, whatever their layout, in a single
+// shader storage buffer (an array of floats), and their elements in a single element array
+// buffer. Shaders do not read the vertices through vertex attributes (there is no vertex format,
+// hence no VAO per mesh): they fetch them by gl_VertexID from the storage buffer, with the offset
+// and stride of each attribute of the mesh ("programmable vertex pulling"). Meshes with different
+// layouts can then be drawn by a single indirect draw call (see gloo::IndirectDrawList, and the
+// shaders in shaders/debug_pulling and shaders/phong_pulling).
+//
+// Each mesh is added with the arguments of MeshGroup::SetVertexAttribList()/Load(), and with the
+// shader location of each attribute (as in MeshGroup::AddRenderingPass()). Locations must be
+// below kMaxAttributes.
+//
+// Usage:
+//   GeometryBuffer* geometry = new GeometryBuffer();
+//   geometry->Load();  // With a current GL context.
+//
+//   // Interleaved positions, normals and uvs (locations 0, 1 and 2).
+//   int mesh = geometry->Add(Interleave, {3, 3, 2}, {0, 1, 2}, vertices, numVertices,
+//                            indices, numElements);
+//   // Batched positions and colors, (locations 0 and 1).
+//   int axis = geometry->Add(Batch, {3, 3}, {0, 1}, buffer, numVertices, nullptr, numElements);
+//
+// Vertices and elements are appended, up to the capacities given to the constructor. It requires
+// GL 4.3 (shader storage buffers), see GLCapabilities::HasVertexPulling().
+
+#pragma once
+
+#include <vector>
+
+#include "gloo/gl_header.h"
+#include "gloo/gl_capabilities.h"
+#include "gloo/gl_state_cache.h"
+#include "group.h"
+
+namespace gloo
+{
+
+class GeometryBuffer
+{
+public:
+  static const int kMaxAttributes = 4;  // Shader locations 0 to 3.
+
+  struct Range
+  {
+    GLuint mFirstElement;  // In the element array buffer.
+    GLuint mNumElements;
+    GLuint mFirstFloat;    // Of the vertices, in the storage buffer.
+    GLint mAttribOffset[kMaxAttributes];  // From mFirstFloat, in floats (-1 if missing).
+    GLint mAttribStride[kMaxAttributes];  // Between two vertices, in floats.
+  };
+
+  // Capacities in floats and elements.
+  explicit GeometryBuffer(GLsizeiptr floatCapacity = 1 << 22,
+                          GLsizeiptr elementCapacity = 1 << 22)
+  : mFloatCapacity(floatCapacity)
+  , mElementCapacity(elementCapacity) { }
+
+  ~GeometryBuffer();
+
+  // Creates the buffers (requires a current GL context).
+  bool Load();
+
+  // Appends a mesh (see above), and returns its index, or -1 if it does not fit. Without indices,
+  // the elements are 0, 1, 2, ...
+  int Add(StorageFormat format, const std::vector<GLuint> & attribList,
+          const std::vector<GLint> & locations, const GLfloat* vertices, GLuint numVertices,
+          const GLuint* indices, GLuint numElements);
+
+  // Getters.
+  const Range & GetRange(int mesh) const { return mRanges[mesh]; }
+  size_t GetNumMeshes() const { return mRanges.size(); }
+  GLuint GetVertexBuffer()  const { return mVertexBuffer;  }
+  GLuint GetElementBuffer() const { return mElementBuffer; }
+
+private:
+  GeometryBuffer(const GeometryBuffer &) = delete;
+  GeometryBuffer & operator=(const GeometryBuffer &) = delete;
+
+  // Copies size bytes of data into buffer at offset.
+  void Upload(GLuint buffer, GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid* data);
+
+  GLuint mVertexBuffer  { 0 };  // Shader storage buffer (floats).
+  GLuint mElementBuffer { 0 };
+  bool mDirectStateAccess { false };
+
+  GLsizeiptr mFloatCapacity;
+  GLsizeiptr mElementCapacity;
+  GLuint mNumFloats   { 0 };  // In use.
+  GLuint mNumElements { 0 };
+
+  std::vector<Range> mRanges;  // Of each mesh.
+};
+
+}  // namespace gloo.
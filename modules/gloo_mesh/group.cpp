@@ -72,13 +72,69 @@ void MeshGroup<Interleave>::BuildVAO(const std::vector<std::pair<GLint, bool>> &
   }
 }
 
+template <>
+void MeshGroup<Interleave>::BuildVAODirect(GLuint vao,
+                                           const std::vector<std::pair<GLint, bool>> & attribList)
+{
+  // A single vertex buffer binding (0), with one vertex per stride.
+  glVertexArrayVertexBuffer(vao, 0, mVbo, 0, sizeof(GLfloat) * mVertexSize);
+
+  int offset = 0;
+  for (int j = 0; j < mNumAttributes; j++)
+  {
+    const int size    = mVertexAttributeList[j];
+    const GLint loc   = attribList[j].first;
+    const bool active = attribList[j].second;
+
+    if ((size > 0) && active)
+    {
+      glVertexArrayAttribFormat(vao, loc, size, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * offset);
+      glVertexArrayAttribBinding(vao, loc, 0);
+    }
+
+    offset += size;
+  }
+}
+
+template <>
+const VertexFormat* MeshGroup<Interleave>::BuildVertexFormat(
+  const std::vector<std::pair<GLint, bool>> & attribList)
+{
+  // All attributes come from binding 0, at their offset in the vertex.
+  std::vector<VertexFormat::Attribute> attributes;
+
+  int offset = 0;
+  for (int j = 0; j < mNumAttributes; j++)
+  {
+    const int size    = mVertexAttributeList[j];
+    const GLint loc   = attribList[j].first;
+    const bool active = attribList[j].second;
+
+    if ((size > 0) && active)
+    {
+      const GLuint relativeOffset = sizeof(GLfloat) * offset;
+      attributes.push_back({ static_cast<GLuint>(loc), size, GL_FLOAT, GL_FALSE, relativeOffset,
+                             0 });
+    }
+
+    offset += size;
+  }
+
+  return VertexFormat::Get(attributes);
+}
+
+template <>
+void MeshGroup<Interleave>::BindVertexBuffers(const VertexFormat* /* format */) const
+{
+  // All attributes come from binding 0, whatever the format.
+  GLStateCache::Get().BindVertexBuffer(0, mVbo, 0, sizeof(GLfloat) * mVertexSize);
+}
+
 template <>
 bool MeshGroup<Interleave>::Update(const std::vector<GLfloat*> & bufferList)
 {
   assert(bufferList.size() == mNumAttributes);
 
-  glBindBuffer(GL_ARRAY_BUFFER, mVbo);
-
   // Upload subdata of geometry to GPU.
   int attrib_offset = 0;
   for (int j = 0; j < mNumAttributes; j++)
@@ -90,9 +146,9 @@ bool MeshGroup<Interleave>::Update(const std::vector<GLfloat*> & bufferList)
     {
       for (int i = 0; i < mNumVertices; i++)
       {
-        glBufferSubData(GL_ARRAY_BUFFER,
-                        (mVertexSize*i + attrib_offset)*sizeof(GLfloat), // Offset.
-                        size*sizeof(GLfloat), &buffer[size*i]);          // Size.
+        MeshGroup<Interleave>::UpdateVertexData(
+          (mVertexSize*i + attrib_offset)*sizeof(GLfloat),  // Offset.
+          size*sizeof(GLfloat), &buffer[size*i]);           // Size.
       }
     }
 
@@ -130,8 +186,6 @@ bool MeshGroup<Batch>::Update(const std::vector<GLfloat*> & bufferList)
 {
   assert(bufferList.size() == mNumAttributes);
 
-  glBindBuffer(GL_ARRAY_BUFFER, mVbo);
-
   // Upload subdata of geometry to GPU.
   int offset = 0;
   for (int j = 0; j < mNumAttributes; j++)
@@ -141,7 +195,7 @@ bool MeshGroup<Batch>::Update(const std::vector<GLfloat*> & bufferList)
 
     if ((size > 0) && (buffer != nullptr))
     {
-      glBufferSubData(GL_ARRAY_BUFFER, offset, size*mNumVertices*sizeof(GLfloat), buffer);
+      MeshGroup<Batch>::UpdateVertexData(offset, size*mNumVertices*sizeof(GLfloat), buffer);
     }
 
     offset += size*mNumVertices * sizeof(GLfloat);
@@ -170,6 +224,69 @@ void MeshGroup<Batch>::BuildVAO(const std::vector<std::pair<GLint, bool>> & attr
   }
 }
 
+template <>
+void MeshGroup<Batch>::BuildVAODirect(GLuint vao,
+                                      const std::vector<std::pair<GLint, bool>> & attribList)
+{
+  // One vertex buffer binding per attribute (j), at the start of its sub-buffer.
+  int offset = 0;
+  for (int j = 0; j < mNumAttributes; j++)
+  {
+    const int size    = mVertexAttributeList[j];
+    const GLint loc   = attribList[j].first;
+    const bool active = attribList[j].second;
+
+    if ((size > 0) && active)
+    {
+      glVertexArrayVertexBuffer(vao, j, mVbo, sizeof(GLfloat) * offset*mNumVertices,
+                                sizeof(GLfloat) * size);
+      glVertexArrayAttribFormat(vao, loc, size, GL_FLOAT, GL_FALSE, 0);
+      glVertexArrayAttribBinding(vao, loc, j);
+    }
+
+    offset += size;
+  }
+}
+
+template <>
+const VertexFormat* MeshGroup<Batch>::BuildVertexFormat(
+  const std::vector<std::pair<GLint, bool>> & attribList)
+{
+  // Attribute j comes from binding j (its sub-buffer is bound there by BindVertexBuffers()).
+  std::vector<VertexFormat::Attribute> attributes;
+
+  for (int j = 0; j < mNumAttributes; j++)
+  {
+    const int size    = mVertexAttributeList[j];
+    const GLint loc   = attribList[j].first;
+    const bool active = attribList[j].second;
+
+    if ((size > 0) && active)
+      attributes.push_back({ static_cast<GLuint>(loc), size, GL_FLOAT, GL_FALSE, 0,
+                             static_cast<GLuint>(j) });
+  }
+
+  return VertexFormat::Get(attributes);
+}
+
+template <>
+void MeshGroup<Batch>::BindVertexBuffers(const VertexFormat* format) const
+{
+  GLStateCache & gl = GLStateCache::Get();
+
+  for (const VertexFormat::Attribute & attribute : format->GetAttributes())
+  {
+    // Sub-buffer of attribute j = binding.
+    const GLuint j = attribute.mBinding;
+    GLuint offset = 0;
+    for (GLuint k = 0; k < j; k++)
+      offset += mVertexAttributeList[k];
+
+    gl.BindVertexBuffer(j, mVbo, sizeof(GLfloat) * offset*mNumVertices,
+                        sizeof(GLfloat) * mVertexAttributeList[j]);
+  }
+}
+
 // ============================================================================================= //
 
 
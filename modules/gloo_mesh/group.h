@@ -37,6 +37,11 @@
 // which attributes will be enabled or not and what are their locations in the shader.
 //
 // The location in shaders must be coeherent to attributes you've written on your shader.   
+//
+// When the vertex format can be separated from the buffers (GL 4.3, see gloo::VertexFormat), a
+// rendering pass does not get its own VAO: it uses the VAO shared by all groups with the same
+// layout (attribute locations, sizes and offsets), and Render() only binds the buffers of this
+// group to it. Drawing many meshes then switches VAOs only when the layout changes.
 
 // [Loading/updating data]
 // 
@@ -51,6 +56,15 @@
 // list of buffers, each one corresponding to an attribute. 
 // When updating, you can optionally pass nullptr for attributes you don't want to update.
 
+// [Direct State Access]
+//
+// When the context supports it (GL 4.5, see GLCapabilities::HasDirectStateAccess()), buffers and
+// VAOs are created with glCreate*() and edited by name (glNamedBufferSubData(),
+// glVertexArrayAttribFormat(), ...): loading or updating a group does not change the current
+// bindings. Buffers then get immutable storage, allocated by the first Load() (the number of
+// vertices and elements of a group never changes); later loads replace the contents only.
+// Otherwise, the buffers are bound to be edited (through gloo::GLStateCache).
+
 // [USAGE]
 /*
     // Create.
@@ -84,6 +98,9 @@
 #pragma once
 
 #include "gloo/gl_header.h"
+#include "gloo/gl_capabilities.h"
+#include "gloo/gl_state_cache.h"
+#include "vertex_format.h"
 #include <vector>
 #include <initializer_list>
 #include <cassert>
@@ -151,12 +168,26 @@ private:
   // mapped to attribute locations on shader).
   void BuildVAO(const std::vector<std::pair<GLint, bool>> & attribList);
 
+  // Same as above, for an unbound VAO (direct state access).
+  void BuildVAODirect(GLuint vao, const std::vector<std::pair<GLint, bool>> & attribList);
+
+  // Shared vertex format of the active attributes, and binding of the buffers to it.
+  const VertexFormat* BuildVertexFormat(const std::vector<std::pair<GLint, bool>> & attribList);
+  void BindVertexBuffers(const VertexFormat* format) const;
+
+  // Replaces size bytes of the vertex buffer at offset.
+  void UpdateVertexData(GLintptr offset, GLsizeiptr size, const GLvoid* data);
+
   /* Attributes */
 
   // OpenGL buffer IDs.
   GLuint mEab { 0 };  // Element array buffer.
   GLuint mVbo { 0 };  // Vertex buffer object.
   std::vector<GLuint> mVaoList;  // Verter array object list.
+  std::vector<const VertexFormat*> mFormatList;  // Shared format of each pass (or nullptr).
+
+  bool mDirectStateAccess { false };  // Buffers/VAOs are edited by name (see above).
+  bool mStorageAllocated  { false };  // Immutable storage of the buffers (direct state access).
 
   // Mesh attributes.
   GLenum mDrawMode;     // How mesh is rendered (drawing mode).
@@ -201,9 +232,20 @@ void MeshGroup<F>::Render(unsigned renderingPass) const
   assert((renderingPass >= 0) && (renderingPass < mVaoList.size()));
 
   const int option = renderingPass;
-  
-  glBindVertexArray(mVaoList[option]);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEab);
+  const VertexFormat* format = mFormatList[option];
+
+  if (format)
+  {
+    // Shared vertex array: only the buffers of this group are bound to it.
+    format->Bind();
+    MeshGroup<F>::BindVertexBuffers(format);
+    GLStateCache::Get().BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEab);
+  }
+  else
+  {
+    // The element array buffer is part of the vertex array state.
+    GLStateCache::Get().BindVertexArray(mVaoList[option]);
+  }
 
   glDrawElements(
     mDrawMode,         // mode (GL_LINES, GL_TRIANGLES, ...)
@@ -226,9 +268,20 @@ void MeshGroup<F>::SetVertexAttribList(std::initializer_list<GLuint> vertexAttri
     mNumAttributes++;
   }
 
-  // Generate geometry buffers.
-  glGenBuffers(1, &mVbo);       // Vertex buffer object.
-  glGenBuffers(1, &mEab);       // Element array buffer.
+  // Generate geometry buffers. With direct state access, the buffer objects are created here
+  // (not only their names), so that they can be edited without being bound.
+  mDirectStateAccess = GLCapabilities::Get().HasDirectStateAccess();
+
+  if (mDirectStateAccess)
+  {
+    glCreateBuffers(1, &mVbo);    // Vertex buffer object.
+    glCreateBuffers(1, &mEab);    // Element array buffer.
+  }
+  else
+  {
+    glGenBuffers(1, &mVbo);       // Vertex buffer object.
+    glGenBuffers(1, &mEab);       // Element array buffer.
+  }
 }
 
 template <StorageFormat F>
@@ -236,14 +289,32 @@ int MeshGroup<F>::AddRenderingPass(const std::vector<std::pair<GLint, bool>> & a
 {
   assert(attribList.size() == mNumAttributes);
 
+  if (GLCapabilities::Get().HasVertexAttribBinding())
+  {
+    mVaoList.push_back(0);
+    mFormatList.push_back(MeshGroup<F>::BuildVertexFormat(attribList));
+    return mVaoList.size()-1;
+  }
+
   GLuint vao = 0;
-  glGenVertexArrays(1, &vao);
 
-  glBindVertexArray(vao);
-  glBindBuffer(GL_ARRAY_BUFFER, mVbo);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEab);
+  if (mDirectStateAccess)
+  {
+    glCreateVertexArrays(1, &vao);
+    glVertexArrayElementBuffer(vao, mEab);
+    MeshGroup<F>::BuildVAODirect(vao, attribList);
+  }
+  else
+  {
+    glGenVertexArrays(1, &vao);
+
+    GLStateCache & gl = GLStateCache::Get();
+    gl.BindVertexArray(vao);
+    gl.BindBuffer(GL_ARRAY_BUFFER, mVbo);
+    gl.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEab);
   
-  MeshGroup<F>::BuildVAO(attribList);
+    MeshGroup<F>::BuildVAO(attribList);
+  }
 
   for (int i = 0; i < mNumAttributes; i++)
   {
@@ -253,15 +324,26 @@ int MeshGroup<F>::AddRenderingPass(const std::vector<std::pair<GLint, bool>> & a
     // If the attribute is active...
     if (active)
     {
-      glEnableVertexAttribArray(attribLoc);
+      if (mDirectStateAccess)
+        glEnableVertexArrayAttrib(vao, attribLoc);
+      else
+        glEnableVertexAttribArray(attribLoc);
     }
     else if (attribLoc != -1)
     {
-      glDisableVertexAttribArray(attribLoc);
+      if (mDirectStateAccess)
+        glDisableVertexArrayAttrib(vao, attribLoc);
+      else
+        glDisableVertexAttribArray(attribLoc);
     }
   }
 
+  // Unbound: the element array buffer bindings of other groups would be stored in this one.
+  if (!mDirectStateAccess)
+    GLStateCache::Get().BindVertexArray(0);
+
   mVaoList.push_back(vao);
+  mFormatList.push_back(nullptr);
 
   return mVaoList.size()-1;
 }
@@ -270,24 +352,48 @@ int MeshGroup<F>::AddRenderingPass(const std::vector<std::pair<GLint, bool>> & a
 template <StorageFormat F>
 void MeshGroup<F>::AllocateBuffers(const GLfloat* vertices, const GLuint* elements)
 {  
-  // Allocate buffer for elements (EAB).
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEab);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, mNumElements * sizeof(GLuint),
-               elements, GL_STATIC_DRAW);
+  const GLsizeiptr elementsSize = mNumElements * sizeof(GLuint);
+  const GLsizeiptr verticesSize = mVertexSize * mNumVertices * sizeof(GLfloat);
+
+  if (mDirectStateAccess)
+  {
+    // Immutable storage, allocated once (Update() needs GL_DYNAMIC_STORAGE_BIT).
+    if (!mStorageAllocated)
+    {
+      glNamedBufferStorage(mEab, elementsSize, elements, GL_DYNAMIC_STORAGE_BIT);
+      glNamedBufferStorage(mVbo, verticesSize, vertices, GL_DYNAMIC_STORAGE_BIT);
+      mStorageAllocated = true;
+    }
+    else
+    {
+      glNamedBufferSubData(mEab, 0, elementsSize, elements);
+      if (vertices)
+        glNamedBufferSubData(mVbo, 0, verticesSize, vertices);
+    }
+    return;
+  }
+
+  GLStateCache & gl = GLStateCache::Get();
+
+  // Allocate buffer for elements (EAB), through GL_COPY_WRITE_BUFFER: binding it to
+  // GL_ELEMENT_ARRAY_BUFFER would attach it to the bound vertex array (of another group).
+  gl.BindBuffer(GL_COPY_WRITE_BUFFER, mEab);
+  glBufferData(GL_COPY_WRITE_BUFFER, elementsSize, elements, GL_STATIC_DRAW);
 
   // Allocate buffer for vertices (VBO).
-  glBindBuffer(GL_ARRAY_BUFFER, mVbo);
-  glBufferData(GL_ARRAY_BUFFER, mVertexSize * mNumVertices * sizeof(GLfloat),
-               vertices, mDataUsage);
+  gl.BindBuffer(GL_ARRAY_BUFFER, mVbo);
+  glBufferData(GL_ARRAY_BUFFER, verticesSize, vertices, mDataUsage);
 }
 
 /* Delete buffers */
 template <StorageFormat F>
 void MeshGroup<F>::ClearBuffers()
 {
-  glDeleteBuffers(1, &mVbo);
-  glDeleteBuffers(1, &mEab);
-  glDeleteVertexArrays(mVaoList.size(), mVaoList.data());
+  GLStateCache & gl = GLStateCache::Get();
+  gl.DeleteBuffers(1, &mVbo);
+  gl.DeleteBuffers(1, &mEab);
+  gl.DeleteVertexArrays(mVaoList.size(), mVaoList.data());
+  mStorageAllocated = false;
 }
 
 template <StorageFormat F>
@@ -312,8 +418,21 @@ bool MeshGroup<F>::Load(const GLfloat* buffer, const GLuint* indices)
 template <StorageFormat F>
 bool MeshGroup<F>::Update(const GLfloat* buffer)
 {
-  glBindBuffer(GL_ARRAY_BUFFER, mVbo);
-  glBufferSubData(GL_ARRAY_BUFFER, 0, mVertexSize * mNumVertices * sizeof(GLfloat), buffer);
+  MeshGroup<F>::UpdateVertexData(0, mVertexSize * mNumVertices * sizeof(GLfloat), buffer);
+}
+
+template <StorageFormat F>
+void MeshGroup<F>::UpdateVertexData(GLintptr offset, GLsizeiptr size, const GLvoid* data)
+{
+  if (mDirectStateAccess)
+  {
+    glNamedBufferSubData(mVbo, offset, size, data);
+  }
+  else
+  {
+    GLStateCache::Get().BindBuffer(GL_ARRAY_BUFFER, mVbo);
+    glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+  }
 }
 
 // ============================================================================================= //
@@ -331,6 +450,17 @@ bool MeshGroup<Batch>::Update(const std::vector<GLfloat*> & bufferList);
 template <>
 void MeshGroup<Batch>::BuildVAO(const std::vector<std::pair<GLint, bool>> & attribList);
 
+template <>
+void MeshGroup<Batch>::BuildVAODirect(GLuint vao,
+                                      const std::vector<std::pair<GLint, bool>> & attribList);
+
+template <>
+const VertexFormat* MeshGroup<Batch>::BuildVertexFormat(
+  const std::vector<std::pair<GLint, bool>> & attribList);
+
+template <>
+void MeshGroup<Batch>::BindVertexBuffers(const VertexFormat* format) const;
+
 // ================ Interleaved Storage ==================== //
 
 template <>
@@ -343,5 +473,16 @@ bool MeshGroup<Interleave>::Update(const std::vector<GLfloat*> & bufferList);
 template <>
 void MeshGroup<Interleave>::BuildVAO(const std::vector<std::pair<GLint, bool>> & attribList);
 
+template <>
+void MeshGroup<Interleave>::BuildVAODirect(GLuint vao,
+                                           const std::vector<std::pair<GLint, bool>> & attribList);
+
+template <>
+const VertexFormat* MeshGroup<Interleave>::BuildVertexFormat(
+  const std::vector<std::pair<GLint, bool>> & attribList);
+
+template <>
+void MeshGroup<Interleave>::BindVertexBuffers(const VertexFormat* format) const;
+
 
 }  // namespace gloo.
\ No newline at end of file
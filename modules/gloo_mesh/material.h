@@ -13,13 +13,6 @@
 namespace gloo
 {
 
-struct MaterialUniformPack
-{
-  GLint mKaLoc;  // Ambient component uniform loc.
-  GLint mKdLoc;  // Diffuse component uniform loc.
-  GLint mKsLoc;  // Specular component uniform loc.
-};
-
 struct Material
 {
   glm::vec3 mKa;  // Ambient component.
@@ -9,60 +9,80 @@ namespace gloo
 
 Texture2d::~Texture2d()
 {
-  glDeleteTextures(1, &mBuffer);
+  GLStateCache::Get().DeleteTextures(1, &mBuffer);
 }
 
 bool Texture2d::Load(ImageIO* source, GLenum format, GLenum type)
 {
-  glGenTextures(1, &mBuffer);
-  glBindTexture(GL_TEXTURE_2D, mBuffer);
-
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  Texture2d::Create(GL_LINEAR);
 
   int bytesPerPixel = source->getBytesPerPixel();
   // TODO: use bytesPerPixel to use a different input internal format.
 
-  glTexImage2D( GL_TEXTURE_2D,  // Target.
-                0,              // Detail level - original.
-                GL_RGBA,        // How the colors are stored.
-                source->getWidth(),   // Width.
-                source->getHeight(),  // Height.
-                0,                    // Border must be 0. 
-                format,               // Input format.  
-                type,                 // Input data type.
-                source->getPixels()   // Buffer address.
-  );
-
+  Texture2d::Allocate(source->getWidth(), source->getHeight(), format, type,
+                      source->getPixels());
   return true;
 }
 
 bool Texture2d::Load(int width, int height, GLenum format, GLenum type)
 {
-  glGenTextures(1, &mBuffer);
-  glBindTexture(GL_TEXTURE_2D, mBuffer);
-
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-  glTexImage2D( GL_TEXTURE_2D,  // Target.
-                0,              // Detail level - original.
-                GL_RGBA,        // How many channels the texture will have.
-                width,   // Width.
-                height,  // Height.
-                0,        // Border must be 0. 
-                format,   // Format (RGB, RGBA, GRBA, and so on).  
-                type,     // Data type (unsigned byte, ...).
-                nullptr   // Buffer address.
-              );
-
+  Texture2d::Create(GL_LINEAR_MIPMAP_LINEAR);
+  Texture2d::Allocate(width, height, format, type, nullptr);
   return true;
 }
 
+void Texture2d::Create(GLint minFilter)
+{
+  mDirectStateAccess = GLCapabilities::Get().HasDirectStateAccess();
+
+  if (mDirectStateAccess)
+  {
+    glCreateTextures(GL_TEXTURE_2D, 1, &mBuffer);
+
+    glTextureParameteri(mBuffer, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTextureParameteri(mBuffer, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTextureParameteri(mBuffer, GL_TEXTURE_MIN_FILTER, minFilter);
+    glTextureParameteri(mBuffer, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  }
+  else
+  {
+    glGenTextures(1, &mBuffer);
+    GLStateCache::Get().BindTexture(GL_TEXTURE0, GL_TEXTURE_2D, mBuffer);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  }
+}
+
+void Texture2d::Allocate(GLsizei width, GLsizei height, GLenum format, GLenum type,
+                         const GLvoid* pixels)
+{
+  if (mDirectStateAccess)
+  {
+    // Immutable storage needs a sized format. A single level: the texture is complete even
+    // with a mipmap filter (the levels of immutable textures are clamped to the ones allocated).
+    glTextureStorage2D(mBuffer, 1, GL_RGBA8, width, height);
+
+    if (pixels)
+      glTextureSubImage2D(mBuffer, 0, 0, 0, width, height, format, type, pixels);
+  }
+  else
+  {
+    glTexImage2D( GL_TEXTURE_2D,  // Target.
+                  0,              // Detail level - original.
+                  GL_RGBA,        // How the colors are stored.
+                  width,          // Width.
+                  height,         // Height.
+                  0,              // Border must be 0. 
+                  format,         // Input format (RGB, RGBA, GRBA, and so on).
+                  type,           // Input data type (unsigned byte, ...).
+                  pixels          // Buffer address.
+    );
+  }
+}
+
 bool Texture2d::Load(const std::string & filename, GLenum format, GLenum type)
 {
   bool successful = false;
@@ -4,11 +4,18 @@
 // |        Author: Rodrigo Castiel, 2016.    |
 // + ======================================== +
 
+// Texture2d keeps an RGBA 2d texture. With direct state access (GL 4.5, see
+// GLCapabilities::HasDirectStateAccess()), it is created with immutable storage
+// (glTextureStorage2D()) and filled by name (glTextureSubImage2D()), so loading a texture does not
+// change the texture bound to GL_TEXTURE0. Otherwise, it is bound and filled by glTexImage2D().
+
 #pragma once
 
 #include <string>
 #include "../../dependencies/imageIO/imageIO.h"
 #include "gloo/gl_header.h"
+#include "gloo/gl_capabilities.h"
+#include "gloo/gl_state_cache.h"
 
 namespace gloo
 {
@@ -31,14 +38,20 @@ public:
   bool Load(int width, int height, GLenum format=GL_RGB, GLenum type=GL_UNSIGNED_BYTE);
 
 private:
+  // Creates the texture object and sets its sampling parameters.
+  void Create(GLint minFilter);
+
+  // Allocates the storage of the texture, and fills it from pixels (if not nullptr).
+  void Allocate(GLsizei width, GLsizei height, GLenum format, GLenum type, const GLvoid* pixels);
+
   GLuint mBuffer { 0 };  // Texture buffer object.
+  bool mDirectStateAccess { false };
 };
 
 inline
 void Texture2d::Bind(GLenum unit) const
 {
-  glActiveTexture(unit);
-  glBindTexture(GL_TEXTURE_2D, mBuffer);
+  GLStateCache::Get().BindTexture(unit, GL_TEXTURE_2D, mBuffer);
 }
 
 
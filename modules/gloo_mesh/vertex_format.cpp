@@ -0,0 +1,78 @@
+#include "vertex_format.h"
+
+#include <algorithm>
+#include <tuple>
+
+namespace gloo
+{
+
+bool VertexFormat::Attribute::operator<(const Attribute & other) const
+{
+  return std::tie(mLocation, mSize, mType, mNormalized, mRelativeOffset, mBinding) <
+         std::tie(other.mLocation, other.mSize, other.mType, other.mNormalized,
+                  other.mRelativeOffset, other.mBinding);
+}
+
+const VertexFormat* VertexFormat::Get(const std::vector<Attribute> & attributes)
+{
+  // The same layout listed in another order is the same format.
+  std::vector<Attribute> key = attributes;
+  std::sort(key.begin(), key.end());
+
+  FormatMap & formats = VertexFormat::GetFormats();
+  auto it = formats.find(key);
+  if (it != formats.end())
+    return it->second.get();
+
+  VertexFormat* format = new VertexFormat(key);
+  formats[key].reset(format);
+  return format;
+}
+
+void VertexFormat::Clear()
+{
+  VertexFormat::GetFormats().clear();
+}
+
+VertexFormat::FormatMap & VertexFormat::GetFormats()
+{
+  static FormatMap formats;
+  return formats;
+}
+
+VertexFormat::VertexFormat(const std::vector<Attribute> & attributes)
+: mAttributes(attributes)
+{
+  if (GLCapabilities::Get().HasDirectStateAccess())
+  {
+    glCreateVertexArrays(1, &mVertexArray);
+
+    for (const Attribute & attribute : mAttributes)
+    {
+      glVertexArrayAttribFormat(mVertexArray, attribute.mLocation, attribute.mSize,
+                                attribute.mType, attribute.mNormalized, attribute.mRelativeOffset);
+      glVertexArrayAttribBinding(mVertexArray, attribute.mLocation, attribute.mBinding);
+      glEnableVertexArrayAttrib(mVertexArray, attribute.mLocation);
+    }
+  }
+  else
+  {
+    glGenVertexArrays(1, &mVertexArray);
+    GLStateCache::Get().BindVertexArray(mVertexArray);
+
+    for (const Attribute & attribute : mAttributes)
+    {
+      glVertexAttribFormat(attribute.mLocation, attribute.mSize, attribute.mType,
+                           attribute.mNormalized, attribute.mRelativeOffset);
+      glVertexAttribBinding(attribute.mLocation, attribute.mBinding);
+      glEnableVertexAttribArray(attribute.mLocation);
+    }
+  }
+}
+
+VertexFormat::~VertexFormat()
+{
+  GLStateCache::Get().DeleteVertexArrays(1, &mVertexArray);
+}
+
+}  // namespace gloo.
@@ -0,0 +1,93 @@
+// + ======================================== +
+// |         gl-oo-interface library          |
+// |            Module: GLOO Mesh.            |
+// |        Author: Rodrigo Castiel, 2016.    |
+// + ======================================== +
+//
+// gloo::VertexFormat describes a vertex layout (which attributes, at which locations, with which
+// size, type and offset, read from which vertex buffer binding) apart from the buffers that hold
+// the vertices. Formats are interned: Get() returns the same format for the same layout, and
+// each format owns a single vertex array object, with glVertexAttribFormat() and
+// glVertexAttribBinding() set once. All meshes with the same layout share it: drawing another
+// mesh only binds its buffers to the vertex array (glBindVertexBuffer() and the element array
+// buffer), instead of switching vertex arrays.
+//
+// Usage:
+//   const VertexFormat* format = VertexFormat::Get({
+//     // location, size, type,     normalized, relative offset, binding.
+//     { 0,        3,    GL_FLOAT, GL_FALSE,   0,               0 },  // Position.
+//     { 1,        3,    GL_FLOAT, GL_FALSE,   12,              0 },  // Normal.
+//     { 2,        2,    GL_FLOAT, GL_FALSE,   24,              0 },  // Uv.
+//   });
+//   ...
+//   format->Bind();
+//   GLStateCache & gl = GLStateCache::Get();
+//   gl.BindVertexBuffer(0, vbo, 0, 32);          // Binding 0, stride 32.
+//   gl.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, eab);
+//   glDrawElements(...);
+//
+// It requires GLCapabilities::HasVertexAttribBinding() (GL 4.3): gloo::MeshGroup only uses it
+// then. The formats live until Clear() (call it before destroying the GL context). Since the
+// shaders have fixed attribute locations, meshes with the same attributes share a format across
+// all programs.
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "gloo/gl_header.h"
+#include "gloo/gl_capabilities.h"
+#include "gloo/gl_state_cache.h"
+
+namespace gloo
+{
+
+class VertexFormat
+{
+public:
+  struct Attribute
+  {
+    GLuint mLocation;
+    GLint mSize;              // Number of components (1 to 4).
+    GLenum mType;             // E.g. GL_FLOAT.
+    GLboolean mNormalized;
+    GLuint mRelativeOffset;   // In bytes, from the start of the vertex in its binding.
+    GLuint mBinding;          // Vertex buffer binding index.
+
+    bool operator<(const Attribute & other) const;
+  };
+
+  // The interned format with this layout (created the first time, with a current GL context).
+  static const VertexFormat* Get(const std::vector<Attribute> & attributes);
+
+  // Deletes all formats (and their vertex arrays).
+  static void Clear();
+
+  // Number of distinct layouts in use.
+  static size_t GetNumFormats() { return VertexFormat::GetFormats().size(); }
+
+  // Binds the shared vertex array (redundant binds are skipped, see gloo::GLStateCache).
+  void Bind() const { GLStateCache::Get().BindVertexArray(mVertexArray); }
+
+  // Getters.
+  GLuint GetVertexArray() const { return mVertexArray; }
+  const std::vector<Attribute> & GetAttributes() const { return mAttributes; }
+
+  ~VertexFormat();
+
+private:
+  typedef std::map<std::vector<Attribute>, std::unique_ptr<VertexFormat>> FormatMap;
+
+  explicit VertexFormat(const std::vector<Attribute> & attributes);
+  VertexFormat(const VertexFormat &) = delete;
+  VertexFormat & operator=(const VertexFormat &) = delete;
+
+  static FormatMap & GetFormats();
+
+  std::vector<Attribute> mAttributes;  // Sorted by location.
+  GLuint mVertexArray { 0 };
+};
+
+}  // namespace gloo.
@@ -1,5 +1,7 @@
 #include "debug_renderer.h"
 
+#include <glm/gtc/type_ptr.hpp>
+
 #define LOG_OUTPUT_ON 1
 
 namespace gloo
@@ -12,9 +14,9 @@ DebugRenderer::~DebugRenderer()
 
 void DebugRenderer::Bind(int renderingPass) 
 { 
-  if (mDebugShader)
+  if (mPipeline)
   {
-    mDebugShader->Bind();
+    mPipeline->Apply();  // Program and fixed-function state (only what changed).
   }
   // ELSE: show an error?
 }
@@ -39,7 +41,9 @@ bool DebugRenderer::Load()
     mColorAttribLoc    = mDebugShader->GetAttribLocation("v_color");
     mModelViewProjMatrixLoc = mDebugShader->GetUniformLocation("MVP");
 
-    return true;
+    mPipelineDesc.mProgram = mDebugShader;
+    mPipeline = PipelineState::Get(mPipelineDesc);
+    return (mPipeline != nullptr);
   }
   else
   {
@@ -47,31 +51,70 @@ bool DebugRenderer::Load()
   }
 }
 
-GLint DebugRenderer::GetAttribLocation(const std::string & name, int renderingPass) const
+bool DebugRenderer::SetPipelineDesc(const PipelineState::Desc & desc)
 {
-  if (name == "position" || name == "v_position")
+  PipelineState::Desc pipelineDesc = desc;
+  pipelineDesc.mProgram = mPipelineDesc.mProgram;  // nullptr until Load().
+
+  if (pipelineDesc.mProgram)
   {
-    return mPositionAttribLoc;
+    const PipelineState* pipeline = PipelineState::Get(pipelineDesc);
+    if (!pipeline)
+      return false;
+
+    mPipeline = pipeline;
   }
-  else if (name == "color" || name == "v_color")
+  else if (!PipelineState::Validate(pipelineDesc))
   {
-    return mColorAttribLoc;
+    return false;
   }
-  else  // There is no other attributes.
+
+  mPipelineDesc = pipelineDesc;
+  return true;
+}
+
+void DebugRenderer::SetModelViewProj(const glm::mat4 & model, Camera* camera) const
+{
+  const glm::mat4 MVP = camera->GetViewProjMatrix() * model;  // (P * V) * M, with P * V cached.
+  mDebugShader->SetUniform(HashName("MVP"), glm::value_ptr(MVP), 16);
+  mDebugShader->FlushUniforms();
+}
+
+void DebugRenderer::Render(const IndirectDrawList* drawList, Camera* camera) const
+{
+  // P * V only: the model matrix of each draw is in its record.
+  DebugRenderer::SetModelViewProj(glm::mat4(1.0f), camera);
+  drawList->Draw();
+}
+
+GLint DebugRenderer::GetAttribLocation(const std::string & name, int renderingPass) const
+{
+  switch (HashName(name).mValue)  // See PhongRenderer::GetAttribLocation().
   {
-    return -1;
+    case HashName("position").mValue:
+    case HashName("v_position").mValue:
+      return mPositionAttribLoc;
+
+    case HashName("color").mValue:
+    case HashName("v_color").mValue:
+      return mColorAttribLoc;
+
+    default:  // There is no other attributes.
+      return -1;
   }
 }
 
 GLint DebugRenderer::GetUniformLocation(const std::string & name, int renderingPass) const
 {
-  if (name == "MVP" || name == "model-view-projection" || name == "mvp")
+  switch (HashName(name).mValue)
   {
-    return mModelViewProjMatrixLoc;
-  }
-  else  // There is no other uniforms.
-  {
-    return -1;
+    case HashName("MVP").mValue:
+    case HashName("model-view-projection").mValue:
+    case HashName("mvp").mValue:
+      return mModelViewProjMatrixLoc;
+
+    default:  // There is no other uniforms.
+      return -1;
   }
 }
 
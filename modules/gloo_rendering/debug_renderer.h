@@ -16,6 +16,8 @@
 //   -> Vertex RGB color   (3d) [use GetColorAttribLoc()].
 // and only one uniform:
 //   -> Model-view-proj matrix (4x4) [use GetModelViewProjUniformLoc()].
+// Render() sets it through ShaderProgram::SetUniform(), so drawing static objects from a still
+// camera does not upload it again.
 //
 // I strongly suggest that you use DebugRenderer to render useful meshes, such as Axis or Grid.
 // This is a good way of getting feedback when programming complex hierachy of objects and so on.
@@ -41,15 +43,27 @@
 //
 // 5. Before use (i.e. rendering calls):
 //  mDebugRenderer->Bind();
+//  It applies the pipeline state of the renderer (program, depth test on, no blending, no
+//  culling by default). To draw e.g. wireframes or translucent lines, change it (once):
+//  PipelineState::Desc desc;
+//  desc.mRaster.mPolygonMode = GL_LINE;
+//  mDebugRenderer->SetPipelineDesc(desc);
 //
 // 6. (optionally) For rendering mesh groups:
 //  mDebugRenderer->Render(meshGroup, modelTransformation, camera);
 //
+// 7. (optionally) For rendering shared useful meshes (AxisMesh, BoundingBoxMesh, ...):
+//  mDebugRenderer->RenderPrimitive(boundingBox, modelTransformation, camera);
+//  (or boundingBox->Render(mDebugRenderer, modelTransformation, camera)).
+//  It combines the model with the primitive's local matrix and sets its instance color.
+//
 // ------------------------------------------------------------------------------------------------
 
 #pragma once
 
 #include "renderer.h"
+#include "indirect_draw_list.h"
+#include "pipeline_state.h"
 #include "gloo/group.h"
 #include "gloo/camera.h"
 
@@ -83,9 +97,28 @@ public:
   template <StorageFormat F>
   void Render(const MeshGroup<F>* mesh, Transform & model, Camera* camera, int pass=0) const;
 
+  // Same as above, with a plain model matrix (e.g. SceneGraph::GetWorldMatrix()).
+  template <StorageFormat F>
+  void Render(const MeshGroup<F>* mesh, const glm::mat4 & model, Camera* camera, int pass=0) const;
+
+  // Renders all draws of a list at once. It requires the vertex pulling shaders:
+  //   gl-oo-interface/shaders/debug_pulling/vertex_shader.glsl (and fragment_shader.glsl).
+  // They fetch the position (location 0) and color (location 1, or the material Kd otherwise).
+  void Render(const IndirectDrawList* drawList, Camera* camera) const;
+
+  // Renders a useful mesh whose geometry is shared (see gloo_tools/useful_meshes.h).
+  // Primitive must provide GetLocalMatrix() and Draw() (see e.g. BoundingBoxMesh::Render()).
+  template <class Primitive>
+  void RenderPrimitive(const Primitive* primitive, Transform & model, Camera* camera) const;
+
   inline unsigned GetNumRenderingPasses() const { return 1; }
 
   inline const ShaderProgram* GetShaderProgram(int renderingPass = 0) const { return mDebugShader; }
+
+  // Sets the depth/stencil, blend and raster state that Bind() applies (the program is always
+  // the debug shader). Returns false, keeping the previous state, if desc is invalid.
+  bool SetPipelineDesc(const PipelineState::Desc & desc);
+  inline const PipelineState* GetPipelineState(int renderingPass = 0) const { return mPipeline; }
   
   GLint GetAttribLocation( const std::string & name, int renderingPass = 0) const;
   GLint GetUniformLocation(const std::string & name, int renderingPass = 0) const;
@@ -96,9 +129,16 @@ public:
   GLint GetModelViewProjUniformLoc() const { return mModelViewProjMatrixLoc; }
 
 protected:
+  // Sets Proj * View * Model (shadowed: uploaded only if it changed since the last draw).
+  void SetModelViewProj(const glm::mat4 & model, Camera* camera) const;
+
   // Shader program.
   ShaderProgram* mDebugShader { nullptr };
 
+  // Pipeline state of the pass (set by Load()), and its description.
+  PipelineState::Desc mPipelineDesc;
+  const PipelineState* mPipeline { nullptr };
+
   // Main attribute/uniform locations.
   // It works as fast access variables (without querying the GPU).
   GLint mPositionAttribLoc { -1 };
@@ -113,8 +153,28 @@ protected:
 template <StorageFormat F>
 void DebugRenderer::Render(const MeshGroup<F>* mesh, Transform & model, Camera* camera, int pass) const
 {
-  camera->SetUniformModelViewProj(mModelViewProjMatrixLoc, model);  // Proj * View * Model.
+  DebugRenderer::SetModelViewProj(model.GetMatrix(), camera);
   mesh->Render(pass);
 }
 
+template <StorageFormat F>
+void DebugRenderer::Render(const MeshGroup<F>* mesh, const glm::mat4 & model, Camera* camera,
+                           int pass) const
+{
+  DebugRenderer::SetModelViewProj(model, camera);
+  mesh->Render(pass);
+}
+
+template <class Primitive>
+void DebugRenderer::RenderPrimitive(const Primitive* primitive, Transform & model, Camera* camera) const
+{
+  {
+    ScopedMatrixPush push(model);
+    model.MultMatrix(primitive->GetLocalMatrix());  // Model * Local.
+    DebugRenderer::SetModelViewProj(model.GetMatrix(), camera);
+  }
+
+  primitive->Draw();  // Sets the instance color and draws the shared geometry.
+}
+
 }  // namespace gloo.
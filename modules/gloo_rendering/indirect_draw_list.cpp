@@ -0,0 +1,112 @@
+#include "indirect_draw_list.h"
+
+#include "gloo/gl_capabilities.h"
+#include "gloo/transform.h"
+
+namespace gloo
+{
+
+IndirectDrawList::~IndirectDrawList()
+{
+  GLStateCache & gl = GLStateCache::Get();
+  gl.DeleteBuffers(1, &mRecordBuffer);
+  gl.DeleteBuffers(1, &mCommandBuffer);
+  gl.DeleteVertexArrays(1, &mVertexArray);
+}
+
+bool IndirectDrawList::Load()
+{
+  mDirectStateAccess = GLCapabilities::Get().HasDirectStateAccess();
+
+  if (mDirectStateAccess)
+  {
+    glCreateBuffers(1, &mRecordBuffer);
+    glCreateBuffers(1, &mCommandBuffer);
+    glCreateVertexArrays(1, &mVertexArray);
+  }
+  else
+  {
+    glGenBuffers(1, &mRecordBuffer);
+    glGenBuffers(1, &mCommandBuffer);
+    glGenVertexArrays(1, &mVertexArray);
+  }
+
+  mDirty = true;
+  return (mRecordBuffer != 0) && (mCommandBuffer != 0) && (mVertexArray != 0);
+}
+
+void IndirectDrawList::Clear()
+{
+  mRecords.clear();
+  mCommands.clear();
+  mDirty = true;
+}
+
+void IndirectDrawList::Add(int mesh, const glm::mat4 & model, const Material & material)
+{
+  const GeometryBuffer::Range & range = mGeometry->GetRange(mesh);
+
+  DrawRecord record;
+  record.mModel = model;
+  record.mNormal = Transform::ComputeInverseTranspose(model);
+  record.mKa = glm::vec4(material.mKa, 0.0f);
+  record.mKd = glm::vec4(material.mKd, 0.0f);
+  record.mKs = glm::vec4(material.mKs, 0.0f);
+  record.mFirstFloat = range.mFirstFloat;
+
+  for (int a = 0; a < GeometryBuffer::kMaxAttributes; a++)
+  {
+    record.mAttribs[a][0] = range.mAttribOffset[a];
+    record.mAttribs[a][1] = range.mAttribStride[a];
+  }
+
+  // gl_VertexID is the element itself (base vertex 0): the shader adds the offsets.
+  const Command command = { range.mNumElements, 1, range.mFirstElement, 0, 0 };
+
+  mRecords.push_back(record);
+  mCommands.push_back(command);
+  mDirty = true;
+}
+
+void IndirectDrawList::Draw() const
+{
+  if (mCommands.empty())
+    return;
+
+  if (mDirty)
+  {
+    IndirectDrawList::Upload(mRecordBuffer, GL_SHADER_STORAGE_BUFFER,
+                             mRecords.size() * sizeof(DrawRecord), mRecords.data());
+    IndirectDrawList::Upload(mCommandBuffer, GL_DRAW_INDIRECT_BUFFER,
+                             mCommands.size() * sizeof(Command), mCommands.data());
+    mDirty = false;
+  }
+
+  GLStateCache & gl = GLStateCache::Get();
+  gl.BindVertexArray(mVertexArray);
+  gl.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mGeometry->GetElementBuffer());
+  gl.BindBufferBase(GL_SHADER_STORAGE_BUFFER, kDrawRecordsStorageBinding, mRecordBuffer);
+  gl.BindBufferBase(GL_SHADER_STORAGE_BUFFER, kVertexDataStorageBinding,
+                    mGeometry->GetVertexBuffer());
+  gl.BindBuffer(GL_DRAW_INDIRECT_BUFFER, mCommandBuffer);
+
+  glMultiDrawElementsIndirect(mDrawMode, GL_UNSIGNED_INT, nullptr,
+                              static_cast<GLsizei>(mCommands.size()), 0);
+}
+
+void IndirectDrawList::Upload(GLuint buffer, GLenum target, GLsizeiptr size,
+                              const GLvoid* data) const
+{
+  // A new data store each time: no wait for the draws that read the previous one.
+  if (mDirectStateAccess)
+  {
+    glNamedBufferData(buffer, size, data, GL_STREAM_DRAW);
+  }
+  else
+  {
+    GLStateCache::Get().BindBuffer(target, buffer);
+    glBufferData(target, size, data, GL_STREAM_DRAW);
+  }
+}
+
+}  // namespace gloo.
@@ -0,0 +1,117 @@
+// + ======================================== +
+// |         gl-oo-interface library          |
+// |         Module: GLOO Rendering.          |
+// |        Author: Rodrigo Castiel, 2016.    |
+// + ======================================== +
+//
+// gloo::IndirectDrawList draws many meshes of a gloo::GeometryBuffer, whatever their vertex
+// layout, with a single glMultiDrawElementsIndirect() call. Each draw has a record (model and
+// normal matrices, material, and where the attributes of the mesh are in the geometry buffer),
+// stored in a shader storage buffer and read by the vertex shader at gl_DrawIDARB. The vertex
+// shader fetches its vertices itself (see shaders/debug_pulling and shaders/phong_pulling): no
+// vertex format, hence a single (empty) VAO for all meshes.
+//
+// Usage:
+//   IndirectDrawList* drawList = new IndirectDrawList(geometry);
+//   drawList->Load();  // With a current GL context.
+//   ...
+//   drawList->Clear();
+//   drawList->Add(mesh, modelMatrix, material);  // For each object.
+//   ...
+//   phongRenderer->Render(drawList, camera);     // Or debugRenderer->Render(drawList, camera).
+//
+// Records and commands are uploaded by the first Draw() after they change: a list that is not
+// cleared is drawn again without any upload. Requires GLCapabilities::HasVertexPulling().
+//
+// Storage buffer bindings (fixed in the shaders):
+//   0: draw records (DrawRecord, std430).
+//   1: vertex data (floats of the geometry buffer).
+
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "gloo/gl_header.h"
+#include "gloo/gl_state_cache.h"
+#include "gloo/geometry_buffer.h"
+#include "gloo/material.h"
+
+namespace gloo
+{
+
+const GLuint kDrawRecordsStorageBinding = 0;
+const GLuint kVertexDataStorageBinding  = 1;
+
+// Mirrors struct DrawRecord of the vertex pulling shaders (std430).
+struct DrawRecord
+{
+  glm::mat4 mModel { 1.0f };
+  glm::mat4 mNormal { 1.0f };
+  glm::vec4 mKa { 0.0f };  // Material (w is not used).
+  glm::vec4 mKd { 0.0f };
+  glm::vec4 mKs { 0.0f };
+  GLint mAttribs[GeometryBuffer::kMaxAttributes][2];  // (offset, stride) of each location.
+  GLuint mFirstFloat { 0 };
+  GLuint mPadding[3] { };
+};
+
+static_assert(sizeof(DrawRecord) == 224, "DrawRecord does not match the std430 layout.");
+
+class IndirectDrawList
+{
+public:
+  // Draws meshes of geometry (as drawMode primitives).
+  explicit IndirectDrawList(const GeometryBuffer* geometry, GLenum drawMode = GL_TRIANGLES)
+  : mGeometry(geometry)
+  , mDrawMode(drawMode) { }
+
+  ~IndirectDrawList();
+
+  // Creates the buffers and the vertex array (requires a current GL context).
+  bool Load();
+
+  // Removes all draws.
+  void Clear();
+
+  // Adds a draw of a mesh of the geometry buffer.
+  void Add(int mesh, const glm::mat4 & model, const Material & material = Material());
+
+  // Issues all draws (with the program of the pulling shaders in use).
+  void Draw() const;
+
+  // Getters.
+  size_t GetNumDraws() const { return mCommands.size(); }
+  GLenum GetDrawMode() const { return mDrawMode; }
+
+private:
+  // Layout of glMultiDrawElementsIndirect() commands.
+  struct Command
+  {
+    GLuint mCount;
+    GLuint mInstanceCount;
+    GLuint mFirstIndex;
+    GLint mBaseVertex;
+    GLuint mBaseInstance;
+  };
+
+  IndirectDrawList(const IndirectDrawList &) = delete;
+  IndirectDrawList & operator=(const IndirectDrawList &) = delete;
+
+  // Replaces the contents of buffer (orphaning the previous ones).
+  void Upload(GLuint buffer, GLenum target, GLsizeiptr size, const GLvoid* data) const;
+
+  const GeometryBuffer* mGeometry;
+  GLenum mDrawMode;
+
+  std::vector<DrawRecord> mRecords;
+  std::vector<Command> mCommands;
+  mutable bool mDirty { true };  // Changed since the last upload.
+
+  GLuint mRecordBuffer  { 0 };  // Shader storage buffer.
+  GLuint mCommandBuffer { 0 };  // Draw indirect buffer.
+  GLuint mVertexArray   { 0 };  // Empty (only the element array buffer is attached).
+  bool mDirectStateAccess { false };
+};
+
+}  // namespace gloo.
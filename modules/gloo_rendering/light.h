@@ -21,15 +21,6 @@ namespace gloo
 
 const GLint kNoUniform = -1;
 
-struct LightUniformPack
-{
-  GLint mPosLoc;    // Location of vec3 position.
-  GLint mDirLoc;    // Location of vec3 direction.
-  GLint mLdLoc;     // Location of diffuse component.
-  GLint mLsLoc;     // Location of specular component.
-  GLint mAlphaLoc;  // Location of alpha component.
-};
-
 struct LightSource
 {
   // Position and direction (in world coordinates).
@@ -1,5 +1,8 @@
 #include "phong_renderer.h"
 
+#include <cstring>
+#include <iostream>
+
 #define GLM_SWIZZLE
 #include "gloo/gl_header.h"
 
@@ -10,162 +13,333 @@ namespace gloo
 
 PhongRenderer::~PhongRenderer()
 {
-  delete mPhongShader;
+  // The variants belong to mPermutations.
+}
+
+void PhongRenderer::AddFeatures()
+{
+  // In the order of enum Feature.
+  mPermutations.AddFeature("LIGHTING");
+  mPermutations.AddFeature("NUM_LIGHTS", 4);
+  mPermutations.AddFeature("COLOR_MAP");
+  mPermutations.AddFeature("NORMAL_MAP");
 }
 
 bool PhongRenderer::Load()
 {
-  // Allocate shader.
-  mPhongShader = new ShaderProgram();
+  mPhongShader = nullptr;
+  mFailedVariants.clear();
 
-  // Load and build it.
-  mPhongShader->BuildFromFiles(mVertexShaderPath, mFragmentShaderPath);
+  // Load the sources.
+  if (!mPermutations.Load())
+    return false;
 
-  // Check if compilation was successful.
-  gloo::CompilationStatus status = mPhongShader->GetCompilationStatus();
+  // Build the variant with all features on: it checks all the code, and it uses every attribute
+  // (inactive attributes have no location, even with an explicit layout).
+  const uint32_t fullKey = mPermutations.Encode(kLightingFeature, 1) |
+                           mPermutations.Encode(kNumLightsFeature, kMaxNumberLights) |
+                           mPermutations.Encode(kColorMapFeature, 1) |
+                           mPermutations.Encode(kNormalMapFeature, 1);
 
-  if (status == gloo::CompilationStatus::kSuccess)
-  {
-    mPhongShader->Bind();
-
-    // Get uniform/attribute locations.
-    mPositionAttribLoc = mPhongShader->GetAttribLocation("v_position");
-    mNormalAttribLoc   = mPhongShader->GetAttribLocation("v_normal");
-    mTextureAttribLoc  = mPhongShader->GetAttribLocation("v_uv");
-    mTangentAttribLoc  = mPhongShader->GetAttribLocation("v_tangent");
-
-    mProjMatrixLoc   = mPhongShader->GetUniformLocation("P");
-    mViewMatrixLoc   = mPhongShader->GetUniformLocation("V");
-    mModelMatrixLoc  = mPhongShader->GetUniformLocation("M");
-    mNormalMatrixLoc = mPhongShader->GetUniformLocation("N");
-
-    // Pre-load material uniform pack.
-    mMaterialUniform.mKaLoc = mPhongShader->GetUniformLocation("material.Ka");
-    mMaterialUniform.mKdLoc = mPhongShader->GetUniformLocation("material.Kd");
-    mMaterialUniform.mKsLoc = mPhongShader->GetUniformLocation("material.Ks");
-
-    // Pre-load light uniform packs.
-    mLightingLoc = mPhongShader->GetUniformLocation("lighting");
-    mNumLightUniform = mPhongShader->GetUniformLocation("num_lights");
-    mLaLoc = mPhongShader->GetUniformLocation("La");
-
-    for (int i = 0; i < kMaxNumberLights; i++)
-    {
-      std::string light_prefix = "light[" + std::to_string(i) + "].";
+  if (!PhongRenderer::SelectVariant(fullKey))
+    return false;
 
-      mLightUniformArray[i].mPosLoc   = mPhongShader->GetUniformLocation(light_prefix + "pos");
-      mLightUniformArray[i].mDirLoc   = mPhongShader->GetUniformLocation(light_prefix + "dir");
-      mLightUniformArray[i].mLdLoc    = mPhongShader->GetUniformLocation(light_prefix + "Ld");
-      mLightUniformArray[i].mLsLoc    = mPhongShader->GetUniformLocation(light_prefix + "Ls");
-      mLightUniformArray[i].mAlphaLoc = mPhongShader->GetUniformLocation(light_prefix + "alpha");
+  // Get uniform/attribute locations.
+  mPositionAttribLoc = mPhongShader->GetAttribLocation("v_position");
+  mNormalAttribLoc   = mPhongShader->GetAttribLocation("v_normal");
+  mTextureAttribLoc  = mPhongShader->GetAttribLocation("v_uv");
+  mTangentAttribLoc  = mPhongShader->GetAttribLocation("v_tangent");
 
-      mLightSwitchUniformArray[i] = mPhongShader->GetUniformLocation("light_switch[" + std::to_string(i) + "]");
-    }
-
-    return true;
-  }
-  else 
-  {
-    mPhongShader->PrintCompilationLog();
-    return false;
-  }
+  mFrameBlocksDirty = true;
+  return mUniformRing.Load();
 }
 
 void PhongRenderer::Bind(int renderingPass)
 {
   if (mPhongShader) 
   {
-    mPhongShader->Bind();
+    PhongRenderer::SelectVariant(PhongRenderer::GetFeatureKey());
+
+    if (mPipeline)
+      mPipeline->Apply();  // Program and fixed-function state (only what changed).
+    else
+      mPhongShader->Bind();
   }
 }
 
-GLint PhongRenderer::GetAttribLocation(const std::string & name, int renderingPass) const
+uint32_t PhongRenderer::GetVariantKey(bool colorMap, bool normalMap) const
 {
-  if (name == "position" || name == "v_position")
-  {
-    return mPositionAttribLoc;
-  }
-  else if (name == "texture" || name == "v_uv" || name == "uv")
+  uint32_t key = mPermutations.Encode(kColorMapFeature, colorMap ? 1 : 0);
+
+  // The other features only matter with lighting: leave them out otherwise, so that they do
+  // not make distinct (but identical) variants.
+  if (mLightsBlock.mLighting)
   {
-    return mTextureAttribLoc;
+    key |= mPermutations.Encode(kLightingFeature, 1) |
+           mPermutations.Encode(kNumLightsFeature, mLightsBlock.mNumLights) |
+           mPermutations.Encode(kNormalMapFeature, normalMap ? 1 : 0);
   }
-  else if (name == "normal" || name == "v_normal")
+
+  return key;
+}
+
+void PhongRenderer::PrefetchVariants() const
+{
+  for (int colorMap = 0; colorMap < 2; colorMap++)
   {
-    return mNormalAttribLoc;
+    const uint32_t colorMapKey = mPermutations.Encode(kColorMapFeature, colorMap);
+    mPermutations.Prefetch(colorMapKey);
+
+    for (int numLights = 0; numLights <= kMaxNumberLights; numLights++)
+    {
+      for (int normalMap = 0; normalMap < 2; normalMap++)
+      {
+        mPermutations.Prefetch(colorMapKey | mPermutations.Encode(kLightingFeature, 1) |
+                               mPermutations.Encode(kNumLightsFeature, numLights) |
+                               mPermutations.Encode(kNormalMapFeature, normalMap));
+      }
+    }
   }
-  else if (name == "tangent" || name == "v_tangent")
+}
+
+bool PhongRenderer::SelectVariant(uint32_t key) const
+{
+  if (mPhongShader && (key == mVariantKey))
+    return true;
+
+  // A variant that does not compile (or set up) is not retried.
+  if (mFailedVariants.count(key))
+    return false;
+
+  // The first variant is always built synchronously: it stands in for the others.
+  bool compiled = false;
+  ShaderProgram* variant = nullptr;
+  if (mAsyncCompilation && mPhongShader)
+    variant = mPermutations.Request(key, &compiled);
+  else
+    variant = mPermutations.Get(key, &compiled);
+
+  if (!variant)
   {
-    return mTangentAttribLoc;
+    // One that is still compiling is polled again by the next Bind()/Flush(). Either way, the
+    // current variant (and mVariantKey) stays.
+    if (mPermutations.GetStatus(key) != kPending)
+      mFailedVariants.insert(key);
+
+    return false;
   }
-  else  // Search it up.
+
+  variant->Bind();
+  if (compiled && !PhongRenderer::SetUpVariant(variant))
   {
-    return mPhongShader->GetAttribLocation(name);
+    mFailedVariants.insert(key);
+    if (mPhongShader)
+      mPhongShader->Bind();
+
+    return false;
   }
+
+  // Samplers are plain uniforms of each program (shadowed: only new values are uploaded).
+  for (const auto & unit : mTextureUnits)
+    variant->SetUniform(HashName(unit.first), static_cast<GLint>(unit.second));
+  variant->FlushUniforms();
+
+  // Each variant has its own pipeline state: same fixed-function state, another program.
+  mPhongShader = variant;
+  mVariantKey = key;
+  mPipelineDesc.mProgram = variant;
+  mPipeline = PipelineState::Get(mPipelineDesc);
+  return true;
 }
 
-GLint PhongRenderer::GetUniformLocation(const std::string & name, int renderingPass) const
+bool PhongRenderer::SetPipelineDesc(const PipelineState::Desc & desc)
 {
-  if (name == "M" || name == "model")
+  PipelineState::Desc pipelineDesc = desc;
+  pipelineDesc.mProgram = mPhongShader;  // nullptr until Load().
+
+  if (pipelineDesc.mProgram)
   {
-    return mModelMatrixLoc;
+    const PipelineState* pipeline = PipelineState::Get(pipelineDesc);
+    if (!pipeline)
+      return false;
+
+    mPipeline = pipeline;
   }
-  else if (name == "V" || name == "view")
+  else if (!PipelineState::Validate(pipelineDesc))
   {
-    return mViewMatrixLoc;
+    return false;
   }
-  else if (name == "P" || name == "projection" || name == "proj")
+
+  mPipelineDesc = pipelineDesc;
+  return true;
+}
+
+bool PhongRenderer::SetUpVariant(const ShaderProgram* variant) const
+{
+  // Attach the uniform blocks to their binding points (see uniform_blocks.h). A variant without
+  // lighting does not use the Lights block, which is then optimized out. The vertex pulling
+  // shaders have no Object block (see IndirectDrawList). Only the shadow_phong shaders have a
+  // Shadows block (see PhongShadowMappingRenderer).
+  const GLuint program = variant->GetHandle();
+  const char* blockNames[] = { "Camera", "Object", "Lights", "Shadows" };
+  const GLuint blockBindings[] = { kCameraBlockBinding, kObjectBlockBinding,
+                                   kLightsBlockBinding, kShadowsBlockBinding };
+  const bool blockRequired[] = { true, false, false, false };
+
+  for (int i = 0; i < 4; i++)
   {
-    return mProjMatrixLoc;
+    const GLuint blockIndex = variant->GetUniformBlockIndex(blockNames[i]);
+    if (blockIndex != GL_INVALID_INDEX)
+    {
+      glUniformBlockBinding(program, blockIndex, blockBindings[i]);
+    }
+    else if (blockRequired[i])
+    {
+      std::cerr << "ERROR: uniform block '" << blockNames[i] << "' not found in the phong "
+                << "shader." << std::endl;
+      return false;
+    }
   }
-  else if (name == "N" || name == "normal")
+
+  return true;
+}
+
+void PhongRenderer::Flush() const
+{
+  // Features changed after Bind() (e.g. EnableLighting() between draws).
+  const uint32_t key = PhongRenderer::GetFeatureKey();
+  if (key != mVariantKey)
+    PhongRenderer::SelectVariant(key);
+
+  if (mPhongShader)
+    mPhongShader->FlushUniforms();
+
+  // Camera and lights go along with the object block if they changed, or if the ring moved on
+  // since their upload (their copy in the previous segment may be overwritten). Otherwise their
+  // ranges are bound again: GLStateCache drops that unless another renderer (or another
+  // PhongRenderer) took the binding points in between.
+  const GLsizeiptr cameraSize = mUniformRing.Align(sizeof(CameraBlock));
+  const GLsizeiptr lightsSize = mUniformRing.Align(sizeof(LightsBlock));
+  const GLsizeiptr objectSize = sizeof(ObjectBlock);
+
+  char* data = static_cast<char*>(mUniformRing.Map(cameraSize + lightsSize + objectSize));
+  if (!data)
+    return;
+
+  const bool uploadFrameBlocks = mFrameBlocksDirty ||
+                                 (mFrameBlocksGeneration != mUniformRing.GetGeneration());
+
+  GLsizeiptr objectOffset = 0;
+  if (uploadFrameBlocks)
   {
-    return mNormalMatrixLoc;
+    std::memcpy(data, &mCameraBlock, sizeof(CameraBlock));
+    std::memcpy(data + cameraSize, &mLightsBlock, sizeof(LightsBlock));
+    objectOffset = cameraSize + lightsSize;
   }
-  else // Search it up.
+  std::memcpy(data + objectOffset, &mObjectBlock, objectSize);
+
+  const GLintptr base = mUniformRing.Unmap(objectOffset + objectSize);
+
+  if (uploadFrameBlocks)
   {
-    return mPhongShader->GetUniformLocation(name);
+    mFrameBlocksBase = base;
+    mFrameBlocksGeneration = mUniformRing.GetGeneration();
+    mFrameBlocksDirty = false;
+    UniformState::CountUploaded(2);
   }
+  mUniformRing.BindRange(kCameraBlockBinding, mFrameBlocksBase, sizeof(CameraBlock));
+  mUniformRing.BindRange(kLightsBlockBinding, mFrameBlocksBase + cameraSize, sizeof(LightsBlock));
+  mUniformRing.BindRange(kObjectBlockBinding, base + objectOffset, objectSize);
 }
 
-namespace 
+void PhongRenderer::Render(const IndirectDrawList* drawList, Camera* camera) const
 {
-  void SetUniform3f(GLint loc, const glm::vec3 & data)
+  PhongRenderer::SetCamera(camera);
+  PhongRenderer::Render(drawList);
+}
+
+void PhongRenderer::Render(const IndirectDrawList* drawList) const
+{
+  PhongRenderer::Flush();
+  drawList->Draw();
+}
+
+GLint PhongRenderer::GetAttribLocation(const std::string & name, int renderingPass) const
+{
+  // The names are compared by hash: a switch on compile-time constants (two equal hashes would
+  // not compile) instead of a chain of string comparisons.
+  const NameHash hash = HashName(name);
+
+  switch (hash.mValue)
   {
-    if (loc != kNoUniform)
-    {
-      glUniform3f(loc, data[0], data[1], data[2]);
-    }
+    case HashName("position").mValue:
+    case HashName("v_position").mValue:
+      return mPositionAttribLoc;
+
+    case HashName("texture").mValue:
+    case HashName("v_uv").mValue:
+    case HashName("uv").mValue:
+      return mTextureAttribLoc;
+
+    case HashName("normal").mValue:
+    case HashName("v_normal").mValue:
+      return mNormalAttribLoc;
+
+    case HashName("tangent").mValue:
+    case HashName("v_tangent").mValue:
+      return mTangentAttribLoc;
+
+    default:  // Search it up.
+      return mPhongShader->GetAttribLocation(hash);
   }
+}
 
-  void SetUniform1f(GLint loc, GLfloat data)
+GLint PhongRenderer::GetUniformLocation(const std::string & name, int renderingPass) const
+{
+  return mPhongShader->GetUniformLocation(name);
+}
+
+void PhongRenderer::SetTextureUnit(const std::string & samplerName, GLuint slot) const
+{
+  bool found = false;
+  for (auto & unit : mTextureUnits)
   {
-    if (loc != kNoUniform)
+    if (unit.first == samplerName)
     {
-      glUniform1f(loc, data);
+      unit.second = slot;
+      found = true;
     }
   }
+
+  if (!found)
+    mTextureUnits.emplace_back(samplerName, slot);
+
+  // Uploaded by the next Flush(). The other variants get it when they are selected.
+  if (mPhongShader)
+    mPhongShader->SetUniform(HashName(samplerName), static_cast<GLint>(slot));
 }
 
 void PhongRenderer::SetLightAmbientComponent(const glm::vec3 & La) const
 {
-  SetUniform3f(mLaLoc, La);
+  PhongRenderer::SetFrameValue(mLightsBlock.mLa, La);
 }
 
 void PhongRenderer::SetLightSource(const LightSource & lightSource, int slot) const
 {
-  const LightUniformPack & lightSourceUniform = mLightUniformArray[slot];
+  LightSourceBlock block = mLightsBlock.mLights[slot];
 
-  SetUniform3f(lightSourceUniform.mPosLoc, lightSource.mPos);  // Position.
-  SetUniform3f(lightSourceUniform.mDirLoc, lightSource.mDir);  // Direction.
-  SetUniform3f(lightSourceUniform.mLdLoc,  lightSource.mLd);  // Diffuse component.
-  SetUniform3f(lightSourceUniform.mLsLoc,  lightSource.mLs);  // Specular component.
-  SetUniform1f(lightSourceUniform.mAlphaLoc, lightSource.mAlpha);  // Shininess.
+  block.mPos = lightSource.mPos;      // Position.
+  block.mDir = lightSource.mDir;      // Direction.
+  block.mLd  = lightSource.mLd;       // Diffuse component.
+  block.mLs  = lightSource.mLs;       // Specular component.
+  block.mAlpha = lightSource.mAlpha;  // Shininess.
+  PhongRenderer::SetFrameValue(mLightsBlock.mLights[slot], block);
 }
 
 void PhongRenderer::SetLightSourceInCameraCoordinates(const LightSource & lightSource, 
                                                       const Camera * camera, int slot) const
 {
-  const LightUniformPack & lightSourceUniform = mLightUniformArray[slot];
+  LightSourceBlock block = mLightsBlock.mLights[slot];
 
   // Transform position/direction into camera coordinates.
   glm::vec4 p = glm::vec4(lightSource.mPos, 1.0f);
@@ -176,18 +350,19 @@ void PhongRenderer::SetLightSourceInCameraCoordinates(const LightSource & lightS
   d = V * d;
   p = p / p[3];  // Normalize homogenous coordinates.
 
-  SetUniform3f(lightSourceUniform.mPosLoc, p.xyz());  // Position.
-  SetUniform3f(lightSourceUniform.mDirLoc, d.xyz());  // Direction.
-  SetUniform3f(lightSourceUniform.mLdLoc,  lightSource.mLd);  // Diffuse component.
-  SetUniform3f(lightSourceUniform.mLsLoc,  lightSource.mLs);  // Specular component.
-  SetUniform1f(lightSourceUniform.mAlphaLoc, lightSource.mAlpha);  // Shininess.
+  block.mPos = p.xyz();               // Position.
+  block.mDir = d.xyz();               // Direction.
+  block.mLd  = lightSource.mLd;       // Diffuse component.
+  block.mLs  = lightSource.mLs;       // Specular component.
+  block.mAlpha = lightSource.mAlpha;  // Shininess.
+  PhongRenderer::SetFrameValue(mLightsBlock.mLights[slot], block);
 }
 
 void PhongRenderer::SetMaterial(const Material & material) const
 {
-  SetUniform3f(mMaterialUniform.mKaLoc,  material.mKa);  // Ambient component.
-  SetUniform3f(mMaterialUniform.mKdLoc,  material.mKd);  // Diffuse component.
-  SetUniform3f(mMaterialUniform.mKsLoc,  material.mKs);  // Specular component.
+  mObjectBlock.mMaterial.mKa = material.mKa;  // Ambient component.
+  mObjectBlock.mMaterial.mKd = material.mKd;  // Diffuse component.
+  mObjectBlock.mMaterial.mKs = material.mKs;  // Specular component.
 }
 
-}  // namespace gloo.
\ No newline at end of file
+}  // namespace gloo.
@@ -12,11 +12,13 @@
 //  Fragment: "../../shaders/phong/fragment_shader.glsl"
 //
 // Optionally, you can write custom shaders based on the above shaders to extend the features.
-// As example, in the folder 'shaders' you can find the normal_mapping_phong shaders.
+// As example, in the folder 'shaders' you can find the normal_mapping_phong shaders. The
+// phong_pulling shaders fetch their vertices from a gloo::GeometryBuffer instead of vertex
+// attributes, to render many meshes per draw call (see Render(const IndirectDrawList*)).
 // Perhaps, you could also add more texture samplers or anything to improve your rendering.
-// PhongRenderer contains several methods for querying attribute/uniform locations in an 
-// optimized way (it stores in the client memory all IDs). 
-// 
+// PhongRenderer contains several methods for querying attribute locations in an optimized way
+// (it stores in the client memory all IDs).
+//
 // This is the list of mandatory uniforms/attributes that the Phong Shader must have:
 // Reference of Attributes:
 //  vec3 v_position;  // Vertex position (object coordinates).
@@ -24,20 +26,35 @@
 //  vec2 v_uv;        // Texture coordinates.
 //
 // Reference of Uniforms:
-// (Vertex)
-//  mat4 M;  // Model matrix.
-//  mat4 V;  // View  matrix.
-//  mat4 P;  // Projection matrix.
-//  mat4 N;  // Normal matrix N = (VM)^-t.
+//  uniform Camera { ... };  // V, P (per frame).
+//  uniform Lights { ... };  // Light sources, La, lighting switch (per frame).
+//  uniform Object { ... };  // M, N and material (per draw).
+//  sampler2D color_map;     // Color texture sampler.
 //
-// (Fragment)
-//  int lighting = 0;                   // Light switch (toggle on/off).
-//  int num_lights = 1;                 // Number of light sources.
-//  int light_switch[max_num_lights];   // Array of light source states (on/off).
-//  vec3 La = vec3(0.1);                // Ambient light component.
-//  LightSource light[max_num_lights];  // Array of light sources.
-//  sampler2D color_map;  // Color texture sampler.
-//  Material material;    // Material properties (Ka, Kd, Ks).
+// Shader variants: the phong shaders are compiled with #define feature flags instead of branching
+// on uniforms (see gloo::ShaderPermutations):
+//  LIGHTING      Lighting on (otherwise the surface color is output as is).
+//  NUM_LIGHTS    Number of light sources (loop size, in [0, kMaxNumberLights]).
+//  COLOR_MAP     Diffuse color from color_map (otherwise material Kd).
+//  NORMAL_MAP    Normals from normal_map (shaders that support it).
+// Bind() (and Flush(), if the features changed since) selects the variant that matches the
+// current settings, compiling it the first time it is used. Load() compiles the variant with all
+// features on, to check the shaders and get the attribute locations. The other variants compile
+// asynchronously (see ShaderProgram::BuildFromStringsAsync()): until the matching one is ready,
+// the previous variant is used instead (IsVariantReady() tells when it is not the right one).
+// PrefetchVariants() submits them all at once, e.g. at load time. Samplers set with
+// SetTextureUnit() apply to all variants; other plain uniforms belong to the current variant.
+//
+// Camera, Lights and Object are std140 uniform blocks, mirrored by the structs of
+// uniform_blocks.h (which documents their members). The setters below only change a copy of
+// the blocks in client memory (a memcpy); Render() uploads what changed into a ring of uniform
+// buffers (gloo::UniformRingBuffer, persistently mapped with GL 4.4: a memcpy, no driver call)
+// and binds it with glBindBufferRange(). Camera and lights are uploaded once per frame (when
+// they change), and the object block once per draw. Their ranges are re-bound before each draw
+// through gloo::GLStateCache, which only issues the call when another renderer took the binding
+// points. The camera and light setters compare the new value with the copy first: setting the
+// same lights every frame does not upload them again. Samplers are shadowed by each variant
+// (see ShaderProgram::SetUniform()). Both count in UniformState::GetStats().
 //
 // Basic Usage:
 //
@@ -48,9 +65,8 @@
 // 2. Load and check for errors:
 //  bool success = mPhongRenderer->Load();
 //
-// 3. Get default shader attribute/uniform locations (please read the method declarations):
+// 3. Get default shader attribute locations (please read the method declarations):
 //  GLint attribLoc  = mPhongRenderer->Get<Name>AttribLoc();
-//  GLint uniformLoc = mPhongRenderer->Get<Name>UniformLoc();
 //  ...
 //
 // 4. Get custom shader attribute/uniform locations (please read the method declarations):
@@ -60,13 +76,17 @@
 //
 // 5. Before use (i.e. rendering calls):
 //  mPhongRenderer->Bind();
+//  It applies the pipeline state of the current variant: its program, and the depth/stencil,
+//  blend and raster state of SetPipelineDesc() (depth test on, no blending, no culling by
+//  default). Only the state that differs from the previous pass is changed.
 //
 // 6. Lighting management:
 //  (a) EnableLighting() or DisableLighting() to toggle on/off the lighting.
 //  (b) EnableLightSource() or DisableLightSource() to toggle on/off a specific light source.
-//  (c) SetNumLightSources() for setting the loop size when rendering on shader.
+//  (c) SetNumLightSources() for setting the loop size when rendering on shader (NUM_LIGHTS).
 //  (d) SetLightSource() for setting the light source properties in world coordinates.
 //  (e) SetLightSourceInCameraCoordinates() to set the light source properties in camera reference.
+//  If you draw meshes yourself instead of calling Render(), call Flush() before each draw.
 //
 // 7. Material and texture management:
 //  (a) SetMaterial() to update the current material properties.
@@ -77,25 +97,37 @@
 //      mPhongRenderer->SetTextureUnit(color_map, slot);
 //     And then bind your Texture* to this slot:
 //      myTexture->Bind(slot);
+//  (c) EnableColorMap()/DisableColorMap() and EnableNormalMap()/DisableNormalMap() to tell
+//     whether the textures are present (both on by default).
 //
 // ------------------------------------------------------------------------------------------------
 
 #pragma once 
 
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <glm/gtc/type_ptr.hpp>
 
+#include "indirect_draw_list.h"
 #include "light.h"
+#include "pipeline_state.h"
 #include "renderer.h"
+#include "uniform_blocks.h"
+#include "uniform_ring_buffer.h"
 
 #include "gloo/material.h"
 #include "gloo/group.h"
 #include "gloo/camera.h"
+#include "gloo/shader_permutations.h"
+#include "gloo/uniform_state.h"
 
 namespace gloo 
 {
 
-const int kMaxNumberLights = 8;
-
 class PhongRenderer : public Renderer
 {
 public:
@@ -105,13 +137,19 @@ public:
   : Renderer()
   , mVertexShaderPath(vertexShaderPath)
   , mFragmentShaderPath(fragmentShaderPath)
-  { }
+  , mPermutations(mVertexShaderPath, mFragmentShaderPath)
+  {
+    PhongRenderer::AddFeatures();
+  }
 
   PhongRenderer()
   : Renderer()
   , mVertexShaderPath(  "../../shaders/phong/vertex_shader.glsl")
   , mFragmentShaderPath("../../shaders/phong/fragment_shader.glsl")
-  { }
+  , mPermutations(mVertexShaderPath, mFragmentShaderPath)
+  {
+    PhongRenderer::AddFeatures();
+  }
 
   ~PhongRenderer();
 
@@ -130,11 +168,52 @@ public:
   template <StorageFormat F>
   void Render(const MeshGroup<F>* mesh, const Transform & model, int pass=0) const;
 
-  // Call bind before using PhongRenderer. Internally, it calls glUseProgram().
+  // Same as above, with a plain model matrix (e.g. SceneGraph::GetWorldMatrix()).
+  template <StorageFormat F>
+  void Render(const MeshGroup<F>* mesh, const glm::mat4 & model, Camera* camera, int pass=0) const;
+  template <StorageFormat F>
+  void Render(const MeshGroup<F>* mesh, const glm::mat4 & model, int pass=0) const;
+
+  // Renders all draws of a list at once (with or without setting the camera). It requires the
+  // vertex pulling shaders (shaders/phong_pulling), which read the model and normal matrices and
+  // the material of each draw from its record, instead of the Object block.
+  void Render(const IndirectDrawList* drawList, Camera* camera) const;
+  void Render(const IndirectDrawList* drawList) const;
+
+  // Call bind before using PhongRenderer. Internally, it selects the shader variant that matches
+  // the current features and calls glUseProgram().
   virtual void Bind(int renderingPass = 0);
 
+  // Uploads the uniform blocks that changed and binds them (Render() calls it before drawing).
+  // It switches to another variant if the features changed since Bind().
+  void Flush() const;
+
   inline unsigned GetNumRenderingPasses() const { return 1; }
   inline const ShaderProgram* GetShaderProgram(int renderingPass = 0) const { return mPhongShader; }
+  inline size_t GetNumShaderVariants() const { return mPermutations.GetNumVariants(); }
+
+  // Key of the variant that the current lighting settings select with (or without) a color map
+  // and a normal map: equal keys draw with the same program (e.g. to sort draws by variant).
+  uint32_t GetVariantKey(bool colorMap, bool normalMap) const;
+
+  // Sets the depth/stencil, blend and raster state that Bind() applies (the program is the
+  // current variant). Returns false, keeping the previous state, if desc is invalid.
+  bool SetPipelineDesc(const PipelineState::Desc & desc);
+  inline const PipelineState* GetPipelineState(int renderingPass = 0) const { return mPipeline; }
+
+  // Whether the variant in use matches the current features (otherwise it stands in for one
+  // that is still compiling, or that failed to compile).
+  inline bool IsVariantReady() const
+  {
+    return mPhongShader && (mVariantKey == PhongRenderer::GetFeatureKey());
+  }
+
+  // Submits the build of all variants without waiting (they compile in parallel when the driver
+  // supports it).
+  void PrefetchVariants() const;
+
+  // Whether variants compile without blocking Bind() (on by default). When off, Bind() waits.
+  void SetAsyncCompilation(bool async) { mAsyncCompilation = async; }
 
   GLint GetAttribLocation( const std::string & name, int renderingPass = 0) const;
   GLint GetUniformLocation(const std::string & name, int renderingPass = 0) const;
@@ -145,18 +224,10 @@ public:
   GLint GetNormalAttribLoc()   const { return mNormalAttribLoc;   }
   GLint GetTangentAttribLoc()  const { return mTangentAttribLoc;  }
 
-  GLint GetViewUniformLoc()   const { return mViewMatrixLoc; }
-  GLint GetProjUniformLoc()   const { return mProjMatrixLoc; }
-  GLint GetModelUniformLoc()  const { return mModelMatrixLoc;  }
-  GLint GetNormalUniformLoc() const { return mNormalMatrixLoc; }
-
-  GLint GetLightAmbientComponentLoc() const { return mLaLoc; }
-  LightUniformPack GetLightSourceUniformLoc(int slot) const { return mLightUniformArray[slot]; }
-  MaterialUniformPack GetMaterialUniformLoc() const { return mMaterialUniform; }
-
   // Geometric transformation methods.
   void SetCamera(const Camera* camera) const;
   void SetModelNormalMatrix(const Transform & model) const;
+  void SetModelNormalMatrix(const glm::mat4 & model) const;
 
   // === Lighting configuration methods ===
   
@@ -187,9 +258,53 @@ public:
   void SetTextureUnit(const char * samplerName, GLuint slot) const;
   void SetTextureUnit(const std::string & samplerName, GLuint slot) const;
 
+  // Whether a color map/normal map is bound (selects the shader variant).
+  void EnableColorMap()   const { mColorMap = true;   }
+  void DisableColorMap()  const { mColorMap = false;  }
+  void EnableNormalMap()  const { mNormalMap = true;  }
+  void DisableNormalMap() const { mNormalMap = false; }
+
 private:
-  // Shader Program.
-  ShaderProgram* mPhongShader { nullptr };
+  // Indices of the shader features (in the order AddFeatures() declares them).
+  enum Feature { kLightingFeature, kNumLightsFeature, kColorMapFeature, kNormalMapFeature };
+
+  // Declares the features to mPermutations.
+  void AddFeatures();
+
+  // Variant key of the current settings.
+  uint32_t GetFeatureKey() const { return PhongRenderer::GetVariantKey(mColorMap, mNormalMap); }
+
+  // Binds the variant of key (compiling and setting it up if needed). If it does not compile,
+  // or is still compiling, the current variant is kept and false is returned.
+  bool SelectVariant(uint32_t key) const;
+
+  // Attaches the uniform blocks of a new variant to their binding points.
+  bool SetUpVariant(const ShaderProgram* variant) const;
+
+  // Changes the view matrix only (the camera of Render()).
+  void SetViewMatrix(const glm::mat4 & view) const;
+
+  // Sets a member of the camera/lights blocks, which are then uploaded by the next Flush() only
+  // if the value changed.
+  template <typename T>
+  void SetFrameValue(T & member, const T & value) const;
+
+  // Current shader variant (owned by mPermutations).
+  mutable ShaderProgram* mPhongShader { nullptr };
+  mutable uint32_t mVariantKey { 0 };                    // Of mPhongShader.
+  mutable std::unordered_set<uint32_t> mFailedVariants;  // Keys that did not compile.
+
+  // Pipeline state of the current variant, and its description (mProgram is the variant).
+  mutable PipelineState::Desc mPipelineDesc;
+  mutable const PipelineState* mPipeline { nullptr };
+  bool mAsyncCompilation { true };
+
+  // Features that do not live in the uniform blocks.
+  mutable bool mColorMap { true };
+  mutable bool mNormalMap { true };
+
+  // Sampler name -> texture unit, set on every variant.
+  mutable std::vector<std::pair<std::string, GLuint>> mTextureUnits;
 
   // Fast-access attribute/uniform locations.
   GLint mPositionAttribLoc { -1 };
@@ -197,24 +312,22 @@ private:
   GLint mNormalAttribLoc   { -1 };
   GLint mTangentAttribLoc  { -1 };
 
-  GLint mViewMatrixLoc   { -1 };
-  GLint mProjMatrixLoc   { -1 };
-  GLint mModelMatrixLoc  { -1 };
-  GLint mNormalMatrixLoc { -1 };
-
-  // Lighting.  
-  GLint mLightingLoc { -1 };
-  GLint mLaLoc { -1 };
-  GLint mNumLightUniform { -1 };
-  GLint mLightSwitchUniformArray[kMaxNumberLights];
-  LightUniformPack mLightUniformArray[kMaxNumberLights];
-
-  // Material.
-  MaterialUniformPack mMaterialUniform;  // Set of material uniforms.
+  // Client copies of the uniform blocks. They mirror GPU state, which const methods have
+  // always been allowed to change, hence mutable.
+  mutable CameraBlock mCameraBlock;
+  mutable LightsBlock mLightsBlock;
+  mutable ObjectBlock mObjectBlock;
+  mutable bool mFrameBlocksDirty { true };        // Camera or lights changed since the upload.
+  mutable unsigned mFrameBlocksGeneration { 0 };  // Ring generation of their last upload.
+  mutable GLintptr mFrameBlocksBase { 0 };        // Offset of that upload in the ring.
+  mutable UniformRingBuffer mUniformRing;
 
   // Constant data (passed to constructor).
   const std::string mVertexShaderPath;
   const std::string mFragmentShaderPath;
+
+  // Shader variants (compiled on demand, after mVertexShaderPath/mFragmentShaderPath).
+  mutable ShaderPermutations mPermutations;
 };
 
 // ----- Rendering methods ------------------------------------------------------------------------
@@ -224,7 +337,8 @@ void PhongRenderer::Render(const MeshGroup<F>* mesh, const Transform & model, Ca
                            int pass) const
 {
   PhongRenderer::SetModelNormalMatrix(model);
-  camera->SetUniformViewMatrix(mViewMatrixLoc);
+  PhongRenderer::SetViewMatrix(camera->GetViewMatrix());
+  PhongRenderer::Flush();
   mesh->Render(pass);
 }
 
@@ -232,6 +346,25 @@ template <StorageFormat F>
 void PhongRenderer::Render(const MeshGroup<F>* mesh, const Transform & model, int pass) const
 {
   PhongRenderer::SetModelNormalMatrix(model);
+  PhongRenderer::Flush();
+  mesh->Render(pass);
+}
+
+template <StorageFormat F>
+void PhongRenderer::Render(const MeshGroup<F>* mesh, const glm::mat4 & model, Camera* camera,
+                           int pass) const
+{
+  PhongRenderer::SetModelNormalMatrix(model);
+  PhongRenderer::SetViewMatrix(camera->GetViewMatrix());
+  PhongRenderer::Flush();
+  mesh->Render(pass);
+}
+
+template <StorageFormat F>
+void PhongRenderer::Render(const MeshGroup<F>* mesh, const glm::mat4 & model, int pass) const
+{
+  PhongRenderer::SetModelNormalMatrix(model);
+  PhongRenderer::Flush();
   mesh->Render(pass);
 }
 
@@ -240,60 +373,80 @@ void PhongRenderer::Render(const MeshGroup<F>* mesh, const Transform & model, in
 inline
 void PhongRenderer::SetTextureUnit(const char * samplerName, GLuint slot) const
 {
-  glUniform1i(mPhongShader->GetUniformLocation(samplerName), slot);
+  PhongRenderer::SetTextureUnit(std::string(samplerName), slot);
 }
 
 inline
-void PhongRenderer::SetTextureUnit(const std::string & samplerName, GLuint slot) const
+void PhongRenderer::SetCamera(const Camera* camera) const
 {
-  PhongRenderer::SetTextureUnit(samplerName.c_str(), slot);
+  PhongRenderer::SetFrameValue(mCameraBlock.mView, camera->GetViewMatrix());
+  PhongRenderer::SetFrameValue(mCameraBlock.mProj, camera->GetProjMatrix());
 }
 
 inline
-void PhongRenderer::SetCamera(const Camera* camera) const
+void PhongRenderer::SetViewMatrix(const glm::mat4 & view) const
 {
-  camera->SetUniformProjMatrix(mProjMatrixLoc);
-  camera->SetUniformViewMatrix(mViewMatrixLoc);
+  PhongRenderer::SetFrameValue(mCameraBlock.mView, view);
 }
 
 inline
 void PhongRenderer::SetModelNormalMatrix(const Transform & model) const
 {
-  model.SetUniform(mModelMatrixLoc);
-  model.SetInverseTransposeUniform(mNormalMatrixLoc);
+  mObjectBlock.mModel = model.GetMatrix();
+  mObjectBlock.mNormal = model.GetInverseTransposeMatrix();
 }
 
+inline
+void PhongRenderer::SetModelNormalMatrix(const glm::mat4 & model) const
+{
+  mObjectBlock.mModel = model;
+  mObjectBlock.mNormal = Transform::ComputeInverseTranspose(model);
+}
 
 inline
 void PhongRenderer::SetNumLightSources(int numLightSources) const
 {
   // Make sure that (0 <= numLightSources <= kMaxNumberLights).
-  numLightSources = std::max(0, std::min(kMaxNumberLights, numLightSources));
-  glUniform1i(mNumLightUniform, numLightSources);
+  const GLint numLights = std::max(0, std::min(kMaxNumberLights, numLightSources));
+  PhongRenderer::SetFrameValue(mLightsBlock.mNumLights, numLights);
 }
 
 inline
 void PhongRenderer::EnableLightSource(int slot)  const
 {
-  glUniform1i(mLightSwitchUniformArray[slot], 1);
+  PhongRenderer::SetFrameValue(mLightsBlock.mLights[slot].mEnabled, GLint(1));
 }
 
 inline
 void PhongRenderer::DisableLightSource(int slot) const
 {
-  glUniform1i(mLightSwitchUniformArray[slot], 0);
+  PhongRenderer::SetFrameValue(mLightsBlock.mLights[slot].mEnabled, GLint(0));
 }
 
 inline
 void PhongRenderer::EnableLighting()  const
 {
-  glUniform1i(mLightingLoc, 1);
+  PhongRenderer::SetFrameValue(mLightsBlock.mLighting, GLint(1));
 }
 
 inline
 void PhongRenderer::DisableLighting() const
 {
-  glUniform1i(mLightingLoc, 0);
+  PhongRenderer::SetFrameValue(mLightsBlock.mLighting, GLint(0));
+}
+
+template <typename T>
+void PhongRenderer::SetFrameValue(T & member, const T & value) const
+{
+  // Bytewise, as the driver sees it (the blocks have explicit padding).
+  if (std::memcmp(&member, &value, sizeof(T)) == 0)
+  {
+    UniformState::CountSkipped();
+    return;
+  }
+
+  member = value;
+  mFrameBlocksDirty = true;
 }
 
 }  // namespace gloo.
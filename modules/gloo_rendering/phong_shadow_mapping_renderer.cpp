@@ -0,0 +1,479 @@
+#include "phong_shadow_mapping_renderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "gloo/gl_capabilities.h"
+
+namespace gloo
+{
+
+const int PhongShadowMappingRenderer::kShadowPass;
+const int PhongShadowMappingRenderer::kLightingPass;
+const GLuint PhongShadowMappingRenderer::kShadowMapTextureUnit;
+
+PhongShadowMappingRenderer::PhongShadowMappingRenderer()
+: Renderer()
+, mPhongRenderer("../../shaders/shadow_phong/vertex_shader.glsl",
+                 "../../shaders/shadow_phong/fragment_shader.glsl")
+, mDepthVertexShaderPath(  "../../shaders/shadow_depth/vertex_shader.glsl")
+, mDepthFragmentShaderPath("../../shaders/shadow_depth/fragment_shader.glsl")
+{ }
+
+PhongShadowMappingRenderer::PhongShadowMappingRenderer(const std::string & phongVertexShaderPath,
+                                                       const std::string & phongFragmentShaderPath,
+                                                       const std::string & depthVertexShaderPath,
+                                                       const std::string & depthFragmentShaderPath)
+: Renderer()
+, mPhongRenderer(phongVertexShaderPath, phongFragmentShaderPath)
+, mDepthVertexShaderPath(depthVertexShaderPath)
+, mDepthFragmentShaderPath(depthFragmentShaderPath)
+{ }
+
+PhongShadowMappingRenderer::~PhongShadowMappingRenderer()
+{
+  GLStateCache & gl = GLStateCache::Get();
+  gl.DeleteTextures(1, &mShadowMap);
+  gl.DeleteTextures(1, &mStaticShadowMap);
+  gl.DeleteBuffers(1, &mShadowsBuffer);
+  glDeleteFramebuffers(1, &mFramebuffer);
+  delete mDepthShader;
+}
+
+bool PhongShadowMappingRenderer::Load()
+{
+  if (!mPhongRenderer.Load())
+    return false;
+
+  mPhongRenderer.SetTextureUnit("shadow_map", kShadowMapTextureUnit);
+
+  // Depth pass: position only, depth clamped (casters in front of the cascades still count).
+  delete mDepthShader;
+  mDepthShader = new ShaderProgram();
+  mDepthShader->BuildFromFiles(mDepthVertexShaderPath, mDepthFragmentShaderPath);
+
+  if (mDepthShader->GetCompilationStatus() != gloo::CompilationStatus::kSuccess)
+    return false;
+
+  PipelineState::Desc depthDesc;
+  depthDesc.mProgram = mDepthShader;
+  depthDesc.mRaster.mDepthClamp = true;
+  mDepthPipeline = PipelineState::Get(depthDesc);
+  if (!mDepthPipeline)
+    return false;
+
+  // Shadow maps (the layers of a previous Load() are dropped).
+  GLStateCache & gl = GLStateCache::Get();
+  gl.DeleteTextures(1, &mShadowMap);
+  gl.DeleteTextures(1, &mStaticShadowMap);
+  mDirectStateAccess = GLCapabilities::Get().HasDirectStateAccess();
+
+  mShadowMap = PhongShadowMappingRenderer::CreateShadowMap();
+  mStaticShadowMap = 0;
+  if (GLCapabilities::Get().HasCopyImage())
+    mStaticShadowMap = PhongShadowMappingRenderer::CreateShadowMap();
+
+  for (Cascade & cascade : mCascades)
+    cascade = Cascade();
+
+  if (mFramebuffer == 0)
+  {
+    // Depth only: no color buffer is drawn or read (a state of the framebuffer).
+    glGenFramebuffers(1, &mFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  }
+
+  if (mShadowsBuffer == 0)
+  {
+    if (mDirectStateAccess)
+      glCreateBuffers(1, &mShadowsBuffer);
+    else
+      glGenBuffers(1, &mShadowsBuffer);
+  }
+
+  return (mShadowMap != 0) && (mFramebuffer != 0) && (mShadowsBuffer != 0);
+}
+
+GLuint PhongShadowMappingRenderer::CreateShadowMap() const
+{
+  // Linear filtering with comparison: each lookup is a bilinear 2x2 PCF in hardware.
+  const GLenum parameters[][2] =
+  {
+    { GL_TEXTURE_MIN_FILTER, GL_LINEAR },
+    { GL_TEXTURE_MAG_FILTER, GL_LINEAR },
+    { GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE },
+    { GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE },
+    { GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE },
+    { GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL },
+  };
+
+  GLuint texture = 0;
+  if (mDirectStateAccess)
+  {
+    glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &texture);
+    glTextureStorage3D(texture, 1, GL_DEPTH_COMPONENT24, mShadowMapSize, mShadowMapSize,
+                       mNumCascades);
+
+    for (const auto & parameter : parameters)
+      glTextureParameteri(texture, parameter[0], parameter[1]);
+  }
+  else
+  {
+    glGenTextures(1, &texture);
+    GLStateCache::Get().BindTexture(GL_TEXTURE0 + kShadowMapTextureUnit, GL_TEXTURE_2D_ARRAY,
+                                    texture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, mShadowMapSize, mShadowMapSize,
+                 mNumCascades, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+
+    for (const auto & parameter : parameters)
+      glTexParameteri(GL_TEXTURE_2D_ARRAY, parameter[0], parameter[1]);
+  }
+
+  return texture;
+}
+
+void PhongShadowMappingRenderer::Bind(int renderingPass)
+{
+  GLStateCache & gl = GLStateCache::Get();
+
+  if (renderingPass == kShadowPass)
+  {
+    if (mDepthPipeline)
+      mDepthPipeline->Apply();
+  }
+  else
+  {
+    mPhongRenderer.Bind();
+    gl.BindBufferBase(GL_UNIFORM_BUFFER, kShadowsBlockBinding, mShadowsBuffer);
+    gl.BindTexture(GL_TEXTURE0 + kShadowMapTextureUnit, GL_TEXTURE_2D_ARRAY, mShadowMap);
+  }
+}
+
+// ------------------------------------------------------------------------------------------------
+// -> Configuration.
+
+void PhongShadowMappingRenderer::SetShadowLight(const glm::vec3 & direction, int slot)
+{
+  const glm::vec3 lightDirection = glm::normalize(direction);
+  if (lightDirection != mLightDirection)
+  {
+    for (Cascade & cascade : mCascades)  // Every light matrix changes.
+      cascade.mStaticValid = false;
+  }
+
+  mLightDirection = lightDirection;
+  mShadowLight = slot;
+}
+
+void PhongShadowMappingRenderer::SetNumCascades(int numCascades)
+{
+  mNumCascades = std::max(1, std::min(kMaxShadowCascades, numCascades));
+}
+
+// ------------------------------------------------------------------------------------------------
+// -> Casters.
+
+int PhongShadowMappingRenderer::AddCaster(const Caster & caster)
+{
+  mCasters.push_back(caster);
+  Caster & added = mCasters.back();
+
+  if (added.mStatic)
+  {
+    added.mCullerIndex = mStaticCuller.AddAABB(added.mBounds);
+    mStaticCasters.push_back(static_cast<uint32_t>(mCasters.size() - 1));
+    mStaticBounds.Merge(added.mBounds);
+    mStaticVersion++;
+  }
+
+  return static_cast<int>(mCasters.size()) - 1;
+}
+
+void PhongShadowMappingRenderer::SetCasterTransform(int caster, const glm::mat4 & model)
+{
+  Caster & target = mCasters[caster];
+  target.mModel = model;
+  target.mBounds = target.mLocalBounds.Transformed(model);
+
+  if (target.mStatic)  // Rare: the static layers are rendered again.
+  {
+    mStaticCuller.SetAABB(target.mCullerIndex, target.mBounds);
+
+    mStaticBounds = AABB();
+    for (uint32_t index : mStaticCasters)
+      mStaticBounds.Merge(mCasters[index].mBounds);
+
+    mStaticVersion++;
+  }
+}
+
+void PhongShadowMappingRenderer::ClearCasters()
+{
+  mCasters.clear();
+  mStaticCasters.clear();
+  mStaticCuller.ClearAABBs();
+  mStaticBounds = AABB();
+  mStaticVersion++;
+}
+
+// ------------------------------------------------------------------------------------------------
+// -> Shadow pass.
+
+void PhongShadowMappingRenderer::FitCascades(const Camera* camera)
+{
+  const ProjectionParameters & projection = camera->GetProjectionParameters();
+  const float nearZ = projection.mNearZ;
+  const float farZ = std::min(projection.mFarZ, mShadowDistance);
+  const float tanY = std::tan(0.5f * projection.mFovy);
+  const float tanX = tanY * projection.mAspect;
+  const glm::mat4 cameraToWorld = glm::inverse(camera->GetViewMatrix());
+
+  // Light space: fixed rotation (only the direction matters), so that snapping is stable.
+  const glm::vec3 up = (std::fabs(mLightDirection[1]) > 0.99f) ? glm::vec3(1.0f, 0.0f, 0.0f)
+                                                               : glm::vec3(0.0f, 1.0f, 0.0f);
+  const glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), mLightDirection, up);
+
+  // Static casters towards the light (light space z above the cascade) must be in the culling
+  // volume: its near plane is moved up to them. It only depends on the static casters.
+  float casterTop = -std::numeric_limits<float>::max();
+  if (!mStaticBounds.IsEmpty())
+    casterTop = mStaticBounds.Transformed(lightView).mMax[2];
+
+  float splitNear = nearZ;
+  for (int c = 0; c < mNumCascades; c++)
+  {
+    // Practical split scheme: logarithmic and uniform splits, weighted by mSplitLambda.
+    const float t = static_cast<float>(c + 1) / mNumCascades;
+    const float logSplit = nearZ * std::pow(farZ / nearZ, t);
+    const float uniformSplit = nearZ + (farZ - nearZ) * t;
+    const float splitFar = mSplitLambda * logSplit + (1.0f - mSplitLambda) * uniformSplit;
+
+    // Bounding sphere of the slice [splitNear, splitFar] (world coordinates).
+    glm::vec3 corners[8];
+    glm::vec3 center(0.0f);
+    for (int i = 0; i < 8; i++)
+    {
+      const float z = (i < 4) ? splitNear : splitFar;
+      const float x = ((i & 1) ? 1.0f : -1.0f) * tanX * z;
+      const float y = ((i & 2) ? 1.0f : -1.0f) * tanY * z;
+      corners[i] = glm::vec3(cameraToWorld * glm::vec4(x, y, -z, 1.0f));
+      center += corners[i] / 8.0f;
+    }
+
+    float radius = 0.0f;
+    for (const glm::vec3 & corner : corners)
+      radius = std::max(radius, glm::length(corner - center));
+    radius = std::ceil(radius * 16.0f) / 16.0f;  // No size jitter from rounding errors.
+
+    // Snap the center to whole texels in light space. Along z as well: the matrix (and the
+    // static casters of the cascade) only change when the camera moves by a texel.
+    const float texelSize = 2.0f * radius / mShadowMapSize;
+    glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+    for (int i = 0; i < 3; i++)
+      lightCenter[i] = std::floor(lightCenter[i] / texelSize) * texelSize;
+
+    // The light looks down -z: the sphere covers distances [-(z + r), -(z - r)].
+    const float left = lightCenter[0] - radius;
+    const float right = lightCenter[0] + radius;
+    const float bottom = lightCenter[1] - radius;
+    const float top = lightCenter[1] + radius;
+    const float zNear = -(lightCenter[2] + radius);
+    const float zFar = -(lightCenter[2] - radius);
+
+    Cascade & cascade = mCascades[c];
+    const glm::mat4 viewProj = glm::ortho(left, right, bottom, top, zNear, zFar) * lightView;
+    if ((viewProj != cascade.mViewProj) || (cascade.mStaticVersion != mStaticVersion))
+    {
+      const float cullNear = std::min(zNear, -casterTop);
+      cascade.mViewProj = viewProj;
+      cascade.mCullFrustum.SetFromMatrix(glm::ortho(left, right, bottom, top, cullNear, zFar) *
+                                         lightView);
+      cascade.mStaticVersion = mStaticVersion;
+      cascade.mStaticValid = false;
+    }
+
+    cascade.mFar = splitFar;
+    splitNear = splitFar;
+  }
+}
+
+void PhongShadowMappingRenderer::RenderShadowMaps(const Camera* camera)
+{
+  mStats = Stats();
+  if (!mDepthPipeline || (mShadowLight < 0))
+  {
+    PhongShadowMappingRenderer::UploadShadowsBlock(camera);
+    return;
+  }
+
+  PhongShadowMappingRenderer::FitCascades(camera);
+
+  GLStateCache & gl = GLStateCache::Get();
+  GLint viewport[4];
+  if (!gl.GetViewport(viewport))
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+  bool bound = false;
+  for (int c = 0; c < mNumCascades; c++)
+  {
+    Cascade & cascade = mCascades[c];
+
+    // Dynamic casters: the near plane is not tested (casters above the cascade count).
+    mVisible.clear();
+    for (size_t i = 0; i < mCasters.size(); i++)
+    {
+      unsigned planeMask = kAllFrustumPlanes & ~(1u << kNearPlane);
+      if (!mCasters[i].mStatic &&
+          (cascade.mCullFrustum.Classify(mCasters[i].mBounds, planeMask) != kOutsideFrustum))
+      {
+        mVisible.push_back(static_cast<uint32_t>(i));
+      }
+    }
+
+    // Nothing changed since the layer was rendered: keep it.
+    if (cascade.mStaticValid && mVisible.empty() && !cascade.mHasDynamic)
+    {
+      mStats.mCascadesReused++;
+      continue;
+    }
+
+    if (!bound)
+    {
+      PhongShadowMappingRenderer::Bind(kShadowPass);
+      glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+      gl.Viewport(0, 0, mShadowMapSize, mShadowMapSize);
+      bound = true;
+    }
+
+    // Static casters of the cascade (culled as a batch, indices into mStaticCasters).
+    mVisibleStatic.clear();
+    if (!cascade.mStaticValid || !mStaticShadowMap)
+    {
+      mStaticCuller.CullAABBs(cascade.mCullFrustum, mVisibleStatic);
+      for (uint32_t & index : mVisibleStatic)
+        index = mStaticCasters[index];
+    }
+
+    if (mStaticShadowMap)
+    {
+      // Static layer (only when the cascade moved), copied under the dynamic casters.
+      if (!cascade.mStaticValid)
+        PhongShadowMappingRenderer::RenderLayer(mStaticShadowMap, c, mVisibleStatic, true);
+
+      glCopyImageSubData(mStaticShadowMap, GL_TEXTURE_2D_ARRAY, 0, 0, 0, c,
+                         mShadowMap, GL_TEXTURE_2D_ARRAY, 0, 0, 0, c,
+                         mShadowMapSize, mShadowMapSize, 1);
+      PhongShadowMappingRenderer::RenderLayer(mShadowMap, c, mVisible, false);
+    }
+    else
+    {
+      mVisibleStatic.insert(mVisibleStatic.end(), mVisible.begin(), mVisible.end());
+      PhongShadowMappingRenderer::RenderLayer(mShadowMap, c, mVisibleStatic, true);
+    }
+
+    cascade.mStaticValid = true;
+    cascade.mHasDynamic = !mVisible.empty();
+    mStats.mCascadesRendered++;
+  }
+
+  if (bound)
+  {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    gl.Viewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+  }
+
+  PhongShadowMappingRenderer::UploadShadowsBlock(camera);
+}
+
+void PhongShadowMappingRenderer::RenderLayer(GLuint texture, int cascade,
+                                             const std::vector<uint32_t> & casters, bool clear)
+{
+  glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, cascade);
+
+  if (clear)
+    glClear(GL_DEPTH_BUFFER_BIT);  // The depth pipeline writes depth.
+
+  const glm::mat4 & viewProj = mCascades[cascade].mViewProj;
+  for (uint32_t index : casters)
+  {
+    const Caster & caster = mCasters[index];
+    const glm::mat4 MVP = viewProj * caster.mModel;
+    mDepthShader->SetUniform(HashName("MVP"), glm::value_ptr(MVP), 16);
+    mDepthShader->FlushUniforms();
+    caster.mDraw(caster.mMesh, caster.mPass);
+    mStats.mCasterDraws++;
+  }
+}
+
+void PhongShadowMappingRenderer::UploadShadowsBlock(const Camera* camera)
+{
+  if (mShadowsBuffer == 0)
+    return;  // Load() failed: there is nothing to upload to.
+
+  // Camera coordinates -> [0, 1] shadow map coordinates (x, y) and depth (z).
+  const glm::mat4 bias = glm::translate(glm::mat4(1.0f), glm::vec3(0.5f)) *
+                         glm::scale(glm::mat4(1.0f), glm::vec3(0.5f));
+  const glm::mat4 cameraToWorld = glm::inverse(camera->GetViewMatrix());
+
+  for (int c = 0; c < mNumCascades; c++)
+  {
+    mShadowsBlock.mShadowMatrix[c] = bias * mCascades[c].mViewProj * cameraToWorld;
+    mShadowsBlock.mCascadeFar[c] = mCascades[c].mFar;
+  }
+
+  const glm::vec3 toLight = glm::mat3(camera->GetViewMatrix()) * -mLightDirection;
+  mShadowsBlock.mLightDir = glm::vec4(glm::normalize(toLight), 0.0f);
+  mShadowsBlock.mNumCascades = mNumCascades;
+  mShadowsBlock.mShadowLight = mDepthPipeline ? mShadowLight : -1;
+  mShadowsBlock.mTexelSize = 1.0f / mShadowMapSize;
+  mShadowsBlock.mBias = mDepthBias;
+
+  // A new data store each frame (no wait for the draws of the previous one).
+  if (mDirectStateAccess)
+  {
+    glNamedBufferData(mShadowsBuffer, sizeof(ShadowsBlock), &mShadowsBlock, GL_STREAM_DRAW);
+  }
+  else
+  {
+    GLStateCache::Get().BindBuffer(GL_UNIFORM_BUFFER, mShadowsBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(ShadowsBlock), &mShadowsBlock, GL_STREAM_DRAW);
+  }
+}
+
+// ------------------------------------------------------------------------------------------------
+// -> Getters.
+
+const ShaderProgram* PhongShadowMappingRenderer::GetShaderProgram(int renderingPass) const
+{
+  if (renderingPass == kShadowPass)
+    return mDepthShader;
+
+  return mPhongRenderer.GetShaderProgram();
+}
+
+GLint PhongShadowMappingRenderer::GetAttribLocation(const std::string & name,
+                                                    int renderingPass) const
+{
+  if (renderingPass == kShadowPass)
+    return mDepthShader ? mDepthShader->GetAttribLocation(name) : -1;
+
+  return mPhongRenderer.GetAttribLocation(name);
+}
+
+GLint PhongShadowMappingRenderer::GetUniformLocation(const std::string & name,
+                                                     int renderingPass) const
+{
+  if (renderingPass == kShadowPass)
+    return mDepthShader ? mDepthShader->GetUniformLocation(name) : -1;
+
+  return mPhongRenderer.GetUniformLocation(name);
+}
+
+}  // namespace gloo.
@@ -0,0 +1,271 @@
+// + ======================================== +
+// |         gl-oo-interface library          |
+// |         Module: GLOO Rendering.          |
+// |        Author: Rodrigo Castiel, 2016.    |
+// + ======================================== +
+
+// ------------------------------------------------------------------------------------------------
+// PhongShadowMappingRenderer is a two-pass renderer: phong shading with the shadows of one
+// directional light (e.g. the sun), through cascaded shadow maps.
+//
+//  Pass 0 (kShadowPass): depth only, from the light, into one layer of a depth texture array per
+//    cascade. Minimal shaders (position only):
+//      gl-oo-interface/shaders/shadow_depth/vertex_shader.glsl
+//      gl-oo-interface/shaders/shadow_depth/fragment_shader.glsl
+//  Pass 1 (kLightingPass): a PhongRenderer (GetPhongRenderer()) with the shadow_phong shaders:
+//      gl-oo-interface/shaders/shadow_phong/vertex_shader.glsl
+//      gl-oo-interface/shaders/shadow_phong/fragment_shader.glsl
+//    They are the phong shaders, plus a Shadows block (see uniform_blocks.h) and the
+//    shadow_map sampler (a sampler2DArrayShadow). The shadow light is attenuated by 3x3 PCF
+//    taps of hardware-filtered depth comparisons. The other light sources are not shadowed.
+//
+// Cascades: the view frustum of the camera, up to the shadow distance, is split into slices
+// (mixing logarithmic and uniform splits, see SetSplitLambda()). Each cascade is an orthographic
+// projection along the light that bounds the sphere around its slice. The sphere does not
+// change size when the camera rotates, and its center is snapped to whole shadow map texels in
+// light space: shadow edges do not shimmer when the camera moves. Depth is clamped instead of
+// clipped, so that casters between the light and the cascade still cast shadows.
+//
+// Casters: meshes are registered once (AddCaster()) with their world bounds, and culled against
+// each cascade. Static casters (the default) are culled as a batch (gloo::FrustumCuller), and
+// a cascade whose projection did not change keeps them: with GLCapabilities::HasCopyImage(), the
+// static casters of each cascade are kept in a second texture array and copied under the
+// dynamic ones, and a cascade without dynamic casters is not rendered again at all. Moving a
+// static caster (SetCasterTransform()) redraws the static layers.
+//
+// Usage:
+//  PhongShadowMappingRenderer* renderer = new PhongShadowMappingRenderer();
+//  renderer->Load();
+//  renderer->SetShadowLight(glm::vec3(-1, -2, -1), 0);  // Direction of the light rays, slot.
+//  int floor = renderer->AddCaster(floorMesh, floorModel, floorBounds);        // Static.
+//  int actor = renderer->AddCaster(actorMesh, actorModel, actorBounds, false); // Dynamic.
+//  ...
+//  // Each frame:
+//  camera->SetOnRendering();
+//  renderer->SetCasterTransform(actor, newModel);
+//  renderer->RenderShadowMaps(camera);  // Pass 0 (restores the framebuffer and the viewport).
+//
+//  renderer->Bind(PhongShadowMappingRenderer::kLightingPass);  // Pass 1, as a PhongRenderer.
+//  PhongRenderer* phong = renderer->GetPhongRenderer();
+//  phong->SetCamera(camera);
+//  phong->SetLightSource(sun, 0);  // Its position should be far along -direction.
+//  phong->SetMaterial(material);
+//  phong->Render(floorMesh, floorModel, camera);
+//  ...
+//
+// Every mesh group needs its positions at location 0 in the rendering pass given to
+// AddCaster(), like the phong shaders.
+// ------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "renderer.h"
+#include "phong_renderer.h"
+#include "pipeline_state.h"
+#include "uniform_blocks.h"
+
+#include "gloo/bounds.h"
+#include "gloo/camera.h"
+#include "gloo/frustum.h"
+#include "gloo/frustum_culler.h"
+#include "gloo/group.h"
+
+namespace gloo
+{
+
+class PhongShadowMappingRenderer : public Renderer
+{
+public:
+  static const int kShadowPass = 0;
+  static const int kLightingPass = 1;
+  static const GLuint kShadowMapTextureUnit = 2;  // After color_map and normal_map.
+
+  struct Stats
+  {
+    unsigned mCascadesRendered { 0 };  // In the last RenderShadowMaps().
+    unsigned mCascadesReused { 0 };    // Kept from the previous frame.
+    unsigned mCasterDraws { 0 };
+  };
+
+  PhongShadowMappingRenderer();
+  PhongShadowMappingRenderer(const std::string & phongVertexShaderPath,
+                             const std::string & phongFragmentShaderPath,
+                             const std::string & depthVertexShaderPath,
+                             const std::string & depthFragmentShaderPath);
+
+  ~PhongShadowMappingRenderer();
+
+  // Builds the shaders and the shadow maps (with the current shadow map size and cascades).
+  bool Load();
+
+  // Binds the depth pass or the phong pass (with the shadow maps and the Shadows block).
+  virtual void Bind(int renderingPass);
+
+  // Fits the cascades to camera, culls the casters and renders the shadow maps that changed
+  // (pass 0). Call it once per frame, after camera->SetOnRendering().
+  void RenderShadowMaps(const Camera* camera);
+
+  // === Shadow configuration methods ===
+
+  // The light that casts shadows: direction of its rays (world coordinates), and its slot in
+  // the phong renderer.
+  void SetShadowLight(const glm::vec3 & direction, int slot);
+  void DisableShadows() { mShadowLight = -1; }
+
+  // Number of cascades (1 to kMaxShadowCascades) and size of each shadow map. Call them
+  // before Load() (or Load() again).
+  void SetNumCascades(int numCascades);
+  void SetShadowMapSize(GLsizei size) { mShadowMapSize = size; }
+
+  // Distance from the camera covered by the cascades (clipped to the far plane).
+  void SetShadowDistance(float distance) { mShadowDistance = distance; }
+
+  // Weight of the logarithmic splits (1), against the uniform ones (0).
+  void SetSplitLambda(float lambda) { mSplitLambda = lambda; }
+
+  // Depth bias, in shadow map texels (scaled by the slope in the shader).
+  void SetDepthBias(float texels) { mDepthBias = texels; }
+
+  // === Caster management methods ===
+
+  // Registers a mesh that casts shadows (drawn with rendering pass 'pass'), with its bounds in
+  // model coordinates. Returns the index of the caster.
+  template <StorageFormat F>
+  int AddCaster(const MeshGroup<F>* mesh, const glm::mat4 & model, const AABB & bounds,
+                bool isStatic = true, int pass = 0);
+
+  void SetCasterTransform(int caster, const glm::mat4 & model);
+  void ClearCasters();
+
+  // Getters.
+  size_t GetNumCasters() const { return mCasters.size(); }
+  int GetNumCascades() const { return mNumCascades; }
+  float GetCascadeFar(int cascade) const { return mCascades[cascade].mFar; }
+  const glm::mat4 & GetCascadeViewProj(int cascade) const { return mCascades[cascade].mViewProj; }
+  GLuint GetShadowMap() const { return mShadowMap; }
+  const Stats & GetStats() const { return mStats; }
+
+  PhongRenderer* GetPhongRenderer() { return &mPhongRenderer; }
+  const PhongRenderer* GetPhongRenderer() const { return &mPhongRenderer; }
+
+  inline unsigned GetNumRenderingPasses() const { return 2; }
+  const ShaderProgram* GetShaderProgram(int renderingPass = kLightingPass) const;
+
+  GLint GetAttribLocation( const std::string & name, int renderingPass = kLightingPass) const;
+  GLint GetUniformLocation(const std::string & name, int renderingPass = kLightingPass) const;
+
+private:
+  struct Caster
+  {
+    void (*mDraw)(const void* mesh, int pass);  // Draws mMesh (a MeshGroup<F>, F known).
+    const void* mMesh;
+    int mPass;
+    glm::mat4 mModel;
+    AABB mLocalBounds;
+    AABB mBounds;            // World coordinates.
+    bool mStatic;
+    uint32_t mCullerIndex;   // In mStaticCuller (static casters only).
+  };
+
+  struct Cascade
+  {
+    float mFar { 0.0f };              // Split distance (camera space).
+    glm::mat4 mViewProj { 1.0f };     // Light view-projection.
+    Frustum mCullFrustum;             // Its volume, extended towards the light.
+    unsigned mStaticVersion { 0 };    // Of the static casters in the static layer.
+    bool mStaticValid { false };      // The static layer matches mViewProj.
+    bool mHasDynamic { true };        // The shadow map layer has dynamic casters.
+  };
+
+  PhongShadowMappingRenderer(const PhongShadowMappingRenderer &) = delete;
+  PhongShadowMappingRenderer & operator=(const PhongShadowMappingRenderer &) = delete;
+
+  template <StorageFormat F>
+  static void DrawCaster(const void* mesh, int pass);
+
+  // Adds a caster (AddCaster() fills in the mesh).
+  int AddCaster(const Caster & caster);
+
+  // Creates a depth texture array with one layer per cascade.
+  GLuint CreateShadowMap() const;
+
+  // Computes the split distances and the light matrices of all cascades.
+  void FitCascades(const Camera* camera);
+
+  // Renders the casters of a list into a layer of texture (which is cleared first or not).
+  void RenderLayer(GLuint texture, int cascade, const std::vector<uint32_t> & casters,
+                   bool clear);
+
+  // Fills the Shadows block for camera and uploads it.
+  void UploadShadowsBlock(const Camera* camera);
+
+  // Shaders and pipelines.
+  PhongRenderer mPhongRenderer;
+  ShaderProgram* mDepthShader { nullptr };
+  const PipelineState* mDepthPipeline { nullptr };
+
+  // Shadow maps (depth texture arrays) and the framebuffer that renders into them.
+  GLuint mShadowMap { 0 };
+  GLuint mStaticShadowMap { 0 };  // Static casters only (with HasCopyImage()).
+  GLuint mFramebuffer { 0 };
+  GLuint mShadowsBuffer { 0 };    // Uniform buffer of the Shadows block.
+  bool mDirectStateAccess { false };
+
+  // Settings.
+  int mNumCascades { 4 };
+  GLsizei mShadowMapSize { 2048 };
+  float mShadowDistance { 100.0f };
+  float mSplitLambda { 0.75f };
+  float mDepthBias { 1.5f };
+  glm::vec3 mLightDirection { 0.0f, -1.0f, 0.0f };
+  int mShadowLight { -1 };
+
+  // Casters.
+  std::vector<Caster> mCasters;
+  std::vector<uint32_t> mStaticCasters;  // Caster index of each box of mStaticCuller.
+  FrustumCuller mStaticCuller;           // World bounds of the static casters.
+  AABB mStaticBounds;                    // Union of them.
+  unsigned mStaticVersion { 1 };         // Incremented when static casters change.
+
+  // Per frame.
+  Cascade mCascades[kMaxShadowCascades];
+  std::vector<uint32_t> mVisible;        // Scratch lists of casters.
+  std::vector<uint32_t> mVisibleStatic;
+  ShadowsBlock mShadowsBlock;
+  Stats mStats;
+
+  // Constant data (passed to constructor).
+  const std::string mDepthVertexShaderPath;
+  const std::string mDepthFragmentShaderPath;
+};
+
+// =========== IMPLEMENTATION OF INLINE METHODS ===================================================
+
+template <StorageFormat F>
+void PhongShadowMappingRenderer::DrawCaster(const void* mesh, int pass)
+{
+  static_cast<const MeshGroup<F>*>(mesh)->Render(static_cast<unsigned>(pass));
+}
+
+template <StorageFormat F>
+int PhongShadowMappingRenderer::AddCaster(const MeshGroup<F>* mesh, const glm::mat4 & model,
+                                          const AABB & bounds, bool isStatic, int pass)
+{
+  Caster caster;
+  caster.mDraw = &PhongShadowMappingRenderer::DrawCaster<F>;
+  caster.mMesh = mesh;
+  caster.mPass = pass;
+  caster.mModel = model;
+  caster.mLocalBounds = bounds;
+  caster.mBounds = bounds.Transformed(model);
+  caster.mStatic = isStatic;
+  caster.mCullerIndex = 0;
+  return PhongShadowMappingRenderer::AddCaster(caster);
+}
+
+}  // namespace gloo.
@@ -0,0 +1,265 @@
+#include "pipeline_state.h"
+
+#include <iostream>
+#include <tuple>
+
+namespace gloo
+{
+
+namespace
+{
+
+bool IsCompareFunction(GLenum function)
+{
+  switch (function)
+  {
+    case GL_NEVER: case GL_LESS: case GL_EQUAL: case GL_LEQUAL:
+    case GL_GREATER: case GL_NOTEQUAL: case GL_GEQUAL: case GL_ALWAYS:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool IsStencilOp(GLenum op)
+{
+  switch (op)
+  {
+    case GL_KEEP: case GL_ZERO: case GL_REPLACE: case GL_INCR:
+    case GL_INCR_WRAP: case GL_DECR: case GL_DECR_WRAP: case GL_INVERT:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool IsBlendFactor(GLenum factor)
+{
+  switch (factor)
+  {
+    case GL_ZERO: case GL_ONE:
+    case GL_SRC_COLOR: case GL_ONE_MINUS_SRC_COLOR: case GL_DST_COLOR: case GL_ONE_MINUS_DST_COLOR:
+    case GL_SRC_ALPHA: case GL_ONE_MINUS_SRC_ALPHA: case GL_DST_ALPHA: case GL_ONE_MINUS_DST_ALPHA:
+    case GL_CONSTANT_COLOR: case GL_ONE_MINUS_CONSTANT_COLOR:
+    case GL_CONSTANT_ALPHA: case GL_ONE_MINUS_CONSTANT_ALPHA:
+    case GL_SRC_ALPHA_SATURATE:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool IsBlendEquation(GLenum mode)
+{
+  switch (mode)
+  {
+    case GL_FUNC_ADD: case GL_FUNC_SUBTRACT: case GL_FUNC_REVERSE_SUBTRACT:
+    case GL_MIN: case GL_MAX:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// FNV-1a, one 32-bit word at a time.
+uint32_t HashWord(uint32_t hash, uint32_t word)
+{
+  return (hash ^ word) * 16777619u;
+}
+
+}  // namespace.
+
+bool PipelineState::Desc::operator==(const Desc & other) const
+{
+  const DepthStencilState & d = mDepthStencil;
+  const DepthStencilState & od = other.mDepthStencil;
+
+  return (mProgram == other.mProgram) && (mVertexFormat == other.mVertexFormat) &&
+         std::tie(d.mDepthTest, d.mDepthWrite, d.mDepthFunc, d.mStencilTest, d.mStencilFunc,
+                  d.mStencilReference, d.mStencilMask, d.mStencilFail, d.mDepthFail,
+                  d.mDepthPass) ==
+         std::tie(od.mDepthTest, od.mDepthWrite, od.mDepthFunc, od.mStencilTest, od.mStencilFunc,
+                  od.mStencilReference, od.mStencilMask, od.mStencilFail, od.mDepthFail,
+                  od.mDepthPass) &&
+         std::tie(mBlend.mEnabled, mBlend.mSource, mBlend.mDestination, mBlend.mEquation) ==
+         std::tie(other.mBlend.mEnabled, other.mBlend.mSource, other.mBlend.mDestination,
+                  other.mBlend.mEquation) &&
+         std::tie(mRaster.mCullFace, mRaster.mCullMode, mRaster.mFrontFace,
+                  mRaster.mPolygonMode, mRaster.mDepthClamp) ==
+         std::tie(other.mRaster.mCullFace, other.mRaster.mCullMode, other.mRaster.mFrontFace,
+                  other.mRaster.mPolygonMode, other.mRaster.mDepthClamp);
+}
+
+const PipelineState* PipelineState::Get(const Desc & desc)
+{
+  const uint32_t hash = PipelineState::ComputeHash(desc);
+
+  StateMap & states = PipelineState::GetStates();
+  auto range = states.equal_range(hash);
+  for (auto it = range.first; it != range.second; ++it)
+  {
+    if (it->second->mDesc == desc)
+      return it->second.get();
+  }
+
+  // Validated once, when the state is first created.
+  if (!PipelineState::Validate(desc))
+    return nullptr;
+
+  PipelineState* state = new PipelineState(desc, hash);
+  states.emplace(hash, std::unique_ptr<PipelineState>(state));
+  return state;
+}
+
+bool PipelineState::Validate(const Desc & desc)
+{
+  const DepthStencilState & depthStencil = desc.mDepthStencil;
+  const BlendState & blend = desc.mBlend;
+  const RasterState & raster = desc.mRaster;
+
+  if (desc.mProgram && (desc.mProgram->GetCompilationStatus() != CompilationStatus::kSuccess))
+  {
+    std::cerr << "ERROR: pipeline state with a shader program that is not built." << std::endl;
+    return false;
+  }
+
+  if (!IsCompareFunction(depthStencil.mDepthFunc) || !IsCompareFunction(depthStencil.mStencilFunc))
+  {
+    std::cerr << "ERROR: invalid depth/stencil function in pipeline state." << std::endl;
+    return false;
+  }
+
+  if (!IsStencilOp(depthStencil.mStencilFail) || !IsStencilOp(depthStencil.mDepthFail) ||
+      !IsStencilOp(depthStencil.mDepthPass))
+  {
+    std::cerr << "ERROR: invalid stencil operation in pipeline state." << std::endl;
+    return false;
+  }
+
+  if (!IsBlendFactor(blend.mSource) || !IsBlendFactor(blend.mDestination) ||
+      !IsBlendEquation(blend.mEquation))
+  {
+    std::cerr << "ERROR: invalid blend function/equation in pipeline state." << std::endl;
+    return false;
+  }
+
+  if (((raster.mCullMode != GL_FRONT) && (raster.mCullMode != GL_BACK) &&
+       (raster.mCullMode != GL_FRONT_AND_BACK)) ||
+      ((raster.mFrontFace != GL_CW) && (raster.mFrontFace != GL_CCW)) ||
+      ((raster.mPolygonMode != GL_POINT) && (raster.mPolygonMode != GL_LINE) &&
+       (raster.mPolygonMode != GL_FILL)))
+  {
+    std::cerr << "ERROR: invalid cull/front face/polygon mode in pipeline state." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+void PipelineState::Clear()
+{
+  PipelineState::GetStates().clear();
+}
+
+PipelineState::StateMap & PipelineState::GetStates()
+{
+  static StateMap states;
+  return states;
+}
+
+uint32_t PipelineState::ComputeHash(const Desc & desc)
+{
+  const DepthStencilState & depthStencil = desc.mDepthStencil;
+  const BlendState & blend = desc.mBlend;
+  const RasterState & raster = desc.mRaster;
+
+  const uint32_t words[] =
+  {
+    desc.mProgram ? desc.mProgram->GetHandle() : 0,
+    desc.mVertexFormat ? desc.mVertexFormat->GetVertexArray() : 0,
+    (depthStencil.mDepthTest ? 1u : 0u) | (depthStencil.mDepthWrite ? 2u : 0u) |
+    (depthStencil.mStencilTest ? 4u : 0u) | (blend.mEnabled ? 8u : 0u) |
+    (raster.mCullFace ? 16u : 0u) | (raster.mDepthClamp ? 32u : 0u),
+    depthStencil.mDepthFunc, depthStencil.mStencilFunc,
+    static_cast<uint32_t>(depthStencil.mStencilReference), depthStencil.mStencilMask,
+    depthStencil.mStencilFail, depthStencil.mDepthFail, depthStencil.mDepthPass,
+    blend.mSource, blend.mDestination, blend.mEquation,
+    raster.mCullMode, raster.mFrontFace, raster.mPolygonMode
+  };
+
+  uint32_t hash = 2166136261u;
+  for (uint32_t word : words)
+    hash = HashWord(hash, word);
+
+  return hash;
+}
+
+void PipelineState::Apply() const
+{
+  GLStateCache & gl = GLStateCache::Get();
+  const DepthStencilState & depthStencil = mDesc.mDepthStencil;
+  const BlendState & blend = mDesc.mBlend;
+  const RasterState & raster = mDesc.mRaster;
+
+  if (mDesc.mProgram)
+    mDesc.mProgram->Bind();
+
+  if (mDesc.mVertexFormat)
+    mDesc.mVertexFormat->Bind();
+
+  // Parameters of disabled tests are left as they are.
+  if (depthStencil.mDepthTest)
+  {
+    gl.Enable(GL_DEPTH_TEST);
+    gl.DepthFunc(depthStencil.mDepthFunc);
+  }
+  else
+  {
+    gl.Disable(GL_DEPTH_TEST);
+  }
+
+  gl.DepthMask(depthStencil.mDepthWrite ? GL_TRUE : GL_FALSE);
+
+  if (depthStencil.mStencilTest)
+  {
+    gl.Enable(GL_STENCIL_TEST);
+    gl.StencilFunc(depthStencil.mStencilFunc, depthStencil.mStencilReference,
+                   depthStencil.mStencilMask);
+    gl.StencilOp(depthStencil.mStencilFail, depthStencil.mDepthFail, depthStencil.mDepthPass);
+  }
+  else
+  {
+    gl.Disable(GL_STENCIL_TEST);
+  }
+
+  if (blend.mEnabled)
+  {
+    gl.Enable(GL_BLEND);
+    gl.BlendFunc(blend.mSource, blend.mDestination);
+    gl.BlendEquation(blend.mEquation);
+  }
+  else
+  {
+    gl.Disable(GL_BLEND);
+  }
+
+  if (raster.mCullFace)
+  {
+    gl.Enable(GL_CULL_FACE);
+    gl.CullFace(raster.mCullMode);
+  }
+  else
+  {
+    gl.Disable(GL_CULL_FACE);
+  }
+
+  gl.FrontFace(raster.mFrontFace);
+  gl.PolygonMode(raster.mPolygonMode);
+
+  if (raster.mDepthClamp)
+    gl.Enable(GL_DEPTH_CLAMP);
+  else
+    gl.Disable(GL_DEPTH_CLAMP);
+}
+
+}  // namespace gloo.
@@ -0,0 +1,128 @@
+// + ======================================== +
+// |         gl-oo-interface library          |
+// |         Module: GLOO Rendering.          |
+// |        Author: Rodrigo Castiel, 2016.    |
+// + ======================================== +
+//
+// gloo::PipelineState is the whole GL state a rendering pass draws with: program (variant),
+// vertex format, depth/stencil, blend and raster (cull, front face, polygon mode, depth clamp)
+// state. States are immutable and interned: Get() validates a description and hashes it once,
+// and returns the same object for the same description (so equal pipelines compare equal by
+// pointer). Apply() sets every piece of state through gloo::GLStateCache, which diffs it against
+// the current state: switching from one pass to another only issues the calls for what differs,
+// and passes no longer depend on the state the application (or the previous pass) happened to
+// leave.
+//
+// Usage:
+//   PipelineState::Desc desc;             // Depth test on (GL_LESS), no blending, no culling.
+//   desc.mProgram = program;
+//   desc.mBlend.mEnabled = true;
+//   desc.mBlend.mSource = GL_SRC_ALPHA;
+//   desc.mBlend.mDestination = GL_ONE_MINUS_SRC_ALPHA;
+//   desc.mRaster.mPolygonMode = GL_LINE;
+//
+//   const PipelineState* pipeline = PipelineState::Get(desc);  // nullptr if invalid.
+//   ...
+//   pipeline->Apply();  // Before drawing.
+//
+// A null program or vertex format leaves it as is (e.g. gloo::MeshGroup binds its own vertex
+// format). Renderers own one pipeline per pass (see DebugRenderer/PhongRenderer::
+// SetPipelineDesc()). The states live until Clear() (all pointers are invalid then).
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+#include "gloo/gl_header.h"
+#include "gloo/gl_state_cache.h"
+#include "gloo/shader_program.h"
+#include "gloo/vertex_format.h"
+
+namespace gloo
+{
+
+struct DepthStencilState
+{
+  bool mDepthTest { true };
+  bool mDepthWrite { true };
+  GLenum mDepthFunc { GL_LESS };
+
+  bool mStencilTest { false };
+  GLenum mStencilFunc { GL_ALWAYS };
+  GLint mStencilReference { 0 };
+  GLuint mStencilMask { 0xFF };
+  GLenum mStencilFail { GL_KEEP };
+  GLenum mDepthFail { GL_KEEP };
+  GLenum mDepthPass { GL_KEEP };
+};
+
+struct BlendState
+{
+  bool mEnabled { false };
+  GLenum mSource { GL_ONE };
+  GLenum mDestination { GL_ZERO };
+  GLenum mEquation { GL_FUNC_ADD };
+};
+
+struct RasterState
+{
+  bool mCullFace { false };
+  GLenum mCullMode { GL_BACK };
+  GLenum mFrontFace { GL_CCW };
+  GLenum mPolygonMode { GL_FILL };
+  bool mDepthClamp { false };  // Depth is clamped instead of clipped by the near/far planes.
+};
+
+class PipelineState
+{
+public:
+  struct Desc
+  {
+    const ShaderProgram* mProgram { nullptr };     // Or nullptr (left as is).
+    const VertexFormat* mVertexFormat { nullptr };  // Or nullptr (left as is).
+    DepthStencilState mDepthStencil;
+    BlendState mBlend;
+    RasterState mRaster;
+
+    bool operator==(const Desc & other) const;
+  };
+
+  // The interned state of desc, or nullptr if desc is invalid (the error is printed).
+  static const PipelineState* Get(const Desc & desc);
+
+  // Whether desc is valid (a program must be built, and all enums must be accepted by GL).
+  static bool Validate(const Desc & desc);
+
+  // Deletes all states.
+  static void Clear();
+
+  // Number of distinct states in use.
+  static size_t GetNumStates() { return PipelineState::GetStates().size(); }
+
+  // Sets the whole state (only what differs from the current one reaches GL).
+  void Apply() const;
+
+  // Getters.
+  const Desc & GetDesc() const { return mDesc; }
+  uint32_t GetHash() const { return mHash; }
+
+private:
+  typedef std::unordered_multimap<uint32_t, std::unique_ptr<PipelineState>> StateMap;
+
+  static StateMap & GetStates();
+  static uint32_t ComputeHash(const Desc & desc);
+
+  PipelineState(const Desc & desc, uint32_t hash)
+  : mDesc(desc)
+  , mHash(hash) { }
+
+  PipelineState(const PipelineState &) = delete;
+  PipelineState & operator=(const PipelineState &) = delete;
+
+  const Desc mDesc;
+  const uint32_t mHash;
+};
+
+}  // namespace gloo.
@@ -0,0 +1,208 @@
+#include "render_queue.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace gloo
+{
+
+const int RenderQueue::kMaxTextures;
+
+namespace
+{
+
+const int kPassBits     = 4;
+const int kProgramBits  = 8;
+const int kMaterialBits = 12;
+const int kTextureBits  = 12;
+const int kDepthBits    = 28;
+
+static_assert(kPassBits + kProgramBits + kMaterialBits + kTextureBits + kDepthBits == 64,
+              "RenderQueue: the key fields must fill 64 bits.");
+
+// Radix sort digits: at most 6 passes of 11 bits (2048-bucket histograms).
+const int kRadixBits = 11;
+const int kRadixSize = 1 << kRadixBits;
+const int kRadixDigits = (64 + kRadixBits - 1) / kRadixBits;
+
+// The lowest digit only tells apart depths closer than 1/256th of their distance: not worth a
+// pass (packets that close to each other stay in the order they were added).
+const int kFirstRadixDigit = 1;
+
+// Top 'bits' bits of a multiplicative (Fibonacci) hash of the value.
+uint64_t HashBits(uint64_t value, int bits)
+{
+  return (value * 0x9E3779B97F4A7C15ull) >> (64 - bits);
+}
+
+uint64_t HashPointer(const void* pointer, int bits)
+{
+  return HashBits(static_cast<uint64_t>(reinterpret_cast<uintptr_t>(pointer)), bits);
+}
+
+// The bit patterns of non-negative floats sort like the floats themselves: the top bits of the
+// pattern are an order-preserving quantization of the depth.
+uint64_t QuantizeDepth(float depth)
+{
+  uint32_t bits;
+  std::memcpy(&bits, &depth, sizeof(bits));
+
+  // Behind the camera (sign bit set): first. Masked instead of compared, since the sign of the
+  // depth is as good as random and a branch on it mispredicts.
+  bits &= (bits >> 31) - 1;
+  return bits >> (32 - kDepthBits);
+}
+
+}  // namespace.
+
+void RenderQueue::Begin(Camera* camera)
+{
+  mCamera = camera;
+  mView = camera->GetViewMatrix();
+  mPackets.clear();
+}
+
+void RenderQueue::BuildKeys()
+{
+  mEntries.resize(mPackets.size());
+
+  // Locals, which the compiler can keep in registers (the stores to the entries could alias
+  // members).
+  const Packet* packets = mPackets.data();
+  SortEntry* entries = mEntries.data();
+  const glm::vec4 viewZ(mView[0][2], mView[1][2], mView[2][2], mView[3][2]);
+
+  // Consecutive packets mostly come from the same renderer: skip the virtual call. The program
+  // bits of each combination of maps (only phong renderers select variants from them).
+  const Renderer* lastRenderer = nullptr;
+  unsigned lastPass = 0;
+  uint64_t programBits[1 << kMaxTextures] = { };
+
+  for (size_t i = 0; i < mPackets.size(); i++)
+  {
+    const Packet & packet = packets[i];
+
+    if ((packet.mRenderer != lastRenderer) || (packet.mPass != lastPass))
+    {
+      lastRenderer = packet.mRenderer;
+      lastPass = packet.mPass;
+
+      if (packet.mPhong)
+      {
+        // The variant is known by its key (it may not even be compiled yet).
+        const PhongRenderer* phong = static_cast<const PhongRenderer*>(packet.mRenderer);
+        for (int maps = 0; maps < (1 << kMaxTextures); maps++)
+        {
+          const uint32_t variant = phong->GetVariantKey((maps & 1) != 0, (maps & 2) != 0);
+          programBits[maps] = HashPointer(phong, kProgramBits) ^
+                              HashBits(variant + 1, kProgramBits);
+        }
+      }
+      else
+      {
+        const ShaderProgram* program = packet.mRenderer->GetShaderProgram(packet.mPass);
+        for (uint64_t & bits : programBits)
+          bits = (program ? program->GetHandle() : 0) & ((1 << kProgramBits) - 1);
+      }
+    }
+
+    uint64_t textures = 0;
+    for (const Texture2d* texture : packet.mTextures)
+      textures = textures * 31 + static_cast<uint64_t>(reinterpret_cast<uintptr_t>(texture));
+
+    // View-space depth of the model origin (the camera looks down -z).
+    const glm::vec4 & origin = packet.mModel[3];
+    const float depth = -(viewZ[0] * origin[0] + viewZ[1] * origin[1] +
+                          viewZ[2] * origin[2] + viewZ[3] * origin[3]);
+
+    uint64_t key = std::min<uint64_t>(packet.mPass, (1 << kPassBits) - 1);
+    key = (key << kProgramBits)  | programBits[packet.mMaps];
+    key = (key << kMaterialBits) | (packet.mMaterial ? HashPointer(packet.mMaterial, kMaterialBits)
+                                                     : 0);
+    key = (key << kTextureBits)  | (textures ? HashBits(textures, kTextureBits) : 0);
+    key = (key << kDepthBits)    | QuantizeDepth(depth);
+
+    entries[i].mKey = key;
+    entries[i].mPacket = static_cast<uint32_t>(i);
+  }
+}
+
+void RenderQueue::Sort()
+{
+  RenderQueue::BuildKeys();
+
+  const size_t n = mEntries.size();
+  if (n < 2)
+    return;
+
+  // Histograms of all digits in a single pass over the keys.
+  mSortCounts.assign(kRadixDigits * kRadixSize, 0);
+  uint32_t* counts = mSortCounts.data();
+  for (const SortEntry & entry : mEntries)
+  {
+    for (int d = kFirstRadixDigit; d < kRadixDigits; d++)
+      counts[d * kRadixSize + ((entry.mKey >> (kRadixBits * d)) & (kRadixSize - 1))]++;
+  }
+
+  mSortBuffer.resize(n);
+  SortEntry* source = mEntries.data();
+  SortEntry* destination = mSortBuffer.data();
+
+  for (int d = kFirstRadixDigit; d < kRadixDigits; d++)
+  {
+    const int shift = kRadixBits * d;
+    uint32_t* offsets = &counts[d * kRadixSize];
+
+    // All keys share this digit (e.g. a single pass or program): nothing would move.
+    if (offsets[(source[0].mKey >> shift) & (kRadixSize - 1)] == n)
+      continue;
+
+    uint32_t sum = 0;
+    for (int b = 0; b < kRadixSize; b++)
+    {
+      const uint32_t count = offsets[b];
+      offsets[b] = sum;
+      sum += count;
+    }
+
+    // Stable scatter, so the previous (less significant) digits stay sorted.
+    for (size_t i = 0; i < n; i++)
+      destination[offsets[(source[i].mKey >> shift) & (kRadixSize - 1)]++] = source[i];
+
+    std::swap(source, destination);
+  }
+
+  if (source != mEntries.data())
+    mEntries.swap(mSortBuffer);
+}
+
+void RenderQueue::Submit()
+{
+  RenderQueue::Sort();
+
+  const Renderer* boundRenderer = nullptr;
+  unsigned boundPass = 0;
+
+  for (const SortEntry & entry : mEntries)
+  {
+    const Packet & packet = mPackets[entry.mPacket];
+
+    if ((packet.mRenderer != boundRenderer) || (packet.mPass != boundPass))
+    {
+      packet.mRenderer->Bind(packet.mPass);
+      boundRenderer = packet.mRenderer;
+      boundPass = packet.mPass;
+    }
+
+    // Consecutive packets mostly share textures: GLStateCache drops the redundant binds.
+    for (int t = 0; t < kMaxTextures; t++)
+    {
+      if (packet.mTextures[t])
+        packet.mTextures[t]->Bind(GL_TEXTURE0 + t);
+    }
+
+    packet.mDraw(packet, mCamera);
+  }
+}
+
+}  // namespace gloo.
@@ -0,0 +1,198 @@
+// + ======================================== +
+// |         gl-oo-interface library          |
+// |         Module: GLOO Rendering.          |
+// |        Author: Rodrigo Castiel, 2016.    |
+// + ======================================== +
+//
+// gloo::RenderQueue collects the draws of a frame as packets (renderer, mesh group, pass, model
+// matrix, material, textures) and submits them sorted by state, so that shader, material and
+// texture switches happen as rarely as possible, instead of in the order they were issued.
+//
+// Each packet gets a 64-bit sort key, from the most to the least significant bits:
+//
+//   | pass (4) | program (8) | material (12) | texture (12) | depth (28) |
+//
+// Program, material and texture fields are hashes of the objects (equal objects always end up
+// next to each other; a collision only costs a state change). The program of a phong packet is
+// the variant its maps select (see PhongRenderer::GetVariantKey()). Depth is the view-space
+// distance of the model origin, so that packets sharing state are drawn front to back, and the
+// early depth test rejects as many hidden fragments as possible. Keys are radix sorted (LSD, 11
+// bits per pass; digits that are equal in all keys are skipped, and so is the lowest one: depths
+// within 1/256th of each other keep the order they were added in).
+//
+// Usage:
+//   RenderQueue queue;
+//   ...
+//   // Each frame (renderers set up as usual, e.g. PhongRenderer::SetCamera(), lights):
+//   queue.Begin(camera);
+//   queue.Add(phongRenderer, mesh, model, &material, colorMap, normalMap);
+//   queue.Add(debugRenderer, gridMesh, glm::mat4(1.0f));
+//   ...
+//   queue.Submit();  // Sorts, binds each renderer when it changes, and draws.
+//
+// Meshes, materials, textures and renderers must stay alive until Submit(). Packets are meant
+// for opaque geometry: translucent objects must still be drawn back to front, after Submit().
+// Submit() enables or disables the color/normal map of a phong renderer for each packet, from
+// its textures (they stay as the last packet set them).
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "debug_renderer.h"
+#include "phong_renderer.h"
+
+#include "gloo/camera.h"
+#include "gloo/group.h"
+#include "gloo/material.h"
+#include "gloo/texture.h"
+
+namespace gloo
+{
+
+class RenderQueue
+{
+public:
+  static const int kMaxTextures = 2;  // Bound to texture units 0, 1, ...
+
+  RenderQueue() { }
+  ~RenderQueue() { }
+
+  // Starts a new frame (drops the packets of the previous one, keeping the memory).
+  void Begin(Camera* camera);
+
+  // Queues a mesh group drawn by a phong renderer. material may be null (keeps the current
+  // material of the renderer).
+  template <StorageFormat F>
+  void Add(PhongRenderer* renderer, const MeshGroup<F>* mesh, const glm::mat4 & model,
+           const Material* material, const Texture2d* colorMap = nullptr,
+           const Texture2d* normalMap = nullptr, unsigned pass = 0);
+
+  // Queues a mesh group drawn by a debug renderer.
+  template <StorageFormat F>
+  void Add(DebugRenderer* renderer, const MeshGroup<F>* mesh, const glm::mat4 & model,
+           unsigned pass = 0);
+
+  // Sorts the packets and draws them.
+  void Submit();
+
+  // Computes the keys and sorts the packets only (Submit() calls it).
+  void Sort();
+
+  // Getters.
+  size_t GetNumPackets() const { return mPackets.size(); }
+
+private:
+  struct Packet
+  {
+    void (*mDraw)(const Packet & packet, Camera* camera);  // Draws mMesh with mRenderer.
+    Renderer* mRenderer;
+    const void* mMesh;       // MeshGroup<F>, F known by mDraw.
+    unsigned mPass;
+    glm::mat4 mModel;
+    const Material* mMaterial;
+    const Texture2d* mTextures[kMaxTextures];
+    bool mPhong;             // mRenderer is a PhongRenderer.
+    uint8_t mMaps;           // Bit t is set if mTextures[t] is.
+  };
+
+  struct SortEntry
+  {
+    uint64_t mKey;
+    uint32_t mPacket;  // Index into mPackets.
+  };
+
+  RenderQueue(const RenderQueue &) = delete;
+  RenderQueue & operator=(const RenderQueue &) = delete;
+
+  template <StorageFormat F>
+  static void DrawPhong(const Packet & packet, Camera* camera);
+
+  template <StorageFormat F>
+  static void DrawDebug(const Packet & packet, Camera* camera);
+
+  // Computes the sort key of every packet (in one pass, which is faster than one by one).
+  void BuildKeys();
+
+  Camera* mCamera { nullptr };
+  glm::mat4 mView { 1.0f };  // Of mCamera, at Begin().
+
+  std::vector<Packet> mPackets;
+  std::vector<SortEntry> mEntries;     // Sorted by Sort().
+  std::vector<SortEntry> mSortBuffer;  // Scratch space of the radix sort.
+  std::vector<uint32_t> mSortCounts;   // Digit histograms of the radix sort.
+};
+
+// =========== IMPLEMENTATION OF INLINE METHODS ===================================================
+
+template <StorageFormat F>
+void RenderQueue::DrawPhong(const Packet & packet, Camera* camera)
+{
+  const PhongRenderer* renderer = static_cast<const PhongRenderer*>(packet.mRenderer);
+  if (packet.mMaterial)
+    renderer->SetMaterial(*packet.mMaterial);
+
+  // Selects the variant (Render() switches to it): without a map, the variant does not sample
+  // whatever the previous packet left bound to its texture unit.
+  if (packet.mTextures[0])
+    renderer->EnableColorMap();
+  else
+    renderer->DisableColorMap();
+
+  if (packet.mTextures[1])
+    renderer->EnableNormalMap();
+  else
+    renderer->DisableNormalMap();
+
+  renderer->Render(static_cast<const MeshGroup<F>*>(packet.mMesh), packet.mModel, packet.mPass);
+}
+
+template <StorageFormat F>
+void RenderQueue::DrawDebug(const Packet & packet, Camera* camera)
+{
+  const DebugRenderer* renderer = static_cast<const DebugRenderer*>(packet.mRenderer);
+  renderer->Render(static_cast<const MeshGroup<F>*>(packet.mMesh), packet.mModel, camera,
+                   packet.mPass);
+}
+
+template <StorageFormat F>
+void RenderQueue::Add(PhongRenderer* renderer, const MeshGroup<F>* mesh,
+                      const glm::mat4 & model, const Material* material,
+                      const Texture2d* colorMap, const Texture2d* normalMap, unsigned pass)
+{
+  mPackets.emplace_back();
+  Packet & packet = mPackets.back();
+  packet.mDraw = &RenderQueue::DrawPhong<F>;
+  packet.mRenderer = renderer;
+  packet.mMesh = mesh;
+  packet.mPass = pass;
+  packet.mModel = model;
+  packet.mMaterial = material;
+  packet.mTextures[0] = colorMap;
+  packet.mTextures[1] = normalMap;
+  packet.mPhong = true;
+  packet.mMaps = (colorMap ? 1 : 0) | (normalMap ? 2 : 0);
+}
+
+template <StorageFormat F>
+void RenderQueue::Add(DebugRenderer* renderer, const MeshGroup<F>* mesh,
+                      const glm::mat4 & model, unsigned pass)
+{
+  mPackets.emplace_back();
+  Packet & packet = mPackets.back();
+  packet.mDraw = &RenderQueue::DrawDebug<F>;
+  packet.mRenderer = renderer;
+  packet.mMesh = mesh;
+  packet.mPass = pass;
+  packet.mModel = model;
+  packet.mMaterial = nullptr;
+  packet.mTextures[0] = nullptr;
+  packet.mTextures[1] = nullptr;
+  packet.mPhong = false;
+  packet.mMaps = 0;
+}
+
+}  // namespace gloo.
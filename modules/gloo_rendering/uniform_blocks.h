@@ -0,0 +1,127 @@
+// + ======================================== +
+// |         gl-oo-interface library          |
+// |         Module: GLOO Rendering.          |
+// |        Author: Rodrigo Castiel, 2016.    |
+// + ======================================== +
+//
+// CPU-side mirrors of the std140 uniform blocks declared by the phong shaders (shaders/phong,
+// shaders/normal_mapping_phong and shaders/wireframe_phong). Each struct has exactly the std140
+// layout of its block (vec3 members are padded to 16 bytes), so a block is uploaded with a
+// single memcpy (see gloo::UniformRingBuffer).
+//
+//  layout (std140) uniform Camera   // Binding point kCameraBlockBinding (per frame).
+//  {
+//    mat4 V;  // View  matrix.
+//    mat4 P;  // Projection matrix.
+//  };
+//
+//  layout (std140) uniform Lights   // Binding point kLightsBlockBinding (per frame).
+//  {
+//    LightSource light[max_num_lights];  // {vec3 pos; float alpha; vec3 dir; int enabled;
+//    vec3 La;                            //  vec3 Ld; vec3 Ls;}
+//    int lighting;
+//    int num_lights;
+//  };
+//
+//  layout (std140) uniform Object   // Binding point kObjectBlockBinding (per draw).
+//  {
+//    mat4 M;             // Model matrix.
+//    mat4 N;             // Normal matrix N = (M^-1)'.
+//    Material material;  // {vec3 Ka; vec3 Kd; vec3 Ks;}
+//  };
+//
+//  layout (std140) uniform Shadows  // Binding point kShadowsBlockBinding (per frame, optional).
+//  {
+//    mat4 shadow_matrix[max_cascades];  // Camera coordinates -> shadow map coordinates.
+//    vec4 cascade_far;                  // Far distance of each cascade (camera space).
+//    vec4 light_dir;                    // Towards the shadow light (camera coordinates).
+//    int num_cascades;
+//    int shadow_light;                  // Light that casts shadows (-1: none).
+//    float texel_size;                  // 1 / shadow map size.
+//    float bias;                        // Depth bias (shadow map units).
+//  };
+//
+// Only shaders/shadow_phong declares Shadows (see gloo::PhongShadowMappingRenderer).
+//
+// If you change a block in the shaders, change its mirror here as well.
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "gloo/gl_header.h"
+
+namespace gloo
+{
+
+const int kMaxNumberLights = 8;
+
+const GLuint kCameraBlockBinding = 0;
+const GLuint kLightsBlockBinding = 1;
+const GLuint kObjectBlockBinding = 2;
+const GLuint kShadowsBlockBinding = 3;
+
+const int kMaxShadowCascades = 4;
+
+struct CameraBlock
+{
+  glm::mat4 mView { 1.0f };
+  glm::mat4 mProj { 1.0f };
+};
+
+struct LightSourceBlock
+{
+  glm::vec3 mPos { 0.0f };
+  GLfloat mAlpha { 0.0f };
+  glm::vec3 mDir { 0.0f };
+  GLint mEnabled { 0 };
+  glm::vec3 mLd { 0.0f };
+  GLfloat mPadding0 { 0.0f };
+  glm::vec3 mLs { 0.0f };
+  GLfloat mPadding1 { 0.0f };
+};
+
+struct LightsBlock
+{
+  LightSourceBlock mLights[kMaxNumberLights];
+  glm::vec3 mLa { 0.1f };
+  GLint mLighting { 0 };
+  GLint mNumLights { 1 };
+  GLint mPadding[3] { };
+};
+
+struct MaterialBlock
+{
+  glm::vec3 mKa { 0.0f };
+  GLfloat mPadding0 { 0.0f };
+  glm::vec3 mKd { 0.0f };
+  GLfloat mPadding1 { 0.0f };
+  glm::vec3 mKs { 0.0f };
+  GLfloat mPadding2 { 0.0f };
+};
+
+struct ObjectBlock
+{
+  glm::mat4 mModel { 1.0f };
+  glm::mat4 mNormal { 1.0f };
+  MaterialBlock mMaterial;
+};
+
+struct ShadowsBlock
+{
+  glm::mat4 mShadowMatrix[kMaxShadowCascades];
+  glm::vec4 mCascadeFar { 0.0f };
+  glm::vec4 mLightDir { 0.0f };
+  GLint mNumCascades { 0 };
+  GLint mShadowLight { -1 };
+  GLfloat mTexelSize { 0.0f };
+  GLfloat mBias { 0.0f };
+};
+
+static_assert(sizeof(CameraBlock) == 128, "CameraBlock does not match the std140 layout.");
+static_assert(sizeof(LightSourceBlock) == 64, "LightSourceBlock does not match std140.");
+static_assert(sizeof(LightsBlock) == 544, "LightsBlock does not match the std140 layout.");
+static_assert(sizeof(ObjectBlock) == 176, "ObjectBlock does not match the std140 layout.");
+static_assert(sizeof(ShadowsBlock) == 304, "ShadowsBlock does not match the std140 layout.");
+
+}  // namespace gloo.
@@ -0,0 +1,152 @@
+#include "uniform_ring_buffer.h"
+
+#include <cassert>
+#include <cstring>
+
+namespace gloo
+{
+
+const int UniformRingBuffer::kNumSegments;
+
+UniformRingBuffer::~UniformRingBuffer()
+{
+  for (GLsync & fence : mFences)
+  {
+    if (fence)
+      glDeleteSync(fence);
+  }
+
+  if (mHandle)  // Also unmaps the persistent mapping.
+    GLStateCache::Get().DeleteBuffers(1, &mHandle);
+}
+
+bool UniformRingBuffer::Load()
+{
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &mAlignment);
+  if (mAlignment <= 0)
+    mAlignment = 256;  // The largest alignment required by any implementation.
+
+  // Segments start at aligned offsets.
+  mSegmentSize = (mCapacity / kNumSegments) / mAlignment * mAlignment;
+  if (mSegmentSize == 0)
+    return false;
+
+  const GLsizeiptr size = mSegmentSize * kNumSegments;
+  mDirectStateAccess = GLCapabilities::Get().HasDirectStateAccess();
+  mPersistent = nullptr;
+
+  if (GLCapabilities::Get().HasBufferStorage())
+  {
+    // Mapped once for the lifetime of the buffer. Coherent: writes reach the GPU without
+    // glFlushMappedBufferRange() (the fences of the segments still keep it from reading them
+    // while they are written).
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    void* data = nullptr;
+
+    if (mDirectStateAccess)
+    {
+      glCreateBuffers(1, &mHandle);
+      glNamedBufferStorage(mHandle, size, nullptr, flags);
+      data = glMapNamedBufferRange(mHandle, 0, size, flags);
+    }
+    else
+    {
+      glGenBuffers(1, &mHandle);
+      GLStateCache::Get().BindBuffer(GL_UNIFORM_BUFFER, mHandle);
+      glBufferStorage(GL_UNIFORM_BUFFER, size, nullptr, flags);
+      data = glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, flags);
+    }
+
+    mPersistent = static_cast<char*>(data);
+  }
+  else if (mDirectStateAccess)
+  {
+    glCreateBuffers(1, &mHandle);
+    glNamedBufferStorage(mHandle, size, nullptr, GL_MAP_WRITE_BIT);
+  }
+  else
+  {
+    glGenBuffers(1, &mHandle);
+    GLStateCache & gl = GLStateCache::Get();
+    gl.BindBuffer(GL_UNIFORM_BUFFER, mHandle);
+    glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_STREAM_DRAW);
+  }
+
+  mSegment = 0;
+  mHead = 0;
+  return (mHandle != 0) && (!GLCapabilities::Get().HasBufferStorage() || mPersistent);
+}
+
+void* UniformRingBuffer::Map(GLsizeiptr size)
+{
+  assert(size <= mSegmentSize);
+
+  GLintptr offset = UniformRingBuffer::Align(mHead);
+  if (offset + size > (mSegment + 1) * mSegmentSize)
+  {
+    UniformRingBuffer::NextSegment();
+    offset = mHead;
+  }
+
+  // The GPU is done with this range (see NextSegment()), so there is nothing to wait for.
+  mMapped = offset;
+  if (mPersistent)
+    return mPersistent + offset;
+
+  const GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+                            GL_MAP_UNSYNCHRONIZED_BIT;
+
+  if (mDirectStateAccess)
+    return glMapNamedBufferRange(mHandle, offset, size, access);
+
+  GLStateCache::Get().BindBuffer(GL_UNIFORM_BUFFER, mHandle);
+  return glMapBufferRange(GL_UNIFORM_BUFFER, offset, size, access);
+}
+
+GLintptr UniformRingBuffer::Unmap(GLsizeiptr usedSize)
+{
+  // A persistent mapping stays.
+  if (!mPersistent)
+  {
+    if (mDirectStateAccess)
+      glUnmapNamedBuffer(mHandle);
+    else
+      glUnmapBuffer(GL_UNIFORM_BUFFER);
+  }
+
+  mHead = mMapped + usedSize;
+  return mMapped;
+}
+
+GLintptr UniformRingBuffer::Upload(const void* data, GLsizeiptr size)
+{
+  void* buffer = UniformRingBuffer::Map(size);
+  if (!buffer)
+    return -1;  // Nothing to unmap, and the head stays.
+
+  std::memcpy(buffer, data, size);
+  return UniformRingBuffer::Unmap(size);
+}
+
+void UniformRingBuffer::NextSegment()
+{
+  // Every command that reads the current segment has been issued by now.
+  mFences[mSegment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+  mSegment = (mSegment + 1) % kNumSegments;
+  mHead = mSegment * mSegmentSize;
+  mGeneration++;
+
+  GLsync & fence = mFences[mSegment];
+  if (fence)
+  {
+    // Only blocks if the GPU is kNumSegments - 1 segments behind.
+    while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+      continue;
+
+    glDeleteSync(fence);
+    fence = 0;
+  }
+}
+
+}  // namespace gloo.
@@ -0,0 +1,117 @@
+// + ======================================== +
+// |         gl-oo-interface library          |
+// |         Module: GLOO Rendering.          |
+// |        Author: Rodrigo Castiel, 2016.    |
+// + ======================================== +
+//
+// gloo::UniformRingBuffer streams uniform block data (std140) to the GPU through a single
+// uniform buffer object. Data is appended to the ring and bound with glBindBufferRange(), so
+// changing uniforms between draws costs a memcpy and a range binding instead of one glUniform*
+// call per variable.
+//
+// The ring is split into kNumSegments segments. When it moves on to the next segment, it places
+// a fence after the commands issued so far, and it only writes into a segment again once the
+// fence placed when it was left has signaled (i.e. the GPU is done with its data). Writes are
+// therefore unsynchronized and never stall the driver, as long as the GPU keeps up.
+//
+// Usage:
+//   UniformRingBuffer ring(1 << 20);  // 1 MB.
+//   ring.Load();                      // With a current GL context.
+//   ...
+//   GLintptr offset = ring.Upload(&block, sizeof(block));
+//   ring.BindRange(bindingPoint, offset, sizeof(block));
+//
+//   // Several blocks at once (one mapping): offsets must be multiples of GetAlignment().
+//   char* data = static_cast<char*>(ring.Map(maxSize));
+//   ...
+//   GLintptr base = ring.Unmap(usedSize);
+//
+// With buffer storage (GL 4.4, see GLCapabilities::HasBufferStorage()), the whole ring is mapped
+// once, persistently and coherently, at Load(): Map()/Unmap() only move the head, and streaming
+// a block is a memcpy and a range binding, without a call into the driver. Otherwise, each Map()
+// maps its range (unsynchronized): by name with direct state access (GL 4.5), so that streaming
+// does not touch the GL_UNIFORM_BUFFER binding, or through it.
+//
+// Data uploaded before the ring moved to a new segment (GetGeneration() changed) must not be
+// bound for new draws: upload it again.
+
+#pragma once
+
+#include "gloo/gl_header.h"
+#include "gloo/gl_capabilities.h"
+#include "gloo/gl_state_cache.h"
+
+namespace gloo
+{
+
+class UniformRingBuffer
+{
+public:
+  static const int kNumSegments = 4;
+
+  explicit UniformRingBuffer(GLsizeiptr capacity = 1 << 20)
+  : mCapacity(capacity) { }
+  ~UniformRingBuffer();
+
+  // Creates the buffer object (requires a current GL context).
+  bool Load();
+
+  // Maps 'size' bytes (at most GetSegmentSize()) for writing, moving on to the next segment if
+  // they do not fit in the current one, and returns the pointer (nullptr on failure, and then
+  // Unmap() must not be called). Unmap() commits the first 'usedSize' bytes of them and returns
+  // their offset in the buffer.
+  void* Map(GLsizeiptr size);
+  GLintptr Unmap(GLsizeiptr usedSize);
+
+  // Map() + memcpy + Unmap(). Returns -1 if the data could not be mapped.
+  GLintptr Upload(const void* data, GLsizeiptr size);
+
+  // Binds [offset, offset + size) to a uniform block binding point.
+  void BindRange(GLuint bindingPoint, GLintptr offset, GLsizeiptr size) const;
+
+  // Rounds size up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT.
+  GLsizeiptr Align(GLsizeiptr size) const;
+
+  // Getters.
+  GLuint GetHandle() const { return mHandle; }
+  GLint GetAlignment() const { return mAlignment; }
+  GLsizeiptr GetSegmentSize() const { return mSegmentSize; }
+  unsigned GetGeneration() const { return mGeneration; }  // Incremented at each new segment.
+  bool IsPersistent() const { return mPersistent != nullptr; }
+
+private:
+  UniformRingBuffer(const UniformRingBuffer &) = delete;
+  UniformRingBuffer & operator=(const UniformRingBuffer &) = delete;
+
+  // Fences the current segment and waits until the GPU is done with the next one.
+  void NextSegment();
+
+  GLuint mHandle { 0 };
+  GLsizeiptr mCapacity;
+  GLsizeiptr mSegmentSize { 0 };
+  GLint mAlignment { 256 };
+
+  int mSegment { 0 };
+  GLintptr mHead { 0 };               // Next free byte (in the current segment).
+  GLintptr mMapped { 0 };             // Offset of the mapped range.
+  GLsync mFences[kNumSegments] { };   // Placed when each segment was left (0 if none).
+  unsigned mGeneration { 0 };
+  bool mDirectStateAccess { false };  // Mapped by name.
+  char* mPersistent { nullptr };      // The whole buffer, mapped at Load() (buffer storage).
+};
+
+// =========== IMPLEMENTATION OF INLINE METHODS ===================================================
+
+inline
+GLsizeiptr UniformRingBuffer::Align(GLsizeiptr size) const
+{
+  return (size + mAlignment - 1) / mAlignment * mAlignment;
+}
+
+inline
+void UniformRingBuffer::BindRange(GLuint bindingPoint, GLintptr offset, GLsizeiptr size) const
+{
+  GLStateCache::Get().BindBufferRange(GL_UNIFORM_BUFFER, bindingPoint, mHandle, offset, size);
+}
+
+}  // namespace gloo.
@@ -0,0 +1,476 @@
+#include "aabb_tree.h"
+
+#include <algorithm>
+
+namespace gloo
+{
+
+AABBTree::AABBTree(float margin, float displacementMultiplier)
+: mMargin(margin)
+, mDisplacementMultiplier(displacementMultiplier)
+{
+
+}
+
+// ------------------------------------------------------------------------------------------------
+// -> Proxies.
+
+int AABBTree::Insert(const AABB & box, void* userData)
+{
+  // Take a proxy from the free list or append a new one.
+  int proxy = mFreeProxies;
+  if (proxy != kNullNode)
+  {
+    mFreeProxies = mProxies[proxy].mLeaf;
+    mUserData[proxy] = userData;
+  }
+  else
+  {
+    proxy = static_cast<int>(mProxies.size());
+    mProxies.push_back(Proxy());
+    mUserData.push_back(userData);
+  }
+
+  const int leaf = AABBTree::AllocateNode();
+
+  Node & node = mNodes[leaf];
+  node.mBox = box;
+  node.mBox.Expand(mMargin);
+  node.mProxy = proxy;
+
+  mProxies[proxy].mFatBox = node.mBox;
+  mProxies[proxy].mLeaf = leaf;
+
+  AABBTree::InsertLeaf(leaf);
+  mNumProxies++;
+
+  return proxy;
+}
+
+void AABBTree::Remove(int proxy)
+{
+  const int leaf = mProxies[proxy].mLeaf;
+  AABBTree::RemoveLeaf(leaf);
+  AABBTree::FreeNode(leaf);
+
+  mProxies[proxy].mLeaf = mFreeProxies;
+  mUserData[proxy] = nullptr;
+  mFreeProxies = proxy;
+  mNumProxies--;
+}
+
+bool AABBTree::Move(int proxy, const AABB & box, const glm::vec3 & displacement)
+{
+  // Fat AABB: margin plus the predicted motion.
+  AABB fatBox = box;
+  fatBox.Expand(mMargin);
+
+  const glm::vec3 d = mDisplacementMultiplier * displacement;
+  for (int i = 0; i < 3; i++)
+  {
+    if (d[i] < 0.0f)
+      fatBox.mMin[i] += d[i];
+    else
+      fatBox.mMax[i] += d[i];
+  }
+
+  Proxy & p = mProxies[proxy];
+  if (p.mFatBox.Contains(box))
+  {
+    // Still enclosed. Keep the leaf unless its box became far too large (e.g. the object
+    // stopped moving), since oversized boxes degrade the queries.
+    AABB hugeBox = fatBox;
+    hugeBox.Expand(4.0f * mMargin);
+    if (hugeBox.Contains(p.mFatBox))
+      return false;
+  }
+
+  p.mFatBox = fatBox;
+
+  // If the new box stays within the parent's, the leaf keeps its place: only its box and the
+  // boxes above it (usually just a couple) are refitted. The parent never grows, so this does
+  // not degrade the tree.
+  const int leaf = p.mLeaf;
+  const int parent = mNodes[leaf].mParent;
+  if ((parent != kNullNode) && mNodes[parent].mBox.Contains(fatBox))
+  {
+    mNodes[leaf].mBox = fatBox;
+    AABBTree::Refit(parent);
+    return true;
+  }
+
+  AABBTree::RemoveLeaf(leaf);
+  mNodes[leaf].mBox = fatBox;
+  AABBTree::InsertLeaf(leaf);
+
+  return true;
+}
+
+void AABBTree::Clear()
+{
+  mNodes.clear();
+  mRoot = kNullNode;
+  mFreeList = kNullNode;
+
+  mProxies.clear();
+  mUserData.clear();
+  mFreeProxies = kNullNode;
+  mNumProxies = 0;
+}
+
+// ------------------------------------------------------------------------------------------------
+// -> Node pool.
+
+int AABBTree::AllocateNode()
+{
+  if (mFreeList == kNullNode)
+  {
+    // Grow the pool and chain the new nodes into the free list.
+    const int oldSize = static_cast<int>(mNodes.size());
+    const int newSize = (oldSize == 0) ? 16 : 2 * oldSize;
+    mNodes.resize(newSize);
+
+    for (int i = oldSize; i < newSize; i++)
+    {
+      mNodes[i].mParent = (i + 1 < newSize) ? (i + 1) : kNullNode;
+      mNodes[i].mHeight = -1;
+    }
+    mFreeList = oldSize;
+  }
+
+  const int index = mFreeList;
+  Node & node = mNodes[index];
+  mFreeList = node.mParent;
+
+  node.mParent = kNullNode;
+  node.mChild1 = kNullNode;
+  node.mChild2 = kNullNode;
+  node.mHeight = 0;
+  node.mProxy = kNullNode;
+
+  return index;
+}
+
+void AABBTree::FreeNode(int node)
+{
+  mNodes[node].mParent = mFreeList;
+  mNodes[node].mHeight = -1;
+  mFreeList = node;
+}
+
+// ------------------------------------------------------------------------------------------------
+// -> Insertion/removal.
+
+void AABBTree::InsertLeaf(int leaf)
+{
+  if (mRoot == kNullNode)
+  {
+    mRoot = leaf;
+    mNodes[leaf].mParent = kNullNode;
+    return;
+  }
+
+  // Find the best sibling: descend while it is cheaper to push the leaf further down than to
+  // pair it with the current node (cost = surface area created + inherited by the ancestors).
+  const AABB leafBox = mNodes[leaf].mBox;
+  int index = mRoot;
+  while (!mNodes[index].IsLeaf())
+  {
+    const Node & node = mNodes[index];
+    const int child1 = node.mChild1;
+    const int child2 = node.mChild2;
+
+    const float area = node.mBox.GetSurfaceArea();
+    const float combinedArea = AABB::Union(node.mBox, leafBox).GetSurfaceArea();
+
+    const float cost = 2.0f * combinedArea;                     // New parent for node and leaf.
+    const float inheritanceCost = 2.0f * (combinedArea - area);  // Growth of the ancestors.
+
+    float cost1 = AABB::Union(leafBox, mNodes[child1].mBox).GetSurfaceArea() + inheritanceCost;
+    if (!mNodes[child1].IsLeaf())
+      cost1 -= mNodes[child1].mBox.GetSurfaceArea();
+
+    float cost2 = AABB::Union(leafBox, mNodes[child2].mBox).GetSurfaceArea() + inheritanceCost;
+    if (!mNodes[child2].IsLeaf())
+      cost2 -= mNodes[child2].mBox.GetSurfaceArea();
+
+    if ((cost < cost1) && (cost < cost2))
+      break;
+
+    index = (cost1 < cost2) ? child1 : child2;
+  }
+
+  const int sibling = index;
+
+  // Create a new parent for sibling and leaf (may reallocate the pool).
+  const int newParent = AABBTree::AllocateNode();
+  const int oldParent = mNodes[sibling].mParent;
+
+  mNodes[newParent].mParent = oldParent;
+  mNodes[newParent].mChild1 = sibling;
+  mNodes[newParent].mChild2 = leaf;
+  mNodes[sibling].mParent = newParent;
+  mNodes[leaf].mParent = newParent;
+
+  if (oldParent != kNullNode)
+  {
+    if (mNodes[oldParent].mChild1 == sibling)
+      mNodes[oldParent].mChild1 = newParent;
+    else
+      mNodes[oldParent].mChild2 = newParent;
+  }
+  else
+  {
+    mRoot = newParent;
+  }
+
+  // Refit computes the box and the height of the new parent (and balances it).
+  AABBTree::Refit(newParent);
+}
+
+void AABBTree::RemoveLeaf(int leaf)
+{
+  if (leaf == mRoot)
+  {
+    mRoot = kNullNode;
+    return;
+  }
+
+  const int parent = mNodes[leaf].mParent;
+  const int grandParent = mNodes[parent].mParent;
+  const int sibling = (mNodes[parent].mChild1 == leaf) ? mNodes[parent].mChild2
+                                                       : mNodes[parent].mChild1;
+
+  // The sibling takes the place of the parent.
+  mNodes[sibling].mParent = grandParent;
+  AABBTree::FreeNode(parent);
+
+  if (grandParent != kNullNode)
+  {
+    if (mNodes[grandParent].mChild1 == parent)
+      mNodes[grandParent].mChild1 = sibling;
+    else
+      mNodes[grandParent].mChild2 = sibling;
+
+    AABBTree::Refit(grandParent);
+  }
+  else
+  {
+    mRoot = sibling;
+  }
+}
+
+void AABBTree::Refit(int index)
+{
+  while (index != kNullNode)
+  {
+    const int balanced = AABBTree::Balance(index);
+
+    Node & node = mNodes[balanced];
+    const Node & child1 = mNodes[node.mChild1];
+    const Node & child2 = mNodes[node.mChild2];
+
+    const int height = 1 + std::max(child1.mHeight, child2.mHeight);
+    const AABB box = AABB::Union(child1.mBox, child2.mBox);
+
+    // Stop early if nothing changed: the ancestors are still up to date. Most updates only
+    // touch the bottom levels of the tree.
+    const bool unchanged = (balanced == index) && (height == node.mHeight) &&
+                           (box.mMin == node.mBox.mMin) && (box.mMax == node.mBox.mMax);
+    if (unchanged)
+      return;
+
+    node.mHeight = height;
+    node.mBox = box;
+
+    index = node.mParent;
+  }
+}
+
+// ------------------------------------------------------------------------------------------------
+// -> Balancing.
+
+int AABBTree::Balance(int iA)
+{
+  Node & A = mNodes[iA];
+  if (A.IsLeaf() || (A.mHeight < 2))
+    return iA;
+
+  const int iB = A.mChild1;
+  const int iC = A.mChild2;
+  Node & B = mNodes[iB];
+  Node & C = mNodes[iC];
+
+  const int balance = C.mHeight - B.mHeight;
+
+  if (balance > 1)  // Rotate C up.
+  {
+    const int iF = C.mChild1;
+    const int iG = C.mChild2;
+    Node & F = mNodes[iF];
+    Node & G = mNodes[iG];
+
+    // Swap A and C.
+    C.mChild1 = iA;
+    C.mParent = A.mParent;
+    A.mParent = iC;
+
+    if (C.mParent != kNullNode)
+    {
+      if (mNodes[C.mParent].mChild1 == iA)
+        mNodes[C.mParent].mChild1 = iC;
+      else
+        mNodes[C.mParent].mChild2 = iC;
+    }
+    else
+    {
+      mRoot = iC;
+    }
+
+    // Keep the taller grandchild under C.
+    if (F.mHeight > G.mHeight)
+    {
+      C.mChild2 = iF;
+      A.mChild2 = iG;
+      G.mParent = iA;
+      A.mBox = AABB::Union(B.mBox, G.mBox);
+      C.mBox = AABB::Union(A.mBox, F.mBox);
+      A.mHeight = 1 + std::max(B.mHeight, G.mHeight);
+      C.mHeight = 1 + std::max(A.mHeight, F.mHeight);
+    }
+    else
+    {
+      C.mChild2 = iG;
+      A.mChild2 = iF;
+      F.mParent = iA;
+      A.mBox = AABB::Union(B.mBox, F.mBox);
+      C.mBox = AABB::Union(A.mBox, G.mBox);
+      A.mHeight = 1 + std::max(B.mHeight, F.mHeight);
+      C.mHeight = 1 + std::max(A.mHeight, G.mHeight);
+    }
+
+    return iC;
+  }
+
+  if (balance < -1)  // Rotate B up.
+  {
+    const int iD = B.mChild1;
+    const int iE = B.mChild2;
+    Node & D = mNodes[iD];
+    Node & E = mNodes[iE];
+
+    // Swap A and B.
+    B.mChild1 = iA;
+    B.mParent = A.mParent;
+    A.mParent = iB;
+
+    if (B.mParent != kNullNode)
+    {
+      if (mNodes[B.mParent].mChild1 == iA)
+        mNodes[B.mParent].mChild1 = iB;
+      else
+        mNodes[B.mParent].mChild2 = iB;
+    }
+    else
+    {
+      mRoot = iB;
+    }
+
+    // Keep the taller grandchild under B.
+    if (D.mHeight > E.mHeight)
+    {
+      B.mChild2 = iD;
+      A.mChild1 = iE;
+      E.mParent = iA;
+      A.mBox = AABB::Union(C.mBox, E.mBox);
+      B.mBox = AABB::Union(A.mBox, D.mBox);
+      A.mHeight = 1 + std::max(C.mHeight, E.mHeight);
+      B.mHeight = 1 + std::max(A.mHeight, D.mHeight);
+    }
+    else
+    {
+      B.mChild2 = iE;
+      A.mChild1 = iD;
+      D.mParent = iA;
+      A.mBox = AABB::Union(C.mBox, D.mBox);
+      B.mBox = AABB::Union(A.mBox, E.mBox);
+      A.mHeight = 1 + std::max(C.mHeight, D.mHeight);
+      B.mHeight = 1 + std::max(A.mHeight, E.mHeight);
+    }
+
+    return iB;
+  }
+
+  return iA;
+}
+
+// ------------------------------------------------------------------------------------------------
+// -> Statistics.
+
+float AABBTree::GetAreaRatio() const
+{
+  if (mRoot == kNullNode)
+    return 0.0f;
+
+  float totalArea = 0.0f;
+  for (const Node & node : mNodes)
+  {
+    if (node.mHeight >= 0)  // Skip free nodes.
+      totalArea += node.mBox.GetSurfaceArea();
+  }
+
+  const float rootArea = mNodes[mRoot].mBox.GetSurfaceArea();
+  return (rootArea > 0.0f) ? (totalArea / rootArea) : 0.0f;
+}
+
+bool AABBTree::Validate() const
+{
+  if (mRoot == kNullNode)
+    return mNumProxies == 0;
+
+  if (mNodes[mRoot].mParent != kNullNode)
+    return false;
+
+  int numLeaves = 0;
+  TraversalStack<int> stack;
+  stack.Push(mRoot);
+
+  while (!stack.IsEmpty())
+  {
+    const int index = stack.Pop();
+    if (!AABBTree::ValidateNode(index))
+      return false;
+
+    const Node & node = mNodes[index];
+    if (node.IsLeaf())
+    {
+      numLeaves++;
+    }
+    else
+    {
+      stack.Push(node.mChild1);
+      stack.Push(node.mChild2);
+    }
+  }
+
+  return numLeaves == mNumProxies;
+}
+
+bool AABBTree::ValidateNode(int index) const
+{
+  const Node & node = mNodes[index];
+  if (node.IsLeaf())
+  {
+    return (node.mChild2 == kNullNode) && (node.mHeight == 0) &&
+           (mProxies[node.mProxy].mLeaf == index);
+  }
+
+  const Node & child1 = mNodes[node.mChild1];
+  const Node & child2 = mNodes[node.mChild2];
+
+  return (child1.mParent == index) && (child2.mParent == index) &&
+         (node.mHeight == 1 + std::max(child1.mHeight, child2.mHeight)) &&
+         node.mBox.Contains(child1.mBox) && node.mBox.Contains(child2.mBox);
+}
+
+}  // namespace gloo.
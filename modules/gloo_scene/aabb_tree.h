@@ -0,0 +1,321 @@
+// + ======================================== +
+// |         gl-oo-interface library          |
+// |            Module: GLOO Scene.           |
+// |        Author: Rodrigo Castiel, 2016.    |
+// + ======================================== +
+//
+// gloo::AABBTree is a dynamic bounding volume hierarchy for scenes with moving objects.
+// It is the scene index used for culling and picking.
+//
+// Every object is a "proxy" (a leaf) with a fattened AABB: its bounds grown by a margin and
+// by its predicted displacement. When an object moves, its leaf is only reinserted if the
+// new bounds leave the fat AABB, so small motions cost one containment test.
+// Internal nodes are balanced by AVL-like tree rotations, and leaves are inserted where the
+// increase of the total surface area is the smallest (SAH-like cost).
+//
+// All nodes live in a contiguous pool (std::vector) with an embedded free list. Proxies are
+// stored apart from the nodes, in a dense array of fat AABBs: the common case of Move() (the
+// object is still inside its fat AABB) only reads that array, sequentially, so updating 100k
+// objects per frame is cheap. Proxy ids are plain indices and remain valid until removed.
+//
+// Usage:
+//   AABBTree tree;
+//   int proxy = tree.Insert(model->GetWorldAABB(), model);
+//   ...
+//   tree.Move(proxy, model->GetWorldAABB(), displacementSinceLastFrame);
+//   ...
+//   tree.Query(camera->GetFrustum(), [&](int proxy) {
+//     MyModel* model = static_cast<MyModel*>(tree.GetUserData(proxy));
+//     model->Render(camera);
+//     return true;  // Keep going (return false to stop the query).
+//   });
+//
+//   // Ray queries clip the ray: the callback returns the new maximum distance.
+//   tree.RayCast(ray, 1000.0f, [&](int proxy, const Ray & ray, float tMax) {
+//     float t;
+//     if (IntersectModel(proxy, ray, tMax, &t)) { hit = proxy; return t; }
+//     return tMax;
+//   });
+
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "gloo/bounds.h"
+#include "gloo/frustum.h"
+#include "gloo/ray.h"
+#include "traversal_stack.h"
+
+namespace gloo
+{
+
+class AABBTree
+{
+public:
+  static const int kNullNode = -1;
+
+  // margin: amount added to each side of the leaves' AABBs.
+  // displacementMultiplier: how much the fat AABB is extended along the object's motion.
+  explicit AABBTree(float margin = 0.1f, float displacementMultiplier = 2.0f);
+  ~AABBTree() { }
+
+  // -> Proxies.
+  // Creates a proxy for an object with bounds 'box'. Returns its id.
+  int Insert(const AABB & box, void* userData);
+
+  // Destroys a proxy (its id may be recycled by future insertions).
+  void Remove(int proxy);
+
+  // Updates the bounds of a proxy that moved by 'displacement' since the last call. The leaf is
+  // only reinserted if box is not contained in its fat AABB; returns true in that case.
+  bool Move(int proxy, const AABB & box, const glm::vec3 & displacement = glm::vec3(0.0f));
+
+  // Removes all proxies.
+  void Clear();
+
+  void* GetUserData(int proxy) const { return mUserData[proxy]; }
+  const AABB & GetFatAABB(int proxy) const { return mProxies[proxy].mFatBox; }
+
+  // -> Queries. Callbacks receive the proxy ids of the leaves whose fat AABBs pass the test
+  // (i.e. conservative results) and return false to stop the query.
+  template <class Callback> void Query(const AABB & box, Callback callback) const;
+  template <class Callback> void Query(const BoundingSphere & sphere, Callback callback) const;
+
+  // Leaves of subtrees that are entirely inside the frustum are reported without any test.
+  template <class Callback> void Query(const Frustum & frustum, Callback callback) const;
+
+  // Reports the leaves hit by the ray within [0, tMax], in no particular order. The callback
+  // signature is  float (int proxy, const Ray & ray, float tMax)  and it returns the new tMax
+  // (e.g. the distance of the closest hit so far). Returning 0 stops the query.
+  template <class Callback> void RayCast(const Ray & ray, float tMax, Callback callback) const;
+
+  // -> Statistics.
+  int GetNumProxies() const { return mNumProxies; }
+  int GetHeight() const { return (mRoot == kNullNode) ? 0 : mNodes[mRoot].mHeight; }
+
+  // Sum of the surface areas of all nodes over the root's (lower is better).
+  float GetAreaRatio() const;
+
+  // Checks the structure and the bounds of every node (debugging). Returns false if broken.
+  bool Validate() const;
+
+private:
+  struct Node
+  {
+    AABB mBox;          // Fat AABB for leaves; union of the children for internal nodes.
+    int mParent;        // Next free node, if this node is on the free list.
+    int mChild1;
+    int mChild2;
+    int mHeight;        // Leaves have height 0, free nodes have -1.
+    int mProxy;         // Leaves only.
+
+    bool IsLeaf() const { return mChild1 == kNullNode; }
+  };
+
+  struct Proxy
+  {
+    AABB mFatBox;
+    int mLeaf;          // Next free proxy, if this proxy is on the free list.
+  };
+
+  int AllocateNode();
+  void FreeNode(int node);
+
+  void InsertLeaf(int leaf);
+  void RemoveLeaf(int leaf);
+
+  // Rotates the subtree rooted at A if it is unbalanced. Returns the new root of the subtree.
+  int Balance(int A);
+
+  // Recomputes the boxes and heights from node up to the root (balancing on the way).
+  void Refit(int node);
+
+  bool ValidateNode(int node) const;
+
+  std::vector<Node> mNodes;  // Node pool.
+  int mRoot { kNullNode };
+  int mFreeList { kNullNode };
+
+  std::vector<Proxy> mProxies;
+  std::vector<void*> mUserData;  // Indexed by proxy.
+  int mFreeProxies { kNullNode };
+  int mNumProxies { 0 };
+
+  float mMargin;
+  float mDisplacementMultiplier;
+};
+
+// =========== IMPLEMENTATION OF INLINE METHODS ===================================================
+
+template <class Callback>
+void AABBTree::Query(const AABB & box, Callback callback) const
+{
+  TraversalStack<int> stack;
+  if (mRoot != kNullNode)
+    stack.Push(mRoot);
+
+  while (!stack.IsEmpty())
+  {
+    const int index = stack.Pop();
+    const Node & node = mNodes[index];
+    if (!node.mBox.Overlaps(box))
+      continue;
+
+    if (node.IsLeaf())
+    {
+      if (!callback(node.mProxy))
+        return;
+    }
+    else
+    {
+      stack.Push(node.mChild1);
+      stack.Push(node.mChild2);
+    }
+  }
+}
+
+template <class Callback>
+void AABBTree::Query(const BoundingSphere & sphere, Callback callback) const
+{
+  TraversalStack<int> stack;
+  if (mRoot != kNullNode)
+    stack.Push(mRoot);
+
+  while (!stack.IsEmpty())
+  {
+    const int index = stack.Pop();
+    const Node & node = mNodes[index];
+    if (!sphere.Overlaps(node.mBox))
+      continue;
+
+    if (node.IsLeaf())
+    {
+      if (!callback(node.mProxy))
+        return;
+    }
+    else
+    {
+      stack.Push(node.mChild1);
+      stack.Push(node.mChild2);
+    }
+  }
+}
+
+template <class Callback>
+void AABBTree::Query(const Frustum & frustum, Callback callback) const
+{
+  // Each entry carries the planes that its parent did not fully pass.
+  struct Entry
+  {
+    int mNode;
+    unsigned mPlaneMask;
+  };
+
+  TraversalStack<Entry> stack;
+  if (mRoot != kNullNode)
+    stack.Push(Entry { mRoot, kAllFrustumPlanes });
+
+  TraversalStack<int> inside;  // Subtrees accepted as a whole.
+
+  while (!stack.IsEmpty())
+  {
+    Entry entry = stack.Pop();
+    const Node & node = mNodes[entry.mNode];
+
+    const FrustumTest result = frustum.Classify(node.mBox, entry.mPlaneMask);
+    if (result == kOutsideFrustum)
+      continue;
+
+    if (node.IsLeaf())
+    {
+      if (!callback(node.mProxy))
+        return;
+    }
+    else if (result == kInsideFrustum)
+    {
+      // Report every leaf below this node without further tests.
+      inside.Push(entry.mNode);
+      while (!inside.IsEmpty())
+      {
+        const int index = inside.Pop();
+        const Node & child = mNodes[index];
+        if (child.IsLeaf())
+        {
+          if (!callback(child.mProxy))
+            return;
+        }
+        else
+        {
+          inside.Push(child.mChild1);
+          inside.Push(child.mChild2);
+        }
+      }
+    }
+    else
+    {
+      stack.Push(Entry { node.mChild1, entry.mPlaneMask });
+      stack.Push(Entry { node.mChild2, entry.mPlaneMask });
+    }
+  }
+}
+
+template <class Callback>
+void AABBTree::RayCast(const Ray & ray, float tMax, Callback callback) const
+{
+  // Nodes are pushed with the distance at which the ray enters them, so they can be skipped
+  // when a closer hit has been found meanwhile.
+  struct Entry
+  {
+    int mNode;
+    float mNear;
+  };
+
+  TraversalStack<Entry> stack;
+  float tRoot = 0.0f;
+  if ((mRoot != kNullNode) && ray.Intersects(mNodes[mRoot].mBox, tMax, &tRoot))
+    stack.Push(Entry { mRoot, tRoot });
+
+  while (!stack.IsEmpty() && (tMax > 0.0f))
+  {
+    const Entry entry = stack.Pop();
+    if (entry.mNear > tMax)
+      continue;
+
+    const Node & node = mNodes[entry.mNode];
+    if (node.IsLeaf())
+    {
+      tMax = callback(node.mProxy, ray, tMax);
+      continue;
+    }
+
+    // Visit the nearest child first, so tMax shrinks as early as possible.
+    float t1 = 0.0f, t2 = 0.0f;
+    const bool hit1 = ray.Intersects(mNodes[node.mChild1].mBox, tMax, &t1);
+    const bool hit2 = ray.Intersects(mNodes[node.mChild2].mBox, tMax, &t2);
+
+    if (hit1 && hit2)
+    {
+      if (t1 <= t2)
+      {
+        stack.Push(Entry { node.mChild2, t2 });  // Far one.
+        stack.Push(Entry { node.mChild1, t1 });  // Near one (popped next).
+      }
+      else
+      {
+        stack.Push(Entry { node.mChild1, t1 });
+        stack.Push(Entry { node.mChild2, t2 });
+      }
+    }
+    else if (hit1)
+    {
+      stack.Push(Entry { node.mChild1, t1 });
+    }
+    else if (hit2)
+    {
+      stack.Push(Entry { node.mChild2, t2 });
+    }
+  }
+}
+
+}  // namespace gloo.
@@ -0,0 +1,251 @@
+#include "loose_octree.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "gloo/batch_math.h"
+#include "gloo/job_system.h"
+
+namespace gloo
+{
+
+const int LooseOctree::kMaxDepth;
+
+namespace
+{
+
+const uint32_t kParallelChunkSize = 1 << 15;  // Minimum objects per job in a pass.
+const uint32_t kMaxLeafSize = 16;              // Smaller subtrees are kept as a single cell.
+const int kLevelBits = 4;                      // Low bits of the keys (levels 0 to kMaxDepth).
+const int kRadixBits = 8;
+const uint32_t kRadixSize = 1 << kRadixBits;
+
+// Spreads the 10 low bits of x so that there are two zero bits between each of them.
+uint32_t Part1By2(uint32_t x)
+{
+  x &= 0x000003ff;
+  x = (x ^ (x << 16)) & 0xff0000ff;
+  x = (x ^ (x <<  8)) & 0x0300f00f;
+  x = (x ^ (x <<  4)) & 0x030c30c3;
+  x = (x ^ (x <<  2)) & 0x09249249;
+  return x;
+}
+
+// Stable LSD radix sort of (keys, values) by the 'numBits' low bits of the keys. Each pass
+// builds per-chunk histograms in parallel, then each chunk scatters its own elements.
+void RadixSort(std::vector<uint64_t> & keys, std::vector<uint32_t> & values, int numBits,
+               unsigned numThreads)
+{
+  const uint32_t count = static_cast<uint32_t>(keys.size());
+  std::vector<uint64_t> tmpKeys(count);
+  std::vector<uint32_t> tmpValues(count);
+  std::vector<uint32_t> offsets(numThreads * kRadixSize);
+  JobSystem & jobs = JobSystem::GetDefault();
+
+  for (int shift = 0; shift < numBits; shift += kRadixBits)
+  {
+    std::fill(offsets.begin(), offsets.end(), 0);
+    auto Count = [&](uint32_t begin, uint32_t end, unsigned chunk)
+    {
+      uint32_t* histogram = &offsets[chunk * kRadixSize];
+      for (uint32_t i = begin; i < end; i++)
+        histogram[(keys[i] >> shift) & (kRadixSize - 1)]++;
+    };
+    jobs.ParallelChunks(numThreads, count, kParallelChunkSize, Count);
+
+    // Exclusive prefix sum, by digit and then by chunk. A pass where all keys have the same
+    // digit does not move anything.
+    bool trivial = false;
+    uint32_t sum = 0;
+    for (uint32_t digit = 0; digit < kRadixSize; digit++)
+    {
+      for (unsigned c = 0; c < numThreads; c++)
+      {
+        const uint32_t n = offsets[c * kRadixSize + digit];
+        trivial = trivial || (n == count);
+        offsets[c * kRadixSize + digit] = sum;
+        sum += n;
+      }
+    }
+    if (trivial)
+      continue;
+
+    auto Scatter = [&](uint32_t begin, uint32_t end, unsigned chunk)
+    {
+      uint32_t* offset = &offsets[chunk * kRadixSize];
+      for (uint32_t i = begin; i < end; i++)
+      {
+        const uint32_t j = offset[(keys[i] >> shift) & (kRadixSize - 1)]++;
+        tmpKeys[j] = keys[i];
+        tmpValues[j] = values[i];
+      }
+    };
+    jobs.ParallelChunks(numThreads, count, kParallelChunkSize, Scatter);
+
+    keys.swap(tmpKeys);
+    values.swap(tmpValues);
+  }
+}
+
+int GetLevel(uint64_t key)
+{
+  return static_cast<int>(key & ((1 << kLevelBits) - 1));
+}
+
+}  // namespace.
+
+// ------------------------------------------------------------------------------------------------
+// -> Construction.
+
+void LooseOctree::Build(const AABB* boxes, uint32_t count, unsigned numThreads)
+{
+  LooseOctree::Clear();
+  if (count == 0)
+    return;
+
+  JobSystem & jobs = JobSystem::GetDefault();
+  numThreads = jobs.GetNumThreads(numThreads);
+
+  // Scene bounds.
+  std::vector<AABB> chunkBounds(numThreads);
+  auto ComputeBounds = [&](uint32_t begin, uint32_t end, unsigned chunk)
+  {
+    for (uint32_t i = begin; i < end; i++)
+      chunkBounds[chunk].Merge(boxes[i]);
+  };
+  jobs.ParallelChunks(numThreads, count, kParallelChunkSize, ComputeBounds);
+
+  AABB bounds;
+  for (const AABB & box : chunkBounds)
+    bounds.Merge(box);
+
+  const glm::vec3 rootSize = bounds.GetSize();
+  const float rootExtent = std::max(std::max(rootSize.x, rootSize.y),
+                                    std::max(rootSize.z, 1e-6f));
+  const float toGrid = static_cast<float>(1 << kMaxDepth) / rootExtent;
+
+  // Keys: Morton code of the cell that contains the center of the object, at the deepest level
+  // whose cells are as large as the object (bits below that level are cleared), and the level.
+  std::vector<uint64_t> keys(count);
+  std::vector<uint32_t> ids(count);
+  auto ComputeKeys = [&](uint32_t begin, uint32_t end, unsigned)
+  {
+    for (uint32_t i = begin; i < end; i++)
+    {
+      const glm::vec3 size = boxes[i].GetSize();
+      const float extent = std::max(std::max(size.x, size.y), size.z);
+
+      int level = kMaxDepth;
+      if (extent * (1 << kMaxDepth) > rootExtent)
+        level = static_cast<int>(std::floor(std::log2(rootExtent / extent)));
+      level = std::max(0, std::min(kMaxDepth, level));
+
+      const glm::vec3 cell = (boxes[i].GetCenter() - bounds.mMin) * toGrid;
+      uint32_t morton = 0;
+      for (int axis = 0; axis < 3; axis++)
+      {
+        const float q = std::max(0.0f, std::min(cell[axis], float((1 << kMaxDepth) - 1)));
+        morton |= Part1By2(static_cast<uint32_t>(q)) << axis;
+      }
+
+      const int shift = 3 * (kMaxDepth - level);
+      morton = (morton >> shift) << shift;
+
+      keys[i] = (uint64_t(morton) << kLevelBits) | uint64_t(level);
+      ids[i] = i;
+    }
+  };
+  jobs.ParallelChunks(numThreads, count, kParallelChunkSize, ComputeKeys);
+
+  RadixSort(keys, ids, 3 * kMaxDepth + kLevelBits, numThreads);
+
+  // Copy the object data in sorted order, so that queries read it sequentially.
+  mBoxes.resize(count);
+  auto Gather = [&](uint32_t begin, uint32_t end, unsigned)
+  {
+    for (uint32_t i = begin; i < end; i++)
+      mBoxes[i] = boxes[ids[i]];
+  };
+  jobs.ParallelChunks(numThreads, count, kParallelChunkSize, Gather);
+  mObjectIds.swap(ids);
+
+  mNodes.resize(1);
+  LooseOctree::BuildNode(keys, 0, 0, 0, count);
+  mBounds = bounds;
+}
+
+void LooseOctree::Build(const AABB* localBoxes, const glm::mat4* models, uint32_t count,
+                        unsigned numThreads)
+{
+  JobSystem & jobs = JobSystem::GetDefault();
+  numThreads = jobs.GetNumThreads(numThreads);
+
+  std::vector<AABB> boxes(count);
+  auto TransformBoxes = [&](uint32_t begin, uint32_t end, unsigned)
+  {
+    BatchMath::TransformAABBs(models + begin, localBoxes + begin, &boxes[begin], end - begin);
+  };
+  jobs.ParallelChunks(numThreads, count, kParallelChunkSize, TransformBoxes);
+
+  LooseOctree::Build(boxes.data(), count, numThreads);
+}
+
+void LooseOctree::BuildNode(const std::vector<uint64_t> & keys, uint32_t index, int level,
+                            uint32_t first, uint32_t end)
+{
+  // The objects of this cell come first: their keys have the cell's Morton prefix, zeros below
+  // it and the lowest level. Then come the children's, in Morton order. Small subtrees are not
+  // subdivided (their objects are tested one by one anyway).
+  uint32_t ownEnd = first;
+  while ((ownEnd < end) && (GetLevel(keys[ownEnd]) == level))
+    ownEnd++;
+
+  if (end - first <= kMaxLeafSize)
+    ownEnd = end;
+
+  AABB box;
+  for (uint32_t i = first; i < ownEnd; i++)
+    box.Merge(mBoxes[i]);
+
+  // Split the remaining objects by the octant of the next level.
+  const int shift = kLevelBits + 3 * (kMaxDepth - level - 1);
+  uint32_t childFirst[8], childEnd[8];
+  uint32_t numChildren = 0;
+  for (uint32_t i = ownEnd; i < end; i++)
+  {
+    if ((i == ownEnd) || (((keys[i] ^ keys[i - 1]) >> shift) != 0))
+    {
+      childFirst[numChildren] = i;
+      numChildren++;
+    }
+    childEnd[numChildren - 1] = i + 1;
+  }
+
+  // Children are allocated together (this may reallocate mNodes, hence the indices).
+  const uint32_t firstChild = static_cast<uint32_t>(mNodes.size());
+  mNodes.resize(mNodes.size() + numChildren);
+
+  for (uint32_t c = 0; c < numChildren; c++)
+  {
+    LooseOctree::BuildNode(keys, firstChild + c, level + 1, childFirst[c], childEnd[c]);
+    box.Merge(mNodes[firstChild + c].mBox);
+  }
+
+  Node & node = mNodes[index];
+  node.mBox = box;
+  node.mFirst = first;
+  node.mOwnEnd = ownEnd;
+  node.mEnd = end;
+  node.mFirstChild = firstChild;
+  node.mNumChildren = numChildren;
+}
+
+void LooseOctree::Clear()
+{
+  mNodes.clear();
+  mBoxes.clear();
+  mObjectIds.clear();
+  mBounds = AABB();
+}
+
+}  // namespace gloo.
@@ -0,0 +1,283 @@
+// + ======================================== +
+// |         gl-oo-interface library          |
+// |            Module: GLOO Scene.           |
+// |        Author: Rodrigo Castiel, 2016.    |
+// + ======================================== +
+//
+// gloo::LooseOctree is a static spatial partition for scenes that are built once and queried
+// every frame (e.g. CAD assemblies). Use gloo::AABBTree when objects move.
+//
+// Each object is stored in exactly one cell: the cell, at the deepest level whose cells are at
+// least as large as the object, that contains the object's center. Cells are "loose" (their
+// bounds are extended by half their size on each side), so the object always fits in them.
+//
+// Objects are sorted by a key made of the Morton code of their cell and their level (parallel
+// radix sort). In that order, the objects of any subtree are contiguous, so a subtree that is
+// entirely inside a query volume is reported as a range, without visiting its nodes. Each
+// node also keeps the tight bounds of its subtree, which are used by the queries.
+//
+// Usage:
+//   // World bounds of the parts, e.g. from their CPU-side vertices and model matrices.
+//   std::vector<AABB> localBoxes(numParts);
+//   for (int i = 0; i < numParts; i++)
+//     localBoxes[i] = AABB::FromPoints(parts[i].positions, parts[i].numVertices);
+//
+//   LooseOctree octree;
+//   octree.Build(localBoxes.data(), modelMatrices.data(), numParts);
+//   ...
+//   octree.Query(camera->GetFrustum(), [&](uint32_t part) {
+//     parts[part].Render(camera);
+//     return true;  // Keep going (return false to stop the query).
+//   });
+//
+//   // Lights: objects within a light's range.
+//   octree.Query(BoundingSphere(light.position, light.radius), [&](uint32_t part) { ... });
+//
+// Object ids are their indices in the arrays passed to Build(). Results are conservative
+// (object bounds only).
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "gloo/bounds.h"
+#include "gloo/frustum.h"
+#include "gloo/ray.h"
+#include "traversal_stack.h"
+
+namespace gloo
+{
+
+class LooseOctree
+{
+public:
+  static const int kMaxDepth = 10;  // The deepest level has 2^10 cells per axis.
+
+  LooseOctree() { }
+  ~LooseOctree() { }
+
+  // Builds the octree over the world-space bounds of 'count' objects. numThreads = 0 uses
+  // all the workers of JobSystem::GetDefault().
+  void Build(const AABB* boxes, uint32_t count, unsigned numThreads = 0);
+
+  // Same as above, with object i bounded by models[i] * localBoxes[i] (affine matrices).
+  void Build(const AABB* localBoxes, const glm::mat4* models, uint32_t count,
+             unsigned numThreads = 0);
+
+  void Clear();
+
+  // -> Queries. Callbacks receive object ids and return false to stop the query.
+  template <class Callback> void Query(const Frustum & frustum, Callback callback) const;
+  template <class Callback> void Query(const AABB & box, Callback callback) const;
+  template <class Callback> void Query(const BoundingSphere & sphere, Callback callback) const;
+
+  // Reports the objects whose bounds are hit by the ray within [0, tMax], visiting the nodes
+  // nearest first. The callback signature is  float (uint32_t object, const Ray & ray,
+  // float tMax)  and it returns the new tMax (e.g. the distance of the closest hit so far).
+  // Returning 0 stops the query.
+  template <class Callback> void RayCast(const Ray & ray, float tMax, Callback callback) const;
+
+  // Getters.
+  uint32_t GetNumObjects() const { return static_cast<uint32_t>(mObjectIds.size()); }
+  uint32_t GetNumNodes() const { return static_cast<uint32_t>(mNodes.size()); }
+  const AABB & GetBounds() const { return mBounds; }
+
+private:
+  struct Node
+  {
+    AABB mBox;              // Tight bounds of the subtree's objects.
+    uint32_t mFirst;        // Objects of the subtree: [mFirst, mEnd) in sorted order.
+    uint32_t mOwnEnd;       // Objects stored in this cell: [mFirst, mOwnEnd).
+    uint32_t mEnd;
+    uint32_t mFirstChild;   // Children are contiguous.
+    uint32_t mNumChildren;
+  };
+
+  // Creates the subtree of nodes[index], a cell at 'level' with the sorted objects
+  // [first, end).
+  void BuildNode(const std::vector<uint64_t> & keys, uint32_t index, int level,
+                 uint32_t first, uint32_t end);
+
+  // Reports the objects [first, end) (in sorted order). Returns false if the callback stopped.
+  template <class Callback> bool ReportRange(uint32_t first, uint32_t end, Callback & callback) const;
+
+  // Shared by the AABB and sphere queries: test(box) tells whether a box overlaps the volume
+  // and contained(box) whether it lies entirely inside it.
+  template <class Test, class Contained, class Callback>
+  void QueryVolume(Test test, Contained contained, Callback & callback) const;
+
+  std::vector<Node> mNodes;           // mNodes[0] is the root.
+  std::vector<AABB> mBoxes;           // Object bounds, in sorted order.
+  std::vector<uint32_t> mObjectIds;   // Object ids, in sorted order.
+  AABB mBounds;
+};
+
+// =========== IMPLEMENTATION OF INLINE METHODS ===================================================
+
+template <class Callback>
+bool LooseOctree::ReportRange(uint32_t first, uint32_t end, Callback & callback) const
+{
+  for (uint32_t i = first; i < end; i++)
+  {
+    if (!callback(mObjectIds[i]))
+      return false;
+  }
+  return true;
+}
+
+template <class Callback>
+void LooseOctree::Query(const Frustum & frustum, Callback callback) const
+{
+  // Each entry carries the planes that its parent did not fully pass.
+  struct Entry
+  {
+    uint32_t mNode;
+    unsigned mPlaneMask;
+  };
+
+  TraversalStack<Entry> stack;
+  if (!mNodes.empty())
+    stack.Push(Entry { 0, kAllFrustumPlanes });
+
+  while (!stack.IsEmpty())
+  {
+    const Entry entry = stack.Pop();
+    const Node & node = mNodes[entry.mNode];
+
+    unsigned planeMask = entry.mPlaneMask;
+    const FrustumTest result = frustum.Classify(node.mBox, planeMask);
+    if (result == kOutsideFrustum)
+      continue;
+
+    if (result == kInsideFrustum)  // The whole subtree is a contiguous range.
+    {
+      if (!LooseOctree::ReportRange(node.mFirst, node.mEnd, callback))
+        return;
+      continue;
+    }
+
+    for (uint32_t i = node.mFirst; i < node.mOwnEnd; i++)
+    {
+      unsigned objectMask = planeMask;
+      if ((frustum.Classify(mBoxes[i], objectMask) != kOutsideFrustum) &&
+          !callback(mObjectIds[i]))
+        return;
+    }
+
+    for (uint32_t c = 0; c < node.mNumChildren; c++)
+      stack.Push(Entry { node.mFirstChild + c, planeMask });
+  }
+}
+
+template <class Test, class Contained, class Callback>
+void LooseOctree::QueryVolume(Test test, Contained contained, Callback & callback) const
+{
+  TraversalStack<uint32_t> stack;
+  if (!mNodes.empty())
+    stack.Push(0);
+
+  while (!stack.IsEmpty())
+  {
+    const Node & node = mNodes[stack.Pop()];
+    if (!test(node.mBox))
+      continue;
+
+    if (contained(node.mBox))
+    {
+      if (!LooseOctree::ReportRange(node.mFirst, node.mEnd, callback))
+        return;
+      continue;
+    }
+
+    for (uint32_t i = node.mFirst; i < node.mOwnEnd; i++)
+    {
+      if (test(mBoxes[i]) && !callback(mObjectIds[i]))
+        return;
+    }
+
+    for (uint32_t c = 0; c < node.mNumChildren; c++)
+      stack.Push(node.mFirstChild + c);
+  }
+}
+
+template <class Callback>
+void LooseOctree::Query(const AABB & box, Callback callback) const
+{
+  LooseOctree::QueryVolume(
+    [&](const AABB & other) { return box.Overlaps(other); },
+    [&](const AABB & other) { return box.Contains(other); },
+    callback);
+}
+
+template <class Callback>
+void LooseOctree::Query(const BoundingSphere & sphere, Callback callback) const
+{
+  // A box is inside the sphere if its farthest corner is.
+  const float radius2 = sphere.mRadius * sphere.mRadius;
+  auto Contained = [&](const AABB & other)
+  {
+    const glm::vec3 d = glm::max(glm::abs(other.mMin - sphere.mCenter),
+                                 glm::abs(other.mMax - sphere.mCenter));
+    return glm::dot(d, d) <= radius2;
+  };
+
+  LooseOctree::QueryVolume(
+    [&](const AABB & other) { return sphere.Overlaps(other); },
+    Contained,
+    callback);
+}
+
+template <class Callback>
+void LooseOctree::RayCast(const Ray & ray, float tMax, Callback callback) const
+{
+  // Nodes are pushed with the distance at which the ray enters them, so they can be skipped
+  // when a closer hit has been found meanwhile.
+  struct Entry
+  {
+    uint32_t mNode;
+    float mNear;
+  };
+
+  TraversalStack<Entry> stack;
+  float tRoot = 0.0f;
+  if (!mNodes.empty() && ray.Intersects(mNodes[0].mBox, tMax, &tRoot))
+    stack.Push(Entry { 0, tRoot });
+
+  while (!stack.IsEmpty() && (tMax > 0.0f))
+  {
+    const Entry entry = stack.Pop();
+    if (entry.mNear > tMax)
+      continue;
+
+    const Node & node = mNodes[entry.mNode];
+    for (uint32_t i = node.mFirst; (i < node.mOwnEnd) && (tMax > 0.0f); i++)
+    {
+      if (ray.Intersects(mBoxes[i], tMax))
+        tMax = callback(mObjectIds[i], ray, tMax);
+    }
+
+    // Children hit, sorted by decreasing entry distance (insertion sort of at most 8), and
+    // pushed in that order: the nearest one is visited first, and shrinks tMax for the others.
+    Entry hits[8];
+    uint32_t numHits = 0;
+    for (uint32_t c = 0; c < node.mNumChildren; c++)
+    {
+      float tNear = 0.0f;
+      if (!ray.Intersects(mNodes[node.mFirstChild + c].mBox, tMax, &tNear))
+        continue;
+
+      uint32_t j = numHits++;
+      for (; (j > 0) && (hits[j - 1].mNear < tNear); j--)
+        hits[j] = hits[j - 1];
+
+      hits[j] = Entry { node.mFirstChild + c, tNear };
+    }
+
+    for (uint32_t h = 0; h < numHits; h++)
+      stack.Push(hits[h]);
+  }
+}
+
+}  // namespace gloo.
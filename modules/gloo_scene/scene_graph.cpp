@@ -0,0 +1,278 @@
+#include "scene_graph.h"
+
+#include <algorithm>
+
+#include "gloo/job_system.h"
+
+namespace gloo
+{
+
+const int SceneGraph::kNullNode;
+
+namespace
+{
+
+const int kParallelGrainSize = 1024;  // Minimum nodes per job (and per update to go parallel).
+
+// out = a * b, for affine matrices.
+inline void MultiplyAffine(const glm::mat4 & a, const glm::mat4 & b, glm::mat4 & out)
+{
+  for (int j = 0; j < 4; j++)
+    out[j] = a[0] * b[j][0] + a[1] * b[j][1] + a[2] * b[j][2];
+  out[3] += a[3];
+}
+
+}  // namespace.
+
+// ------------------------------------------------------------------------------------------------
+// -> Structure.
+
+int SceneGraph::CreateNode(int parent, const TRS & local)
+{
+  int node = kNullNode;
+  if (!mFreeNodes.empty())
+  {
+    node = mFreeNodes.back();
+    mFreeNodes.pop_back();
+  }
+  else
+  {
+    node = static_cast<int>(mIndices.size());
+    mIndices.push_back(kNullNode);
+  }
+
+  // Appending keeps parents before children; Update() restores the breadth-first order.
+  const int index = static_cast<int>(mNodes.size());
+  mIndices[node] = index;
+  mNodes.push_back(node);
+  mParents.push_back((parent == kNullNode) ? kNullNode : mIndices[parent]);
+  mLocals.push_back(local);
+  mWorlds.push_back(glm::mat4(1.0f));
+  mFlags.push_back(0);
+
+  SceneGraph::MarkDirty(index);
+  mLayoutDirty = true;
+  return node;
+}
+
+void SceneGraph::DestroyNode(int node)
+{
+  // Descendants are found in one pass, which needs parents before children.
+  if (mLayoutDirty)
+    SceneGraph::Relayout();
+
+  const int first = mIndices[node];
+  const int n = static_cast<int>(mNodes.size());
+
+  for (int i = first; i < n; i++)
+  {
+    const int parent = mParents[i];
+    if ((i == first) || ((parent >= first) && (mFlags[parent] & kDestroyed)))
+    {
+      mFlags[i] |= kDestroyed;
+      mIndices[mNodes[i]] = kNullNode;
+      mFreeNodes.push_back(mNodes[i]);
+    }
+  }
+
+  mLayoutDirty = true;
+}
+
+bool SceneGraph::SetParent(int node, int parent)
+{
+  const int index = mIndices[node];
+  const int parentIndex = (parent == kNullNode) ? kNullNode : mIndices[parent];
+
+  for (int i = parentIndex; i != kNullNode; i = mParents[i])
+  {
+    if (i == index)  // parent is in the subtree of node.
+      return false;
+  }
+
+  mParents[index] = parentIndex;
+  SceneGraph::MarkDirty(index);
+  mLayoutDirty = true;
+  return true;
+}
+
+void SceneGraph::Clear()
+{
+  mParents.clear();
+  mLocals.clear();
+  mWorlds.clear();
+  mFlags.clear();
+  mNodes.clear();
+  mLevels.clear();
+  mIndices.clear();
+  mFreeNodes.clear();
+
+  mFirstDirty = kNullNode;
+  mFirstUpdated = 0;
+  mLayoutDirty = false;
+}
+
+void SceneGraph::Relayout()
+{
+  const int n = static_cast<int>(mNodes.size());
+
+  // Children of each node, in index order (counting sort by parent).
+  std::vector<int> childStart(n + 1, 0);
+  for (int i = 0; i < n; i++)
+  {
+    if (!(mFlags[i] & kDestroyed) && (mParents[i] != kNullNode))
+      childStart[mParents[i] + 1]++;
+  }
+
+  for (int i = 0; i < n; i++)
+    childStart[i + 1] += childStart[i];
+
+  std::vector<int> children(childStart[n]);
+  std::vector<int> cursor(childStart.begin(), childStart.end() - 1);
+  for (int i = 0; i < n; i++)
+  {
+    if (!(mFlags[i] & kDestroyed) && (mParents[i] != kNullNode))
+      children[cursor[mParents[i]]++] = i;
+  }
+
+  // Breadth-first order: roots, then their children, and so on.
+  std::vector<int> order;
+  order.reserve(n);
+  for (int i = 0; i < n; i++)
+  {
+    if (!(mFlags[i] & kDestroyed) && (mParents[i] == kNullNode))
+      order.push_back(i);
+  }
+
+  for (size_t head = 0; head < order.size(); head++)
+  {
+    const int i = order[head];
+    order.insert(order.end(),
+                 children.begin() + childStart[i], children.begin() + childStart[i + 1]);
+  }
+
+  // Permute the arrays.
+  std::vector<int> newIndices(n, kNullNode);
+  for (size_t k = 0; k < order.size(); k++)
+    newIndices[order[k]] = static_cast<int>(k);
+
+  const int m = static_cast<int>(order.size());
+  std::vector<int> parents(m), nodes(m);
+  std::vector<TRS> locals(m);
+  std::vector<glm::mat4> worlds(m);
+  std::vector<uint8_t> flags(m);
+
+  mFirstDirty = kNullNode;
+  for (int k = 0; k < m; k++)
+  {
+    const int i = order[k];
+    parents[k] = (mParents[i] == kNullNode) ? kNullNode : newIndices[mParents[i]];
+    locals[k] = mLocals[i];
+    worlds[k] = mWorlds[i];
+    flags[k] = mFlags[i] & kLocalDirty;
+    nodes[k] = mNodes[i];
+    mIndices[nodes[k]] = k;
+
+    if ((flags[k] & kLocalDirty) && (mFirstDirty == kNullNode))
+      mFirstDirty = k;
+  }
+
+  // A depth starts at the first node whose parent is in the previous one (roots come first).
+  mLevels.assign(1, 0);
+  for (int k = 0; k < m; k++)
+  {
+    if ((parents[k] != kNullNode) && (parents[k] >= mLevels.back()))
+      mLevels.push_back(k);
+  }
+  mLevels.push_back(m);
+
+  mParents.swap(parents);
+  mLocals.swap(locals);
+  mWorlds.swap(worlds);
+  mFlags.swap(flags);
+  mNodes.swap(nodes);
+  mLayoutDirty = false;
+}
+
+// ------------------------------------------------------------------------------------------------
+// -> Transforms.
+
+void SceneGraph::SetLocal(int node, const TRS & local)
+{
+  const int index = mIndices[node];
+  mLocals[index] = local;
+  SceneGraph::MarkDirty(index);
+}
+
+void SceneGraph::Update(unsigned numThreads)
+{
+  // After a relayout, every index may refer to a different node.
+  const bool relayout = mLayoutDirty;
+  if (relayout)
+    SceneGraph::Relayout();
+
+  const int n = static_cast<int>(mNodes.size());
+  if (mFirstDirty == kNullNode)
+  {
+    mFirstUpdated = relayout ? 0 : n;
+    return;
+  }
+
+  // Nodes before the first dirty one cannot change. Parents come before their children, so a
+  // single pass from there updates everything, unless the update is large enough to be split.
+  const int first = mFirstDirty;
+  JobSystem & jobs = JobSystem::GetDefault();
+  numThreads = jobs.GetNumThreads(numThreads);
+
+  if ((numThreads == 1) || (n - first < 2 * kParallelGrainSize))
+  {
+    SceneGraph::UpdateRange(first, first, n);
+  }
+  else
+  {
+    // The nodes of a level only depend on the previous level, which is complete by then.
+    for (size_t level = 0; level + 1 < mLevels.size(); level++)
+    {
+      const int begin = std::max(first, mLevels[level]);
+      const int end = mLevels[level + 1];
+      if (begin >= end)
+        continue;
+
+      const uint32_t count = static_cast<uint32_t>(end - begin);
+      const uint32_t grainSize = std::max(uint32_t(kParallelGrainSize),
+                                          (count + numThreads - 1) / numThreads);
+      auto UpdateLevel = [&](uint32_t rangeBegin, uint32_t rangeEnd)
+      {
+        SceneGraph::UpdateRange(first, begin + rangeBegin, begin + rangeEnd);
+      };
+      jobs.ParallelFor(count, grainSize, UpdateLevel);
+    }
+  }
+
+  mFirstDirty = kNullNode;
+  mFirstUpdated = relayout ? 0 : first;
+}
+
+void SceneGraph::UpdateRange(int first, int begin, int end)
+{
+  // A node changes if its local transform did or if its parent was recomputed in this update.
+  for (int i = begin; i < end; i++)
+  {
+    const int parent = mParents[i];
+    const bool dirty = (mFlags[i] & kLocalDirty) ||
+                       ((parent >= first) && (mFlags[parent] & kWorldDirty));
+    if (!dirty)
+    {
+      mFlags[i] = 0;
+      continue;
+    }
+
+    if (parent == kNullNode)
+      mWorlds[i] = mLocals[i].ToMatrix();
+    else
+      MultiplyAffine(mWorlds[parent], mLocals[i].ToMatrix(), mWorlds[i]);
+
+    mFlags[i] = kWorldDirty;
+  }
+}
+
+}  // namespace gloo.
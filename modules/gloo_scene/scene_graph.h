@@ -0,0 +1,153 @@
+// + ======================================== +
+// |         gl-oo-interface library          |
+// |            Module: GLOO Scene.           |
+// |        Author: Rodrigo Castiel, 2016.    |
+// + ======================================== +
+//
+// gloo::SceneGraph stores a transform hierarchy in flat arrays, in breadth-first order (every
+// parent comes before its children): parent index, local transform (gloo::TRS), world matrix
+// and dirty flags. It replaces recomputing hierarchies with Transform::PushMatrix()/PopMatrix()
+// while drawing.
+//
+// Update() recomputes the world matrices in a single linear pass, which starts at the first
+// node whose local transform changed and only recomputes changed nodes and their descendants.
+// If nothing changed, it returns right away, so static hierarchies cost nothing per frame.
+// Since a node only depends on its parent, and each depth of the hierarchy is contiguous in
+// breadth-first order, large updates run level by level, each level split among the workers of
+// gloo::JobSystem.
+//
+// Nodes are referred to by handles, which stay valid until the node is destroyed. Structural
+// changes (creating, destroying or reparenting nodes) are applied by the next Update(), which
+// then restores the breadth-first order (one linear pass over the graph).
+//
+// Usage:
+//   SceneGraph graph;
+//   int car = graph.CreateNode(SceneGraph::kNullNode, TRS(position, rotation));
+//   int wheel = graph.CreateNode(car, TRS(glm::vec3(1, 0, 1)));
+//   ...
+//   graph.SetLocal(car, TRS(newPosition, newRotation));  // The wheel moves along.
+//   graph.Update();
+//   renderer->Render(wheelMesh, graph.GetWorldMatrix(wheel), camera);
+//
+//   // World matrices may also be read (or uploaded) as an array: after Update(), only the
+//   // entries [GetFirstUpdated(), GetNumNodes()) may have changed.
+//   const glm::mat4* worlds = graph.GetWorldMatrices();
+//   int index = graph.GetIndex(wheel);  // Position of the wheel in the arrays.
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "gloo/trs.h"
+
+namespace gloo
+{
+
+class SceneGraph
+{
+public:
+  static const int kNullNode = -1;
+
+  SceneGraph() { }
+  ~SceneGraph() { }
+
+  // -> Structure.
+  // Creates a node (a root if parent is kNullNode) and returns its handle.
+  int CreateNode(int parent = kNullNode, const TRS & local = TRS());
+
+  // Destroys a node and all its descendants.
+  void DestroyNode(int node);
+
+  // Moves a node (and its subtree) under another parent, keeping its local transform.
+  // Returns false if parent is the node itself or one of its descendants.
+  bool SetParent(int node, int parent);
+
+  void Clear();
+
+  // -> Transforms.
+  void SetLocal(int node, const TRS & local);
+  const TRS & GetLocal(int node) const { return mLocals[mIndices[node]]; }
+
+  // Applies structural changes and recomputes the world matrices that changed. numThreads = 0
+  // uses all the workers of JobSystem::GetDefault() (1 updates on the calling thread only).
+  void Update(unsigned numThreads = 0);
+
+  // World matrix of a node, as of the last Update().
+  const glm::mat4 & GetWorldMatrix(int node) const { return mWorlds[mIndices[node]]; }
+
+  // -> Flat arrays (valid after Update()). Indices are positions in breadth-first order.
+  int GetNumNodes() const { return static_cast<int>(mNodes.size()); }
+  const glm::mat4* GetWorldMatrices() const { return mWorlds.data(); }
+  const int* GetParentIndices() const { return mParents.data(); }
+
+  int GetIndex(int node) const { return mIndices[node]; }
+  int GetNode(int index) const { return mNodes[index]; }
+
+  // Index of the first world matrix recomputed by the last Update() (GetNumNodes() if none).
+  int GetFirstUpdated() const { return mFirstUpdated; }
+
+  // Getters.
+  int GetParent(int node) const;
+  bool IsValid(int node) const;
+
+private:
+  enum Flags
+  {
+    kLocalDirty  = 1 << 0,  // The local transform changed.
+    kWorldDirty  = 1 << 1,  // The world matrix was recomputed by the current Update().
+    kDestroyed   = 1 << 2,  // Removed by the next Update().
+  };
+
+  // Restores the breadth-first order and drops destroyed nodes.
+  void Relayout();
+
+  // Recomputes the nodes of [begin, end) that changed, given that their parents are up to date
+  // and that no node before first changed.
+  void UpdateRange(int first, int begin, int end);
+
+  void MarkDirty(int index);
+
+  // Data per index (breadth-first order).
+  std::vector<int> mParents;       // Parent index (kNullNode for roots).
+  std::vector<TRS> mLocals;
+  std::vector<glm::mat4> mWorlds;
+  std::vector<uint8_t> mFlags;
+  std::vector<int> mNodes;         // Handle of the node at each index.
+  std::vector<int> mLevels;        // First index of each depth, then GetNumNodes().
+
+  // Data per handle.
+  std::vector<int> mIndices;       // Index of each node (kNullNode if the handle is free).
+  std::vector<int> mFreeNodes;
+
+  int mFirstDirty { kNullNode };   // Lowest index with kLocalDirty.
+  int mFirstUpdated { 0 };
+  bool mLayoutDirty { false };
+};
+
+// =========== IMPLEMENTATION OF INLINE METHODS ===================================================
+
+inline
+bool SceneGraph::IsValid(int node) const
+{
+  return (node >= 0) && (node < static_cast<int>(mIndices.size())) &&
+         (mIndices[node] != kNullNode);
+}
+
+inline
+int SceneGraph::GetParent(int node) const
+{
+  const int parent = mParents[mIndices[node]];
+  return (parent == kNullNode) ? kNullNode : mNodes[parent];
+}
+
+inline
+void SceneGraph::MarkDirty(int index)
+{
+  mFlags[index] |= kLocalDirty;
+  if ((mFirstDirty == kNullNode) || (index < mFirstDirty))
+    mFirstDirty = index;
+}
+
+}  // namespace gloo.
@@ -0,0 +1,82 @@
+#include "scene_picker.h"
+
+#include "gloo/transform.h"
+
+namespace gloo
+{
+
+int ScenePicker::Add(const TriangleBVH* bvh, const glm::mat4 & model, void* userData)
+{
+  const AABB worldBox = bvh->GetBounds().Transformed(model);
+  const int object = mTree.Insert(worldBox, nullptr);
+
+  if (object >= static_cast<int>(mObjects.size()))
+    mObjects.resize(object + 1);
+
+  Object & entry = mObjects[object];
+  entry.mBVH = bvh;
+  entry.mInverseModel = Transform::ComputeInverse(model);
+  entry.mWorldBox = worldBox;
+  entry.mUserData = userData;
+
+  return object;
+}
+
+void ScenePicker::Remove(int object)
+{
+  mTree.Remove(object);
+  mObjects[object] = Object();
+}
+
+void ScenePicker::SetTransform(int object, const glm::mat4 & model)
+{
+  Object & entry = mObjects[object];
+  const AABB worldBox = entry.mBVH->GetBounds().Transformed(model);
+  const glm::vec3 displacement = worldBox.GetCenter() - entry.mWorldBox.GetCenter();
+
+  entry.mInverseModel = Transform::ComputeInverse(model);
+  entry.mWorldBox = worldBox;
+  mTree.Move(object, worldBox, displacement);
+}
+
+bool ScenePicker::Pick(const Ray & ray, float tMax, PickResult* result) const
+{
+  int closest = -1;
+  TriangleHit closestHit;
+
+  mTree.RayCast(ray, tMax, [&](int object, const Ray & worldRay, float tCurrent) -> float
+  {
+    const Object & entry = mObjects[object];
+    if (!worldRay.Intersects(entry.mWorldBox, tCurrent))  // The tree stores fat boxes.
+      return tCurrent;
+
+    // Rays are not normalized, so t is the same in local and world space.
+    const glm::mat4 & inverse = entry.mInverseModel;
+    const Ray localRay(glm::vec3(inverse * glm::vec4(worldRay.mOrigin, 1.0f)),
+                       glm::vec3(inverse * glm::vec4(worldRay.mDirection, 0.0f)));
+
+    TriangleHit hit;
+    if (!entry.mBVH->Intersect(localRay, tCurrent, &hit))
+      return tCurrent;
+
+    closest = object;
+    closestHit = hit;
+    return hit.mT;
+  });
+
+  if (closest < 0)
+    return false;
+
+  if (result)
+  {
+    result->mObject = closest;
+    result->mUserData = mObjects[closest].mUserData;
+    result->mTriangle = closestHit.mTriangle;
+    result->mT = closestHit.mT;
+    result->mPoint = ray.GetPoint(closestHit.mT);
+  }
+
+  return true;
+}
+
+}  // namespace gloo.
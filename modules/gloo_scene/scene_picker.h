@@ -0,0 +1,81 @@
+// + ======================================== +
+// |         gl-oo-interface library          |
+// |            Module: GLOO Scene.           |
+// |        Author: Rodrigo Castiel, 2016.    |
+// + ======================================== +
+//
+// gloo::ScenePicker finds the closest triangle hit by a ray among many transformed meshes.
+// Objects are indexed by their world-space bounds in an AABBTree; only the objects whose
+// bounds the ray reaches (nearest first, up to the closest hit so far) have their triangle
+// BVHs traversed, with the ray brought into the mesh's local space.
+//
+// Several objects may share the same TriangleBVH (instancing). The BVHs are not owned by the
+// picker and must outlive it.
+//
+// Usage:
+//   ScenePicker picker;
+//   int id = picker.Add(&meshBVH, model->GetModelMatrix(), model);
+//   ...
+//   picker.SetTransform(id, model->GetModelMatrix());  // When the object moves.
+//   ...
+//   // On mouse move:
+//   PickResult result;
+//   Ray ray = camera->ComputePickingRay(x, y, width, height);
+//   if (picker.Pick(ray, 1.0f, &result))
+//     Highlight(static_cast<MyModel*>(result.mUserData), result.mTriangle);
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "aabb_tree.h"
+#include "triangle_bvh.h"
+
+namespace gloo
+{
+
+struct PickResult
+{
+  int mObject { -1 };            // Id returned by ScenePicker::Add().
+  void* mUserData { nullptr };
+  uint32_t mTriangle { 0 };      // Triangle of the object's mesh.
+  float mT { 0.0f };             // Ray parameter of the hit.
+  glm::vec3 mPoint { 0.0f };     // World-space hit point.
+};
+
+class ScenePicker
+{
+public:
+  ScenePicker() { }
+  ~ScenePicker() { }
+
+  // Adds an object made of the triangles in bvh (local space) placed by model. Returns its id.
+  int Add(const TriangleBVH* bvh, const glm::mat4 & model, void* userData = nullptr);
+
+  void Remove(int object);
+
+  // Updates the model matrix of an object.
+  void SetTransform(int object, const glm::mat4 & model);
+
+  // Finds the closest hit within [0, tMax] of the ray. Returns false if there is none.
+  bool Pick(const Ray & ray, float tMax, PickResult* result) const;
+
+  const AABBTree & GetTree() const { return mTree; }
+  int GetNumObjects() const { return mTree.GetNumProxies(); }
+
+private:
+  struct Object
+  {
+    const TriangleBVH* mBVH { nullptr };
+    glm::mat4 mInverseModel;
+    AABB mWorldBox;
+    void* mUserData { nullptr };
+  };
+
+  AABBTree mTree;
+  std::vector<Object> mObjects;  // Indexed by proxy (object id).
+};
+
+}  // namespace gloo.
@@ -0,0 +1,71 @@
+// + ======================================== +
+// |         gl-oo-interface library          |
+// |            Module: GLOO Scene.           |
+// |        Author: Rodrigo Castiel, 2016.    |
+// + ======================================== +
+//
+// gloo::TraversalStack is the stack of node indices used to traverse the spatial data
+// structures of this module without recursion. The first kInlineCapacity entries live on the
+// (call) stack; deeper traversals, which only happen with badly unbalanced trees, spill
+// into the heap.
+//
+// Usage:
+//   TraversalStack<int> stack;
+//   stack.Push(root);
+//   while (!stack.IsEmpty())
+//   {
+//     int node = stack.Pop();
+//     ...
+//   }
+
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+namespace gloo
+{
+
+template <class T, size_t kInlineCapacity = 64>
+class TraversalStack
+{
+public:
+  TraversalStack() { }
+
+  void Push(const T & value);
+  T Pop() { return (mSize <= kInlineCapacity) ? mInline[--mSize] : mSpill[--mSize - kInlineCapacity]; }
+
+  bool IsEmpty() const { return mSize == 0; }
+  size_t GetSize() const { return mSize; }
+
+  void Clear() { mSize = 0; }
+
+private:
+  TraversalStack(const TraversalStack &) = delete;
+  TraversalStack & operator=(const TraversalStack &) = delete;
+
+  T mInline[kInlineCapacity];
+  std::vector<T> mSpill;  // Entries beyond kInlineCapacity.
+  size_t mSize { 0 };
+};
+
+// =========== IMPLEMENTATION OF INLINE METHODS ===================================================
+
+template <class T, size_t kInlineCapacity>
+inline
+void TraversalStack<T, kInlineCapacity>::Push(const T & value)
+{
+  if (mSize < kInlineCapacity)
+  {
+    mInline[mSize++] = value;
+    return;
+  }
+
+  const size_t spillIndex = mSize++ - kInlineCapacity;
+  if (spillIndex < mSpill.size())
+    mSpill[spillIndex] = value;
+  else
+    mSpill.push_back(value);
+}
+
+}  // namespace gloo.
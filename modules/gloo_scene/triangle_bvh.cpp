@@ -0,0 +1,704 @@
+#include "triangle_bvh.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "gloo/job_system.h"
+#include "traversal_stack.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define GLOO_BVH_SSE  // SSE2 is part of x86-64.
+#include <emmintrin.h>
+#endif
+
+namespace gloo
+{
+
+const uint32_t TriangleBVH::kMaxLeafSize;
+const uint32_t TriangleBVH::kNumBins;
+
+namespace
+{
+
+const float kTraversalCost = 1.0f;           // Relative to the cost of a ray-triangle test.
+const uint32_t kParallelSubtreeSize = 1 << 15;  // Subtrees larger than this get their own job.
+const uint32_t kParallelChunkSize = 1 << 16;    // Minimum triangles per job in a pass.
+
+// Bounds and centroid bounds of the triangles that fall into a bin. Plain floats, so that bins
+// are not initialized when created (nodes only reset the bins they use).
+struct Bin
+{
+  float mMin[3], mMax[3];
+  float mCentroidMin[3], mCentroidMax[3];
+  uint32_t mCount;
+
+  void Reset()
+  {
+    for (int i = 0; i < 3; i++)
+    {
+      mMin[i] = mCentroidMin[i] = std::numeric_limits<float>::max();
+      mMax[i] = mCentroidMax[i] = -std::numeric_limits<float>::max();
+    }
+    mCount = 0;
+  }
+
+  void Add(const AABB & box, const glm::vec3 & centroid)
+  {
+    for (int i = 0; i < 3; i++)
+    {
+      mMin[i] = std::min(mMin[i], box.mMin[i]);
+      mMax[i] = std::max(mMax[i], box.mMax[i]);
+      mCentroidMin[i] = std::min(mCentroidMin[i], centroid[i]);
+      mCentroidMax[i] = std::max(mCentroidMax[i], centroid[i]);
+    }
+    mCount++;
+  }
+
+  void Merge(const Bin & other)
+  {
+    for (int i = 0; i < 3; i++)
+    {
+      mMin[i] = std::min(mMin[i], other.mMin[i]);
+      mMax[i] = std::max(mMax[i], other.mMax[i]);
+      mCentroidMin[i] = std::min(mCentroidMin[i], other.mCentroidMin[i]);
+      mCentroidMax[i] = std::max(mCentroidMax[i], other.mCentroidMax[i]);
+    }
+    mCount += other.mCount;
+  }
+
+  AABB GetBox() const
+  {
+    return AABB(glm::vec3(mMin[0], mMin[1], mMin[2]), glm::vec3(mMax[0], mMax[1], mMax[2]));
+  }
+
+  AABB GetCentroidBox() const
+  {
+    return AABB(glm::vec3(mCentroidMin[0], mCentroidMin[1], mCentroidMin[2]),
+                glm::vec3(mCentroidMax[0], mCentroidMax[1], mCentroidMax[2]));
+  }
+};
+
+// Bins of one range of triangles.
+struct BinSet
+{
+  Bin mBins[TriangleBVH::kNumBins];
+
+  void Reset(uint32_t numBins)
+  {
+    for (uint32_t b = 0; b < numBins; b++)
+      mBins[b].Reset();
+  }
+
+  void Merge(const BinSet & other, uint32_t numBins)
+  {
+    for (uint32_t b = 0; b < numBins; b++)
+      mBins[b].Merge(other.mBins[b]);
+  }
+};
+
+}  // namespace.
+
+struct TriangleBVH::BuildContext
+{
+  const float* mPositions;
+  const uint32_t* mIndices;       // nullptr for plain triangle lists.
+  std::vector<AABB> mBoxes;       // Bounds of each input triangle.
+  std::vector<uint32_t> mRefs;    // Input triangles, partitioned in place by the build.
+
+  JobSystem* mJobs;
+  unsigned mNumThreads;
+
+  uint32_t GetVertex(uint32_t triangle, int k) const
+  {
+    return mIndices ? mIndices[3*triangle + k] : (3*triangle + k);
+  }
+
+  AABB GetTriangleBox(uint32_t triangle) const
+  {
+    AABB box;
+    for (int k = 0; k < 3; k++)
+    {
+      const float* p = mPositions + 3 * GetVertex(triangle, k);
+      box.Expand(glm::vec3(p[0], p[1], p[2]));
+    }
+    return box;
+  }
+
+  // Bounds of the triangles [first, first + count) and of their centroids.
+  void ComputeBounds(uint32_t first, uint32_t count, AABB & box, AABB & centroidBox) const
+  {
+    box = AABB();
+    centroidBox = AABB();
+    for (uint32_t i = first; i < first + count; i++)
+    {
+      box.Merge(mBoxes[mRefs[i]]);
+      centroidBox.Expand(mBoxes[mRefs[i]].GetCenter());
+    }
+  }
+};
+
+// ------------------------------------------------------------------------------------------------
+// -> Construction.
+
+void TriangleBVH::Build(const float* positions, uint32_t numVertices,
+                        const uint32_t* indices, uint32_t numTriangles, unsigned numThreads)
+{
+  TriangleBVH::Clear();
+  if (numTriangles == 0)
+    return;
+
+  JobSystem & jobs = JobSystem::GetDefault();
+  numThreads = jobs.GetNumThreads(numThreads);
+
+  BuildContext context;
+  context.mPositions = positions;
+  context.mIndices = indices;
+  context.mJobs = &jobs;
+  context.mNumThreads = numThreads;
+  context.mBoxes.resize(numTriangles);
+  context.mRefs.resize(numTriangles);
+
+  auto ComputeBoxes = [&](uint32_t begin, uint32_t end, unsigned)
+  {
+    for (uint32_t i = begin; i < end; i++)
+    {
+      context.mBoxes[i] = context.GetTriangleBox(i);
+      context.mRefs[i] = i;
+    }
+  };
+  jobs.ParallelChunks(numThreads, numTriangles, kParallelChunkSize, ComputeBoxes);
+
+  // Root bounds (the children's are derived from the bins of their parents).
+  std::vector<AABB> chunkBoxes(2 * numThreads);
+  auto ComputeRootBounds = [&](uint32_t begin, uint32_t end, unsigned chunk)
+  {
+    context.ComputeBounds(begin, end - begin, chunkBoxes[2*chunk + 0], chunkBoxes[2*chunk + 1]);
+  };
+  jobs.ParallelChunks(numThreads, numTriangles, kParallelChunkSize, ComputeRootBounds);
+
+  AABB box, centroidBox;
+  for (unsigned c = 0; c < numThreads; c++)
+  {
+    box.Merge(chunkBoxes[2*c + 0]);
+    centroidBox.Merge(chunkBoxes[2*c + 1]);
+  }
+
+  mNodes.resize(1);
+  mNodes.reserve(numTriangles);
+  TriangleBVH::BuildSubtree(context, mNodes, 0, 0, numTriangles, box, centroidBox);
+  mNodes.shrink_to_fit();
+
+  mBounds = AABB(glm::vec3(mNodes[0].mMin[0], mNodes[0].mMin[1], mNodes[0].mMin[2]),
+                 glm::vec3(mNodes[0].mMax[0], mNodes[0].mMax[1], mNodes[0].mMax[2]));
+
+  // Store the triangles in leaf order, so leaves reference contiguous ranges.
+  mPositions.assign(positions, positions + 3 * size_t(numVertices));
+  mTriangles.resize(3 * size_t(numTriangles));
+  mLeafOrder.resize(numTriangles);
+  mTriangleIds.swap(context.mRefs);
+
+  for (uint32_t i = 0; i < numTriangles; i++)
+  {
+    const uint32_t id = mTriangleIds[i];
+    mTriangles[3*i + 0] = context.GetVertex(id, 0);
+    mTriangles[3*i + 1] = context.GetVertex(id, 1);
+    mTriangles[3*i + 2] = context.GetVertex(id, 2);
+    mLeafOrder[id] = i;
+  }
+}
+
+void TriangleBVH::BuildSubtree(BuildContext & context, std::vector<Node> & nodes, uint32_t index,
+                               uint32_t first, uint32_t count,
+                               const AABB & box, const AABB & centroidBox) const
+{
+  for (int i = 0; i < 3; i++)
+  {
+    nodes[index].mMin[i] = box.mMin[i];
+    nodes[index].mMax[i] = box.mMax[i];
+  }
+
+  auto MakeLeaf = [&]()
+  {
+    nodes[index].mLeftFirst = first;
+    nodes[index].mCount = count;
+  };
+
+  if (count == 1)
+  {
+    MakeLeaf();
+    return;
+  }
+
+  uint32_t* refs = context.mRefs.data() + first;
+  const AABB* boxes = context.mBoxes.data();
+
+  // Bin the triangles by centroid along the axis of largest extent (small nodes use fewer
+  // bins). If all centroids coincide there is nothing to split.
+  const glm::vec3 extent = centroidBox.GetSize();
+  const int axis = (extent[0] > extent[1]) ? ((extent[0] > extent[2]) ? 0 : 2)
+                                           : ((extent[1] > extent[2]) ? 1 : 2);
+  const uint32_t numBins = std::min(kNumBins, std::max(4u, count));
+  const float scale = (extent[axis] > 0.0f) ? (numBins / extent[axis]) : 0.0f;
+
+  auto GetBin = [&](const AABB & triangleBox) -> uint32_t
+  {
+    const float centroid = 0.5f * (triangleBox.mMin[axis] + triangleBox.mMax[axis]);
+    const float offset = (centroid - centroidBox.mMin[axis]) * scale;
+    return std::min(numBins - 1, static_cast<uint32_t>(offset));
+  };
+
+  // Large nodes are binned by several jobs, each one into its own set of bins.
+  const unsigned numThreads = (count >= kParallelSubtreeSize) ? context.mNumThreads : 1;
+  BinSet localBins;
+  std::vector<BinSet> chunkBins;
+  BinSet* bins = &localBins;
+  if (numThreads > 1)
+  {
+    chunkBins.resize(numThreads);
+    bins = chunkBins.data();
+  }
+
+  if (scale > 0.0f)
+  {
+    for (unsigned c = 0; c < numThreads; c++)  // Also the sets of chunks that may not run.
+      bins[c].Reset(numBins);
+
+    auto BinRange = [&](uint32_t begin, uint32_t end, unsigned chunk)
+    {
+      BinSet & chunkSet = bins[chunk];
+      for (uint32_t i = begin; i < end; i++)
+      {
+        const AABB & triangleBox = boxes[refs[i]];
+        chunkSet.mBins[GetBin(triangleBox)].Add(triangleBox, triangleBox.GetCenter());
+      }
+    };
+    context.mJobs->ParallelChunks(numThreads, count, kParallelChunkSize, BinRange);
+
+    for (unsigned c = 1; c < numThreads; c++)
+      bins[0].Merge(bins[c], numBins);
+  }
+
+  // Evaluate the SAH cost of the split planes between bins.
+  bool found = false;
+  uint32_t bestBin = 0;
+  float bestCost = 0.0f;
+
+  if (scale > 0.0f)
+  {
+    float rightCosts[kNumBins];
+    Bin right;
+    right.Reset();
+    for (uint32_t b = numBins - 1; b > 0; b--)
+    {
+      right.Merge(bins[0].mBins[b]);
+      rightCosts[b] = (right.mCount > 0) ? right.mCount * right.GetBox().GetSurfaceArea() : 0.0f;
+    }
+
+    Bin left;
+    left.Reset();
+    for (uint32_t b = 0; b + 1 < numBins; b++)  // Split between bins b and b + 1.
+    {
+      left.Merge(bins[0].mBins[b]);
+      if ((left.mCount == 0) || (left.mCount == count))
+        continue;
+
+      const float cost = left.mCount * left.GetBox().GetSurfaceArea() + rightCosts[b + 1];
+      if (!found || (cost < bestCost))
+      {
+        found = true;
+        bestBin = b;
+        bestCost = cost;
+      }
+    }
+  }
+
+  uint32_t leftCount = count / 2;
+  AABB leftBox, leftCentroidBox, rightBox, rightCentroidBox;
+
+  if (found)
+  {
+    const float area = box.GetSurfaceArea();
+    const float splitCost = kTraversalCost + ((area > 0.0f) ? (bestCost / area) : 0.0f);
+    if ((count <= kMaxLeafSize) && (count <= splitCost))
+    {
+      MakeLeaf();
+      return;
+    }
+
+    uint32_t* middle = std::partition(refs, refs + count, [&](uint32_t triangle)
+    {
+      return GetBin(boxes[triangle]) <= bestBin;
+    });
+    leftCount = static_cast<uint32_t>(middle - refs);
+
+    // The children's bounds come from the bins, so they need no extra pass.
+    Bin left, right;
+    left.Reset();
+    right.Reset();
+    for (uint32_t b = 0; b < numBins; b++)
+      (b <= bestBin ? left : right).Merge(bins[0].mBins[b]);
+
+    leftBox = left.GetBox();
+    leftCentroidBox = left.GetCentroidBox();
+    rightBox = right.GetBox();
+    rightCentroidBox = right.GetCentroidBox();
+  }
+  else if (count <= kMaxLeafSize)  // All centroids coincide.
+  {
+    MakeLeaf();
+    return;
+  }
+  else  // Median split (in any order, since the centroids coincide).
+  {
+    context.ComputeBounds(first, leftCount, leftBox, leftCentroidBox);
+    context.ComputeBounds(first + leftCount, count - leftCount, rightBox, rightCentroidBox);
+  }
+
+  // Children are allocated as a pair (the vector may grow, so no references are kept).
+  const uint32_t left = static_cast<uint32_t>(nodes.size());
+  nodes.resize(nodes.size() + 2);
+  nodes[index].mLeftFirst = left;
+  nodes[index].mCount = 0;
+
+  const uint32_t rightFirst = first + leftCount;
+  const uint32_t rightCount = count - leftCount;
+  if ((context.mNumThreads > 1) &&
+      (leftCount >= kParallelSubtreeSize) && (rightCount >= kParallelSubtreeSize))
+  {
+    // The left subtree is built by a job into its own array, then appended.
+    std::vector<Node> leftNodes(1);
+    auto BuildLeft = [&]()
+    {
+      TriangleBVH::BuildSubtree(context, leftNodes, 0, first, leftCount,
+                                leftBox, leftCentroidBox);
+    };
+
+    JobCounter counter;
+    context.mJobs->Run(counter, BuildLeft);
+    TriangleBVH::BuildSubtree(context, nodes, left + 1, rightFirst, rightCount,
+                              rightBox, rightCentroidBox);
+    context.mJobs->Wait(counter);
+
+    // Local index i > 0 becomes base + i - 1; the local root goes into the reserved slot.
+    const uint32_t base = static_cast<uint32_t>(nodes.size());
+    for (Node & node : leftNodes)
+    {
+      if (node.mCount == 0)
+        node.mLeftFirst = base + node.mLeftFirst - 1;
+    }
+
+    nodes[left] = leftNodes[0];
+    nodes.insert(nodes.end(), leftNodes.begin() + 1, leftNodes.end());
+  }
+  else
+  {
+    TriangleBVH::BuildSubtree(context, nodes, left, first, leftCount,
+                              leftBox, leftCentroidBox);
+    TriangleBVH::BuildSubtree(context, nodes, left + 1, rightFirst, rightCount,
+                              rightBox, rightCentroidBox);
+  }
+}
+
+void TriangleBVH::Clear()
+{
+  mNodes.clear();
+  mPositions.clear();
+  mTriangles.clear();
+  mTriangleIds.clear();
+  mLeafOrder.clear();
+  mBounds = AABB();
+}
+
+// ------------------------------------------------------------------------------------------------
+// -> Ray queries.
+
+namespace
+{
+
+#ifdef GLOO_BVH_SSE
+
+struct PreparedRay
+{
+  __m128 mOrigin;
+  __m128 mInvDirection;
+};
+
+PreparedRay PrepareRay(const Ray & ray)
+{
+  PreparedRay prepared;
+  prepared.mOrigin = _mm_set_ps(0.0f, ray.mOrigin[2], ray.mOrigin[1], ray.mOrigin[0]);
+  prepared.mInvDirection = _mm_set_ps(0.0f, ray.mInvDirection[2], ray.mInvDirection[1],
+                                      ray.mInvDirection[0]);
+  return prepared;
+}
+
+// Slab test against the box {minimum[0..2], maximum[0..2]}. The fourth float loaded with each
+// corner is node data, so lane 3 is discarded.
+inline bool IntersectBox(const PreparedRay & ray, const float* minimum, const float* maximum,
+                         float tMax, float & tNear)
+{
+  const __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(minimum), ray.mOrigin), ray.mInvDirection);
+  const __m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(maximum), ray.mOrigin), ray.mInvDirection);
+
+  // An origin on a slab plane with a zero direction component gives 0 * inf = NaN: such a slab
+  // does not limit the ray (entry -inf, exit +inf), as in Ray::Intersects().
+  const __m128 ordered = _mm_cmpord_ps(t1, t2);
+  const __m128 infinity = _mm_set1_ps(std::numeric_limits<float>::infinity());
+  __m128 t0 = _mm_or_ps(_mm_and_ps(ordered, _mm_min_ps(t1, t2)),
+                        _mm_andnot_ps(ordered, _mm_sub_ps(_mm_setzero_ps(), infinity)));
+  __m128 t3 = _mm_or_ps(_mm_and_ps(ordered, _mm_max_ps(t1, t2)),
+                        _mm_andnot_ps(ordered, infinity));
+  t0 = _mm_shuffle_ps(t0, t0, _MM_SHUFFLE(0, 2, 1, 0));
+  t3 = _mm_shuffle_ps(t3, t3, _MM_SHUFFLE(0, 2, 1, 0));
+
+  // Horizontal max of the entry distances and min of the exit distances.
+  t0 = _mm_max_ps(t0, _mm_shuffle_ps(t0, t0, _MM_SHUFFLE(2, 3, 0, 1)));
+  t0 = _mm_max_ps(t0, _mm_shuffle_ps(t0, t0, _MM_SHUFFLE(1, 0, 3, 2)));
+  t3 = _mm_min_ps(t3, _mm_shuffle_ps(t3, t3, _MM_SHUFFLE(2, 3, 0, 1)));
+  t3 = _mm_min_ps(t3, _mm_shuffle_ps(t3, t3, _MM_SHUFFLE(1, 0, 3, 2)));
+
+  tNear = std::max(_mm_cvtss_f32(t0), 0.0f);
+  return tNear <= std::min(_mm_cvtss_f32(t3), tMax);
+}
+
+#else
+
+struct PreparedRay
+{
+  const Ray* mRay;
+};
+
+PreparedRay PrepareRay(const Ray & ray)
+{
+  PreparedRay prepared = { &ray };
+  return prepared;
+}
+
+inline bool IntersectBox(const PreparedRay & ray, const float* minimum, const float* maximum,
+                         float tMax, float & tNear)
+{
+  const AABB box(glm::vec3(minimum[0], minimum[1], minimum[2]),
+                 glm::vec3(maximum[0], maximum[1], maximum[2]));
+  return ray.mRay->Intersects(box, tMax, &tNear);
+}
+
+#endif
+
+}  // namespace.
+
+bool TriangleBVH::Intersect(const Ray & ray, float tMax, TriangleHit* hit) const
+{
+  if (mNodes.empty())
+    return false;
+
+  const PreparedRay prepared = PrepareRay(ray);
+
+  struct Entry
+  {
+    uint32_t mNode;
+    float mNear;
+  };
+
+  float tRoot = 0.0f;
+  if (!IntersectBox(prepared, mNodes[0].mMin, mNodes[0].mMax, tMax, tRoot))
+    return false;
+
+  TraversalStack<Entry> stack;
+  stack.Push(Entry { 0, tRoot });
+
+  TriangleHit closest;
+  bool found = false;
+
+  while (!stack.IsEmpty())
+  {
+    const Entry entry = stack.Pop();
+    if (entry.mNear > tMax)
+      continue;
+
+    // Descend towards the nearest child, postponing the farthest one.
+    const Node* node = &mNodes[entry.mNode];
+    while (node && (node->mCount == 0))
+    {
+      const Node* child1 = &mNodes[node->mLeftFirst];
+      const Node* child2 = child1 + 1;
+
+      float t1 = 0.0f, t2 = 0.0f;
+      const bool hit1 = IntersectBox(prepared, child1->mMin, child1->mMax, tMax, t1);
+      const bool hit2 = IntersectBox(prepared, child2->mMin, child2->mMax, tMax, t2);
+
+      if (hit1 && hit2)
+      {
+        if (t2 < t1)
+        {
+          std::swap(child1, child2);
+          std::swap(t1, t2);
+        }
+        stack.Push(Entry { static_cast<uint32_t>(child2 - mNodes.data()), t2 });
+        node = child1;
+      }
+      else
+      {
+        node = hit1 ? child1 : (hit2 ? child2 : nullptr);
+      }
+    }
+
+    if (node && TriangleBVH::IntersectLeaf(ray, *node, tMax, &closest))
+      found = true;
+  }
+
+  if (found && hit)
+    *hit = closest;
+
+  return found;
+}
+
+bool TriangleBVH::IntersectLeaf(const Ray & ray, const Node & leaf, float & tMax,
+                                TriangleHit* hit) const
+{
+  const uint32_t first = leaf.mLeftFirst;
+  const uint32_t last = first + leaf.mCount - 1;
+  const float* positions = mPositions.data();
+  bool found = false;
+
+#ifdef GLOO_BVH_SSE
+  // Moller-Trumbore on 4 triangles at once. The last triangle is repeated to fill the packet.
+  const __m128 dx = _mm_set1_ps(ray.mDirection[0]);
+  const __m128 dy = _mm_set1_ps(ray.mDirection[1]);
+  const __m128 dz = _mm_set1_ps(ray.mDirection[2]);
+  const __m128 ox = _mm_set1_ps(ray.mOrigin[0]);
+  const __m128 oy = _mm_set1_ps(ray.mOrigin[1]);
+  const __m128 oz = _mm_set1_ps(ray.mOrigin[2]);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+
+  for (uint32_t i = first; i <= last; i += 4)
+  {
+    float p[9][4];  // p0, p1, p2 (x, y, z) of each lane.
+    for (int lane = 0; lane < 4; lane++)
+    {
+      const uint32_t* triangle = &mTriangles[3 * std::min(i + lane, last)];
+      for (int k = 0; k < 3; k++)
+      {
+        const float* vertex = positions + 3 * triangle[k];
+        p[3*k + 0][lane] = vertex[0];
+        p[3*k + 1][lane] = vertex[1];
+        p[3*k + 2][lane] = vertex[2];
+      }
+    }
+
+    const __m128 p0x = _mm_loadu_ps(p[0]), p0y = _mm_loadu_ps(p[1]), p0z = _mm_loadu_ps(p[2]);
+    const __m128 e1x = _mm_sub_ps(_mm_loadu_ps(p[3]), p0x);
+    const __m128 e1y = _mm_sub_ps(_mm_loadu_ps(p[4]), p0y);
+    const __m128 e1z = _mm_sub_ps(_mm_loadu_ps(p[5]), p0z);
+    const __m128 e2x = _mm_sub_ps(_mm_loadu_ps(p[6]), p0x);
+    const __m128 e2y = _mm_sub_ps(_mm_loadu_ps(p[7]), p0y);
+    const __m128 e2z = _mm_sub_ps(_mm_loadu_ps(p[8]), p0z);
+
+    // P = D x E2, det = E1 . P
+    const __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+    const __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+    const __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+    const __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)),
+                                  _mm_mul_ps(e1z, pz));
+    const __m128 invDet = _mm_div_ps(one, det);
+
+    // S = O - P0, u = (S . P) / det
+    const __m128 sx = _mm_sub_ps(ox, p0x), sy = _mm_sub_ps(oy, p0y), sz = _mm_sub_ps(oz, p0z);
+    const __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)),
+                                           _mm_mul_ps(sz, pz)), invDet);
+
+    // Q = S x E1, v = (D . Q) / det, t = (E2 . Q) / det
+    const __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+    const __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+    const __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+    const __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)),
+                                           _mm_mul_ps(dz, qz)), invDet);
+    const __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)),
+                                           _mm_mul_ps(e2z, qz)), invDet);
+
+    __m128 mask = _mm_cmpneq_ps(det, zero);
+    mask = _mm_and_ps(mask, _mm_cmpge_ps(u, zero));
+    mask = _mm_and_ps(mask, _mm_cmpge_ps(v, zero));
+    mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), one));
+    mask = _mm_and_ps(mask, _mm_cmpge_ps(t, zero));
+    mask = _mm_and_ps(mask, _mm_cmple_ps(t, _mm_set1_ps(tMax)));
+
+    const int lanes = _mm_movemask_ps(mask);
+    if (lanes == 0)
+      continue;
+
+    float ts[4], us[4], vs[4];
+    _mm_storeu_ps(ts, t);
+    _mm_storeu_ps(us, u);
+    _mm_storeu_ps(vs, v);
+
+    for (int lane = 0; lane < 4; lane++)
+    {
+      if ((lanes & (1 << lane)) && (ts[lane] <= tMax))
+      {
+        tMax = ts[lane];
+        hit->mT = ts[lane];
+        hit->mU = us[lane];
+        hit->mV = vs[lane];
+        hit->mTriangle = mTriangleIds[std::min(i + lane, last)];
+        found = true;
+      }
+    }
+  }
+#else
+  for (uint32_t i = first; i <= last; i++)
+  {
+    const float* a = positions + 3 * mTriangles[3*i + 0];
+    const float* b = positions + 3 * mTriangles[3*i + 1];
+    const float* c = positions + 3 * mTriangles[3*i + 2];
+
+    const glm::vec3 p0(a[0], a[1], a[2]);
+    const glm::vec3 e1 = glm::vec3(b[0], b[1], b[2]) - p0;
+    const glm::vec3 e2 = glm::vec3(c[0], c[1], c[2]) - p0;
+
+    const glm::vec3 p = glm::cross(ray.mDirection, e2);
+    const float det = glm::dot(e1, p);
+    if (det == 0.0f)
+      continue;
+
+    const float invDet = 1.0f / det;
+    const glm::vec3 s = ray.mOrigin - p0;
+    const float u = glm::dot(s, p) * invDet;
+    if ((u < 0.0f) || (u > 1.0f))
+      continue;
+
+    const glm::vec3 q = glm::cross(s, e1);
+    const float v = glm::dot(ray.mDirection, q) * invDet;
+    if ((v < 0.0f) || (u + v > 1.0f))
+      continue;
+
+    const float t = glm::dot(e2, q) * invDet;
+    if ((t >= 0.0f) && (t <= tMax))
+    {
+      tMax = t;
+      hit->mT = t;
+      hit->mU = u;
+      hit->mV = v;
+      hit->mTriangle = mTriangleIds[i];
+      found = true;
+    }
+  }
+#endif
+
+  return found;
+}
+
+void TriangleBVH::GetTriangle(uint32_t triangle, glm::vec3 & p0, glm::vec3 & p1,
+                              glm::vec3 & p2) const
+{
+  const uint32_t* vertices = &mTriangles[3 * mLeafOrder[triangle]];
+  const float* a = &mPositions[3 * vertices[0]];
+  const float* b = &mPositions[3 * vertices[1]];
+  const float* c = &mPositions[3 * vertices[2]];
+
+  p0 = glm::vec3(a[0], a[1], a[2]);
+  p1 = glm::vec3(b[0], b[1], b[2]);
+  p2 = glm::vec3(c[0], c[1], c[2]);
+}
+
+}  // namespace gloo.
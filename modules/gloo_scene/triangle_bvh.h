@@ -0,0 +1,105 @@
+// + ======================================== +
+// |         gl-oo-interface library          |
+// |            Module: GLOO Scene.           |
+// |        Author: Rodrigo Castiel, 2016.    |
+// + ======================================== +
+//
+// gloo::TriangleBVH is a static bounding volume hierarchy over the triangles of a mesh, used
+// for ray picking. It is built from the CPU-side copy of the mesh data (the same positions and
+// indices passed to MeshGroup::Load), in the mesh's local space.
+//
+// Construction uses binned SAH (surface area heuristic) splits along the axis of largest
+// centroid extent. Large nodes are binned by several jobs, and large subtrees are built in
+// parallel (gloo::JobSystem). The BVH keeps its own compact copy of the positions and of the (reordered)
+// triangles, so the input buffers may be freed.
+//
+// Nodes are 32 bytes and siblings are adjacent, so traversal only needs a short stack. Ray-box
+// tests and the Moller-Trumbore ray-triangle tests (4 triangles at once) use SSE on x86-64.
+//
+// Usage:
+//   TriangleBVH bvh;
+//   bvh.Build(positions.data(), numVertices, indices.data(), numTriangles);
+//   ...
+//   TriangleHit hit;
+//   if (bvh.Intersect(localRay, 1000.0f, &hit))
+//     std::cout << "Triangle " << hit.mTriangle << " at t = " << hit.mT << std::endl;
+//
+// See gloo::ScenePicker for picking across many meshes and transforms.
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "gloo/bounds.h"
+#include "gloo/ray.h"
+
+namespace gloo
+{
+
+struct TriangleHit
+{
+  float mT { 0.0f };          // Ray parameter of the hit.
+  float mU { 0.0f };          // Barycentric coordinates: p = (1-u-v) p0 + u p1 + v p2.
+  float mV { 0.0f };
+  uint32_t mTriangle { 0 };   // Index of the triangle in the input (first index / 3).
+};
+
+class TriangleBVH
+{
+public:
+  static const uint32_t kMaxLeafSize = 8;
+  static const uint32_t kNumBins = 16;
+
+  TriangleBVH() { }
+  ~TriangleBVH() { }
+
+  // positions: 3 floats per vertex; indices: 3 per triangle, or nullptr for a plain triangle
+  // list (numVertices = 3 * numTriangles). numThreads = 0 uses all the workers of
+  // JobSystem::GetDefault().
+  void Build(const float* positions, uint32_t numVertices,
+             const uint32_t* indices, uint32_t numTriangles, unsigned numThreads = 0);
+
+  void Clear();
+
+  // Finds the closest hit within [0, tMax]. Returns false if there is none.
+  bool Intersect(const Ray & ray, float tMax, TriangleHit* hit) const;
+
+  // Getters.
+  bool IsEmpty() const { return mNodes.empty(); }
+  const AABB & GetBounds() const { return mBounds; }
+  uint32_t GetNumTriangles() const { return static_cast<uint32_t>(mTriangleIds.size()); }
+  uint32_t GetNumNodes() const { return static_cast<uint32_t>(mNodes.size()); }
+
+  // Positions of the vertices of a triangle (as numbered in the input).
+  void GetTriangle(uint32_t triangle, glm::vec3 & p0, glm::vec3 & p1, glm::vec3 & p2) const;
+
+private:
+  struct Node
+  {
+    float mMin[3];
+    uint32_t mLeftFirst;  // Left child (the right one is next to it) or first triangle.
+    float mMax[3];
+    uint32_t mCount;      // Number of triangles (leaves); 0 for internal nodes.
+  };
+
+  struct BuildContext;  // See triangle_bvh.cpp.
+
+  // Builds the subtree of nodes[index] over the triangles [first, first + count), given their
+  // bounds and the bounds of their centroids.
+  void BuildSubtree(BuildContext & context, std::vector<Node> & nodes, uint32_t index,
+                    uint32_t first, uint32_t count,
+                    const AABB & box, const AABB & centroidBox) const;
+
+  bool IntersectLeaf(const Ray & ray, const Node & leaf, float & tMax, TriangleHit* hit) const;
+
+  std::vector<Node> mNodes;             // mNodes[0] is the root.
+  std::vector<float> mPositions;        // xyz per vertex.
+  std::vector<uint32_t> mTriangles;     // 3 indices per triangle, in leaf order.
+  std::vector<uint32_t> mTriangleIds;   // Input index of each triangle, in leaf order.
+  std::vector<uint32_t> mLeafOrder;     // Position of each input triangle in leaf order.
+  AABB mBounds;
+};
+
+}  // namespace gloo.
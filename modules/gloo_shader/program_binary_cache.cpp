@@ -0,0 +1,226 @@
+#include "program_binary_cache.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#if defined(WIN32)
+  #include <direct.h>
+#else
+  #include <sys/stat.h>
+#endif
+
+namespace gloo
+{
+
+namespace
+{
+
+const char kMagic[4] = { 'G', 'P', 'B', '1' };
+
+// Precedes the binary in every file.
+struct FileHeader
+{
+  char mMagic[4];
+  uint32_t mFormat;  // Binary format (GLenum).
+  uint64_t mKey;     // Checked against the file name, in case of a stray file.
+  uint32_t mLength;  // Bytes of binary.
+  uint32_t mPadding;
+};
+
+// 64-bit FNV-1a.
+const uint64_t kHashBasis = 0xCBF29CE484222325ull;
+
+uint64_t Hash(const void* data, size_t size, uint64_t hash)
+{
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < size; i++)
+  {
+    hash ^= bytes[i];
+    hash *= 0x100000001B3ull;
+  }
+
+  return hash;
+}
+
+uint64_t HashString(const char* string, uint64_t hash)
+{
+  // The terminator is hashed too, so that consecutive strings cannot shift into each other.
+  return Hash(string, string ? std::strlen(string) + 1 : 0, hash);
+}
+
+}  // namespace.
+
+ProgramBinaryCache & ProgramBinaryCache::Get()
+{
+  static ProgramBinaryCache cache;
+  return cache;
+}
+
+bool ProgramBinaryCache::SetDirectory(const std::string & directory)
+{
+  mDirectory = directory;
+  if (mDirectory.empty())
+    return true;
+
+#if defined(WIN32)
+  const int result = _mkdir(mDirectory.c_str());
+#else
+  const int result = mkdir(mDirectory.c_str(), 0755);
+#endif
+
+  if ((result != 0) && (errno != EEXIST))
+  {
+    std::cerr << "ERROR: couldn't create the program binary cache directory '" << mDirectory
+              << "'." << std::endl;
+    mDirectory.clear();
+    return false;
+  }
+
+  return true;
+}
+
+bool ProgramBinaryCache::IsEnabled()
+{
+  if (mDirectory.empty())
+    return false;
+
+  if (!mDriverQueried)
+    ProgramBinaryCache::QueryDriver();
+
+  return mSupported;
+}
+
+void ProgramBinaryCache::QueryDriver()
+{
+  mDriverQueried = true;
+
+  GLint numFormats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+  mSupported = (numFormats > 0);
+
+  const GLenum names[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+  mDriverHash = kHashBasis;
+  for (GLenum name : names)
+    mDriverHash = HashString(reinterpret_cast<const char*>(glGetString(name)), mDriverHash);
+}
+
+uint64_t ProgramBinaryCache::ComputeKey(const char* const codes[], int numCodes,
+                                        const std::string & defines)
+{
+  if (!mDriverQueried)
+    ProgramBinaryCache::QueryDriver();
+
+  uint64_t key = HashString(defines.c_str(), mDriverHash);
+  for (int i = 0; i < numCodes; i++)
+  {
+    key = Hash(&i, sizeof(i), key);  // Stage.
+    key = HashString(codes[i], key);
+  }
+
+  return key;
+}
+
+GLuint ProgramBinaryCache::Load(uint64_t key)
+{
+  const std::string path = ProgramBinaryCache::GetFilePath(key);
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open())
+  {
+    mStats.mMisses++;
+    return 0;
+  }
+
+  FileHeader header;
+  std::vector<char> binary;
+  bool valid = static_cast<bool>(file.read(reinterpret_cast<char*>(&header), sizeof(header))) &&
+               (std::memcmp(header.mMagic, kMagic, sizeof(kMagic)) == 0) &&
+               (header.mKey == key);
+
+  if (valid)
+  {
+    binary.resize(header.mLength);
+    valid = static_cast<bool>(file.read(binary.data(), binary.size()));
+  }
+  file.close();
+
+  GLuint program = 0;
+  if (valid)
+  {
+    program = glCreateProgram();
+    glProgramBinary(program, header.mFormat, binary.data(), static_cast<GLsizei>(binary.size()));
+
+    GLint status = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status == 0)
+    {
+      glDeleteProgram(program);
+      program = 0;
+    }
+  }
+
+  if (program == 0)  // Corrupt, or the driver changed in a way the key does not capture.
+  {
+    mStats.mRejected++;
+    std::remove(path.c_str());
+    return 0;
+  }
+
+  mStats.mHits++;
+  return program;
+}
+
+bool ProgramBinaryCache::Store(uint64_t key, GLuint program)
+{
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0)
+    return false;
+
+  std::vector<char> binary(length);
+  GLenum format = 0;
+  glGetProgramBinary(program, length, &length, &format, binary.data());
+
+  FileHeader header;
+  std::memcpy(header.mMagic, kMagic, sizeof(kMagic));
+  header.mFormat = format;
+  header.mKey = key;
+  header.mLength = static_cast<uint32_t>(length);
+  header.mPadding = 0;
+
+  // Written under a temporary name and renamed, so that a crash never leaves half a file.
+  const std::string path = ProgramBinaryCache::GetFilePath(key);
+  const std::string temporaryPath = path + ".tmp";
+  {
+    std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+    if (!file.write(reinterpret_cast<const char*>(&header), sizeof(header)) ||
+        !file.write(binary.data(), length))
+    {
+      std::cerr << "ERROR: couldn't write the program binary '" << temporaryPath << "'."
+                << std::endl;
+      return false;
+    }
+  }
+
+  std::remove(path.c_str());
+  if (std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+  {
+    std::remove(temporaryPath.c_str());
+    return false;
+  }
+
+  mStats.mStored++;
+  return true;
+}
+
+std::string ProgramBinaryCache::GetFilePath(uint64_t key) const
+{
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+  return mDirectory + "/" + name;
+}
+
+}  // namespace gloo.
@@ -0,0 +1,91 @@
+// + ======================================== +
+// |         gl-oo-interface library          |
+// |        Module: GLOO Shader.              |
+// |        Author: Rodrigo Castiel, 2016.    |
+// + ======================================== +
+//
+// gloo::ProgramBinaryCache stores linked shader programs on disk (glGetProgramBinary()), so that
+// the next launch loads them (glProgramBinary()) instead of compiling them from source.
+// ShaderProgram::BuildFromStrings() (thus BuildFromFiles() and ShaderPermutations) goes through
+// it whenever it is enabled.
+//
+// A binary is identified by a 64-bit hash of the source code of every stage, the defines, and
+// the GL vendor, renderer and version strings: editing a shader or updating the driver makes a
+// new key. Binaries the driver rejects anyway are deleted, and the program is compiled again
+// (and stored again).
+//
+// Usage:
+//   // Once, after the GL context exists (and before building programs):
+//   ProgramBinaryCache::Get().SetDirectory("shader_cache");
+//   ...
+//   program->BuildFromFiles(vertexShaderPath, fragmentShaderPath);  // Loads or compiles.
+//
+//   const ProgramBinaryCache::Stats & stats = ProgramBinaryCache::Get().GetStats();
+//
+// The cache is disabled until a directory is set, and whenever the driver supports no binary
+// format (glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS) is 0).
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "../include/gloo/gl_header.h"
+
+namespace gloo
+{
+
+class ProgramBinaryCache
+{
+public:
+  struct Stats
+  {
+    unsigned mHits { 0 };      // Programs loaded from a binary.
+    unsigned mMisses { 0 };    // No binary for the key.
+    unsigned mRejected { 0 };  // Binaries the driver did not accept.
+    unsigned mStored { 0 };    // Binaries written.
+  };
+
+  // Cache shared by the library.
+  static ProgramBinaryCache & Get();
+
+  // Enables the cache in directory (created if needed). An empty path disables it.
+  bool SetDirectory(const std::string & directory);
+
+  // Whether a directory is set and the driver supports program binaries (queried once).
+  bool IsEnabled();
+
+  // Key of the program built from codes (null stages are skipped) and defines.
+  uint64_t ComputeKey(const char* const codes[], int numCodes, const std::string & defines);
+
+  // Creates a linked program from the binary of key. Returns 0 if there is none, or if the
+  // driver rejects it (the file is deleted then).
+  GLuint Load(uint64_t key);
+
+  // Writes the binary of a linked program. It should have been linked with
+  // GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+  bool Store(uint64_t key, GLuint program);
+
+  // Getters.
+  const std::string & GetDirectory() const { return mDirectory; }
+  const Stats & GetStats() const { return mStats; }
+
+private:
+  ProgramBinaryCache() { }
+  ProgramBinaryCache(const ProgramBinaryCache &) = delete;
+  ProgramBinaryCache & operator=(const ProgramBinaryCache &) = delete;
+
+  // Queries the binary formats and the driver strings.
+  void QueryDriver();
+
+  std::string GetFilePath(uint64_t key) const;
+
+  std::string mDirectory;
+  bool mDriverQueried { false };
+  bool mSupported { false };
+  uint64_t mDriverHash { 0 };  // Of vendor, renderer and version.
+
+  Stats mStats;
+};
+
+}  // namespace gloo.
@@ -0,0 +1,137 @@
+#include "shader_permutations.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace gloo
+{
+
+int ShaderPermutations::AddFeature(const std::string & name, unsigned numBits)
+{
+  if ((numBits == 0) || (mNumBits + numBits > 32))
+  {
+    std::cerr << "ERROR: no room for shader feature '" << name << "' in the variant key."
+              << std::endl;
+    return -1;
+  }
+
+  mFeatures.push_back({ name, mNumBits, numBits });
+  mNumBits += numBits;
+  return static_cast<int>(mFeatures.size()) - 1;
+}
+
+bool ShaderPermutations::Load()
+{
+  mVariants.clear();
+
+  return ShaderPermutations::ReadFile(mVertexShaderPath, mVertexShaderCode) &&
+         ShaderPermutations::ReadFile(mFragmentShaderPath, mFragmentShaderCode);
+}
+
+ShaderProgram* ShaderPermutations::Get(uint32_t key, bool* compiled)
+{
+  return ShaderPermutations::Resolve(ShaderPermutations::Submit(key), true, compiled);
+}
+
+ShaderProgram* ShaderPermutations::Request(uint32_t key, bool* compiled)
+{
+  return ShaderPermutations::Resolve(ShaderPermutations::Submit(key), false, compiled);
+}
+
+CompilationStatus ShaderPermutations::GetStatus(uint32_t key) const
+{
+  auto it = mVariants.find(key);
+  if (it == mVariants.end())
+    return kUnitialized;
+
+  const Variant & variant = it->second;
+  if (!variant.mProgram)
+    return kError;
+
+  return variant.mProgram->GetCompilationStatus();
+}
+
+ShaderPermutations::Variant & ShaderPermutations::Submit(uint32_t key)
+{
+  auto it = mVariants.find(key);
+  if (it != mVariants.end())
+    return it->second;
+
+  Variant & variant = mVariants[key];
+  variant.mProgram.reset(new ShaderProgram());
+  variant.mProgram->SetDefines(ShaderPermutations::GetDefines(key));
+  variant.mProgram->BuildFromStringsAsync(mVertexShaderCode.c_str(), mFragmentShaderCode.c_str());
+  return variant;
+}
+
+ShaderProgram* ShaderPermutations::Resolve(Variant & variant, bool wait, bool* compiled)
+{
+  if (compiled)
+    *compiled = false;
+
+  if (variant.mDone)
+    return variant.mProgram.get();
+
+  ShaderProgram* program = variant.mProgram.get();
+  const CompilationStatus status = wait ? program->FinishBuild()
+                                        : program->PollCompilationStatus();
+  if (status == kPending)
+    return nullptr;
+
+  variant.mDone = true;
+
+  if (status != kSuccess)
+  {
+    std::cerr << "ERROR: shader variant failed to compile:" << std::endl
+              << program->GetDefines();
+    program->PrintCompilationLog();
+    variant.mProgram.reset();
+    return nullptr;
+  }
+
+  if (compiled)
+    *compiled = true;
+
+  return program;
+}
+
+std::string ShaderPermutations::GetDefines(uint32_t key) const
+{
+  std::string defines;
+
+  for (const Feature & feature : mFeatures)
+  {
+    const uint32_t mask = (feature.mNumBits >= 32) ? 0xFFFFFFFF : ((1u << feature.mNumBits) - 1);
+    const uint32_t value = (key >> feature.mShift) & mask;
+
+    if (feature.mNumBits == 1)  // Switch.
+    {
+      if (value)
+        defines += "#define " + feature.mName + "\n";
+    }
+    else
+    {
+      defines += "#define " + feature.mName + " " + std::to_string(value) + "\n";
+    }
+  }
+
+  return defines;
+}
+
+bool ShaderPermutations::ReadFile(const std::string & path, std::string & code)
+{
+  std::ifstream file(path);
+  if (!file.is_open())
+  {
+    std::cerr << "ERROR: couldn't open shader file '" << path << "'." << std::endl;
+    return false;
+  }
+
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  code = buffer.str();
+  return true;
+}
+
+}  // namespace gloo.
@@ -0,0 +1,142 @@
+// + ======================================== +
+// |         gl-oo-interface library          |
+// |        Module: GLOO Shader.              |
+// |        Author: Rodrigo Castiel, 2016.    |
+// + ======================================== +
+//
+// gloo::ShaderPermutations builds variants of one shader program (vertex + fragment sources),
+// each compiled with a different set of #define feature flags. Shaders test the flags with
+// #ifdef/#if instead of branching on uniforms, so every variant only runs the code its features
+// need (constant loop bounds, no dead branches).
+//
+// A variant is identified by a key: a bitmask where each feature owns a range of bits, in the
+// order the features were added. A 1-bit feature is a switch ("#define NAME" when set); a wider
+// feature is a value ("#define NAME <value>"). Variants are compiled the first time their key is
+// requested, and cached.
+//
+// Usage:
+//   ShaderPermutations permutations(vertexShaderPath, fragmentShaderPath);
+//   const int kLighting  = permutations.AddFeature("LIGHTING");       // Switch.
+//   const int kNumLights = permutations.AddFeature("NUM_LIGHTS", 4);  // Value in [0, 15].
+//   if (!permutations.Load()) ...                                     // Reads the files.
+//
+//   uint32_t key = permutations.Encode(kLighting, 1) | permutations.Encode(kNumLights, 2);
+//   ShaderProgram* program = permutations.Get(key);  // "#define LIGHTING\n#define NUM_LIGHTS 2\n"
+//   if (program) program->Bind();
+//
+// Variants can also be built without blocking: Request() submits the build the first time and
+// returns nullptr until it is done (use another variant meanwhile). Requesting many variants in
+// a row compiles them in parallel (see ShaderProgram::BuildFromStringsAsync()):
+//   for (uint32_t key : keysNeededSoon)
+//     permutations.Prefetch(key);
+//   ...
+//   ShaderProgram* program = permutations.Request(key);
+//   if (!program) program = fallbackProgram;    // Still compiling.
+//
+// A variant that fails to compile prints its log once, and Get()/Request() return nullptr for
+// its key from then on.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "shader_program.h"
+
+namespace gloo
+{
+
+class ShaderPermutations
+{
+public:
+  ShaderPermutations(const std::string & vertexShaderPath,
+                     const std::string & fragmentShaderPath)
+  : mVertexShaderPath(vertexShaderPath)
+  , mFragmentShaderPath(fragmentShaderPath)
+  { }
+
+  ~ShaderPermutations() { }
+
+  // Declares a feature taking the next numBits bits of the key. Returns its index (for
+  // Encode()), or -1 if the key has no room left.
+  int AddFeature(const std::string & name, unsigned numBits = 1);
+
+  // Reads the shader sources (variants are compiled by Get()). Drops the cached variants.
+  bool Load();
+
+  // Returns the variant of key, compiling it if needed (and waiting for it). compiled (optional)
+  // tells whether the variant is returned for the first time, e.g. to set up its uniforms.
+  // nullptr if the variant does not compile.
+  ShaderProgram* Get(uint32_t key, bool* compiled = nullptr);
+
+  // Same as Get(), but it never waits: it submits the build of a new variant, and returns
+  // nullptr while it is compiling.
+  ShaderProgram* Request(uint32_t key, bool* compiled = nullptr);
+
+  // Submits the build of a new variant, without checking on it.
+  void Prefetch(uint32_t key) { ShaderPermutations::Submit(key); }
+
+  // kUnitialized if the variant was never requested, kPending while it compiles.
+  CompilationStatus GetStatus(uint32_t key) const;
+
+  // Key bits of feature set to value (clamped to the range of the feature).
+  uint32_t Encode(int feature, unsigned value) const;
+
+  // Preprocessor lines of the variant of key.
+  std::string GetDefines(uint32_t key) const;
+
+  // Getters.
+  size_t GetNumVariants() const { return mVariants.size(); }  // Requested so far.
+
+private:
+  struct Feature
+  {
+    std::string mName;
+    unsigned mShift;
+    unsigned mNumBits;
+  };
+
+  ShaderPermutations(const ShaderPermutations &) = delete;
+  ShaderPermutations & operator=(const ShaderPermutations &) = delete;
+
+  struct Variant
+  {
+    std::unique_ptr<ShaderProgram> mProgram;  // nullptr if it failed.
+    bool mDone { false };                     // Built, and returned once.
+  };
+
+  static bool ReadFile(const std::string & path, std::string & code);
+
+  // Finds the variant of key, submitting its build if it is new.
+  Variant & Submit(uint32_t key);
+
+  // Returns the program of a variant if its build is done (waiting for it if wait is true).
+  ShaderProgram* Resolve(Variant & variant, bool wait, bool* compiled);
+
+  std::vector<Feature> mFeatures;
+  unsigned mNumBits { 0 };  // Used by the features.
+
+  std::string mVertexShaderCode;
+  std::string mFragmentShaderCode;
+
+  std::unordered_map<uint32_t, Variant> mVariants;
+
+  // Constant data (passed to constructor).
+  const std::string mVertexShaderPath;
+  const std::string mFragmentShaderPath;
+};
+
+// =========== IMPLEMENTATION OF INLINE METHODS ===================================================
+
+inline
+uint32_t ShaderPermutations::Encode(int feature, unsigned value) const
+{
+  const Feature & f = mFeatures[feature];
+  const uint32_t maxValue = (f.mNumBits >= 32) ? 0xFFFFFFFF : ((1u << f.mNumBits) - 1);
+  return (value > maxValue ? maxValue : value) << f.mShift;
+}
+
+}  // namespace gloo.
@@ -1,11 +1,32 @@
 #include "shader_program.h"
+#include "program_binary_cache.h"
+
+#include "gloo/gl_capabilities.h"
+
 #include <iostream>
 
 #define LOG_OUTPUT_ON 0
 
+// KHR_parallel_shader_compile (older headers do not define it).
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
 namespace gloo
 {
 
+namespace
+{
+
+// Informative shader names.
+const char* kShaderNames[5] = { "Vertex shader   ", 
+                                "Fragment shader ", 
+                                "Geometry shader ", 
+                                "Tessellation control shader    ", 
+                                "Tessellation evaluation shader " };
+
+}  // namespace.
+
 bool ShaderProgram::BuildFromFiles(const char* vertexShaderPath, 
                                    const char* fragmentShaderPath,
                                    const char* geometryShaderPath,
@@ -92,6 +113,47 @@ bool ShaderProgram::BuildFromStrings(const char* vertexShaderCode,
                                      const char* tessellationControlShaderCode,
                                      const char* tessellationEvaluationShaderCode)
 {
+  // All stages are submitted before any status is checked, so that the driver can compile them
+  // in parallel.
+  if (!ShaderProgram::BuildFromStringsAsync(vertexShaderCode, fragmentShaderCode, 
+                                            geometryShaderCode, tessellationControlShaderCode,
+                                            tessellationEvaluationShaderCode))
+  {
+    return false;
+  }
+
+  return (ShaderProgram::FinishBuild() == kSuccess);
+}
+
+bool ShaderProgram::BuildFromStringsAsync(const char* vertexShaderCode, 
+                                          const char* fragmentShaderCode,
+                                          const char* geometryShaderCode,
+                                          const char* tessellationControlShaderCode,
+                                          const char* tessellationEvaluationShaderCode)
+{
+  // Store the codes into one array.
+  const char * shaderCode[5] = { vertexShaderCode, fragmentShaderCode, geometryShaderCode, 
+                                 tessellationControlShaderCode, tessellationEvaluationShaderCode };
+
+  // Try the binary of a previous build first.
+  ProgramBinaryCache & binaryCache = ProgramBinaryCache::Get();
+  mStoreBinary = binaryCache.IsEnabled();
+
+  if (mStoreBinary)
+  {
+    mBinaryKey = binaryCache.ComputeKey(shaderCode, 5, mDefines);
+    mHandle = binaryCache.Load(mBinaryKey);
+
+    if (mHandle != 0)
+    {
+      mStoreBinary = false;
+      mCompilationStatus = kSuccess;
+      mReflection.Reflect(mHandle);
+      mUniformState.Build(mReflection);
+      return true;
+    }
+  }
+
   // Create an overall shader program handle.
   mHandle = glCreateProgram();
   
@@ -105,12 +167,6 @@ bool ShaderProgram::BuildFromStrings(const char* vertexShaderCode,
     return false;
   }
 
-  // Store the codes into one array.
-  const char * shaderCode[5] = { vertexShaderCode, fragmentShaderCode, geometryShaderCode, 
-                                 tessellationControlShaderCode, tessellationEvaluationShaderCode };
-
-  GLuint h_shaders[5] = { 0, 0, 0, 0, 0 }; // Shader handles to-be-created.
-  
   // OpenGL shader flags (macros are used to prevent a compile error in case the OpenGL 
   // version is too low and a symbolic constant is not defined).
   GLenum shaderFlags[5] = 
@@ -128,13 +184,6 @@ bool ShaderProgram::BuildFromStrings(const char* vertexShaderCode,
     #endif
   };
 
-  // informative shader names
-  std::vector<std::string> shaderName = {"Vertex shader   ", 
-                                         "Fragment shader ", 
-                                         "Geometry shader ", 
-                                         "Tessellation control shader    ", 
-                                         "Tessellation evaluation shader " };
-
   for (int i = 0; i < 5; i++)
   {
     // If code is not provided, skip this shader.
@@ -142,91 +191,167 @@ bool ShaderProgram::BuildFromStrings(const char* vertexShaderCode,
       continue;
 
 #if LOG_OUTPUT_ON == 1
-    std::cout << "Compiling " << shaderName[i] << "... ";
+    std::cout << "Submitting " << kShaderNames[i] << "... " << std::endl;
 #endif
 
-    // Compile the shader.
-    if (CompileShader(shaderCode[i], shaderFlags[i], h_shaders[i]) != 0)
+    // Compile the shader (the status is checked by FinishBuild()).
+    mPendingShaders[i] = ShaderProgram::SubmitShader(shaderCode[i], shaderFlags[i]);
+    if (mPendingShaders[i] == 0)
     {
-      // Failure - error.
-      std::string infoLogStr = "(in shader " + std::string(shaderName[i]) + ")\n";
-      mCompilationLog.push_back(infoLogStr);  // Save infoLog.
-      mCompilationStatus = kError;
+      ShaderProgram::DeletePendingShaders();
+      mCompilationStatus = kLoadFailure;
       return false;
     }
-    else
+
+    // Attach the shader to the shader program handle.
+    glAttachShader(mHandle, mPendingShaders[i]);
+  }
+
+  // Link (keeping the binary retrievable for the cache).
+  if (mStoreBinary)
+    glProgramParameteri(mHandle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+  glLinkProgram(mHandle);
+
+  mCompilationStatus = kPending;
+  return true;
+}
+
+CompilationStatus ShaderProgram::PollCompilationStatus()
+{
+  if (mCompilationStatus != kPending)
+    return mCompilationStatus;
+
+  // Without parallel compilation, asking for the status is what makes the driver finish.
+  if (GLCapabilities::Get().HasParallelShaderCompile())
+  {
+    GLint completed = GL_FALSE;
+    glGetProgramiv(mHandle, GL_COMPLETION_STATUS_KHR, &completed);
+    if (completed == GL_FALSE)
+      return kPending;
+  }
+
+  return ShaderProgram::FinishBuild();
+}
+
+CompilationStatus ShaderProgram::FinishBuild()
+{
+  if (mCompilationStatus != kPending)
+    return mCompilationStatus;
+
+  mCompilationStatus = kSuccess;
+
+  // Compilation errors first (a failed stage makes the link fail as well).
+  for (int i = 0; i < 5; i++)
+  {
+    if ((mPendingShaders[i] != 0) && (ShaderProgram::CheckShader(mPendingShaders[i]) != 0))
     {
-      // Success.
-#if LOG_OUTPUT_ON == 1
-      std::cout << "SUCCESS" << std::endl;
-#endif
-      // Attach the shader to the shader program handle.
-      glAttachShader(mHandle, h_shaders[i]);
+      std::string infoLogStr = "(in shader " + std::string(kShaderNames[i]) + ")\n";
+      mCompilationLog.push_back(infoLogStr);  // Save infoLog.
+      mCompilationStatus = kError;
+      break;
     }
   }
 
   // Link.
-  glLinkProgram(mHandle);
-  
-  int status;
-  glGetProgramiv(mHandle, GL_LINK_STATUS, &status);
-  if (status == 0)
+  if (mCompilationStatus == kSuccess)
   {
-    GLchar infoLog[512];
-    glGetProgramInfoLog(mHandle, 512, NULL, infoLog);
-    mCompilationLog.emplace_back(&infoLog[0]);  // Save infoLog.
-    mCompilationStatus = kLinkError;
+    int status;
+    glGetProgramiv(mHandle, GL_LINK_STATUS, &status);
+    if (status == 0)
+    {
+      GLchar infoLog[512];
+      glGetProgramInfoLog(mHandle, 512, NULL, infoLog);
+      mCompilationLog.emplace_back(&infoLog[0]);  // Save infoLog.
+      mCompilationStatus = kLinkError;
 
 #if LOG_OUTPUT_ON == 1
-    std::cerr << "LINKER ERROR:\n" << infoLog << std::endl;
+      std::cerr << "LINKER ERROR:\n" << infoLog << std::endl;
 #endif
-
-    return false;
+    }
   }
 
   // The shaders are no longer needed after the program is linked.
-  for (int i = 0; i < 5; i++)
-    glDeleteShader(h_shaders[i]);
+  ShaderProgram::DeletePendingShaders();
 
-  mCompilationStatus = kSuccess;
+  if (mCompilationStatus == kSuccess)
+  {
+    mReflection.Reflect(mHandle);
+    mUniformState.Build(mReflection);
+
+    if (mStoreBinary)
+      ProgramBinaryCache::Get().Store(mBinaryKey, mHandle);
+  }
 
 #if LOG_OUTPUT_ON == 1
+  if (mCompilationStatus == kSuccess)
     std::cout << "-- COMPILATION COMPLETE --" << std::endl;
 #endif
 
-  return true;
+  return mCompilationStatus;
 }
 
+void ShaderProgram::DeletePendingShaders()
+{
+  for (GLuint & shader : mPendingShaders)
+  {
+    if (shader != 0)
+      glDeleteShader(shader);
+    shader = 0;
+  }
+}
 
 int ShaderProgram::CompileShader(const char * shaderCode, GLenum shaderType, GLuint & shaderHandle)
 {
-  shaderHandle = glCreateShader(shaderType);
+  shaderHandle = ShaderProgram::SubmitShader(shaderCode, shaderType);
+  if (shaderHandle == 0)
+    return 1;
+
+  return ShaderProgram::CheckShader(shaderHandle);
+}
+
+GLuint ShaderProgram::SubmitShader(const char * shaderCode, GLenum shaderType)
+{
+  GLuint shaderHandle = glCreateShader(shaderType);
 
   if (shaderHandle == 0) 
   {
 #if LOG_OUTPUT_ON == 1
     std::cerr << "ERROR: Creation of shader buffer failed." << std::endl;
 #endif
-    return 1;
+    return 0;
   }
 
-  const int numShaderCodes = 1;
-  const GLchar * shaderCodes[] = { shaderCode };
-  GLint codeLength[] = { (GLint)strlen(shaderCode) };
+  // The defines go right after the #version line (which must come first), as a separate
+  // source string: [#version line] [defines] [rest of the code].
+  const char* rest = shaderCode;
+  const char* version = strstr(shaderCode, "#version");
+  if (version && !mDefines.empty())
+  {
+    const char* endOfLine = strchr(version, '\n');
+    rest = endOfLine ? endOfLine + 1 : shaderCode + strlen(shaderCode);
+  }
+
+  const int numShaderCodes = 3;
+  const GLchar * shaderCodes[] = { shaderCode, mDefines.c_str(), rest };
+  GLint codeLength[] = { (GLint)(rest - shaderCode), (GLint)mDefines.size(), (GLint)strlen(rest) };
 
   // Compile code.
   glShaderSource(shaderHandle, numShaderCodes, shaderCodes, codeLength);
   glCompileShader(shaderHandle);
 
-  // Check if compilation was successful.
+  return shaderHandle;
+}
+
+int ShaderProgram::CheckShader(GLuint shaderHandle)
+{
+  // Check if compilation was successful (waits for it to finish).
   GLint status;
   glGetShaderiv(shaderHandle, GL_COMPILE_STATUS, &status);
   if (status == 0)  // Not successful.
   {
     GLchar infoLog[512];
     glGetShaderInfoLog(shaderHandle, 512, NULL, infoLog);
-    std::string infoLogStr(&infoLog[0]);
-    //infoLogStr = "COMPILE ERROR: " + infoLogStr; 
     mCompilationLog.emplace_back(&infoLog[0]);  // Save infoLog.
 
 #if LOG_OUTPUT_ON == 1
@@ -261,7 +386,14 @@ int ShaderProgram::LoadShader(const char * filename, char * code, int len)
 
 GLint ShaderProgram::GetUniformLocation(const char * variableName) const
 { 
-  GLint vHandle = glGetUniformLocation(mHandle, variableName);
+  // Listed by the reflection, except elements of arrays (e.g. "bones[3]").
+  const ShaderReflection::Variable* uniform = mReflection.Find(ShaderReflection::kUniform,
+                                                               variableName);
+  GLint vHandle = -1;
+  if (uniform)
+    vHandle = uniform->mLocation;
+  else if (strchr(variableName, '['))
+    vHandle = glGetUniformLocation(mHandle, variableName);
 
 #if LOG_OUTPUT_ON == 1
   if (vHandle == -1)
@@ -281,7 +413,9 @@ GLint ShaderProgram::GetUniformLocation(const std::string & variableName) const
 
 GLint ShaderProgram::GetAttribLocation(const char * variableName) const
 { 
-  GLint vHandle = glGetAttribLocation(mHandle, variableName);
+  const ShaderReflection::Variable* attribute = mReflection.Find(ShaderReflection::kAttribute,
+                                                                 variableName);
+  GLint vHandle = attribute ? attribute->mLocation : -1;
 
 #if LOG_OUTPUT_ON == 1
   if (vHandle == -1)
@@ -298,6 +432,32 @@ GLint ShaderProgram::GetAttribLocation(const std::string & variableName) const
   return GetAttribLocation(variableName.c_str());
 }
 
+bool ShaderProgram::SetUniform(NameHash name, const void* values, size_t size)
+{
+  const ShaderReflection::Variable* uniform = mReflection.Find(ShaderReflection::kUniform, name);
+  if (!uniform)
+    return false;
+
+  const size_t index = uniform - mReflection.GetVariables(ShaderReflection::kUniform).data();
+  return mUniformState.Set(index, values, size);
+}
+
+void ShaderProgram::FlushUniforms()
+{
+  if (mUniformState.IsDirty())
+  {
+    ShaderProgram::Bind();
+    mUniformState.Flush();
+  }
+}
+
+GLuint ShaderProgram::GetUniformBlockIndex(const char * blockName) const
+{
+  const ShaderReflection::Variable* block = mReflection.Find(ShaderReflection::kUniformBlock,
+                                                             blockName);
+  return block ? static_cast<GLuint>(block->mLocation) : GL_INVALID_INDEX;
+}
+
 
 void ShaderProgram::PrintCompilationLog() const
 {
@@ -26,25 +26,40 @@
 //    -> kSuccess: successfully compiled and linked
 //    -> kLinkError: linking error (e.g. main not found)
 //    -> kLoadFailure: a provided file doesn't have the correct path/couldn't be opened.
+//    -> kPending: an asynchronous build is still compiling (see below).
+//
+//  Asynchronous build (does not block on the driver):
+//  program->BuildFromStringsAsync(vtxCode, fragCode);  // Submits all stages and the link.
+//  ...
+//  if (program->PollCompilationStatus() == gloo::kSuccess)  // Never blocks with the
+//    program->Bind();                                       // KHR_parallel_shader_compile.
+//  Or program->FinishBuild() to wait for it.
 // 
 //  Get log message (errors):
 //  std::vector<std::string> log = program->GetCompilationLog();
 //
 //  Getting handle for variables by the name:
-//  GLuint h_modelView = program->GetVariableHandle("MV");
+//  GLint h_modelView = program->GetUniformLocation("MV");
+//  Or, without hashing the name at run time (see gloo::ShaderReflection):
+//  constexpr gloo::NameHash kModelView = gloo::HashName("MV");
+//  GLint h_modelView = program->GetUniformLocation(kModelView);
 //  -----------------------------------------------------------------------------------------------
 
 #pragma once
 
 #include "../include/gloo/gl_header.h"
+#include "gloo/gl_state_cache.h"
+#include "shader_reflection.h"
+#include "uniform_state.h"
 
+#include <cstdint>
 #include <vector>
 #include <string>
 
 namespace gloo
 {
 
-enum CompilationStatus { kSuccess, kError, kLinkError, kLoadFailure, kUnitialized };
+enum CompilationStatus { kSuccess, kError, kLinkError, kLoadFailure, kUnitialized, kPending };
 
 class ShaderProgram
 {
@@ -53,7 +68,8 @@ public:
 
   ~ShaderProgram() 
   { 
-    glDeleteProgram(mHandle);
+    ShaderProgram::DeletePendingShaders();
+    GLStateCache::Get().DeleteProgram(mHandle);
   }
 
   // Loads shaders from files specified by the corresponding paths.
@@ -69,7 +85,8 @@ public:
                       const std::string & tessellationControlShaderPath    = "", 
                       const std::string & tessellationEvaluationShaderPath = "");
 
-  // Loads shaders from buffer in memory (c-string).
+  // Loads shaders from buffer in memory (c-string). If gloo::ProgramBinaryCache is enabled, the
+  // program is loaded from its binary when there is one (and stored there otherwise).
   bool BuildFromStrings(const char* vertexShaderCode, 
                         const char* fragmentShaderCode,
                         const char* geometryShaderCode               = nullptr,
@@ -77,21 +94,74 @@ public:
                         const char* tessellationEvaluationShaderCode = nullptr);
 
 
+  // Same as BuildFromStrings(), but it returns as soon as the compilation and linking of all
+  // stages are submitted (status kPending). Several programs submitted in a row compile in
+  // parallel (in driver threads, with KHR_parallel_shader_compile). Returns false on errors
+  // detected right away (e.g. kLoadFailure).
+  bool BuildFromStringsAsync(const char* vertexShaderCode, 
+                             const char* fragmentShaderCode,
+                             const char* geometryShaderCode               = nullptr,
+                             const char* tessellationControlShaderCode    = nullptr,
+                             const char* tessellationEvaluationShaderCode = nullptr);
+
+  // Returns kPending while an asynchronous build is still compiling, without blocking when the
+  // driver supports KHR_parallel_shader_compile (otherwise it waits, like FinishBuild()). Once
+  // the build is done, it returns its final status.
+  CompilationStatus PollCompilationStatus();
+
+  // Waits for an asynchronous build, and returns its final status.
+  CompilationStatus FinishBuild();
+
+  // Whether the program is built and can be used.
+  bool IsReady() { return (ShaderProgram::PollCompilationStatus() == kSuccess); }
+
+  // Preprocessor lines (e.g. "#define LIGHTING\n") inserted into every shader of the next
+  // Build*() call, right after the #version line (see gloo::ShaderPermutations).
+  void SetDefines(const std::string & defines) { mDefines = defines; }
+  const std::string & GetDefines() const { return mDefines; }
+
   // Binds this shader program as the currrent renderer shader.
-  inline void Bind() const { glUseProgram(mHandle); }
+  // Redundant binds are skipped (see gloo::GLStateCache).
+  inline void Bind() const { GLStateCache::Get().UseProgram(mHandle); }
 
   // Returns shader program handle.
   inline GLuint GetHandle() const { return mHandle; }
   
   // Returns the location for a uniform stored in this shader program.
   // If the uniform couldn't be found, the return value is -1.
+  // Locations come from the reflection table (no driver call).
   GLint GetUniformLocation(const char * variableName) const;
   GLint GetUniformLocation(const std::string & variableName) const;
+  GLint GetUniformLocation(NameHash variableName) const;
 
   // Returns the location for a vertex attribute in this shader program.
   // If the uniform couldn't be found, the return value is -1.
   GLint GetAttribLocation(const char * variableName) const;
   GLint GetAttribLocation(const std::string & variableName) const;
+  GLint GetAttribLocation(NameHash variableName) const;
+
+  // Returns the index of a uniform block, or GL_INVALID_INDEX.
+  GLuint GetUniformBlockIndex(const char * blockName) const;
+
+  // Shadowed uniforms (see gloo::UniformState): the value is kept in client memory, and only
+  // uploaded by FlushUniforms() if it changed. count is the number of floats/ints (e.g. 3 for
+  // a vec3, 16 for a mat4). Returns whether the value changed.
+  bool SetUniform(NameHash name, const GLfloat* values, GLsizei count);
+  bool SetUniform(NameHash name, const GLint* values, GLsizei count);
+  bool SetUniform(NameHash name, const GLuint* values, GLsizei count);
+  bool SetUniform(NameHash name, GLfloat value) { return SetUniform(name, &value, 1); }
+  bool SetUniform(NameHash name, GLint value)   { return SetUniform(name, &value, 1); }
+  bool SetUniform(NameHash name, GLuint value)  { return SetUniform(name, &value, 1); }
+
+  // Uploads the shadowed uniforms that changed (binding the program if there are any). Call it
+  // right before drawing.
+  void FlushUniforms();
+
+  // Shadow copies of the uniforms (e.g. to Invalidate() them after raw glUniform*() calls).
+  UniformState & GetUniformState() { return mUniformState; }
+
+  // Active uniforms, uniform blocks and attributes (listed once the program is built).
+  const ShaderReflection & GetReflection() const { return mReflection; }
 
   // Returns the vector of compilation messages (as a copy).
   std::vector<std::string> GetCompilationLog() const { return mCompilationLog; }
@@ -115,11 +185,65 @@ public:
   // Loads shader code from file and stores into code buffer.
   int LoadShader(const char* filename, char* code, int len);
 
+private:
+  // Creates a shader and starts compiling it (0 on failure). CheckShader() waits for the
+  // compilation, and returns 0 if it was successful (the log is saved otherwise).
+  GLuint SubmitShader(const char* shaderCode, GLenum shaderType);
+  int CheckShader(GLuint shaderHandle);
+
+  void DeletePendingShaders();
+
+  bool SetUniform(NameHash name, const void* values, size_t size);
+
 protected:
   GLuint mHandle { 0 };  // OpenGL handle for the entire shader program.
 
   CompilationStatus mCompilationStatus { kUnitialized };  // Tells the result of compilation (see enum).
   std::vector<std::string> mCompilationLog;               // Stores all error messages from compiler/linker.
+  std::string mDefines;                                   // Inserted after #version.
+
+  GLuint mPendingShaders[5] { 0, 0, 0, 0, 0 };  // Of a build that has not finished yet.
+  uint64_t mBinaryKey { 0 };                    // For gloo::ProgramBinaryCache.
+  bool mStoreBinary { false };                  // Store the binary once built.
+
+  ShaderReflection mReflection;  // Of the built program.
+  UniformState mUniformState;    // Shadow copies of its uniforms.
 };
 
+// =========== IMPLEMENTATION OF INLINE METHODS ===================================================
+
+inline
+GLint ShaderProgram::GetUniformLocation(NameHash variableName) const
+{
+  const ShaderReflection::Variable* uniform = mReflection.Find(ShaderReflection::kUniform,
+                                                               variableName);
+  return uniform ? uniform->mLocation : -1;
+}
+
+inline
+bool ShaderProgram::SetUniform(NameHash name, const GLfloat* values, GLsizei count)
+{
+  return ShaderProgram::SetUniform(name, static_cast<const void*>(values), count * sizeof(GLfloat));
+}
+
+inline
+bool ShaderProgram::SetUniform(NameHash name, const GLint* values, GLsizei count)
+{
+  return ShaderProgram::SetUniform(name, static_cast<const void*>(values), count * sizeof(GLint));
+}
+
+inline
+bool ShaderProgram::SetUniform(NameHash name, const GLuint* values, GLsizei count)
+{
+  return ShaderProgram::SetUniform(name, static_cast<const void*>(values), count * sizeof(GLuint));
+}
+
+inline
+GLint ShaderProgram::GetAttribLocation(NameHash variableName) const
+{
+  const ShaderReflection::Variable* attribute = mReflection.Find(ShaderReflection::kAttribute,
+                                                                 variableName);
+  return attribute ? attribute->mLocation : -1;
+}
+
 }  // namespace gloo.
\ No newline at end of file
@@ -0,0 +1,166 @@
+#include "shader_reflection.h"
+
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+namespace gloo
+{
+
+namespace
+{
+
+// Names of arrays end with "[0]" (e.g. "light[0].pos" is not an array, "bones[0]" is).
+bool IsArrayName(const std::string & name)
+{
+  return (name.size() > 3) && (name.compare(name.size() - 3, 3, "[0]") == 0);
+}
+
+}  // namespace.
+
+void ShaderReflection::Reflect(GLuint program)
+{
+  ShaderReflection::Clear();
+
+  std::vector<GLchar> name;
+  GLint count = 0;
+  GLint maxLength = 0;
+
+  // Uniforms (members of uniform blocks included, with location -1).
+  glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+  glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+  name.resize(std::max(maxLength, 1));
+
+  for (GLint i = 0; i < count; i++)
+  {
+    Variable variable;
+    glGetActiveUniform(program, i, static_cast<GLsizei>(name.size()), nullptr, &variable.mSize,
+                       &variable.mType, name.data());
+    variable.mName = name.data();
+    variable.mLocation = glGetUniformLocation(program, name.data());
+    mTables[kUniform].mVariables.push_back(std::move(variable));
+  }
+
+  // Uniform blocks.
+  glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+  glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+  name.resize(std::max(maxLength, 1));
+
+  for (GLint i = 0; i < count; i++)
+  {
+    Variable variable;
+    glGetActiveUniformBlockName(program, i, static_cast<GLsizei>(name.size()), nullptr,
+                                name.data());
+    glGetActiveUniformBlockiv(program, i, GL_UNIFORM_BLOCK_DATA_SIZE, &variable.mSize);
+    variable.mName = name.data();
+    variable.mLocation = i;
+    variable.mType = 0;
+    mTables[kUniformBlock].mVariables.push_back(std::move(variable));
+  }
+
+  // Vertex attributes.
+  glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count);
+  glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength);
+  name.resize(std::max(maxLength, 1));
+
+  for (GLint i = 0; i < count; i++)
+  {
+    Variable variable;
+    glGetActiveAttrib(program, i, static_cast<GLsizei>(name.size()), nullptr, &variable.mSize,
+                      &variable.mType, name.data());
+    variable.mName = name.data();
+    variable.mLocation = glGetAttribLocation(program, name.data());
+    mTables[kAttribute].mVariables.push_back(std::move(variable));
+  }
+
+  for (Table & table : mTables)
+    table.Build();
+}
+
+void ShaderReflection::Clear()
+{
+  for (Table & table : mTables)
+    table = Table();
+}
+
+void ShaderReflection::Table::Build()
+{
+  // (hash, variable) of every name to find, sorted by hash.
+  std::vector<Slot> keys;
+  for (size_t i = 0; i < mVariables.size(); i++)
+  {
+    Variable & variable = mVariables[i];
+    variable.mHash = HashName(variable.mName).mValue;
+    keys.push_back({ variable.mHash, static_cast<int>(i) });
+
+    if (IsArrayName(variable.mName))
+    {
+      const std::string arrayName = variable.mName.substr(0, variable.mName.size() - 3);
+      keys.push_back({ HashName(arrayName).mValue, static_cast<int>(i) });
+    }
+  }
+
+  // Ties (hash collisions) in declaration order, for the check below.
+  std::sort(keys.begin(), keys.end(), [](const Slot & a, const Slot & b)
+  {
+    return (a.mHash < b.mHash) || ((a.mHash == b.mHash) && (a.mIndex < b.mIndex));
+  });
+
+  // Two names with the same hash cannot be told apart: the first one declared wins.
+  for (size_t i = 1; i < keys.size(); i++)
+  {
+    if (keys[i].mHash == keys[i - 1].mHash)
+    {
+      std::cerr << "ERROR: shader variables '" << mVariables[keys[i - 1].mIndex].mName << "' and '"
+                << mVariables[keys[i].mIndex].mName << "' have the same name hash." << std::endl;
+      keys.erase(keys.begin() + i);
+      i--;
+    }
+  }
+
+  // Smallest power of two table with a load factor up to 1/2, grown when no multiplier maps
+  // all keys to distinct slots (a few tries are enough for shader-sized sets).
+  unsigned bits = 1;
+  while ((1u << bits) < 2 * keys.size())
+    bits++;
+
+  uint32_t multiplier = 0x9E3779B1u;  // Golden ratio: a good first try.
+  std::vector<bool> used;
+
+  for (int attempt = 0; ; attempt++)
+  {
+    if ((attempt > 0) && (attempt % 32 == 0))
+      bits++;
+
+    const unsigned shift = 32 - bits;
+    used.assign(size_t(1) << bits, false);
+
+    bool collision = false;
+    for (const Slot & key : keys)
+    {
+      const uint32_t slot = static_cast<uint32_t>(key.mHash * multiplier) >> shift;
+      if (used[slot])
+      {
+        collision = true;
+        break;
+      }
+      used[slot] = true;
+    }
+
+    if (!collision)
+    {
+      mMultiplier = multiplier;
+      mShift = shift;
+      break;
+    }
+
+    // Next odd multiplier (a 32-bit LCG step).
+    multiplier = (multiplier * 1664525u + 1013904223u) | 1u;
+  }
+
+  mSlots.assign(size_t(1) << bits, { 0, -1 });
+  for (const Slot & key : keys)
+    mSlots[static_cast<uint32_t>(key.mHash * mMultiplier) >> mShift] = key;
+}
+
+}  // namespace gloo.
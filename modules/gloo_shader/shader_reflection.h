@@ -0,0 +1,139 @@
+// + ======================================== +
+// |         gl-oo-interface library          |
+// |        Module: GLOO Shader.              |
+// |        Author: Rodrigo Castiel, 2016.    |
+// + ======================================== +
+//
+// gloo::ShaderReflection lists the active uniforms, uniform blocks and vertex attributes of a
+// linked program (queried once, after linking), with their location, type and size. Lookups go
+// through a 32-bit hash of the name, which HashName() computes at compile time for literals, and
+// through a perfect hash table (no collision, hence no probing): a lookup is a multiplication,
+// a shift and one comparison, and never calls the driver.
+//
+// Usage:
+//   constexpr NameHash kColorMap = HashName("color_map");  // Compile time.
+//   ...
+//   const ShaderReflection & reflection = program->GetReflection();
+//   const ShaderReflection::Variable* sampler = reflection.Find(ShaderReflection::kUniform,
+//                                                                kColorMap);
+//   if (sampler) glUniform1i(sampler->mLocation, 0);
+//
+// ShaderProgram::GetUniformLocation()/GetAttribLocation() (by name or by NameHash) use it.
+//
+// Array uniforms are listed once, as "name[0]"; they can be found by "name" as well. Uniforms of
+// uniform blocks have location -1 (they are set through the buffer bound to the block).
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../include/gloo/gl_header.h"
+
+namespace gloo
+{
+
+// 32-bit FNV-1a hash of a shader variable name (a distinct type, so that it does not mix with
+// locations and indices).
+struct NameHash
+{
+  uint32_t mValue;
+};
+
+namespace detail
+{
+
+constexpr uint32_t HashName(const char* name, uint32_t hash)
+{
+  return (*name == '\0') ? hash
+                         : HashName(name + 1, (hash ^ static_cast<uint8_t>(*name)) * 16777619u);
+}
+
+}  // namespace detail.
+
+constexpr NameHash HashName(const char* name)
+{
+  return NameHash { detail::HashName(name, 2166136261u) };
+}
+
+inline NameHash HashName(const std::string & name)
+{
+  return HashName(name.c_str());
+}
+
+class ShaderReflection
+{
+public:
+  enum Kind { kUniform, kUniformBlock, kAttribute, kNumKinds };
+
+  struct Variable
+  {
+    std::string mName;
+    uint32_t mHash;
+    GLint mLocation;  // Uniform/attribute location, or block index.
+    GLenum mType;     // E.g. GL_FLOAT_VEC3, GL_SAMPLER_2D (0 for blocks).
+    GLint mSize;      // Array size (1 if not an array), or block data size in bytes.
+  };
+
+  // Lists the active variables of a linked program (replaces the previous ones).
+  void Reflect(GLuint program);
+
+  // Drops all variables.
+  void Clear();
+
+  // nullptr if the program has no such active variable.
+  const Variable* Find(Kind kind, NameHash hash) const;
+  const Variable* Find(Kind kind, const char* name) const;
+
+  // All variables of a kind.
+  const std::vector<Variable> & GetVariables(Kind kind) const { return mTables[kind].mVariables; }
+
+private:
+  struct Slot
+  {
+    uint32_t mHash;
+    int mIndex;  // Into mVariables, or -1.
+  };
+
+  // Perfect hash table: slot (hash * mMultiplier) >> mShift holds the only name that maps there.
+  struct Table
+  {
+    std::vector<Variable> mVariables;
+    std::vector<Slot> mSlots { { 0, -1 }, { 0, -1 } };
+    uint32_t mMultiplier { 0 };
+    unsigned mShift { 31 };
+
+    // Builds mSlots for the names of mVariables (and "name" for arrays "name[0]").
+    void Build();
+    const Variable* Find(uint32_t hash) const;
+  };
+
+  Table mTables[kNumKinds];
+};
+
+// =========== IMPLEMENTATION OF INLINE METHODS ===================================================
+
+inline
+const ShaderReflection::Variable* ShaderReflection::Table::Find(uint32_t hash) const
+{
+  const Slot & slot = mSlots[static_cast<uint32_t>(hash * mMultiplier) >> mShift];
+  if ((slot.mIndex < 0) || (slot.mHash != hash))
+    return nullptr;
+
+  return &mVariables[slot.mIndex];
+}
+
+inline
+const ShaderReflection::Variable* ShaderReflection::Find(Kind kind, NameHash hash) const
+{
+  return mTables[kind].Find(hash.mValue);
+}
+
+inline
+const ShaderReflection::Variable* ShaderReflection::Find(Kind kind, const char* name) const
+{
+  return mTables[kind].Find(HashName(name).mValue);
+}
+
+}  // namespace gloo.
@@ -0,0 +1,188 @@
+#include "uniform_state.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace gloo
+{
+
+UniformState::Stats UniformState::sStats;
+
+void UniformState::GetFormat(GLenum type, Format & format, unsigned & components)
+{
+  switch (type)
+  {
+    case GL_FLOAT:             format = kFloat;       components = 1;  return;
+    case GL_FLOAT_VEC2:        format = kFloat;       components = 2;  return;
+    case GL_FLOAT_VEC3:        format = kFloat;       components = 3;  return;
+    case GL_FLOAT_VEC4:        format = kFloat;       components = 4;  return;
+    case GL_INT:
+    case GL_BOOL:              format = kInt;         components = 1;  return;
+    case GL_INT_VEC2:
+    case GL_BOOL_VEC2:         format = kInt;         components = 2;  return;
+    case GL_INT_VEC3:
+    case GL_BOOL_VEC3:         format = kInt;         components = 3;  return;
+    case GL_INT_VEC4:
+    case GL_BOOL_VEC4:         format = kInt;         components = 4;  return;
+    case GL_UNSIGNED_INT:      format = kUnsignedInt; components = 1;  return;
+    case GL_UNSIGNED_INT_VEC2: format = kUnsignedInt; components = 2;  return;
+    case GL_UNSIGNED_INT_VEC3: format = kUnsignedInt; components = 3;  return;
+    case GL_UNSIGNED_INT_VEC4: format = kUnsignedInt; components = 4;  return;
+    case GL_FLOAT_MAT2:        format = kMatrix2;     components = 4;  return;
+    case GL_FLOAT_MAT3:        format = kMatrix3;     components = 9;  return;
+    case GL_FLOAT_MAT4:        format = kMatrix4;     components = 16; return;
+
+    // Samplers are set with glUniform1i().
+    case GL_SAMPLER_1D:
+    case GL_SAMPLER_2D:
+    case GL_SAMPLER_3D:
+    case GL_SAMPLER_CUBE:
+    case GL_SAMPLER_1D_SHADOW:
+    case GL_SAMPLER_2D_SHADOW:
+    case GL_SAMPLER_1D_ARRAY:
+    case GL_SAMPLER_2D_ARRAY:
+    case GL_SAMPLER_1D_ARRAY_SHADOW:
+    case GL_SAMPLER_2D_ARRAY_SHADOW:
+    case GL_SAMPLER_CUBE_SHADOW:
+    case GL_SAMPLER_BUFFER:
+    case GL_SAMPLER_2D_RECT:
+    case GL_SAMPLER_2D_MULTISAMPLE:
+    case GL_INT_SAMPLER_2D:
+    case GL_INT_SAMPLER_3D:
+    case GL_INT_SAMPLER_2D_ARRAY:
+    case GL_INT_SAMPLER_BUFFER:
+    case GL_UNSIGNED_INT_SAMPLER_2D:
+    case GL_UNSIGNED_INT_SAMPLER_3D:
+    case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+    case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+                               format = kInt;         components = 1;  return;
+
+    default:                   format = kUnsupported; components = 0;  return;
+  }
+}
+
+void UniformState::Build(const ShaderReflection & reflection)
+{
+  const std::vector<ShaderReflection::Variable> & uniforms =
+    reflection.GetVariables(ShaderReflection::kUniform);
+
+  mEntries.resize(uniforms.size());
+  mDirty.clear();
+  uint32_t numWords = 0;
+
+  for (size_t i = 0; i < uniforms.size(); i++)
+  {
+    const ShaderReflection::Variable & uniform = uniforms[i];
+    Entry & entry = mEntries[i];
+
+    UniformState::GetFormat(uniform.mType, entry.mFormat, entry.mComponents);
+    entry.mLocation = uniform.mLocation;
+    entry.mArraySize = uniform.mSize;
+    entry.mOffset = numWords;
+    entry.mSetWords = 0;
+    entry.mKnownWords = 0;  // Not necessarily zero after linking (initializers).
+    entry.mDirty = false;
+
+    // Members of uniform blocks live in buffers.
+    if (entry.mLocation < 0)
+      entry.mFormat = kUnsupported;
+
+    if (entry.mFormat != kUnsupported)
+      numWords += entry.mComponents * entry.mArraySize;
+  }
+
+  mValues.assign(numWords, 0);
+}
+
+bool UniformState::Set(size_t uniform, const void* data, size_t size)
+{
+  if (uniform >= mEntries.size())
+    return false;
+
+  Entry & entry = mEntries[uniform];
+  if (entry.mFormat == kUnsupported)
+    return false;
+
+  // Whole elements only, and no more than the array holds.
+  const uint32_t elementSize = entry.mComponents * sizeof(uint32_t);
+  const uint32_t numElements = std::min<uint32_t>(size / elementSize, entry.mArraySize);
+  const uint32_t numWords = numElements * entry.mComponents;
+  if (numWords == 0)
+    return false;
+
+  uint32_t* shadow = &mValues[entry.mOffset];
+  if ((numWords <= entry.mKnownWords) &&
+      (std::memcmp(shadow, data, numWords * sizeof(uint32_t)) == 0))
+  {
+    sStats.mSkipped++;
+    return false;
+  }
+
+  std::memcpy(shadow, data, numWords * sizeof(uint32_t));
+  entry.mSetWords = std::max(entry.mSetWords, numWords);
+  entry.mKnownWords = std::max(entry.mKnownWords, numWords);
+
+  if (!entry.mDirty)
+  {
+    entry.mDirty = true;
+    mDirty.push_back(static_cast<uint32_t>(uniform));
+  }
+
+  return true;
+}
+
+void UniformState::Flush()
+{
+  for (uint32_t index : mDirty)
+  {
+    Entry & entry = mEntries[index];
+    const GLsizei count = entry.mSetWords / entry.mComponents;
+    const GLint location = entry.mLocation;
+    const uint32_t* words = &mValues[entry.mOffset];
+    const GLfloat* floats = reinterpret_cast<const GLfloat*>(words);
+    const GLint* ints = reinterpret_cast<const GLint*>(words);
+
+    switch (entry.mFormat)
+    {
+      case kFloat:
+        if      (entry.mComponents == 1) glUniform1fv(location, count, floats);
+        else if (entry.mComponents == 2) glUniform2fv(location, count, floats);
+        else if (entry.mComponents == 3) glUniform3fv(location, count, floats);
+        else                             glUniform4fv(location, count, floats);
+        break;
+
+      case kInt:
+        if      (entry.mComponents == 1) glUniform1iv(location, count, ints);
+        else if (entry.mComponents == 2) glUniform2iv(location, count, ints);
+        else if (entry.mComponents == 3) glUniform3iv(location, count, ints);
+        else                             glUniform4iv(location, count, ints);
+        break;
+
+      case kUnsignedInt:
+        if      (entry.mComponents == 1) glUniform1uiv(location, count, words);
+        else if (entry.mComponents == 2) glUniform2uiv(location, count, words);
+        else if (entry.mComponents == 3) glUniform3uiv(location, count, words);
+        else                             glUniform4uiv(location, count, words);
+        break;
+
+      case kMatrix2: glUniformMatrix2fv(location, count, GL_FALSE, floats); break;
+      case kMatrix3: glUniformMatrix3fv(location, count, GL_FALSE, floats); break;
+      case kMatrix4: glUniformMatrix4fv(location, count, GL_FALSE, floats); break;
+      case kUnsupported: break;
+    }
+
+    entry.mDirty = false;
+    sStats.mUploaded++;
+  }
+
+  mDirty.clear();
+}
+
+void UniformState::Invalidate()
+{
+  for (Entry & entry : mEntries)
+    entry.mKnownWords = 0;
+}
+
+}  // namespace gloo.
@@ -0,0 +1,92 @@
+// + ======================================== +
+// |         gl-oo-interface library          |
+// |        Module: GLOO Shader.              |
+// |        Author: Rodrigo Castiel, 2016.    |
+// + ======================================== +
+//
+// gloo::UniformState shadows the plain (non-block) uniforms of a program in client memory, laid
+// out from its gloo::ShaderReflection. A new value is compared with the shadow copy: if it is
+// the same, nothing happens; otherwise it is copied and the uniform is marked dirty. Flush()
+// uploads the dirty uniforms only (call it right before drawing), so setting the same value for
+// every draw never reaches the driver.
+//
+// Each ShaderProgram has one (see ShaderProgram::SetUniform() and FlushUniforms()):
+//   constexpr NameHash kColorMap = HashName("color_map");
+//   program->SetUniform(kColorMap, 0);           // Shadowed (uploaded at most once).
+//   program->SetUniform(kTint, glm::value_ptr(tint), 3);
+//   ...
+//   program->FlushUniforms();                   // Before the draw call.
+//
+//   const UniformState::Stats & stats = UniformState::GetStats();  // Uploaded vs. skipped.
+//   UniformState::ResetStats();                                     // E.g. once per frame.
+//
+// Uniforms start unknown (GLSL initializers may give them any value after linking): the first
+// value set is always uploaded. Code that sets uniforms with raw glUniform*() calls must call
+// Invalidate() afterwards (the next value set is always uploaded).
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "shader_reflection.h"
+
+namespace gloo
+{
+
+class UniformState
+{
+public:
+  struct Stats
+  {
+    uint64_t mUploaded { 0 };  // Uniform values (or blocks) that reached the driver.
+    uint64_t mSkipped { 0 };   // Values set again to what they already were.
+  };
+
+  // Counters shared by all programs (and renderers that shadow uniform blocks).
+  static const Stats & GetStats() { return sStats; }
+  static void ResetStats() { sStats = Stats(); }
+  static void CountUploaded(unsigned count = 1) { sStats.mUploaded += count; }
+  static void CountSkipped(unsigned count = 1) { sStats.mSkipped += count; }
+
+  // Lays out the shadow copies of the uniforms of a reflected program.
+  void Build(const ShaderReflection & reflection);
+
+  // Sets a uniform (index into reflection.GetVariables(kUniform)) from size bytes of data: 32-bit
+  // floats or ints, as the uniform type needs, up to the whole array. Returns whether the
+  // value changed.
+  bool Set(size_t uniform, const void* data, size_t size);
+
+  // Uploads the dirty uniforms into the program currently in use.
+  void Flush();
+
+  // Forgets the values (they are all uploaded when set next).
+  void Invalidate();
+
+  bool IsDirty() const { return !mDirty.empty(); }
+
+private:
+  enum Format { kUnsupported, kFloat, kInt, kUnsignedInt, kMatrix2, kMatrix3, kMatrix4 };
+
+  struct Entry
+  {
+    GLint mLocation;
+    Format mFormat;
+    unsigned mComponents;  // Per element (e.g. 3 for vec3, 16 for mat4).
+    GLsizei mArraySize;
+    uint32_t mOffset;      // Into mValues (in words).
+    uint32_t mSetWords;    // Words set last (a prefix of the array may be set).
+    uint32_t mKnownWords;  // Words of mValues that hold what the program has (a prefix).
+    bool mDirty;
+  };
+
+  static void GetFormat(GLenum type, Format & format, unsigned & components);
+
+  std::vector<Entry> mEntries;    // In the order of the reflected uniforms.
+  std::vector<uint32_t> mValues;  // Shadow copies, as 32-bit words.
+  std::vector<uint32_t> mDirty;   // Entries to upload.
+
+  static Stats sStats;
+};
+
+}  // namespace gloo.
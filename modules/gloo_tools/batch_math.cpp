@@ -0,0 +1,817 @@
+#include "batch_math.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define GLOO_BATCH_MATH_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// SSE/AVX kernels are compiled for their own target, so the rest of the library can be built
+// with the default flags and still run on CPUs without AVX.
+#if defined(__GNUC__) || defined(__clang__)
+#define GLOO_TARGET_SSE2 __attribute__((target("sse2")))
+#define GLOO_TARGET_AVX  __attribute__((target("avx")))
+#else
+#define GLOO_TARGET_SSE2
+#define GLOO_TARGET_AVX
+#endif
+
+namespace gloo
+{
+
+namespace
+{
+
+// All kernels work on raw floats (glm::mat4 is 16 contiguous floats in column-major order,
+// glm::vec3 is 3 floats and AABB is 6 floats).
+struct KernelTable
+{
+  BatchKernel mKernel;
+  void (*mMultiply)(const float* a, const float* b, float* out, size_t count);
+  void (*mMultiplyShared)(const float* m, const float* b, float* out, size_t count);
+  void (*mPoints3)(const float* m, const float* in, float* out, size_t count);
+  void (*mVectors3)(const float* m, const float* in, float* out, size_t count);
+  void (*mPoints4)(const float* m, const float* in, float* out, size_t count);
+  void (*mPointsSoA)(const float* m, const float* x, const float* y, const float* z,
+                     float* outX, float* outY, float* outZ, size_t count);
+  void (*mInvertAffine)(const float* in, float* out, size_t count);
+  void (*mAABBsShared)(const float* m, const float* in, float* out, size_t count);
+  void (*mAABBs)(const float* m, const float* in, float* out, size_t count);
+  void (*mComposeTRS)(const TRS* in, float* out, size_t count);
+};
+
+// =========== SCALAR KERNELS =====================================================================
+
+inline void MultiplyOneScalar(const float* a, const float* b, float* out)
+{
+  float r[16];  // out may alias a or b.
+  for (int j = 0; j < 4; j++)
+  {
+    for (int i = 0; i < 4; i++)
+    {
+      r[4*j + i] = a[i]*b[4*j] + a[4 + i]*b[4*j + 1] + a[8 + i]*b[4*j + 2] + a[12 + i]*b[4*j + 3];
+    }
+  }
+  std::memcpy(out, r, sizeof(r));
+}
+
+void MultiplyScalar(const float* a, const float* b, float* out, size_t count)
+{
+  for (size_t k = 0; k < count; k++)
+  {
+    MultiplyOneScalar(a + 16*k, b + 16*k, out + 16*k);
+  }
+}
+
+void MultiplySharedScalar(const float* m, const float* b, float* out, size_t count)
+{
+  float a[16];  // Local copy, in case m lives inside out.
+  std::memcpy(a, m, sizeof(a));
+
+  for (size_t k = 0; k < count; k++)
+  {
+    MultiplyOneScalar(a, b + 16*k, out + 16*k);
+  }
+}
+
+template <bool kTranslate>
+void Transform3Scalar(const float* m, const float* in, float* out, size_t count)
+{
+  for (size_t k = 0; k < count; k++)
+  {
+    const float x = in[3*k + 0];
+    const float y = in[3*k + 1];
+    const float z = in[3*k + 2];
+
+    for (int i = 0; i < 3; i++)
+    {
+      out[3*k + i] = m[i]*x + m[4 + i]*y + m[8 + i]*z + (kTranslate ? m[12 + i] : 0.0f);
+    }
+  }
+}
+
+void Points4Scalar(const float* m, const float* in, float* out, size_t count)
+{
+  for (size_t k = 0; k < count; k++)
+  {
+    const float x = in[4*k + 0];
+    const float y = in[4*k + 1];
+    const float z = in[4*k + 2];
+    const float w = in[4*k + 3];
+
+    for (int i = 0; i < 4; i++)
+    {
+      out[4*k + i] = m[i]*x + m[4 + i]*y + m[8 + i]*z + m[12 + i]*w;
+    }
+  }
+}
+
+void PointsSoAScalar(const float* m, const float* x, const float* y, const float* z,
+                     float* outX, float* outY, float* outZ, size_t count)
+{
+  for (size_t k = 0; k < count; k++)
+  {
+    const float px = x[k];
+    const float py = y[k];
+    const float pz = z[k];
+
+    outX[k] = m[0]*px + m[4]*py + m[8]*pz  + m[12];
+    outY[k] = m[1]*px + m[5]*py + m[9]*pz  + m[13];
+    outZ[k] = m[2]*px + m[6]*py + m[10]*pz + m[14];
+  }
+}
+
+void InvertAffineScalar(const float* in, float* out, size_t count)
+{
+  for (size_t k = 0; k < count; k++, in += 16, out += 16)
+  {
+    const glm::vec3 c0(in[0], in[1], in[2]);
+    const glm::vec3 c1(in[4], in[5], in[6]);
+    const glm::vec3 c2(in[8], in[9], in[10]);
+    const glm::vec3 t(in[12], in[13], in[14]);
+
+    // Rows of inverse(A) = cofactors / det.
+    glm::vec3 r0 = glm::cross(c1, c2);
+    const float invDet = 1.0f / glm::dot(c0, r0);
+    r0 *= invDet;
+    const glm::vec3 r1 = glm::cross(c2, c0) * invDet;
+    const glm::vec3 r2 = glm::cross(c0, c1) * invDet;
+
+    for (int j = 0; j < 3; j++)
+    {
+      out[4*j + 0] = r0[j];
+      out[4*j + 1] = r1[j];
+      out[4*j + 2] = r2[j];
+      out[4*j + 3] = 0.0f;
+    }
+
+    out[12] = -glm::dot(r0, t);
+    out[13] = -glm::dot(r1, t);
+    out[14] = -glm::dot(r2, t);
+    out[15] = 1.0f;
+  }
+}
+
+inline void TransformAABBScalar(const float* m, const float* box, float* out)
+{
+  float center[3], extents[3];
+  for (int i = 0; i < 3; i++)
+  {
+    const float c = 0.5f * (box[i] + box[3 + i]);
+    const float e = 0.5f * (box[3 + i] - box[i]);
+    center[i] = c;
+    extents[i] = e;
+  }
+
+  for (int i = 0; i < 3; i++)
+  {
+    const float c = m[12 + i] + m[i]*center[0] + m[4 + i]*center[1] + m[8 + i]*center[2];
+    const float e = std::fabs(m[i])*extents[0] + std::fabs(m[4 + i])*extents[1]
+                  + std::fabs(m[8 + i])*extents[2];
+    out[i]     = c - e;
+    out[3 + i] = c + e;
+  }
+}
+
+void AABBsSharedScalar(const float* m, const float* in, float* out, size_t count)
+{
+  for (size_t k = 0; k < count; k++)
+  {
+    TransformAABBScalar(m, in + 6*k, out + 6*k);
+  }
+}
+
+void AABBsScalar(const float* m, const float* in, float* out, size_t count)
+{
+  for (size_t k = 0; k < count; k++)
+  {
+    TransformAABBScalar(m + 16*k, in + 6*k, out + 6*k);
+  }
+}
+
+// TRS arrays are read through their members (the layout of glm::quat depends on glm's version).
+void ComposeTRSScalar(const TRS* in, float* out, size_t count)
+{
+  for (size_t k = 0; k < count; k++)
+  {
+    const glm::mat4 m = in[k].ToMatrix();
+    std::memcpy(out + 16*k, &m[0][0], 16 * sizeof(float));
+  }
+}
+
+#ifdef GLOO_BATCH_MATH_X86
+
+// =========== SSE KERNELS ========================================================================
+
+#define GLOO_SPLAT(v, i) _mm_shuffle_ps((v), (v), _MM_SHUFFLE(i, i, i, i))
+
+GLOO_TARGET_SSE2
+void MultiplySSE(const float* a, const float* b, float* out, size_t count)
+{
+  for (size_t k = 0; k < count; k++, a += 16, b += 16, out += 16)
+  {
+    const __m128 a0 = _mm_loadu_ps(a + 0);
+    const __m128 a1 = _mm_loadu_ps(a + 4);
+    const __m128 a2 = _mm_loadu_ps(a + 8);
+    const __m128 a3 = _mm_loadu_ps(a + 12);
+
+    for (int j = 0; j < 4; j++)
+    {
+      const __m128 bj = _mm_loadu_ps(b + 4*j);
+      __m128 r = _mm_mul_ps(a0, GLOO_SPLAT(bj, 0));
+      r = _mm_add_ps(r, _mm_mul_ps(a1, GLOO_SPLAT(bj, 1)));
+      r = _mm_add_ps(r, _mm_mul_ps(a2, GLOO_SPLAT(bj, 2)));
+      r = _mm_add_ps(r, _mm_mul_ps(a3, GLOO_SPLAT(bj, 3)));
+      _mm_storeu_ps(out + 4*j, r);
+    }
+  }
+}
+
+GLOO_TARGET_SSE2
+void MultiplySharedSSE(const float* m, const float* b, float* out, size_t count)
+{
+  const __m128 a0 = _mm_loadu_ps(m + 0);
+  const __m128 a1 = _mm_loadu_ps(m + 4);
+  const __m128 a2 = _mm_loadu_ps(m + 8);
+  const __m128 a3 = _mm_loadu_ps(m + 12);
+
+  for (size_t k = 0; k < count; k++, b += 16, out += 16)
+  {
+    for (int j = 0; j < 4; j++)
+    {
+      const __m128 bj = _mm_loadu_ps(b + 4*j);
+      __m128 r = _mm_mul_ps(a0, GLOO_SPLAT(bj, 0));
+      r = _mm_add_ps(r, _mm_mul_ps(a1, GLOO_SPLAT(bj, 1)));
+      r = _mm_add_ps(r, _mm_mul_ps(a2, GLOO_SPLAT(bj, 2)));
+      r = _mm_add_ps(r, _mm_mul_ps(a3, GLOO_SPLAT(bj, 3)));
+      _mm_storeu_ps(out + 4*j, r);
+    }
+  }
+}
+
+// Processes 4 vec3 at a time: the 12 floats are transposed to SoA, transformed and transposed
+// back. The remaining points go through the scalar path.
+template <bool kTranslate>
+GLOO_TARGET_SSE2
+void Transform3SSE(const float* m, const float* in, float* out, size_t count)
+{
+  const __m128 m00 = _mm_set1_ps(m[0]),  m01 = _mm_set1_ps(m[1]),  m02 = _mm_set1_ps(m[2]);
+  const __m128 m10 = _mm_set1_ps(m[4]),  m11 = _mm_set1_ps(m[5]),  m12 = _mm_set1_ps(m[6]);
+  const __m128 m20 = _mm_set1_ps(m[8]),  m21 = _mm_set1_ps(m[9]),  m22 = _mm_set1_ps(m[10]);
+  const __m128 m30 = _mm_set1_ps(kTranslate ? m[12] : 0.0f);
+  const __m128 m31 = _mm_set1_ps(kTranslate ? m[13] : 0.0f);
+  const __m128 m32 = _mm_set1_ps(kTranslate ? m[14] : 0.0f);
+
+  size_t k = 0;
+  for (; k + 4 <= count; k += 4)
+  {
+    const float* p = in + 3*k;
+    const __m128 v0 = _mm_loadu_ps(p + 0);  // x0 y0 z0 x1
+    const __m128 v1 = _mm_loadu_ps(p + 4);  // y1 z1 x2 y2
+    const __m128 v2 = _mm_loadu_ps(p + 8);  // z2 x3 y3 z3
+
+    const __m128 t  = _mm_shuffle_ps(v1, v2, _MM_SHUFFLE(1, 0, 3, 2));  // x2 y2 z2 x3
+    const __m128 w  = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(1, 0, 2, 1));  // y0 z0 y1 z1
+    const __m128 s  = _mm_shuffle_ps(t,  v2, _MM_SHUFFLE(3, 2, 2, 1));  // y2 z2 y3 z3
+    const __m128 X  = _mm_shuffle_ps(v0, t,  _MM_SHUFFLE(3, 0, 3, 0));
+    const __m128 Y  = _mm_shuffle_ps(w,  s,  _MM_SHUFFLE(2, 0, 2, 0));
+    const __m128 Z  = _mm_shuffle_ps(w,  s,  _MM_SHUFFLE(3, 1, 3, 1));
+
+    const __m128 RX = _mm_add_ps(_mm_add_ps(_mm_mul_ps(X, m00), _mm_mul_ps(Y, m10)),
+                                 _mm_add_ps(_mm_mul_ps(Z, m20), m30));
+    const __m128 RY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(X, m01), _mm_mul_ps(Y, m11)),
+                                 _mm_add_ps(_mm_mul_ps(Z, m21), m31));
+    const __m128 RZ = _mm_add_ps(_mm_add_ps(_mm_mul_ps(X, m02), _mm_mul_ps(Y, m12)),
+                                 _mm_add_ps(_mm_mul_ps(Z, m22), m32));
+
+    const __m128 xy01 = _mm_unpacklo_ps(RX, RY);                             // x0 y0 x1 y1
+    const __m128 xy23 = _mm_unpackhi_ps(RX, RY);                             // x2 y2 x3 y3
+    const __m128 zx01 = _mm_shuffle_ps(RZ, RX, _MM_SHUFFLE(1, 1, 0, 0));     // z0 z0 x1 x1
+    const __m128 yz11 = _mm_shuffle_ps(RY, RZ, _MM_SHUFFLE(1, 1, 1, 1));     // y1 y1 z1 z1
+    const __m128 zx23 = _mm_shuffle_ps(RZ, RX, _MM_SHUFFLE(3, 3, 2, 2));     // z2 z2 x3 x3
+    const __m128 yz33 = _mm_shuffle_ps(RY, RZ, _MM_SHUFFLE(3, 3, 3, 3));     // y3 y3 z3 z3
+
+    float* q = out + 3*k;
+    _mm_storeu_ps(q + 0, _mm_shuffle_ps(xy01, zx01, _MM_SHUFFLE(2, 0, 1, 0)));
+    _mm_storeu_ps(q + 4, _mm_shuffle_ps(yz11, xy23, _MM_SHUFFLE(1, 0, 2, 0)));
+    _mm_storeu_ps(q + 8, _mm_shuffle_ps(zx23, yz33, _MM_SHUFFLE(2, 0, 2, 0)));
+  }
+
+  Transform3Scalar<kTranslate>(m, in + 3*k, out + 3*k, count - k);
+}
+
+GLOO_TARGET_SSE2
+void Points4SSE(const float* m, const float* in, float* out, size_t count)
+{
+  const __m128 c0 = _mm_loadu_ps(m + 0);
+  const __m128 c1 = _mm_loadu_ps(m + 4);
+  const __m128 c2 = _mm_loadu_ps(m + 8);
+  const __m128 c3 = _mm_loadu_ps(m + 12);
+
+  for (size_t k = 0; k < count; k++)
+  {
+    const __m128 p = _mm_loadu_ps(in + 4*k);
+    __m128 r = _mm_mul_ps(c0, GLOO_SPLAT(p, 0));
+    r = _mm_add_ps(r, _mm_mul_ps(c1, GLOO_SPLAT(p, 1)));
+    r = _mm_add_ps(r, _mm_mul_ps(c2, GLOO_SPLAT(p, 2)));
+    r = _mm_add_ps(r, _mm_mul_ps(c3, GLOO_SPLAT(p, 3)));
+    _mm_storeu_ps(out + 4*k, r);
+  }
+}
+
+GLOO_TARGET_SSE2
+void PointsSoASSE(const float* m, const float* x, const float* y, const float* z,
+                  float* outX, float* outY, float* outZ, size_t count)
+{
+  const __m128 m00 = _mm_set1_ps(m[0]),  m01 = _mm_set1_ps(m[1]),  m02 = _mm_set1_ps(m[2]);
+  const __m128 m10 = _mm_set1_ps(m[4]),  m11 = _mm_set1_ps(m[5]),  m12 = _mm_set1_ps(m[6]);
+  const __m128 m20 = _mm_set1_ps(m[8]),  m21 = _mm_set1_ps(m[9]),  m22 = _mm_set1_ps(m[10]);
+  const __m128 m30 = _mm_set1_ps(m[12]), m31 = _mm_set1_ps(m[13]), m32 = _mm_set1_ps(m[14]);
+
+  size_t k = 0;
+  for (; k + 4 <= count; k += 4)
+  {
+    const __m128 X = _mm_loadu_ps(x + k);
+    const __m128 Y = _mm_loadu_ps(y + k);
+    const __m128 Z = _mm_loadu_ps(z + k);
+
+    _mm_storeu_ps(outX + k, _mm_add_ps(_mm_add_ps(_mm_mul_ps(X, m00), _mm_mul_ps(Y, m10)),
+                                       _mm_add_ps(_mm_mul_ps(Z, m20), m30)));
+    _mm_storeu_ps(outY + k, _mm_add_ps(_mm_add_ps(_mm_mul_ps(X, m01), _mm_mul_ps(Y, m11)),
+                                       _mm_add_ps(_mm_mul_ps(Z, m21), m31)));
+    _mm_storeu_ps(outZ + k, _mm_add_ps(_mm_add_ps(_mm_mul_ps(X, m02), _mm_mul_ps(Y, m12)),
+                                       _mm_add_ps(_mm_mul_ps(Z, m22), m32)));
+  }
+
+  PointsSoAScalar(m, x + k, y + k, z + k, outX + k, outY + k, outZ + k, count - k);
+}
+
+// Inverts 4 affine matrices at a time. Each column is transposed so that every register holds
+// the same entry of 4 different matrices, then the cofactors are computed lane-wise.
+GLOO_TARGET_SSE2
+void InvertAffineSSE(const float* in, float* out, size_t count)
+{
+  size_t k = 0;
+  for (; k + 4 <= count; k += 4)
+  {
+    const float* src = in + 16*k;
+    __m128 c[4][4];  // c[column][component], lanes = matrices.
+
+    for (int j = 0; j < 4; j++)
+    {
+      c[j][0] = _mm_loadu_ps(src + 4*j);
+      c[j][1] = _mm_loadu_ps(src + 4*j + 16);
+      c[j][2] = _mm_loadu_ps(src + 4*j + 32);
+      c[j][3] = _mm_loadu_ps(src + 4*j + 48);
+      _MM_TRANSPOSE4_PS(c[j][0], c[j][1], c[j][2], c[j][3]);
+    }
+
+    // r0 = c1 x c2, r1 = c2 x c0, r2 = c0 x c1.
+    __m128 r[3][3];
+    for (int i = 0; i < 3; i++)
+    {
+      const __m128* u = c[(i + 1) % 3];
+      const __m128* v = c[(i + 2) % 3];
+      r[i][0] = _mm_sub_ps(_mm_mul_ps(u[1], v[2]), _mm_mul_ps(u[2], v[1]));
+      r[i][1] = _mm_sub_ps(_mm_mul_ps(u[2], v[0]), _mm_mul_ps(u[0], v[2]));
+      r[i][2] = _mm_sub_ps(_mm_mul_ps(u[0], v[1]), _mm_mul_ps(u[1], v[0]));
+    }
+
+    const __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c[0][0], r[0][0]),
+                                             _mm_mul_ps(c[0][1], r[0][1])),
+                                  _mm_mul_ps(c[0][2], r[0][2]));
+    const __m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+    __m128 t[3];
+    for (int i = 0; i < 3; i++)
+    {
+      r[i][0] = _mm_mul_ps(r[i][0], invDet);
+      r[i][1] = _mm_mul_ps(r[i][1], invDet);
+      r[i][2] = _mm_mul_ps(r[i][2], invDet);
+
+      const __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r[i][0], c[3][0]),
+                                             _mm_mul_ps(r[i][1], c[3][1])),
+                                  _mm_mul_ps(r[i][2], c[3][2]));
+      t[i] = _mm_sub_ps(_mm_setzero_ps(), d);
+    }
+
+    // Column j of the inverse is (r0[j], r1[j], r2[j], 0); column 3 is (t, 1).
+    float* dst = out + 16*k;
+    for (int j = 0; j < 4; j++)
+    {
+      __m128 e0 = (j < 3) ? r[0][j] : t[0];
+      __m128 e1 = (j < 3) ? r[1][j] : t[1];
+      __m128 e2 = (j < 3) ? r[2][j] : t[2];
+      __m128 e3 = (j < 3) ? _mm_setzero_ps() : _mm_set1_ps(1.0f);
+      _MM_TRANSPOSE4_PS(e0, e1, e2, e3);
+
+      _mm_storeu_ps(dst + 4*j,      e0);
+      _mm_storeu_ps(dst + 4*j + 16, e1);
+      _mm_storeu_ps(dst + 4*j + 32, e2);
+      _mm_storeu_ps(dst + 4*j + 48, e3);
+    }
+  }
+
+  InvertAffineScalar(in + 16*k, out + 16*k, count - k);
+}
+
+// Boxes are 6 floats, so loads/stores never touch memory beyond [box, box + 6).
+GLOO_TARGET_SSE2
+inline void TransformAABBSSE(__m128 c0, __m128 c1, __m128 c2, __m128 c3,
+                             __m128 a0, __m128 a1, __m128 a2,
+                             const float* box, float* out)
+{
+  const __m128 lo   = _mm_loadu_ps(box);                                       // min  max.x
+  const __m128 hi   = _mm_loadu_ps(box + 2);                                   // min.z  max
+  const __m128 mx   = _mm_shuffle_ps(hi, hi, _MM_SHUFFLE(3, 3, 2, 1));
+  const __m128 half = _mm_set1_ps(0.5f);
+  const __m128 c    = _mm_mul_ps(_mm_add_ps(lo, mx), half);
+  const __m128 e    = _mm_mul_ps(_mm_sub_ps(mx, lo), half);
+
+  __m128 center = _mm_add_ps(c3, _mm_mul_ps(c0, GLOO_SPLAT(c, 0)));
+  center = _mm_add_ps(center, _mm_mul_ps(c1, GLOO_SPLAT(c, 1)));
+  center = _mm_add_ps(center, _mm_mul_ps(c2, GLOO_SPLAT(c, 2)));
+
+  __m128 extents = _mm_mul_ps(a0, GLOO_SPLAT(e, 0));
+  extents = _mm_add_ps(extents, _mm_mul_ps(a1, GLOO_SPLAT(e, 1)));
+  extents = _mm_add_ps(extents, _mm_mul_ps(a2, GLOO_SPLAT(e, 2)));
+
+  const __m128 rmin = _mm_sub_ps(center, extents);
+  const __m128 rmax = _mm_add_ps(center, extents);
+
+  _mm_storel_pi(reinterpret_cast<__m64*>(out), rmin);
+  _mm_store_ss(out + 2, _mm_movehl_ps(rmin, rmin));
+  _mm_storel_pi(reinterpret_cast<__m64*>(out + 3), rmax);
+  _mm_store_ss(out + 5, _mm_movehl_ps(rmax, rmax));
+}
+
+GLOO_TARGET_SSE2
+void AABBsSharedSSE(const float* m, const float* in, float* out, size_t count)
+{
+  const __m128 signMask = _mm_set1_ps(-0.0f);
+  const __m128 c0 = _mm_loadu_ps(m + 0);
+  const __m128 c1 = _mm_loadu_ps(m + 4);
+  const __m128 c2 = _mm_loadu_ps(m + 8);
+  const __m128 c3 = _mm_loadu_ps(m + 12);
+  const __m128 a0 = _mm_andnot_ps(signMask, c0);
+  const __m128 a1 = _mm_andnot_ps(signMask, c1);
+  const __m128 a2 = _mm_andnot_ps(signMask, c2);
+
+  for (size_t k = 0; k < count; k++)
+  {
+    TransformAABBSSE(c0, c1, c2, c3, a0, a1, a2, in + 6*k, out + 6*k);
+  }
+}
+
+GLOO_TARGET_SSE2
+void AABBsSSE(const float* m, const float* in, float* out, size_t count)
+{
+  const __m128 signMask = _mm_set1_ps(-0.0f);
+
+  for (size_t k = 0; k < count; k++, m += 16)
+  {
+    const __m128 c0 = _mm_loadu_ps(m + 0);
+    const __m128 c1 = _mm_loadu_ps(m + 4);
+    const __m128 c2 = _mm_loadu_ps(m + 8);
+    const __m128 c3 = _mm_loadu_ps(m + 12);
+    TransformAABBSSE(c0, c1, c2, c3,
+                     _mm_andnot_ps(signMask, c0),
+                     _mm_andnot_ps(signMask, c1),
+                     _mm_andnot_ps(signMask, c2),
+                     in + 6*k, out + 6*k);
+  }
+}
+
+// Converts 4 transforms at a time: their components are gathered so that every register holds
+// the same component of 4 transforms, the matrix entries are computed lane-wise, and each
+// column is transposed back into the 4 matrices.
+GLOO_TARGET_SSE2
+void ComposeTRSSSE(const TRS* in, float* out, size_t count)
+{
+  const __m128 one = _mm_set1_ps(1.0f);
+
+  size_t k = 0;
+  for (; k + 4 <= count; k += 4)
+  {
+    const TRS* t = in + k;
+#define GLOO_GATHER(member) _mm_setr_ps(t[0].member, t[1].member, t[2].member, t[3].member)
+    const __m128 x = GLOO_GATHER(mRotation.x), y = GLOO_GATHER(mRotation.y);
+    const __m128 z = GLOO_GATHER(mRotation.z), w = GLOO_GATHER(mRotation.w);
+    const __m128 sx = GLOO_GATHER(mScale.x), sy = GLOO_GATHER(mScale.y);
+    const __m128 sz = GLOO_GATHER(mScale.z);
+
+    __m128 c[4][4];  // c[column][component], lanes = transforms.
+    c[3][0] = GLOO_GATHER(mTranslation.x);
+    c[3][1] = GLOO_GATHER(mTranslation.y);
+    c[3][2] = GLOO_GATHER(mTranslation.z);
+    c[3][3] = one;
+#undef GLOO_GATHER
+
+    const __m128 x2 = _mm_add_ps(x, x), y2 = _mm_add_ps(y, y), z2 = _mm_add_ps(z, z);
+    const __m128 xx = _mm_mul_ps(x, x2), yy = _mm_mul_ps(y, y2), zz = _mm_mul_ps(z, z2);
+    const __m128 xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2), yz = _mm_mul_ps(y, z2);
+    const __m128 wx = _mm_mul_ps(w, x2), wy = _mm_mul_ps(w, y2), wz = _mm_mul_ps(w, z2);
+
+    c[0][0] = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx);
+    c[0][1] = _mm_mul_ps(_mm_add_ps(xy, wz), sx);
+    c[0][2] = _mm_mul_ps(_mm_sub_ps(xz, wy), sx);
+    c[1][0] = _mm_mul_ps(_mm_sub_ps(xy, wz), sy);
+    c[1][1] = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy);
+    c[1][2] = _mm_mul_ps(_mm_add_ps(yz, wx), sy);
+    c[2][0] = _mm_mul_ps(_mm_add_ps(xz, wy), sz);
+    c[2][1] = _mm_mul_ps(_mm_sub_ps(yz, wx), sz);
+    c[2][2] = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz);
+    c[0][3] = c[1][3] = c[2][3] = _mm_setzero_ps();
+
+    float* dst = out + 16*k;
+    for (int j = 0; j < 4; j++)
+    {
+      _MM_TRANSPOSE4_PS(c[j][0], c[j][1], c[j][2], c[j][3]);
+      _mm_storeu_ps(dst + 4*j,      c[j][0]);
+      _mm_storeu_ps(dst + 4*j + 16, c[j][1]);
+      _mm_storeu_ps(dst + 4*j + 32, c[j][2]);
+      _mm_storeu_ps(dst + 4*j + 48, c[j][3]);
+    }
+  }
+
+  ComposeTRSScalar(in + k, out + 16*k, count - k);
+}
+
+#undef GLOO_SPLAT
+
+// =========== AVX KERNELS ========================================================================
+// Only the kernels that map naturally to 8 lanes have an AVX version (two matrix columns or two
+// vec4 per register, 8 SoA points). The AVX table reuses the SSE kernels for the rest.
+
+#define GLOO_SPLAT256(v, i) _mm256_shuffle_ps((v), (v), _MM_SHUFFLE(i, i, i, i))
+
+// Loads a 4-float column into both 128-bit lanes.
+#define GLOO_DUPLICATE256(ptr) \
+  _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(ptr)), _mm_loadu_ps(ptr), 1)
+
+GLOO_TARGET_AVX
+void MultiplyAVX(const float* a, const float* b, float* out, size_t count)
+{
+  for (size_t k = 0; k < count; k++, a += 16, b += 16, out += 16)
+  {
+    const __m256 a0 = GLOO_DUPLICATE256(a + 0);
+    const __m256 a1 = GLOO_DUPLICATE256(a + 4);
+    const __m256 a2 = GLOO_DUPLICATE256(a + 8);
+    const __m256 a3 = GLOO_DUPLICATE256(a + 12);
+
+    // Columns (0, 1) and then (2, 3) of b, one per lane.
+    for (int j = 0; j < 2; j++)
+    {
+      const __m256 bj = _mm256_loadu_ps(b + 8*j);
+      __m256 r = _mm256_mul_ps(a0, GLOO_SPLAT256(bj, 0));
+      r = _mm256_add_ps(r, _mm256_mul_ps(a1, GLOO_SPLAT256(bj, 1)));
+      r = _mm256_add_ps(r, _mm256_mul_ps(a2, GLOO_SPLAT256(bj, 2)));
+      r = _mm256_add_ps(r, _mm256_mul_ps(a3, GLOO_SPLAT256(bj, 3)));
+      _mm256_storeu_ps(out + 8*j, r);
+    }
+  }
+}
+
+GLOO_TARGET_AVX
+void MultiplySharedAVX(const float* m, const float* b, float* out, size_t count)
+{
+  const __m256 a0 = GLOO_DUPLICATE256(m + 0);
+  const __m256 a1 = GLOO_DUPLICATE256(m + 4);
+  const __m256 a2 = GLOO_DUPLICATE256(m + 8);
+  const __m256 a3 = GLOO_DUPLICATE256(m + 12);
+
+  // A mat4 array is just an array of columns here (8 floats = 2 columns per iteration).
+  const size_t numColumnPairs = 2 * count;
+  for (size_t k = 0; k < numColumnPairs; k++)
+  {
+    const __m256 bk = _mm256_loadu_ps(b + 8*k);
+    __m256 r = _mm256_mul_ps(a0, GLOO_SPLAT256(bk, 0));
+    r = _mm256_add_ps(r, _mm256_mul_ps(a1, GLOO_SPLAT256(bk, 1)));
+    r = _mm256_add_ps(r, _mm256_mul_ps(a2, GLOO_SPLAT256(bk, 2)));
+    r = _mm256_add_ps(r, _mm256_mul_ps(a3, GLOO_SPLAT256(bk, 3)));
+    _mm256_storeu_ps(out + 8*k, r);
+  }
+}
+
+GLOO_TARGET_AVX
+void Points4AVX(const float* m, const float* in, float* out, size_t count)
+{
+  const __m256 c0 = GLOO_DUPLICATE256(m + 0);
+  const __m256 c1 = GLOO_DUPLICATE256(m + 4);
+  const __m256 c2 = GLOO_DUPLICATE256(m + 8);
+  const __m256 c3 = GLOO_DUPLICATE256(m + 12);
+
+  size_t k = 0;
+  for (; k + 2 <= count; k += 2)
+  {
+    const __m256 p = _mm256_loadu_ps(in + 4*k);
+    __m256 r = _mm256_mul_ps(c0, GLOO_SPLAT256(p, 0));
+    r = _mm256_add_ps(r, _mm256_mul_ps(c1, GLOO_SPLAT256(p, 1)));
+    r = _mm256_add_ps(r, _mm256_mul_ps(c2, GLOO_SPLAT256(p, 2)));
+    r = _mm256_add_ps(r, _mm256_mul_ps(c3, GLOO_SPLAT256(p, 3)));
+    _mm256_storeu_ps(out + 4*k, r);
+  }
+
+  Points4Scalar(m, in + 4*k, out + 4*k, count - k);
+}
+
+GLOO_TARGET_AVX
+void PointsSoAAVX(const float* m, const float* x, const float* y, const float* z,
+                  float* outX, float* outY, float* outZ, size_t count)
+{
+  const __m256 m00 = _mm256_set1_ps(m[0]),  m01 = _mm256_set1_ps(m[1]),  m02 = _mm256_set1_ps(m[2]);
+  const __m256 m10 = _mm256_set1_ps(m[4]),  m11 = _mm256_set1_ps(m[5]),  m12 = _mm256_set1_ps(m[6]);
+  const __m256 m20 = _mm256_set1_ps(m[8]),  m21 = _mm256_set1_ps(m[9]),  m22 = _mm256_set1_ps(m[10]);
+  const __m256 m30 = _mm256_set1_ps(m[12]), m31 = _mm256_set1_ps(m[13]), m32 = _mm256_set1_ps(m[14]);
+
+  size_t k = 0;
+  for (; k + 8 <= count; k += 8)
+  {
+    const __m256 X = _mm256_loadu_ps(x + k);
+    const __m256 Y = _mm256_loadu_ps(y + k);
+    const __m256 Z = _mm256_loadu_ps(z + k);
+
+    _mm256_storeu_ps(outX + k, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(X, m00), _mm256_mul_ps(Y, m10)),
+                                             _mm256_add_ps(_mm256_mul_ps(Z, m20), m30)));
+    _mm256_storeu_ps(outY + k, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(X, m01), _mm256_mul_ps(Y, m11)),
+                                             _mm256_add_ps(_mm256_mul_ps(Z, m21), m31)));
+    _mm256_storeu_ps(outZ + k, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(X, m02), _mm256_mul_ps(Y, m12)),
+                                             _mm256_add_ps(_mm256_mul_ps(Z, m22), m32)));
+  }
+
+  PointsSoAScalar(m, x + k, y + k, z + k, outX + k, outY + k, outZ + k, count - k);
+}
+
+#undef GLOO_SPLAT256
+#undef GLOO_DUPLICATE256
+
+#endif  // GLOO_BATCH_MATH_X86
+
+// =========== DISPATCH ===========================================================================
+
+KernelTable MakeTable(BatchKernel kernel)
+{
+  KernelTable table =
+  {
+    kScalarKernel,
+    MultiplyScalar, MultiplySharedScalar,
+    Transform3Scalar<true>, Transform3Scalar<false>, Points4Scalar, PointsSoAScalar,
+    InvertAffineScalar,
+    AABBsSharedScalar, AABBsScalar,
+    ComposeTRSScalar,
+  };
+
+#ifdef GLOO_BATCH_MATH_X86
+  if (kernel >= kSSEKernel)
+  {
+    table.mKernel         = kSSEKernel;
+    table.mMultiply       = MultiplySSE;
+    table.mMultiplyShared = MultiplySharedSSE;
+    table.mPoints3        = Transform3SSE<true>;
+    table.mVectors3       = Transform3SSE<false>;
+    table.mPoints4        = Points4SSE;
+    table.mPointsSoA      = PointsSoASSE;
+    table.mInvertAffine   = InvertAffineSSE;
+    table.mAABBsShared    = AABBsSharedSSE;
+    table.mAABBs          = AABBsSSE;
+    table.mComposeTRS     = ComposeTRSSSE;
+  }
+
+  if (kernel >= kAVXKernel)
+  {
+    table.mKernel         = kAVXKernel;
+    table.mMultiply       = MultiplyAVX;
+    table.mMultiplyShared = MultiplySharedAVX;
+    table.mPoints4        = Points4AVX;
+    table.mPointsSoA      = PointsSoAAVX;
+  }
+#else
+  (void) kernel;
+#endif
+
+  return table;
+}
+
+KernelTable & GetTable()
+{
+  static KernelTable sTable = MakeTable(BatchMath::GetSupportedKernel());
+  return sTable;
+}
+
+// Plain float views of glm/AABB arrays (pointers are not dereferenced, so empty arrays may be null).
+template <class T>
+inline const float* Floats(const T* ptr) { return reinterpret_cast<const float*>(ptr); }
+
+template <class T>
+inline float* Floats(T* ptr) { return reinterpret_cast<float*>(ptr); }
+
+}  // namespace.
+
+void BatchMath::MultiplyMatrices(const glm::mat4* a, const glm::mat4* b,
+                                 glm::mat4* out, size_t count)
+{
+  GetTable().mMultiply(Floats(a), Floats(b), Floats(out), count);
+}
+
+void BatchMath::MultiplyMatrices(const glm::mat4 & m, const glm::mat4* b,
+                                 glm::mat4* out, size_t count)
+{
+  GetTable().mMultiplyShared(Floats(&m), Floats(b), Floats(out), count);
+}
+
+void BatchMath::TransformPoints(const glm::mat4 & m, const glm::vec3* in,
+                                glm::vec3* out, size_t count)
+{
+  GetTable().mPoints3(Floats(&m), Floats(in), Floats(out), count);
+}
+
+void BatchMath::TransformPoints(const glm::mat4 & m, const glm::vec4* in,
+                                glm::vec4* out, size_t count)
+{
+  GetTable().mPoints4(Floats(&m), Floats(in), Floats(out), count);
+}
+
+void BatchMath::TransformPoints(const glm::mat4 & m,
+                                const float* x, const float* y, const float* z,
+                                float* outX, float* outY, float* outZ, size_t count)
+{
+  GetTable().mPointsSoA(Floats(&m), x, y, z, outX, outY, outZ, count);
+}
+
+void BatchMath::TransformVectors(const glm::mat4 & m, const glm::vec3* in,
+                                 glm::vec3* out, size_t count)
+{
+  GetTable().mVectors3(Floats(&m), Floats(in), Floats(out), count);
+}
+
+void BatchMath::InvertAffine(const glm::mat4* in, glm::mat4* out, size_t count)
+{
+  GetTable().mInvertAffine(Floats(in), Floats(out), count);
+}
+
+void BatchMath::TransformAABBs(const glm::mat4 & m, const AABB* in, AABB* out, size_t count)
+{
+  GetTable().mAABBsShared(Floats(&m), Floats(in), Floats(out), count);
+}
+
+void BatchMath::TransformAABBs(const glm::mat4* m, const AABB* in, AABB* out, size_t count)
+{
+  GetTable().mAABBs(Floats(m), Floats(in), Floats(out), count);
+}
+
+void BatchMath::ComposeTRS(const TRS* in, glm::mat4* out, size_t count)
+{
+  GetTable().mComposeTRS(in, Floats(out), count);
+}
+
+BatchKernel BatchMath::GetKernel()
+{
+  return GetTable().mKernel;
+}
+
+const char* BatchMath::GetKernelName()
+{
+  switch (GetTable().mKernel)
+  {
+    case kAVXKernel: return "AVX";
+    case kSSEKernel: return "SSE";
+    default:         return "Scalar";
+  }
+}
+
+BatchKernel BatchMath::GetSupportedKernel()
+{
+#if defined(GLOO_BATCH_MATH_X86) && (defined(__GNUC__) || defined(__clang__))
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx"))   // Also checks that the OS saves the YMM registers.
+    return kAVXKernel;
+  if (__builtin_cpu_supports("sse2"))
+    return kSSEKernel;
+#elif defined(GLOO_BATCH_MATH_X86) && defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 1);
+  const bool osxsave = (info[2] & (1 << 27)) != 0;
+  const bool avx     = (info[2] & (1 << 28)) != 0;
+  if (osxsave && avx && (_xgetbv(0) & 0x6) == 0x6)
+    return kAVXKernel;
+  if (info[3] & (1 << 26))
+    return kSSEKernel;
+#endif
+  return kScalarKernel;
+}
+
+bool BatchMath::ForceKernel(BatchKernel kernel)
+{
+  if (kernel > BatchMath::GetSupportedKernel())
+    return false;
+
+  GetTable() = MakeTable(kernel);
+  return true;
+}
+
+}  // namespace gloo.
@@ -0,0 +1,158 @@
+// + ======================================== +
+// |         gl-oo-interface library          |
+// |            Module: GLOO Tool.            |
+// |        Author: Rodrigo Castiel, 2016.    |
+// + ======================================== +
+//
+// gloo::BatchMath provides batched matrix kernels for transform hierarchies, culling and
+// skinning-like workloads, where thousands of matrices/points are processed per frame.
+//
+// Every kernel has a scalar fallback plus SSE (4-wide) and AVX (8-wide) versions. The best
+// implementation supported by the running CPU is selected once, at the first call (runtime
+// dispatch), so the library does not need to be compiled with -mavx.
+//
+// Supported operations:
+//  1. MultiplyMatrices:      out[i] = a[i] * b[i]   or   out[i] = m * b[i].
+//  2. TransformPoints:       out[i] = m * vec4(p[i], 1)   (AoS vec3/vec4 or SoA x/y/z).
+//  3. TransformVectors:      out[i] = m * vec4(v[i], 0).
+//  4. InvertAffine:          out[i] = inverse(a[i]), for affine matrices (last row 0 0 0 1).
+//  5. TransformAABBs:        out[i] = bounding box of (m * box[i])   (m affine).
+//  6. ComposeTRS:            out[i] = T[i] * R[i] * S[i]   (see gloo::TRS).
+//
+// Buffers may be AoS (glm::mat4, glm::vec3, AABB arrays) or SoA (separate float arrays).
+// Any alignment is accepted, but 16/32-byte aligned buffers are faster on older CPUs. Use
+// gloo::AlignedAllocator to obtain aligned storage from std::vector:
+//   std::vector<glm::mat4, AlignedAllocator<glm::mat4, 32>> worlds(n);
+//   BatchMath::MultiplyMatrices(parents.data(), locals.data(), worlds.data(), n);
+//
+// Input and output arrays may alias only if they are exactly the same array.
+// ForceKernel() may be used to compare implementations (debugging and benchmarking).
+
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+#include "trs.h"
+
+namespace gloo
+{
+
+enum BatchKernel
+{
+  kScalarKernel = 0,
+  kSSEKernel,
+  kAVXKernel,
+};
+
+class BatchMath
+{
+public:
+  // out[i] = a[i] * b[i], for i in [0, count).
+  static void MultiplyMatrices(const glm::mat4* a, const glm::mat4* b,
+                               glm::mat4* out, size_t count);
+
+  // out[i] = m * b[i] (e.g. viewProj * model[i]).
+  static void MultiplyMatrices(const glm::mat4 & m, const glm::mat4* b,
+                               glm::mat4* out, size_t count);
+
+  // Points (w = 1). The result is not divided by w, so m is expected to be affine.
+  static void TransformPoints(const glm::mat4 & m, const glm::vec3* in,
+                              glm::vec3* out, size_t count);
+
+  // Homogeneous points (full 4x4 product, no division).
+  static void TransformPoints(const glm::mat4 & m, const glm::vec4* in,
+                              glm::vec4* out, size_t count);
+
+  // SoA points (w = 1): (outX[i], outY[i], outZ[i]) = m * (x[i], y[i], z[i], 1).
+  static void TransformPoints(const glm::mat4 & m,
+                              const float* x, const float* y, const float* z,
+                              float* outX, float* outY, float* outZ, size_t count);
+
+  // Directions (w = 0), i.e. only the 3x3 block of m is applied.
+  static void TransformVectors(const glm::mat4 & m, const glm::vec3* in,
+                               glm::vec3* out, size_t count);
+
+  // Inverts affine matrices. Singular matrices produce non-finite entries.
+  static void InvertAffine(const glm::mat4* in, glm::mat4* out, size_t count);
+
+  // Bounding boxes of affinely transformed boxes (Arvo's method).
+  static void TransformAABBs(const glm::mat4 & m, const AABB* in, AABB* out, size_t count);
+
+  // Same as above with a different matrix per box: out[i] = bounds(m[i] * in[i]).
+  static void TransformAABBs(const glm::mat4* m, const AABB* in, AABB* out, size_t count);
+
+  // Matrices of translation-rotation-scale transforms: out[i] = in[i].ToMatrix().
+  static void ComposeTRS(const TRS* in, glm::mat4* out, size_t count);
+
+  // Kernel currently in use (the best one supported by the CPU unless forced).
+  static BatchKernel GetKernel();
+  static const char* GetKernelName();
+
+  // Returns the best kernel supported by the CPU.
+  static BatchKernel GetSupportedKernel();
+
+  // Forces a given kernel. Returns false (and keeps the current one) if it is unsupported.
+  static bool ForceKernel(BatchKernel kernel);
+};
+
+// Minimal C++11 allocator returning memory aligned to 'Alignment' bytes (power of two).
+template <class T, size_t Alignment = 32>
+class AlignedAllocator
+{
+public:
+  typedef T value_type;
+
+  template <class U>
+  struct rebind { typedef AlignedAllocator<U, Alignment> other; };
+
+  AlignedAllocator() { }
+
+  template <class U>
+  AlignedAllocator(const AlignedAllocator<U, Alignment> &) { }
+
+  T* allocate(size_t n);
+  void deallocate(T* p, size_t);
+
+  template <class U>
+  bool operator==(const AlignedAllocator<U, Alignment> &) const { return true;  }
+
+  template <class U>
+  bool operator!=(const AlignedAllocator<U, Alignment> &) const { return false; }
+};
+
+// =========== IMPLEMENTATION OF INLINE METHODS ===================================================
+
+template <class T, size_t Alignment>
+inline
+T* AlignedAllocator<T, Alignment>::allocate(size_t n)
+{
+  void* ptr = nullptr;
+#ifdef _WIN32
+  ptr = _aligned_malloc(n * sizeof(T), Alignment);
+#else
+  if (posix_memalign(&ptr, Alignment, n * sizeof(T)) != 0)
+    ptr = nullptr;
+#endif
+
+  if (!ptr)
+    throw std::bad_alloc();
+
+  return static_cast<T*>(ptr);
+}
+
+template <class T, size_t Alignment>
+inline
+void AlignedAllocator<T, Alignment>::deallocate(T* p, size_t)
+{
+#ifdef _WIN32
+  _aligned_free(p);
+#else
+  free(p);
+#endif
+}
+
+}  // namespace gloo.
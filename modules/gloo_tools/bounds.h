@@ -0,0 +1,195 @@
+// + ======================================== +
+// |         gl-oo-interface library          |
+// |            Module: GLOO Tool.            |
+// |        Author: Rodrigo Castiel, 2016.    |
+// + ======================================== +
+//
+// Bounding volumes used for culling, picking and spatial data structures.
+//
+//  -> AABB: axis-aligned bounding box, stored as [mMin, mMax].
+//  -> BoundingSphere: center and radius.
+//
+// An AABB is "empty" after construction (mMin = +inf, mMax = -inf), so it can be
+// grown with Expand() and Merge() right away:
+//   AABB box;
+//   box.Expand(p0);
+//   box.Expand(p1);
+//
+// To transform many boxes at once, use gloo::BatchMath::TransformAABBs().
+
+#pragma once
+
+#include <limits>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+namespace gloo
+{
+
+struct AABB
+{
+  glm::vec3 mMin {  std::numeric_limits<float>::max() };
+  glm::vec3 mMax { -std::numeric_limits<float>::max() };
+
+  AABB() { }
+  AABB(const glm::vec3 & minCorner, const glm::vec3 & maxCorner)
+  : mMin(minCorner), mMax(maxCorner) { }
+
+  bool IsEmpty() const;
+
+  glm::vec3 GetCenter()  const { return 0.5f * (mMin + mMax); }
+  glm::vec3 GetExtents() const { return 0.5f * (mMax - mMin); }  // Half sizes.
+  glm::vec3 GetSize()    const { return mMax - mMin; }
+
+  // Surface area (used as a cost metric by the spatial data structures).
+  float GetSurfaceArea() const;
+
+  void Expand(const glm::vec3 & p);
+  void Expand(float margin);
+  void Merge(const AABB & other);
+
+  bool Contains(const glm::vec3 & p) const;
+  bool Contains(const AABB & other) const;
+  bool Overlaps(const AABB & other) const;
+
+  // Returns the smallest box containing both a and b.
+  static AABB Union(const AABB & a, const AABB & b);
+
+  // Builds the bounding box of 'numPoints' points stored as xyz triples (e.g. positions of
+  // a mesh group on client memory). 'stride' is the number of floats between consecutive
+  // points, e.g. 8 for interleaved (P N T) vertices.
+  static AABB FromPoints(const float* xyz, int numPoints, int stride = 3);
+
+  // Transforms the box by an affine matrix and returns its new bounding box (Arvo's method).
+  AABB Transformed(const glm::mat4 & m) const;
+};
+
+struct BoundingSphere
+{
+  glm::vec3 mCenter { 0.0f };
+  float mRadius { 0.0f };
+
+  BoundingSphere() { }
+  BoundingSphere(const glm::vec3 & center, float radius)
+  : mCenter(center), mRadius(radius) { }
+
+  bool Overlaps(const AABB & box) const;
+
+  // Smallest sphere enclosing box.
+  static BoundingSphere FromAABB(const AABB & box);
+};
+
+// =========== IMPLEMENTATION OF INLINE METHODS ===================================================
+
+inline
+bool AABB::IsEmpty() const
+{
+  return (mMin[0] > mMax[0]) || (mMin[1] > mMax[1]) || (mMin[2] > mMax[2]);
+}
+
+inline
+float AABB::GetSurfaceArea() const
+{
+  glm::vec3 d = mMax - mMin;
+  return 2.0f * (d[0]*d[1] + d[1]*d[2] + d[2]*d[0]);
+}
+
+inline
+void AABB::Expand(const glm::vec3 & p)
+{
+  mMin = glm::min(mMin, p);
+  mMax = glm::max(mMax, p);
+}
+
+inline
+void AABB::Expand(float margin)
+{
+  mMin -= glm::vec3(margin);
+  mMax += glm::vec3(margin);
+}
+
+inline
+void AABB::Merge(const AABB & other)
+{
+  mMin = glm::min(mMin, other.mMin);
+  mMax = glm::max(mMax, other.mMax);
+}
+
+inline
+bool AABB::Contains(const glm::vec3 & p) const
+{
+  return (p[0] >= mMin[0]) && (p[0] <= mMax[0]) &&
+         (p[1] >= mMin[1]) && (p[1] <= mMax[1]) &&
+         (p[2] >= mMin[2]) && (p[2] <= mMax[2]);
+}
+
+inline
+bool AABB::Contains(const AABB & other) const
+{
+  return (other.mMin[0] >= mMin[0]) && (other.mMax[0] <= mMax[0]) &&
+         (other.mMin[1] >= mMin[1]) && (other.mMax[1] <= mMax[1]) &&
+         (other.mMin[2] >= mMin[2]) && (other.mMax[2] <= mMax[2]);
+}
+
+inline
+bool AABB::Overlaps(const AABB & other) const
+{
+  return (mMin[0] <= other.mMax[0]) && (mMax[0] >= other.mMin[0]) &&
+         (mMin[1] <= other.mMax[1]) && (mMax[1] >= other.mMin[1]) &&
+         (mMin[2] <= other.mMax[2]) && (mMax[2] >= other.mMin[2]);
+}
+
+inline
+AABB AABB::Union(const AABB & a, const AABB & b)
+{
+  return AABB(glm::min(a.mMin, b.mMin), glm::max(a.mMax, b.mMax));
+}
+
+inline
+AABB AABB::FromPoints(const float* xyz, int numPoints, int stride)
+{
+  AABB box;
+  for (int i = 0; i < numPoints; i++)
+  {
+    const float* p = xyz + i * stride;
+    box.Expand(glm::vec3(p[0], p[1], p[2]));
+  }
+
+  return box;
+}
+
+inline
+AABB AABB::Transformed(const glm::mat4 & m) const
+{
+  // c' = M c,  e' = |A| e  (A is the 3x3 block of M).
+  const glm::vec3 c = GetCenter();
+  const glm::vec3 e = GetExtents();
+
+  glm::vec3 center(m[3]);
+  glm::vec3 extents(0.0f);
+  for (int j = 0; j < 3; j++)
+  {
+    const glm::vec3 column(m[j]);
+    center  += column * c[j];
+    extents += glm::abs(column) * e[j];
+  }
+
+  return AABB(center - extents, center + extents);
+}
+
+inline
+bool BoundingSphere::Overlaps(const AABB & box) const
+{
+  // Squared distance from the center to the closest point in the box.
+  const glm::vec3 closest = glm::clamp(mCenter, box.mMin, box.mMax);
+  const glm::vec3 d = mCenter - closest;
+  return glm::dot(d, d) <= mRadius * mRadius;
+}
+
+inline
+BoundingSphere BoundingSphere::FromAABB(const AABB & box)
+{
+  return BoundingSphere(box.GetCenter(), glm::length(box.GetExtents()));
+}
+
+}  // namespace gloo.
@@ -1,11 +1,33 @@
 #include "camera.h"
 
+#include <cmath>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "batch_math.h"
+
 namespace gloo
 {
 
 void Camera::SetOnReshape(int xo, int yo, int w, int h)
 {
   mProjParameters.mAspect = static_cast<float>(w - xo) / static_cast<float>(h - yo);
+  Camera::BuildProjection();
+}
+
+void Camera::SetOnRendering()
+{
+  if (mProjDirty)
+    Camera::BuildProjection();
+
+  // Rebuild V only if the camera moved (or if V was modified through ViewTransform()).
+  if (mViewDirty || (mView.GetVersion() != mBuiltViewVersion))
+    Camera::BuildView();
+
+  Camera::GetCache();  // Refresh VP and the frustum once, before rendering.
+}
+
+void Camera::BuildProjection()
+{
   mProj.LoadIdentity();
 
   const float & mFovy = mProjParameters.mFovy;
@@ -14,50 +36,104 @@ void Camera::SetOnReshape(int xo, int yo, int w, int h)
   const float & mAspect = mProjParameters.mAspect;
 
   mProj.Perspective(mFovy, mAspect, mNearZ, mFarZ);
+  mProjDirty = false;
 }
 
-void Camera::SetOnRendering()
+void Camera::BuildView()
 {
-  mView.LoadIdentity();
-
   // Set transform according to position, orientation and scales.
   // Since we are setting the camera, we need to do the inverse 
   // transform.
 
-  // V =  (S R T)^-1 = T^-1 R^-1 S^-1.
-  mView.Translate(-mPos);
-  mView.Rotate(-mRot[2], 0, 0, 1);
-  mView.Rotate(-mRot[0], 1, 0, 0);
-  mView.Rotate(-mRot[1], 0, 1, 0);
-  mView.Scale(mScale);
+  // V = T(-p) * R^-1 * S, with R^-1 = Rz(-rz) Rx(-rx) Ry(-ry). Built as one TRS, instead of
+  // a chain of 4x4 products (the inverse comes for free as well).
+  mView.LoadTRS(TRS(-mPos, glm::conjugate(mOrientation), mScale));
+
+  mBuiltViewVersion = mView.GetVersion();
+  mViewDirty = false;
+}
+
+glm::quat Camera::ComputeOrientation(const glm::vec3 & rot)
+{
+  // R = Ry(ry) * Rx(rx) * Rz(rz).
+  return glm::angleAxis(rot[1], glm::vec3(0, 1, 0)) *
+         glm::angleAxis(rot[0], glm::vec3(1, 0, 0)) *
+         glm::angleAxis(rot[2], glm::vec3(0, 0, 1));
 }
 
-void Camera::SetUniformViewProj(unsigned uniformLoc)
+glm::vec3 Camera::ComputeEulerAngles(const glm::quat & q)
 {
-  // Compute MVP = P * V * M, where M is identity here.
-  mProj.PushMatrix();  // Save P.
-  mProj.Combine(mView);          // P = P * V.
-  mProj.SetUniform(uniformLoc);  // Upload P.
-  mProj.PopMatrix();   // Restore P.
+  // Entries of R = Ry(ry) * Rx(rx) * Rz(rz) (r_ij = row i, column j):
+  //   r02 = sin(ry) cos(rx),  r22 = cos(ry) cos(rx),  r12 = -sin(rx),
+  //   r10 = cos(rx) sin(rz),  r11 = cos(rx) cos(rz).
+  const float r02 = 2.0f * (q.x * q.z + q.w * q.y);
+  const float r22 = 1.0f - 2.0f * (q.x * q.x + q.y * q.y);
+  const float r12 = 2.0f * (q.y * q.z - q.w * q.x);
+  const float r10 = 2.0f * (q.x * q.y + q.w * q.z);
+  const float r11 = 1.0f - 2.0f * (q.x * q.x + q.z * q.z);
+
+  return glm::vec3(std::asin(glm::clamp(-r12, -1.0f, 1.0f)),
+                   std::atan2(r02, r22),
+                   std::atan2(r10, r11));
 }
 
-void Camera::SetUniformModelView(unsigned uniformLoc, const Transform & model)
+void Camera::UpdateCache() const
+{
+  mCache.mView = mView.GetMatrix();
+  mCache.mProj = mProj.GetMatrix();
+  mCache.mViewProj = mCache.mProj * mCache.mView;
+  mCache.mFrustum.SetFromMatrix(mCache.mViewProj);
+
+  mCache.mViewVersion = mView.GetVersion();
+  mCache.mProjVersion = mProj.GetVersion();
+  mCache.mInverseValid = false;
+  mCache.mValid = true;
+}
+
+const glm::mat4 & Camera::GetInverseViewProjMatrix() const
+{
+  const Cache & cache = Camera::GetCache();
+  if (!cache.mInverseValid)
+  {
+    mCache.mInverseViewProj = glm::inverse(cache.mViewProj);
+    mCache.mInverseValid = true;
+  }
+
+  return mCache.mInverseViewProj;
+}
+
+void Camera::SetUniformViewProj(unsigned uniformLoc) const
+{
+  glUniformMatrix4fv(uniformLoc, 1, GL_FALSE, glm::value_ptr(Camera::GetViewProjMatrix()));
+}
+
+void Camera::SetUniformModelView(unsigned uniformLoc, const Transform & model) const
 {
   // Compute MV = V * M (combining with input transform)
-  mView.PushMatrix();  // Save V.
-  mView.LeftCombine(model);      // Compute M * V.
-  mView.SetUniform(uniformLoc);  // Upload it.
-  mView.PopMatrix();  // Restore P.
+  const glm::mat4 MV = Camera::GetViewMatrix() * model.GetMatrix();
+  glUniformMatrix4fv(uniformLoc, 1, GL_FALSE, glm::value_ptr(MV));
+}
+
+void Camera::SetUniformModelViewProj(unsigned uniformLoc, const Transform & model) const
+{
+  Camera::SetUniformModelViewProj(uniformLoc, model.GetMatrix());
+}
+
+void Camera::SetUniformModelViewProj(unsigned uniformLoc, const glm::mat4 & model) const
+{
+  // Compute MVP = (P * V) * M, with P * V cached.
+  const glm::mat4 MVP = Camera::GetViewProjMatrix() * model;
+  glUniformMatrix4fv(uniformLoc, 1, GL_FALSE, glm::value_ptr(MVP));
 }
 
-void Camera::SetUniformModelViewProj(unsigned uniformLoc, const Transform & model)
+void Camera::ComputeModelViewProj(const glm::mat4* models, glm::mat4* out, size_t count) const
 {
-  // Compute MVP = P * V * M.
-  mProj.PushMatrix();  // Save P.
-  mProj.Combine(mView);          // P = P * V.
-  mProj.Combine(model);          // P = P * M.
-  mProj.SetUniform(uniformLoc);  // Upload P.
-  mProj.PopMatrix();   // Restore P.
+  BatchMath::MultiplyMatrices(Camera::GetViewProjMatrix(), models, out, count);
+}
+
+void Camera::ComputeModelView(const glm::mat4* models, glm::mat4* out, size_t count) const
+{
+  BatchMath::MultiplyMatrices(Camera::GetViewMatrix(), models, out, count);
 }
 
 glm::vec3 Camera::ComputeRayAt(float x_v, float y_v, float w, float h) const
@@ -71,12 +147,24 @@ glm::vec3 Camera::ComputeRayAt(float x_v, float y_v, float w, float h) const
   float xp = ((x_v / w) * (2*x_max)) - x_max;
   float yp = ((y_v / h) * (2*y_max)) - y_max; 
 
-  const glm::mat4& V = mView.GetMatrix();
-  const glm::mat4& P = mProj.GetMatrix();
-
-  glm::vec4 ray = glm::inverse(P*V) * glm::vec4(xp, yp, 1.0, 1.0);
+  glm::vec4 ray = Camera::GetInverseViewProjMatrix() * glm::vec4(xp, yp, 1.0, 1.0);
 
   return glm::vec3(ray[0], ray[1], ray[2]);
 }
 
+Ray Camera::ComputePickingRay(float x_v, float y_v, float w, float h) const
+{
+  // Viewport to normalized device coordinates.
+  const float xp = 2.0f * (x_v / w) - 1.0f;
+  const float yp = 2.0f * ((h - y_v) / h) - 1.0f;
+
+  const glm::mat4 & inverseViewProj = Camera::GetInverseViewProjMatrix();
+  glm::vec4 nearPoint = inverseViewProj * glm::vec4(xp, yp, -1.0f, 1.0f);
+  glm::vec4 farPoint  = inverseViewProj * glm::vec4(xp, yp,  1.0f, 1.0f);
+  nearPoint /= nearPoint[3];
+  farPoint  /= farPoint[3];
+
+  return Ray(glm::vec3(nearPoint), glm::vec3(farPoint - nearPoint));
+}
+
 }  // namespace gloo.
\ No newline at end of file
@@ -26,14 +26,31 @@
 //
 //  NOTE2: by calling getter methods for Transforms, you'll get
 //  the transform set from the last rendering.
+//
+//  NOTE3: the camera only rebuilds V (and P) when position, rotation, scale or
+//  projection parameters change. V, P, P * V, (P * V)^-1 and the frustum planes
+//  are cached, so they cost nothing for the remaining calls in the frame:
+//    camera->GetViewProjMatrix();          // P * V.
+//    camera->GetInverseViewProjMatrix();   // (P * V)^-1 (computed on demand).
+//    camera->GetFrustum();                 // World-space frustum planes.
+//  Edits made directly through ViewTransform()/ProjTransform() are detected as well.
+//  For many objects, ComputeModelViewProj() computes P * V * M[i] in batch.
+//
+//  NOTE4: the orientation is stored as a quaternion. The Euler angles of SetRotation()/Rotate()
+//  are converted once (R = Ry * Rx * Rz), and V is built as a single TRS. For free-look or
+//  trackball cameras, RotateLocal()/SetOrientation() avoid Euler angles (and gimbal lock).
 //  ---------------------------------------------------------------------------
 
 #pragma once
 
+#include <cstddef>
 #include <glm/glm.hpp>
 
 #include "gloo/gl_header.h"
 #include "transform.h"
+#include "trs.h"
+#include "frustum.h"
+#include "ray.h"
 
 namespace gloo
 {
@@ -75,9 +92,14 @@ public:
   // Please call SetOnRendering() before setting uniforms.
   void SetUniformViewMatrix(unsigned uniformLoc) const;  // Just view matrix.
   void SetUniformProjMatrix(unsigned uniformLoc) const;  // Just projection matrix.
-  void SetUniformViewProj(unsigned uniformLoc);    // Proj * View.
-  void SetUniformModelView(unsigned uniformLoc, const Transform & model);      // View * Model.
-  void SetUniformModelViewProj(unsigned uniformLoc, const Transform & model);  // Proj * View * Model.
+  void SetUniformViewProj(unsigned uniformLoc) const;    // Proj * View.
+  void SetUniformModelView(unsigned uniformLoc, const Transform & model) const;      // View * Model.
+  void SetUniformModelViewProj(unsigned uniformLoc, const Transform & model) const;  // Proj * View * Model.
+  void SetUniformModelViewProj(unsigned uniformLoc, const glm::mat4 & model) const;
+
+  // Batch versions: out[i] = (Proj * View) * models[i]  and  out[i] = View * models[i].
+  void ComputeModelViewProj(const glm::mat4* models, glm::mat4* out, size_t count) const;
+  void ComputeModelView(const glm::mat4* models, glm::mat4* out, size_t count) const;
 
   // Animate camera center, orientation and scale -> glm::vec3.
   void Translate(const glm::vec3 & dPos);
@@ -92,21 +114,29 @@ public:
   // 2. Setter methods -> change the internal parameters.
 
   // Set camera propeties -> glm::vec3.
-  inline void SetPosition(const glm::vec3 & pos) { mPos = pos; }       // pos = [xc, yc, zc]'
-  inline void SetRotation(const glm::vec3 & rot) { mRot = rot; }       // rot = [rx, ry, rz]'
-  inline void SetScale(const glm::vec3 & scales) { mScale = scales; }  // scales = [sx, sy, sz]'
+  inline void SetPosition(const glm::vec3 & pos) { mPos = pos; mViewDirty = true; }       // pos = [xc, yc, zc]'
+  inline void SetRotation(const glm::vec3 & rot);                                         // rot = [rx, ry, rz]'
+  inline void SetScale(const glm::vec3 & scales) { mScale = scales; mViewDirty = true; }  // scales = [sx, sy, sz]'
 
   // Set camera propeties -> 3 floats.
   void SetPosition(float xc, float yc, float zc);
   void SetRotation(float rx, float ry, float rz);
   void SetScale(float sx, float sy, float sz);
 
+  // Orientation (camera to world) as a unit quaternion. GetRotation() then returns equivalent
+  // Euler angles.
+  void SetOrientation(const glm::quat & orientation);
+
+  // Rotates theta radians around an axis given in camera coordinates (e.g. [0, 1, 0] = yaw).
+  void RotateLocal(float theta, const glm::vec3 & axis);
+
   // Set projection parameters.
   void SetProjectionParameters(const ProjectionParameters & projParameters);
 
   // 3. Getter methods.
   inline glm::vec3 GetPosition() const { return mPos; }
   inline glm::vec3 GetRotation() const { return mRot; }
+  inline const glm::quat & GetOrientation() const { return mOrientation; }
   inline glm::vec3 GetScale() const  { return mScale; }
 
   inline const Transform & ViewTransform() const { return mView; };
@@ -116,22 +146,67 @@ public:
   inline Transform & ProjTransform() { return mProj; };
 
   const ProjectionParameters & GetProjectionParameters() const { return mProjParameters; }
-  ProjectionParameters & GetProjectionParameters() { return mProjParameters; }
+  ProjectionParameters & GetProjectionParameters() { mProjDirty = true; return mProjParameters; }
+
+  // Cached matrices (up to date with the internal transforms).
+  const glm::mat4 & GetViewMatrix() const { return Camera::GetCache().mView; }
+  const glm::mat4 & GetProjMatrix() const { return Camera::GetCache().mProj; }
+  const glm::mat4 & GetViewProjMatrix() const { return Camera::GetCache().mViewProj; }
+  const glm::mat4 & GetInverseViewProjMatrix() const;
+
+  // World-space frustum of the current view-projection.
+  const Frustum & GetFrustum() const { return Camera::GetCache().mFrustum; }
 
   // 4. Methods for selection/intersection.
 
   // Computes the vector which goes from camera center to mouse coordinates on projection plane.
   glm::vec3 ComputeRayAt(float x_v, float y_v, float w, float h) const;
 
+  // World-space ray through the viewport point (x_v, y_v), from the near plane (t = 0) to the
+  // far plane (t = 1). Used for picking (see gloo::ScenePicker).
+  Ray ComputePickingRay(float x_v, float y_v, float w, float h) const;
+
 protected:
   glm::vec3 mPos   { 0, 0, 1 };  // Center coordinates.
   glm::vec3 mRot   { 0, 0, 0 };  // Rotation angles in x, y, z axis (orientation).
   glm::vec3 mScale { 1, 1, 1 };  // Scaling factors for x, y, z axis.
+  glm::quat mOrientation { 1, 0, 0, 0 };  // Same rotation as mRot (kept in sync).
 
   // Transform stacks.
   Transform mView;  // Specifies camera position, orientation and so on [a stack].
   Transform mProj;  // Specifies projective transform.
   ProjectionParameters mProjParameters;  // Specifies parameters of projection.
+
+  bool mViewDirty { true };   // Position, rotation or scale changed since V was built.
+  bool mProjDirty { false };  // Projection parameters changed since P was built.
+
+private:
+  // Data derived from mView and mProj, refreshed whenever their versions change.
+  struct Cache
+  {
+    bool mValid { false };
+    bool mInverseValid { false };
+    unsigned mViewVersion { 0 };
+    unsigned mProjVersion { 0 };
+    glm::mat4 mView;
+    glm::mat4 mProj;
+    glm::mat4 mViewProj;
+    glm::mat4 mInverseViewProj;
+    Frustum mFrustum;
+  };
+
+  const Cache & GetCache() const;
+  void UpdateCache() const;
+
+  void BuildProjection();  // Rebuilds mProj from mProjParameters.
+  void BuildView();        // Rebuilds mView from position, rotation and scale.
+
+  // Conversions between mRot and mOrientation.
+  static glm::quat ComputeOrientation(const glm::vec3 & rot);
+  static glm::vec3 ComputeEulerAngles(const glm::quat & orientation);
+
+  unsigned mBuiltViewVersion { 0 };  // Version of mView produced by the last rebuild.
+  mutable Cache mCache;
 };
 
 // =========== IMPLEMENTATION OF INLINE METHODS ===================================================
@@ -139,18 +214,22 @@ protected:
 inline
 void Camera::Translate(const glm::vec3 & dPos)
 {
+  mViewDirty = true;
   mPos += dPos;
 }
 
 inline
 void Camera::Rotate(const glm::vec3 & dRot)
 {
+  mViewDirty = true;
   mRot += dRot;
+  mOrientation = Camera::ComputeOrientation(mRot);
 }
 
 inline
 void Camera::Scale(const glm::vec3 & dScale)
 {
+  mViewDirty = true;
   mScale[0] *= (1.0f + dScale[0]);
   mScale[1] *= (1.0f + dScale[1]);
   mScale[2] *= (1.0f + dScale[2]);
@@ -161,6 +240,7 @@ void Camera::Scale(const glm::vec3 & dScale)
 inline
 void Camera::Translate(float dx, float dy, float dz)
 {
+  mViewDirty = true;
   mPos[0] += dx;
   mPos[1] += dy;
   mPos[2] += dz;
@@ -169,14 +249,17 @@ void Camera::Translate(float dx, float dy, float dz)
 inline
 void Camera::Rotate(float dx, float dy, float dz)
 {
+  mViewDirty = true;
   mRot[0] += dx;
   mRot[1] += dy;
   mRot[2] += dz;
+  mOrientation = Camera::ComputeOrientation(mRot);
 }
 
 inline
 void Camera::Scale(float dx, float dy, float dz)
 {
+  mViewDirty = true;
   mScale[0] *= (1.0f + dx);
   mScale[1] *= (1.0f + dy);
   mScale[2] *= (1.0f + dz);
@@ -187,6 +270,7 @@ void Camera::Scale(float dx, float dy, float dz)
 inline
 void Camera::SetPosition(float xc, float yc, float zc)
 {
+  mViewDirty = true;
   mPos[0] = xc;
   mPos[1] = yc;
   mPos[2] = zc;
@@ -195,14 +279,39 @@ void Camera::SetPosition(float xc, float yc, float zc)
 inline
 void Camera::SetRotation(float rx, float ry, float rz)
 {
+  mViewDirty = true;
   mRot[0] = rx;
   mRot[1] = ry;
   mRot[2] = rz;
+  mOrientation = Camera::ComputeOrientation(mRot);
+}
+
+inline
+void Camera::SetRotation(const glm::vec3 & rot)
+{
+  mViewDirty = true;
+  mRot = rot;
+  mOrientation = Camera::ComputeOrientation(mRot);
+}
+
+inline
+void Camera::SetOrientation(const glm::quat & orientation)
+{
+  mViewDirty = true;
+  mOrientation = glm::normalize(orientation);
+  mRot = Camera::ComputeEulerAngles(mOrientation);
+}
+
+inline
+void Camera::RotateLocal(float theta, const glm::vec3 & axis)
+{
+  Camera::SetOrientation(mOrientation * glm::angleAxis(theta, glm::normalize(axis)));
 }
 
 inline
 void Camera::SetScale(float sx, float sy, float sz)
 {
+  mViewDirty = true;
   mScale[0] = sx;
   mScale[1] = sy;
   mScale[2] = sz;
@@ -214,6 +323,20 @@ inline
 void Camera::SetProjectionParameters(const ProjectionParameters & projParameters)
 {
   mProjParameters = projParameters;
+  mProjDirty = true;
+}
+
+inline
+const Camera::Cache & Camera::GetCache() const
+{
+  if (!mCache.mValid ||
+      mCache.mViewVersion != mView.GetVersion() ||
+      mCache.mProjVersion != mProj.GetVersion())
+  {
+    Camera::UpdateCache();
+  }
+
+  return mCache;
 }
 
 inline
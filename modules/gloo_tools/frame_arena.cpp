@@ -0,0 +1,24 @@
+#include "frame_arena.h"
+
+namespace gloo
+{
+
+FrameArena::FrameArena(size_t capacity)
+: mBuffer(new char[capacity])
+, mCapacity(capacity)
+{
+
+}
+
+FrameArena::~FrameArena()
+{
+  delete [] mBuffer;
+}
+
+void FrameArena::Reset()
+{
+  mOffset = 0;
+  mFrame++;
+}
+
+}  // namespace gloo.
@@ -0,0 +1,80 @@
+// + ======================================== +
+// |         gl-oo-interface library          |
+// |            Module: GLOO Tool.            |
+// |        Author: Rodrigo Castiel, 2016.    |
+// + ======================================== +
+//
+// gloo::FrameArena is a linear (bump) allocator for short-lived, per-frame data.
+// Allocating is a pointer increment and nothing is ever freed individually: the whole
+// arena is recycled at once by Reset(), typically at the beginning of each frame.
+//
+// Usage:
+//   FrameArena arena(1 << 20);             // 1 MB, allocated once.
+//   ...
+//   arena.Reset();                         // Beginning of the frame.
+//   glm::mat4* m = arena.Allocate<glm::mat4>(n);
+//   if (!m) { /* Arena is full -- fall back to the heap. */ }
+//
+// Only trivially destructible types should be stored in the arena, since destructors
+// are never called. Memory returned by Allocate() is invalid after Reset().
+// GetFrame() is incremented by every Reset(), so clients can tell stale allocations apart.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace gloo
+{
+
+class FrameArena
+{
+public:
+  explicit FrameArena(size_t capacity);
+  ~FrameArena();
+
+  // Returns 'size' bytes aligned to 'alignment' (power of two), or nullptr if the arena is full.
+  void* Allocate(size_t size, size_t alignment = 16);
+
+  template <class T>
+  T* Allocate(size_t count) { return static_cast<T*>(FrameArena::Allocate(count * sizeof(T), alignof(T) < 16 ? 16 : alignof(T))); }
+
+  // Recycles all the memory (every previous allocation becomes invalid).
+  void Reset();
+
+  size_t GetCapacity()  const { return mCapacity; }
+  size_t GetUsedBytes() const { return mOffset;   }
+  size_t GetPeakBytes() const { return mPeak;     }  // Highest GetUsedBytes() ever reached.
+  unsigned GetFrame()   const { return mFrame;    }  // Number of resets so far.
+
+private:
+  FrameArena(const FrameArena &) = delete;
+  FrameArena & operator=(const FrameArena &) = delete;
+
+  char* mBuffer;
+  size_t mCapacity;
+  size_t mOffset { 0 };
+  size_t mPeak { 0 };
+  unsigned mFrame { 0 };
+};
+
+// =========== IMPLEMENTATION OF INLINE METHODS ===================================================
+
+inline
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+  const uintptr_t base = reinterpret_cast<uintptr_t>(mBuffer);
+  const uintptr_t start = (base + mOffset + alignment - 1) & ~(uintptr_t)(alignment - 1);
+  const size_t end = (start - base) + size;
+
+  if (end > mCapacity)
+    return nullptr;
+
+  mOffset = end;
+  if (mOffset > mPeak)
+    mPeak = mOffset;
+
+  return reinterpret_cast<void*>(start);
+}
+
+}  // namespace gloo.
@@ -0,0 +1,32 @@
+#include "frustum.h"
+
+namespace gloo
+{
+
+void Frustum::SetFromMatrix(const glm::mat4 & viewProj)
+{
+  // Rows of the matrix (glm is column-major).
+  glm::vec4 row[4];
+  for (int i = 0; i < 4; i++)
+  {
+    row[i] = glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]);
+  }
+
+  // Clip space: -w <= x, y, z <= w.
+  mPlanes[kLeftPlane]   = row[3] + row[0];
+  mPlanes[kRightPlane]  = row[3] - row[0];
+  mPlanes[kBottomPlane] = row[3] + row[1];
+  mPlanes[kTopPlane]    = row[3] - row[1];
+  mPlanes[kNearPlane]   = row[3] + row[2];
+  mPlanes[kFarPlane]    = row[3] - row[2];
+
+  for (int i = 0; i < kNumFrustumPlanes; i++)
+  {
+    glm::vec4 & plane = mPlanes[i];
+    const float length = glm::length(glm::vec3(plane));
+    if (length > 0.0f)
+      plane /= length;
+  }
+}
+
+}  // namespace gloo.
@@ -0,0 +1,161 @@
+// + ======================================== +
+// |         gl-oo-interface library          |
+// |            Module: GLOO Tool.            |
+// |        Author: Rodrigo Castiel, 2016.    |
+// + ======================================== +
+//
+// gloo::Frustum stores the 6 clipping planes of a view-projection matrix, in world
+// coordinates (or in model coordinates, if the matrix is a model-view-projection).
+//
+// Each plane is a glm::vec4 (a, b, c, d) with normalized (a, b, c) pointing inwards, so a
+// point p is inside the half-space if dot((a, b, c), p) + d >= 0.
+//
+// Usage:
+//   Frustum frustum(camera->GetViewProjMatrix());   // Or camera->GetFrustum().
+//   if (frustum.Intersects(box))
+//     renderer->Render(mesh, model, camera);
+//
+// The tests are conservative: objects near the frustum corners may be reported as visible.
+// For large batches, use gloo::FrustumCuller.
+//
+// Hierarchical structures should use Classify(), which also tells when a box is entirely
+// inside (so its whole subtree can be accepted) and keeps a mask of the planes that still
+// need to be tested for its children:
+//   unsigned planeMask = kAllFrustumPlanes;
+//   FrustumTest result = frustum.Classify(rootBox, planeMask);
+//   ... pass planeMask on to the children.
+
+#pragma once
+
+#include <cmath>
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+
+namespace gloo
+{
+
+enum FrustumPlane
+{
+  kLeftPlane = 0,
+  kRightPlane,
+  kBottomPlane,
+  kTopPlane,
+  kNearPlane,
+  kFarPlane,
+  kNumFrustumPlanes,
+};
+
+const unsigned kAllFrustumPlanes = (1u << kNumFrustumPlanes) - 1;
+
+enum FrustumTest
+{
+  kOutsideFrustum,     // Entirely outside.
+  kIntersectsFrustum,  // Crosses at least one plane (or cannot be decided cheaply).
+  kInsideFrustum,      // Entirely inside.
+};
+
+class Frustum
+{
+public:
+  // All planes are (0, 0, 0, 1) until SetFromMatrix(): everything is inside.
+  Frustum()
+  {
+    for (glm::vec4 & plane : mPlanes)
+      plane = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+  }
+
+  explicit Frustum(const glm::mat4 & viewProj) { Frustum::SetFromMatrix(viewProj); }
+
+  // Extracts the planes from a (model-)view-projection matrix (Gribb-Hartmann method).
+  void SetFromMatrix(const glm::mat4 & viewProj);
+
+  const glm::vec4 & GetPlane(int i) const { return mPlanes[i]; }
+  const glm::vec4* GetPlanes() const { return mPlanes; }
+
+  bool Contains(const glm::vec3 & p) const;
+  bool Intersects(const BoundingSphere & sphere) const;
+  bool Intersects(const AABB & box) const;
+
+  // Classifies box against the planes in planeMask (bit i = plane i). The bits of the planes
+  // that box is entirely inside of are cleared, so the children of box can skip them.
+  FrustumTest Classify(const AABB & box, unsigned & planeMask) const;
+
+private:
+  glm::vec4 mPlanes[kNumFrustumPlanes];
+};
+
+// =========== IMPLEMENTATION OF INLINE METHODS ===================================================
+
+inline
+bool Frustum::Contains(const glm::vec3 & p) const
+{
+  for (int i = 0; i < kNumFrustumPlanes; i++)
+  {
+    const glm::vec4 & plane = mPlanes[i];
+    if (plane[0]*p[0] + plane[1]*p[1] + plane[2]*p[2] + plane[3] < 0.0f)
+      return false;
+  }
+
+  return true;
+}
+
+inline
+bool Frustum::Intersects(const BoundingSphere & sphere) const
+{
+  const glm::vec3 & c = sphere.mCenter;
+  for (int i = 0; i < kNumFrustumPlanes; i++)
+  {
+    const glm::vec4 & plane = mPlanes[i];
+    if (plane[0]*c[0] + plane[1]*c[1] + plane[2]*c[2] + plane[3] < -sphere.mRadius)
+      return false;
+  }
+
+  return true;
+}
+
+inline
+bool Frustum::Intersects(const AABB & box) const
+{
+  const glm::vec3 c = box.GetCenter();
+  const glm::vec3 e = box.GetExtents();
+
+  for (int i = 0; i < kNumFrustumPlanes; i++)
+  {
+    // The box is outside if its "most inside" corner is behind the plane.
+    const glm::vec4 & plane = mPlanes[i];
+    const float d = plane[0]*c[0] + plane[1]*c[1] + plane[2]*c[2] + plane[3];
+    const float r = std::fabs(plane[0])*e[0] + std::fabs(plane[1])*e[1] + std::fabs(plane[2])*e[2];
+    if (d + r < 0.0f)
+      return false;
+  }
+
+  return true;
+}
+
+inline
+FrustumTest Frustum::Classify(const AABB & box, unsigned & planeMask) const
+{
+  const glm::vec3 c = box.GetCenter();
+  const glm::vec3 e = box.GetExtents();
+
+  for (int i = 0; i < kNumFrustumPlanes; i++)
+  {
+    if (!(planeMask & (1u << i)))
+      continue;
+
+    const glm::vec4 & plane = mPlanes[i];
+    const float d = plane[0]*c[0] + plane[1]*c[1] + plane[2]*c[2] + plane[3];
+    const float r = std::fabs(plane[0])*e[0] + std::fabs(plane[1])*e[1] + std::fabs(plane[2])*e[2];
+
+    if (d + r < 0.0f)        // Entirely behind the plane.
+      return kOutsideFrustum;
+
+    if (d - r >= 0.0f)       // Entirely in front of it -- children don't need this plane.
+      planeMask &= ~(1u << i);
+  }
+
+  return (planeMask == 0) ? kInsideFrustum : kIntersectsFrustum;
+}
+
+}  // namespace gloo.
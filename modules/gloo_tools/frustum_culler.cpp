@@ -0,0 +1,368 @@
+#include "frustum_culler.h"
+
+#include <cmath>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define GLOO_CULLER_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define GLOO_TARGET_SSE2 __attribute__((target("sse2")))
+#define GLOO_TARGET_AVX  __attribute__((target("avx")))
+#else
+#define GLOO_TARGET_SSE2
+#define GLOO_TARGET_AVX
+#endif
+
+namespace gloo
+{
+
+namespace
+{
+
+const uint8_t kNoPlane = kNumFrustumPlanes;  // Block was not rejected by a single plane.
+const unsigned kAllOutside = 0xFF;           // One bit per object of a block.
+
+// SoA view of the volumes. For spheres, mEx holds the radii and mEy/mEz are unused.
+struct CullInput
+{
+  const float* mX;
+  const float* mY;
+  const float* mZ;
+  const float* mEx;
+  const float* mEy;
+  const float* mEz;
+};
+
+// Each tester returns a bit mask with the objects of a block that lie outside a plane.
+// Bit i is set if object (base + i) is outside.
+
+template <bool kBox>
+struct ScalarTester
+{
+  const glm::vec4* mPlanes;
+  CullInput mIn;
+
+  unsigned OutsideMask(int p, size_t base) const
+  {
+    const glm::vec4 & n = mPlanes[p];
+    unsigned mask = 0;
+    for (size_t i = 0; i < FrustumCuller::kBlockSize; i++)
+    {
+      const size_t k = base + i;
+      const float d = n[0]*mIn.mX[k] + n[1]*mIn.mY[k] + n[2]*mIn.mZ[k] + n[3];
+      const float r = kBox ? std::fabs(n[0])*mIn.mEx[k] + std::fabs(n[1])*mIn.mEy[k]
+                           + std::fabs(n[2])*mIn.mEz[k]
+                           : mIn.mEx[k];
+      mask |= (d < -r) ? (1u << i) : 0u;
+    }
+    return mask;
+  }
+};
+
+#ifdef GLOO_CULLER_X86
+
+template <bool kBox>
+struct SSETester
+{
+  __m128 mN[kNumFrustumPlanes][4];  // Broadcast plane coefficients.
+  __m128 mA[kNumFrustumPlanes][3];  // Broadcast |normal|.
+  CullInput mIn;
+
+  GLOO_TARGET_SSE2
+  SSETester(const glm::vec4* planes, const CullInput & in)
+  : mIn(in)
+  {
+    for (int p = 0; p < kNumFrustumPlanes; p++)
+    {
+      for (int j = 0; j < 4; j++)
+        mN[p][j] = _mm_set1_ps(planes[p][j]);
+      for (int j = 0; j < 3; j++)
+        mA[p][j] = _mm_set1_ps(std::fabs(planes[p][j]));
+    }
+  }
+
+  GLOO_TARGET_SSE2
+  int OutsideMask4(int p, size_t k) const
+  {
+    const __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(mN[p][0], _mm_load_ps(mIn.mX + k)),
+                                           _mm_mul_ps(mN[p][1], _mm_load_ps(mIn.mY + k))),
+                                _mm_add_ps(_mm_mul_ps(mN[p][2], _mm_load_ps(mIn.mZ + k)),
+                                           mN[p][3]));
+    __m128 r;
+    if (kBox)
+    {
+      r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(mA[p][0], _mm_load_ps(mIn.mEx + k)),
+                                _mm_mul_ps(mA[p][1], _mm_load_ps(mIn.mEy + k))),
+                     _mm_mul_ps(mA[p][2], _mm_load_ps(mIn.mEz + k)));
+    }
+    else
+    {
+      r = _mm_load_ps(mIn.mEx + k);
+    }
+
+    // d < -r  <=>  d + r < 0.
+    return _mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(d, r), _mm_setzero_ps()));
+  }
+
+  GLOO_TARGET_SSE2
+  unsigned OutsideMask(int p, size_t base) const
+  {
+    return SSETester::OutsideMask4(p, base) | (SSETester::OutsideMask4(p, base + 4) << 4);
+  }
+};
+
+template <bool kBox>
+struct AVXTester
+{
+  __m256 mN[kNumFrustumPlanes][4];
+  __m256 mA[kNumFrustumPlanes][3];
+  CullInput mIn;
+
+  GLOO_TARGET_AVX
+  AVXTester(const glm::vec4* planes, const CullInput & in)
+  : mIn(in)
+  {
+    for (int p = 0; p < kNumFrustumPlanes; p++)
+    {
+      for (int j = 0; j < 4; j++)
+        mN[p][j] = _mm256_set1_ps(planes[p][j]);
+      for (int j = 0; j < 3; j++)
+        mA[p][j] = _mm256_set1_ps(std::fabs(planes[p][j]));
+    }
+  }
+
+  GLOO_TARGET_AVX
+  unsigned OutsideMask(int p, size_t k) const
+  {
+    const __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(mN[p][0], _mm256_load_ps(mIn.mX + k)),
+                                                 _mm256_mul_ps(mN[p][1], _mm256_load_ps(mIn.mY + k))),
+                                   _mm256_add_ps(_mm256_mul_ps(mN[p][2], _mm256_load_ps(mIn.mZ + k)),
+                                                 mN[p][3]));
+    __m256 r;
+    if (kBox)
+    {
+      r = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(mA[p][0], _mm256_load_ps(mIn.mEx + k)),
+                                      _mm256_mul_ps(mA[p][1], _mm256_load_ps(mIn.mEy + k))),
+                        _mm256_mul_ps(mA[p][2], _mm256_load_ps(mIn.mEz + k)));
+    }
+    else
+    {
+      r = _mm256_load_ps(mIn.mEx + k);
+    }
+
+    return _mm256_movemask_ps(_mm256_cmp_ps(_mm256_add_ps(d, r), _mm256_setzero_ps(), _CMP_LT_OQ));
+  }
+};
+
+#endif  // GLOO_CULLER_X86
+
+// Tests all blocks and writes the visible indices into out (which must have room for
+// numBlocks * kBlockSize entries). Returns the number of visible objects.
+// The macro below is instantiated once per kernel, so that the tester calls are inlined
+// into a function compiled for the same target.
+#define GLOO_DEFINE_CULL_BLOCKS(Name, Target)                                                    \
+template <class Tester>                                                                          \
+Target                                                                                           \
+size_t Name(const Tester & tester, size_t numBlocks, uint8_t* lastPlane, bool coherence,        \
+            uint32_t* out)                                                                       \
+{                                                                                                \
+  size_t count = 0;                                                                              \
+  for (size_t b = 0; b < numBlocks; b++)                                                         \
+  {                                                                                              \
+    const size_t base = b * FrustumCuller::kBlockSize;                                           \
+    const int cached = coherence ? lastPlane[b] : kNoPlane;                                      \
+                                                                                                 \
+    /* Temporal coherence: try the plane that rejected this block last time. */                 \
+    unsigned outside = (cached != kNoPlane) ? tester.OutsideMask(cached, base) : 0u;             \
+    int rejectedBy = (outside == kAllOutside) ? cached : kNoPlane;                               \
+                                                                                                 \
+    for (int p = 0; (p < kNumFrustumPlanes) && (rejectedBy == kNoPlane); p++)                    \
+    {                                                                                            \
+      if (p == cached)                                                                           \
+        continue;                                                                                \
+                                                                                                 \
+      outside |= tester.OutsideMask(p, base);                                                    \
+      if (outside == kAllOutside)                                                                \
+        rejectedBy = p;                                                                          \
+    }                                                                                            \
+                                                                                                 \
+    lastPlane[b] = static_cast<uint8_t>(rejectedBy);                                             \
+    if (rejectedBy != kNoPlane)                                                                  \
+      continue;                                                                                  \
+                                                                                                 \
+    /* Branchless compaction (padding objects are always outside). */                           \
+    const unsigned visible = ~outside;                                                           \
+    for (size_t i = 0; i < FrustumCuller::kBlockSize; i++)                                       \
+    {                                                                                            \
+      out[count] = static_cast<uint32_t>(base + i);                                              \
+      count += (visible >> i) & 1u;                                                              \
+    }                                                                                            \
+  }                                                                                              \
+  return count;                                                                                  \
+}
+
+GLOO_DEFINE_CULL_BLOCKS(CullBlocksScalar, )
+#ifdef GLOO_CULLER_X86
+GLOO_DEFINE_CULL_BLOCKS(CullBlocksSSE, GLOO_TARGET_SSE2)
+GLOO_DEFINE_CULL_BLOCKS(CullBlocksAVX, GLOO_TARGET_AVX)
+#endif
+
+#undef GLOO_DEFINE_CULL_BLOCKS
+
+template <bool kBox>
+size_t Cull(const Frustum & frustum, const CullInput & in, size_t numBlocks,
+            uint8_t* lastPlane, bool coherence, uint32_t* out)
+{
+  const glm::vec4* planes = frustum.GetPlanes();
+
+#ifdef GLOO_CULLER_X86
+  switch (BatchMath::GetKernel())
+  {
+    case kAVXKernel:
+      return CullBlocksAVX(AVXTester<kBox>(planes, in), numBlocks, lastPlane, coherence, out);
+    case kSSEKernel:
+      return CullBlocksSSE(SSETester<kBox>(planes, in), numBlocks, lastPlane, coherence, out);
+    default:
+      break;
+  }
+#endif
+
+  const ScalarTester<kBox> tester = { planes, in };
+  return CullBlocksScalar(tester, numBlocks, lastPlane, coherence, out);
+}
+
+}  // namespace.
+
+// ------------------------------------------------------------------------------------------------
+// -> Spheres.
+
+void FrustumCuller::ReserveSphere(size_t index)
+{
+  if (index % kBlockSize != 0)
+    return;
+
+  // Padding spheres have radius -inf, so they are outside every plane.
+  const size_t size = index + kBlockSize;
+  mSphereX.resize(size, 0.0f);
+  mSphereY.resize(size, 0.0f);
+  mSphereZ.resize(size, 0.0f);
+  mSphereRadius.resize(size, -std::numeric_limits<float>::max());
+  mSphereLastPlane.resize(size / kBlockSize, kNoPlane);
+}
+
+uint32_t FrustumCuller::AddSphere(const BoundingSphere & sphere)
+{
+  FrustumCuller::ReserveSphere(mNumSpheres);
+  FrustumCuller::SetSphere(static_cast<uint32_t>(mNumSpheres), sphere);
+  return static_cast<uint32_t>(mNumSpheres++);
+}
+
+void FrustumCuller::SetSphere(uint32_t index, const BoundingSphere & sphere)
+{
+  mSphereX[index] = sphere.mCenter[0];
+  mSphereY[index] = sphere.mCenter[1];
+  mSphereZ[index] = sphere.mCenter[2];
+  mSphereRadius[index] = sphere.mRadius;
+}
+
+void FrustumCuller::SetSpheres(const BoundingSphere* spheres, size_t count)
+{
+  mSphereX.clear();
+  mSphereY.clear();
+  mSphereZ.clear();
+  mSphereRadius.clear();
+  mSphereLastPlane.clear();
+  mNumSpheres = 0;
+
+  for (size_t i = 0; i < count; i++)
+  {
+    FrustumCuller::AddSphere(spheres[i]);
+  }
+}
+
+size_t FrustumCuller::CullSpheres(const Frustum & frustum, std::vector<uint32_t> & visible)
+{
+  const CullInput in = { mSphereX.data(), mSphereY.data(), mSphereZ.data(),
+                         mSphereRadius.data(), nullptr, nullptr };
+
+  visible.resize(mSphereX.size());
+  const size_t count = Cull<false>(frustum, in, mSphereLastPlane.size(), mSphereLastPlane.data(),
+                                   mTemporalCoherence, visible.data());
+  visible.resize(count);
+
+  return count;
+}
+
+// ------------------------------------------------------------------------------------------------
+// -> Axis-aligned boxes.
+
+void FrustumCuller::ReserveAABB(size_t index)
+{
+  if (index % kBlockSize != 0)
+    return;
+
+  // Padding boxes have extents -inf, so they are outside every plane.
+  const size_t size = index + kBlockSize;
+  const float kNegativeExtent = -std::numeric_limits<float>::max();
+  mBoxX.resize(size, 0.0f);
+  mBoxY.resize(size, 0.0f);
+  mBoxZ.resize(size, 0.0f);
+  mBoxExtentX.resize(size, kNegativeExtent);
+  mBoxExtentY.resize(size, kNegativeExtent);
+  mBoxExtentZ.resize(size, kNegativeExtent);
+  mBoxLastPlane.resize(size / kBlockSize, kNoPlane);
+}
+
+uint32_t FrustumCuller::AddAABB(const AABB & box)
+{
+  FrustumCuller::ReserveAABB(mNumBoxes);
+  FrustumCuller::SetAABB(static_cast<uint32_t>(mNumBoxes), box);
+  return static_cast<uint32_t>(mNumBoxes++);
+}
+
+void FrustumCuller::SetAABB(uint32_t index, const AABB & box)
+{
+  const glm::vec3 c = box.GetCenter();
+  const glm::vec3 e = box.GetExtents();
+  mBoxX[index] = c[0];
+  mBoxY[index] = c[1];
+  mBoxZ[index] = c[2];
+  mBoxExtentX[index] = e[0];
+  mBoxExtentY[index] = e[1];
+  mBoxExtentZ[index] = e[2];
+}
+
+void FrustumCuller::SetAABBs(const AABB* boxes, size_t count)
+{
+  mBoxX.clear();
+  mBoxY.clear();
+  mBoxZ.clear();
+  mBoxExtentX.clear();
+  mBoxExtentY.clear();
+  mBoxExtentZ.clear();
+  mBoxLastPlane.clear();
+  mNumBoxes = 0;
+
+  for (size_t i = 0; i < count; i++)
+  {
+    FrustumCuller::AddAABB(boxes[i]);
+  }
+}
+
+size_t FrustumCuller::CullAABBs(const Frustum & frustum, std::vector<uint32_t> & visible)
+{
+  const CullInput in = { mBoxX.data(), mBoxY.data(), mBoxZ.data(),
+                         mBoxExtentX.data(), mBoxExtentY.data(), mBoxExtentZ.data() };
+
+  visible.resize(mBoxX.size());
+  const size_t count = Cull<true>(frustum, in, mBoxLastPlane.size(), mBoxLastPlane.data(),
+                                  mTemporalCoherence, visible.data());
+  visible.resize(count);
+
+  return count;
+}
+
+}  // namespace gloo.
@@ -0,0 +1,91 @@
+// + ======================================== +
+// |         gl-oo-interface library          |
+// |            Module: GLOO Tool.            |
+// |        Author: Rodrigo Castiel, 2016.    |
+// + ======================================== +
+//
+// gloo::FrustumCuller tests large sets of bounding spheres and AABBs against a Frustum and
+// returns the indices of the visible ones (a compact list, in increasing order).
+//
+// The volumes are stored inside the culler in SoA layout (x[], y[], z[], ...), aligned and
+// padded to blocks of 8 objects, so each block is tested with one AVX (or two SSE) operations
+// per plane. The kernel is the one chosen by gloo::BatchMath (AVX, SSE or scalar).
+//
+// Temporal coherence: for every block, the culler remembers the plane that rejected the whole
+// block in the last call and tests it first in the next one. Blocks that stay out of view
+// are then rejected after a single plane test. Objects that are close in space should be
+// stored close in the arrays (e.g. in traversal order) for the blocks to be coherent.
+//
+// Usage:
+//   FrustumCuller culler;
+//   culler.SetAABBs(worldBoxes.data(), worldBoxes.size());  // Or AddAABB()/SetAABB().
+//   ...
+//   std::vector<uint32_t> visible;
+//   culler.CullAABBs(camera->GetFrustum(), visible);
+//   for (uint32_t i : visible)
+//     renderer->Render(meshes[i], models[i], camera);
+
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "bounds.h"
+#include "frustum.h"
+#include "batch_math.h"
+
+namespace gloo
+{
+
+class FrustumCuller
+{
+public:
+  static const size_t kBlockSize = 8;  // Objects per SIMD block.
+
+  FrustumCuller() { }
+
+  // -> Spheres.
+  uint32_t AddSphere(const BoundingSphere & sphere);  // Returns the index of the sphere.
+  void SetSphere(uint32_t index, const BoundingSphere & sphere);
+  void SetSpheres(const BoundingSphere* spheres, size_t count);  // Replaces all spheres.
+  void ClearSpheres() { FrustumCuller::SetSpheres(nullptr, 0); }
+  size_t GetNumSpheres() const { return mNumSpheres; }
+
+  // -> Axis-aligned boxes.
+  uint32_t AddAABB(const AABB & box);  // Returns the index of the box.
+  void SetAABB(uint32_t index, const AABB & box);
+  void SetAABBs(const AABB* boxes, size_t count);  // Replaces all boxes.
+  void ClearAABBs() { FrustumCuller::SetAABBs(nullptr, 0); }
+  size_t GetNumAABBs() const { return mNumBoxes; }
+
+  // -> Culling. Stores the indices of the visible objects into 'visible' and returns how
+  // many they are. The tests are conservative (nothing visible is ever culled).
+  size_t CullSpheres(const Frustum & frustum, std::vector<uint32_t> & visible);
+  size_t CullAABBs(const Frustum & frustum, std::vector<uint32_t> & visible);
+
+  // Enables/disables the last-failed-plane cache (enabled by default).
+  void SetTemporalCoherence(bool enabled) { mTemporalCoherence = enabled; }
+  bool GetTemporalCoherence() const { return mTemporalCoherence; }
+
+private:
+  typedef std::vector<float, AlignedAllocator<float, 32>> FloatArray;
+
+  // Appends a block of padding objects (never visible) when count reaches a block boundary.
+  void ReserveSphere(size_t index);
+  void ReserveAABB(size_t index);
+
+  // Spheres: center and radius.
+  FloatArray mSphereX, mSphereY, mSphereZ, mSphereRadius;
+  std::vector<uint8_t> mSphereLastPlane;  // One entry per block.
+  size_t mNumSpheres { 0 };
+
+  // Boxes: center and extents (half sizes).
+  FloatArray mBoxX, mBoxY, mBoxZ, mBoxExtentX, mBoxExtentY, mBoxExtentZ;
+  std::vector<uint8_t> mBoxLastPlane;  // One entry per block.
+  size_t mNumBoxes { 0 };
+
+  bool mTemporalCoherence { true };
+};
+
+}  // namespace gloo.
@@ -0,0 +1,76 @@
+#include "matrix_stack.h"
+
+#include <memory>
+
+namespace gloo
+{
+
+MatrixStack::MatrixStack(const MatrixStack & other)
+: mArena(other.mArena)
+{
+  MatrixStack::CopyFrom(other);
+}
+
+MatrixStack::~MatrixStack()
+{
+  ::operator delete(mHeap);
+}
+
+MatrixStack & MatrixStack::operator=(const MatrixStack & other)
+{
+  if (this != &other)
+  {
+    mArena = other.mArena;
+    MatrixStack::CopyFrom(other);
+  }
+
+  return *this;
+}
+
+void MatrixStack::CopyFrom(const MatrixStack & other)
+{
+  MatrixStack::Clear();
+
+  if (other.mSize > mCapacity)
+    MatrixStack::Grow(other.mSize);
+
+  std::uninitialized_copy(other.mData, other.mData + other.mSize, mData);
+  mSize = other.mSize;
+}
+
+void MatrixStack::Grow(size_t capacity)
+{
+  glm::mat4* buffer = mArena ? mArena->Allocate<glm::mat4>(capacity) : nullptr;
+  glm::mat4* oldHeap = nullptr;
+
+  if (buffer == nullptr)
+  {
+    if ((mHeapCapacity >= capacity) && (mData != mHeap))  // Reuse the previous heap buffer.
+    {
+      buffer = mHeap;
+      capacity = mHeapCapacity;
+    }
+    else
+    {
+      oldHeap = mHeap;
+      buffer = static_cast<glm::mat4*>(::operator new(capacity * sizeof(glm::mat4)));
+      mHeap = buffer;
+      mHeapCapacity = capacity;
+    }
+  }
+
+  std::uninitialized_copy(mData, mData + mSize, buffer);
+  ::operator delete(oldHeap);  // Only after copying, since mData may point to it.
+
+  mData = buffer;
+  mCapacity = capacity;
+}
+
+void MatrixStack::ReleaseSpill()
+{
+  // Heap buffers are kept for the next spill; arena buffers die with the frame anyway.
+  mData = MatrixStack::GetInline();
+  mCapacity = kInlineCapacity;
+}
+
+}  // namespace gloo.
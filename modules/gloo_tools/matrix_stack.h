@@ -0,0 +1,114 @@
+// + ======================================== +
+// |         gl-oo-interface library          |
+// |            Module: GLOO Tool.            |
+// |        Author: Rodrigo Castiel, 2016.    |
+// + ======================================== +
+//
+// gloo::MatrixStack is the stack of glm::mat4 used by gloo::Transform for hierarchical
+// transforms. It never touches the heap while the depth is at most kInlineCapacity,
+// because the first matrices are stored inside the object itself (small-buffer storage).
+//
+// Deeper hierarchies spill into a larger buffer, which comes from:
+//  -> a FrameArena, if one was given by SetArena() and it still has room;
+//  -> the heap, otherwise. Heap buffers are kept (and reused) until the stack dies.
+//
+// Arena buffers are only valid for the current frame, so the stack drops them (back to the
+// inline storage) as soon as it becomes empty. In other words, a stack backed by an arena
+// must be balanced (every Push() matched by a Pop()) before the arena is reset.
+//
+// Copies only duplicate the used entries, and unused slots are never constructed, so
+// creating or copying a Transform with a shallow stack is cheap.
+
+#pragma once
+
+#include <new>
+#include <cstddef>
+#include <glm/glm.hpp>
+
+#include "frame_arena.h"
+
+namespace gloo
+{
+
+class MatrixStack
+{
+public:
+  static const size_t kInlineCapacity = 8;
+
+  MatrixStack() { }
+  MatrixStack(const MatrixStack & other);
+  ~MatrixStack();
+
+  MatrixStack & operator=(const MatrixStack & other);
+
+  void Push(const glm::mat4 & m);
+  void Pop();                             // Removes the top. The stack must not be empty.
+
+  const glm::mat4 & Top() const { return mData[mSize - 1]; }
+  const glm::mat4 & operator[](size_t i) const { return mData[i]; }  // 0 is the bottom.
+
+  size_t GetSize()     const { return mSize; }
+  size_t GetCapacity() const { return mCapacity; }
+  bool IsEmpty()       const { return mSize == 0; }
+
+  void Clear();
+
+  // Spilled buffers are taken from arena while it has room (nullptr disables it).
+  void SetArena(FrameArena* arena) { mArena = arena; }
+  FrameArena* GetArena() const { return mArena; }
+
+private:
+  // Moves the entries into a buffer with room for at least 'capacity' matrices.
+  void Grow(size_t capacity);
+
+  // Returns to the inline buffer (releasing any spilled storage). Only valid when empty.
+  void ReleaseSpill();
+
+  // Replaces the content of this stack by the used entries of other.
+  void CopyFrom(const MatrixStack & other);
+
+  glm::mat4* GetInline() { return reinterpret_cast<glm::mat4*>(mInline); }
+
+  alignas(16) unsigned char mInline[kInlineCapacity * sizeof(glm::mat4)];  // Raw storage.
+  glm::mat4* mData { GetInline() };
+  size_t mSize { 0 };
+  size_t mCapacity { kInlineCapacity };
+
+  glm::mat4* mHeap { nullptr };   // Heap buffer (kept for reuse), if any.
+  size_t mHeapCapacity { 0 };
+  FrameArena* mArena { nullptr };  // Optional per-frame storage for spills.
+};
+
+// =========== IMPLEMENTATION OF INLINE METHODS ===================================================
+
+inline
+void MatrixStack::Push(const glm::mat4 & m)
+{
+  if (mSize == mCapacity)
+  {
+    const glm::mat4 copy = m;  // m may live in the buffer being replaced.
+    MatrixStack::Grow(2 * mCapacity);
+    new (mData + mSize++) glm::mat4(copy);
+    return;
+  }
+
+  new (mData + mSize++) glm::mat4(m);
+}
+
+inline
+void MatrixStack::Pop()
+{
+  mSize--;
+  if ((mSize == 0) && (mData != GetInline()))
+    MatrixStack::ReleaseSpill();
+}
+
+inline
+void MatrixStack::Clear()
+{
+  mSize = 0;
+  if (mData != GetInline())
+    MatrixStack::ReleaseSpill();
+}
+
+}  // namespace gloo.
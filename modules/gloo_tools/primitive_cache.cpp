@@ -0,0 +1,45 @@
+#include "primitive_cache.h"
+
+namespace gloo
+{
+
+std::map<PrimitiveKey, PrimitiveCache::Entry> PrimitiveCache::sEntries;
+
+MeshGroup<Batch>* PrimitiveCache::Acquire(const PrimitiveKey & key, BuildFunction build)
+{
+  std::map<PrimitiveKey, Entry>::iterator it = sEntries.find(key);
+
+  if (it != sEntries.end())  // Cache hit -- share it.
+  {
+    it->second.mRefCount++;
+    return it->second.mMeshGroup;
+  }
+
+  // Cache miss -- build the unit geometry once.
+  Entry entry = { build(key), 1 };
+  sEntries[key] = entry;
+
+  return entry.mMeshGroup;
+}
+
+void PrimitiveCache::Release(const PrimitiveKey & key)
+{
+  std::map<PrimitiveKey, Entry>::iterator it = sEntries.find(key);
+
+  if (it == sEntries.end())
+    return;
+
+  if (--it->second.mRefCount == 0)
+  {
+    delete it->second.mMeshGroup;
+    sEntries.erase(it);
+  }
+}
+
+unsigned PrimitiveCache::GetRefCount(const PrimitiveKey & key)
+{
+  std::map<PrimitiveKey, Entry>::const_iterator it = sEntries.find(key);
+  return (it != sEntries.end()) ? it->second.mRefCount : 0;
+}
+
+}  // namespace gloo.
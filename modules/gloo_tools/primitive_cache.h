@@ -0,0 +1,101 @@
+// + ======================================== +
+// |         gl-oo-interface library          |
+// |            Module: GLOO Tool.            |
+// |        Author: Rodrigo Castiel, 2016.    |
+// + ======================================== +
+//
+// gloo::PrimitiveCache stores the GPU geometry (VBO, EAB and VAOs) of the useful meshes
+// so that identical primitives share a single MeshGroup instead of allocating new buffers
+// for every instance. Entries are reference-counted and keyed by PrimitiveKey, which holds
+// the primitive type, its level of detail and the attribute locations baked into its VAO.
+//
+// The geometry stored in the cache is always the "unit" version of the primitive. Anything
+// that changes per instance (color, extents, position) must be provided separately, e.g.
+// as a constant vertex attribute or as a local transform (see useful_meshes.h).
+//
+// Usage:
+//   PrimitiveKey key = { kBoundingBoxPrimitive, 0, {posLoc, -1, -1, -1} };
+//   MeshGroup<Batch>* mesh = PrimitiveCache::Acquire(key, BuildMyBoundingBox);
+//   ...
+//   PrimitiveCache::Release(key);  // Buffers are destroyed with the last reference.
+//
+// NOTE: the cache must be used with a single OpenGL context, and all primitives must be
+// released before the context is destroyed.
+
+#pragma once
+
+#include <map>
+
+#include "gloo/gl_header.h"
+#include "gloo/group.h"
+
+namespace gloo
+{
+
+enum PrimitiveType
+{
+  kAxisPrimitive,
+  kBoundingBoxPrimitive,
+  kWireframeSpherePrimitive,
+  kTexturedSpherePrimitive,
+};
+
+struct PrimitiveKey
+{
+  PrimitiveType mType;
+  int mDetail;             // Level of detail (subdivisions), 0 if not applicable.
+  GLint mAttribLocs[4];    // Attribute locations baked into the VAO (-1 if unused).
+
+  bool operator<(const PrimitiveKey & other) const;
+};
+
+class PrimitiveCache
+{
+public:
+  // Builds the unit geometry of a primitive described by key (called on cache misses).
+  typedef MeshGroup<Batch>* (*BuildFunction)(const PrimitiveKey & key);
+
+  // Returns the shared mesh group for key, building it with 'build' if needed.
+  // Every call to Acquire() must be matched by a call to Release().
+  static MeshGroup<Batch>* Acquire(const PrimitiveKey & key, BuildFunction build);
+
+  // Drops one reference to key. The GPU buffers are destroyed with the last reference.
+  static void Release(const PrimitiveKey & key);
+
+  // Number of distinct primitives currently alive (i.e. MeshGroups on GPU).
+  static unsigned GetNumPrimitives() { return sEntries.size(); }
+
+  // Number of instances sharing key (0 if it is not cached).
+  static unsigned GetRefCount(const PrimitiveKey & key);
+
+private:
+  struct Entry
+  {
+    MeshGroup<Batch>* mMeshGroup;
+    unsigned mRefCount;
+  };
+
+  static std::map<PrimitiveKey, Entry> sEntries;
+};
+
+// =========== IMPLEMENTATION OF INLINE METHODS ===================================================
+
+inline
+bool PrimitiveKey::operator<(const PrimitiveKey & other) const
+{
+  if (mType != other.mType)
+    return mType < other.mType;
+
+  if (mDetail != other.mDetail)
+    return mDetail < other.mDetail;
+
+  for (int i = 0; i < 4; i++)
+  {
+    if (mAttribLocs[i] != other.mAttribLocs[i])
+      return mAttribLocs[i] < other.mAttribLocs[i];
+  }
+
+  return false;
+}
+
+}  // namespace gloo.
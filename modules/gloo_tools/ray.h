@@ -0,0 +1,85 @@
+// + ======================================== +
+// |         gl-oo-interface library          |
+// |            Module: GLOO Tool.            |
+// |        Author: Rodrigo Castiel, 2016.    |
+// + ======================================== +
+//
+// gloo::Ray is a half-line origin + t * direction (t >= 0), used for picking and
+// intersection queries (see gloo_scene). The direction does not need to be normalized;
+// distances t are measured in units of |direction|.
+//
+// The reciprocal of the direction is stored for fast slab tests, so always change the
+// direction through the constructor or Set().
+//
+// Usage:
+//   Ray ray(camera->GetPosition(), camera->ComputeRayAt(x, y, w, h));
+//   float t;
+//   if (ray.Intersects(box, 1000.0f, &t))
+//     std::cout << "Hit at " << t << std::endl;
+
+#pragma once
+
+#include <algorithm>
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+
+namespace gloo
+{
+
+struct Ray
+{
+  glm::vec3 mOrigin { 0.0f };
+  glm::vec3 mDirection { 0.0f, 0.0f, -1.0f };
+  glm::vec3 mInvDirection { 0.0f, 0.0f, -1.0f };  // 1 / mDirection (component-wise).
+
+  Ray() { }
+  Ray(const glm::vec3 & origin, const glm::vec3 & direction) { Ray::Set(origin, direction); }
+
+  void Set(const glm::vec3 & origin, const glm::vec3 & direction);
+
+  glm::vec3 GetPoint(float t) const { return mOrigin + t * mDirection; }
+
+  // Slab test. Returns true if the ray hits box for some t in [0, tMax], and stores the
+  // entry distance (0 if the origin is inside the box) into tNear.
+  bool Intersects(const AABB & box, float tMax, float* tNear = nullptr) const;
+};
+
+// =========== IMPLEMENTATION OF INLINE METHODS ===================================================
+
+inline
+void Ray::Set(const glm::vec3 & origin, const glm::vec3 & direction)
+{
+  mOrigin = origin;
+  mDirection = direction;
+  mInvDirection = glm::vec3(1.0f / direction[0], 1.0f / direction[1], 1.0f / direction[2]);
+}
+
+inline
+bool Ray::Intersects(const AABB & box, float tMax, float* tNear) const
+{
+  float t0 = 0.0f;
+  float t1 = tMax;
+
+  for (int i = 0; i < 3; i++)
+  {
+    float tA = (box.mMin[i] - mOrigin[i]) * mInvDirection[i];
+    float tB = (box.mMax[i] - mOrigin[i]) * mInvDirection[i];
+    if (tA > tB)
+      std::swap(tA, tB);
+
+    // Written so that NaNs (origin on a slab with a zero direction) never reject a hit.
+    t0 = (tA > t0) ? tA : t0;
+    t1 = (tB < t1) ? tB : t1;
+  }
+
+  if (t0 > t1)
+    return false;
+
+  if (tNear)
+    *tNear = t0;
+
+  return true;
+}
+
+}  // namespace gloo.
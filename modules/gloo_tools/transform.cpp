@@ -1,8 +1,10 @@
 #include "transform.h"
 #include "gloo/gl_header.h"
+#include "trs.h"
 
 #include <iomanip>
 #include <sstream>
+#include <utility>
 
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -10,6 +12,8 @@
 namespace gloo 
 {
 
+std::atomic<unsigned> Transform::sLastVersion(0);
+
 // -- 1
 Transform::Transform()
 {
@@ -17,6 +21,29 @@ Transform::Transform()
   mCurrent = glm::mat4(1.0f);
 }
 
+Transform::Transform(const Transform & other)
+: mStack(other.mStack),
+  mCurrent(other.mCurrent),
+  mVersion(Transform::NextVersion()),
+  mInverseValid(other.mInverseValid),
+  mInverseTransposeValid(other.mInverseTransposeValid),
+  mInverse(other.mInverse),
+  mInverseTranspose(other.mInverseTranspose)
+{ }
+
+Transform & Transform::operator=(const Transform & other)
+{
+  // A fresh version, so that caches keyed on the old one of this Transform are dropped.
+  mStack = other.mStack;
+  mCurrent = other.mCurrent;
+  mVersion = Transform::NextVersion();
+  mInverseValid = other.mInverseValid;
+  mInverseTransposeValid = other.mInverseTransposeValid;
+  mInverse = other.mInverse;
+  mInverseTranspose = other.mInverseTranspose;
+  return *this;
+}
+
 void Transform::SetUniform(unsigned programHandle, const std::string & uniformName) const
 {
   const float* m = glm::value_ptr(mCurrent);
@@ -48,16 +75,20 @@ void Transform::SetInverseUniform(unsigned uniformHandler) const
 void Transform::SetInverseTransposeUniform(unsigned programHandle, const std::string & uniformName) const
 {
   GLint uniformLoc = glGetUniformLocation(programHandle, uniformName.c_str());
-  glm::mat4 N = Transform::GetInverseMatrix();
-  N = glm::transpose(N);
-  glUniformMatrix4fv(uniformLoc, 1, GL_FALSE, glm::value_ptr(N));
+  Transform::SetInverseTransposeUniform(uniformLoc);
 }
 
 void Transform::SetInverseTransposeUniform(unsigned uniformHandler) const
 {
-  glm::mat4 N = Transform::GetInverseMatrix();
-  N = glm::transpose(N);
-  glUniformMatrix4fv(uniformHandler, 1, GL_FALSE, glm::value_ptr(N));
+  if (!mInverseTransposeValid)
+  {
+    // Reuse the cached inverse if it is available.
+    mInverseTranspose = mInverseValid ? glm::transpose(mInverse) 
+                                      : Transform::ComputeInverseTranspose(mCurrent);
+    mInverseTransposeValid = true;
+  }
+
+  glUniformMatrix4fv(uniformHandler, 1, GL_FALSE, glm::value_ptr(mInverseTranspose));
 }
 
 // ------------------------------------------------------------------------------------------------
@@ -118,18 +149,30 @@ void Transform::LookAt(const glm::vec3 & eye,
 // -- 6
 void Transform::Invert()
 {
-  mCurrent = glm::inverse(mCurrent);
+  if (mInverseValid)  // Swap current and inverse -- both stay valid.
+  {
+    std::swap(mCurrent, mInverse);
+    mVersion = Transform::NextVersion();
+    mInverseTransposeValid = false;
+  }
+  else
+  {
+    mCurrent = Transform::ComputeInverse(mCurrent);
+    Transform::Invalidate();
+  }
 }
 
 void Transform::Transpose()
 {
   mCurrent = glm::transpose(mCurrent);
+  Transform::Invalidate();
 }
 
 // -- 7
 void Transform::MultMatrix(const glm::mat4 & m)
 {
   mCurrent = mCurrent * m;
+  Transform::Invalidate();
 }
 
 void Transform::MultMatrix(const float* m)
@@ -140,6 +183,7 @@ void Transform::MultMatrix(const float* m)
 void Transform::LeftMultMatrix(const glm::mat4 & m)
 {
   mCurrent = m * mCurrent;
+  Transform::Invalidate();
 }
 
 void Transform::LeftMultMatrix(const float* m)  // Column-major.
@@ -147,6 +191,11 @@ void Transform::LeftMultMatrix(const float* m)  // Column-major.
   Transform::LeftMultMatrix(glm::make_mat4(m));
 }
 
+void Transform::MultTRS(const TRS & trs)
+{
+  Transform::MultMatrix(trs.ToMatrix());
+}
+
 // ------------------------------------------------------------------------------------------------
 // -> Methods for setting the current matrix as projective transformation.
 
@@ -172,22 +221,23 @@ void Transform::Perspective(float fovY, float aspect, float zNear, float zFar)
 // -- 9
 void Transform::PushMatrix()
 {
-  mStack.push_back(mCurrent);
+  mStack.Push(mCurrent);
 }
 
 void Transform::PopMatrix()
 {
-  if (mStack.size() >= 1) 
+  if (!mStack.IsEmpty()) 
   {
-    mCurrent = mStack.back();
-    mStack.pop_back();
+    mCurrent = mStack.Top();
+    mStack.Pop();
+    Transform::Invalidate();
   }
 }
 
 void Transform::PushAndLoadIdentity()
 {
   Transform::PushMatrix();
-  mCurrent = glm::mat4(1.0f);
+  Transform::LoadIdentity();
 }
 
 // ------------------------------------------------------------------------------------------------
@@ -206,28 +256,69 @@ void Transform::GetMatrix(float* m) const
 
 glm::mat4 Transform::GetInverseMatrix() const
 {
-  return glm::inverse(mCurrent);
+  if (!mInverseValid)
+  {
+    mInverse = Transform::ComputeInverse(mCurrent);
+    mInverseValid = true;
+  }
+
+  return mInverse;
 }
 
 void Transform::GetInverseMatrix(float* m) const
 {
-  glm::mat4 mCurrentInv = glm::inverse(mCurrent);
+  glm::mat4 mCurrentInv = Transform::GetInverseMatrix();
   memcpy(m, glm::value_ptr(mCurrentInv), sizeof(float) * 16);
 }
 
+glm::mat4 Transform::GetInverseTransposeMatrix() const
+{
+  if (!mInverseTransposeValid)
+  {
+    mInverseTranspose = glm::transpose(Transform::GetInverseMatrix());
+    mInverseTransposeValid = true;
+  }
+
+  return mInverseTranspose;
+}
+
 void Transform::LoadIdentity()
 {
   mCurrent = glm::mat4(1.0f);
+  Transform::Invalidate();
+
+  // The identity is its own inverse.
+  mInverse = mCurrent;
+  mInverseTranspose = mCurrent;
+  mInverseValid = true;
+  mInverseTransposeValid = true;
 }
 
 void Transform::LoadMatrix(const glm::mat4 & m)
 {
   mCurrent = m;
+  Transform::Invalidate();
 }
 
 void Transform::LoadMatrix(const float* m)
 {
   mCurrent = glm::make_mat4(m);
+  Transform::Invalidate();
+}
+
+void Transform::LoadTRS(const TRS & trs)
+{
+  mCurrent = trs.ToMatrix();
+  Transform::Invalidate();
+
+  // The inverse of a TRS is cheap and exact, so it is cached right away.
+  mInverse = trs.ToInverseMatrix();
+  mInverseValid = true;
+}
+
+bool Transform::GetTRS(TRS* trs) const
+{
+  return TRS::Decompose(mCurrent, trs);
 }
 
 // ------------------------------------------------------------------------------------------------
@@ -258,7 +349,7 @@ void Transform::PrintStack(int precision, int width, bool fixed) const
             << Transform::MatrixToStr(mCurrent, precision, width, fixed) << std::endl;
   
   std::cout << "-------------------------- Top  --------------------------" << std::endl;
-  for (int i = mStack.size()-1; i >= 0; i--) 
+  for (int i = static_cast<int>(mStack.GetSize())-1; i >= 0; i--) 
   {
     std::cout << "S[" << i << "] = \n" 
               << Transform::MatrixToStr(mStack[i], precision, width, fixed) << std::endl;
@@ -267,6 +358,63 @@ void Transform::PrintStack(int precision, int width, bool fixed) const
             << std::endl;
 }
 
+// -- 13
+glm::mat4 Transform::ComputeInverse(const glm::mat4 & m)
+{
+  if (!Transform::IsAffine(m))
+  {
+    return glm::inverse(m);
+  }
+
+  // M = [A t; 0 1]  =>  M^-1 = [A^-1  -A^-1 t; 0 1].
+  // A^-1 = C' / det(A), where the columns of C are the cofactors of A.
+  const glm::vec3 a0(m[0]);
+  const glm::vec3 a1(m[1]);
+  const glm::vec3 a2(m[2]);
+  const glm::vec3 t(m[3]);
+
+  const glm::vec3 c0 = glm::cross(a1, a2);
+  const glm::vec3 c1 = glm::cross(a2, a0);
+  const glm::vec3 c2 = glm::cross(a0, a1);
+  const float invDet = 1.0f / glm::dot(a0, c0);
+
+  // Rows of A^-1 are c0, c1, c2 (scaled); store them column-major.
+  glm::mat4 inv;
+  inv[0] = glm::vec4(c0[0], c1[0], c2[0], 0.0f) * invDet;
+  inv[1] = glm::vec4(c0[1], c1[1], c2[1], 0.0f) * invDet;
+  inv[2] = glm::vec4(c0[2], c1[2], c2[2], 0.0f) * invDet;
+  inv[3] = glm::vec4(-glm::dot(c0, t) * invDet, 
+                     -glm::dot(c1, t) * invDet,
+                     -glm::dot(c2, t) * invDet, 1.0f);
+  return inv;
+}
+
+glm::mat4 Transform::ComputeInverseTranspose(const glm::mat4 & m)
+{
+  if (!Transform::IsAffine(m))
+  {
+    return glm::transpose(glm::inverse(m));
+  }
+
+  // (M^-1)' = [A^-t 0; (-A^-1 t)' 1], where A^-t = C / det(A) (cofactor matrix).
+  const glm::vec3 a0(m[0]);
+  const glm::vec3 a1(m[1]);
+  const glm::vec3 a2(m[2]);
+  const glm::vec3 t(m[3]);
+
+  const glm::vec3 c0 = glm::cross(a1, a2);
+  const glm::vec3 c1 = glm::cross(a2, a0);
+  const glm::vec3 c2 = glm::cross(a0, a1);
+  const float invDet = 1.0f / glm::dot(a0, c0);
+
+  glm::mat4 N;
+  N[0] = glm::vec4(c0, -glm::dot(c0, t)) * invDet;
+  N[1] = glm::vec4(c1, -glm::dot(c1, t)) * invDet;
+  N[2] = glm::vec4(c2, -glm::dot(c2, t)) * invDet;
+  N[3] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+  return N;
+}
+
 std::string Transform::MatrixToStr(const glm::mat4 & m, int precision, int width, bool fixed)
 {
   std::ostringstream oss;
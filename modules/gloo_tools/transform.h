@@ -53,25 +53,55 @@
 //  MVP.Perspective(...);     // Set projection 
 //  MVP.Combine(modelView);   // Combine with modelView (right side)
 //  MVP.SetUniform(shaderProgram->GetHandle(), "MVP");
+//
+//  7. The inverse and the inverse transpose (normal matrix) of the current
+//  matrix are computed lazily and cached until the current matrix changes,
+//  so uploading them for static objects costs nothing but the upload.
+//  When the bottom row is (0, 0, 0, 1), an affine fast path inverts only the
+//  3x3 rotation-scale block (by cofactors) and the translation.
+//  GetVersion() changes whenever the current matrix is modified, which lets
+//  client code detect changes cheaply. Versions come from a counter shared by
+//  all Transforms, and copies get a new one: a version that was seen once
+//  always stands for the same matrix, even after "view = otherTransform".
+//
+//  8. TRS (translation, quaternion rotation, scale) transforms can be applied
+//  with MultTRS(), loaded with LoadTRS() (which also caches the exact inverse)
+//  and extracted with GetTRS(). See "gloo_tools/trs.h".
+//
+//  9. The matrix stack keeps its first MatrixStack::kInlineCapacity entries
+//  inside the Transform, so pushing/popping and copying shallow hierarchies
+//  never allocate. Deeper stacks spill into a FrameArena (see SetStackArena)
+//  or into the heap. ScopedMatrixPush pops automatically at the end of a scope:
+//  {
+//    ScopedMatrixPush push(model);
+//    model.Translate(...);
+//    renderer.Render(mesh, model, camera);
+//  }  // Calls model.PopMatrix().
 //  ----------------------------------------------------------------------
 
 #pragma once
 
-#include <vector>
+#include <atomic>
 #include <string>
 #include <iostream>
 #include <glm/glm.hpp>
 
+#include "matrix_stack.h"
+
 namespace gloo
 {
 
+struct TRS;
+
 class Transform
 {
 public:
   // -> Constructor/Destructor.
   // Constructs Transform and loads identity in it.
   Transform();
-  
+  Transform(const Transform & other);
+  Transform & operator=(const Transform & other);  // Both give this Transform a new version.
+
   ~Transform()
   { }
 
@@ -124,6 +154,9 @@ public:
   void LeftMultMatrix(const glm::mat4 & m);
   void LeftMultMatrix(const float* m);  // Column-major.
 
+  // Multiply current matrix by the matrix of trs (T * R * S).
+  void MultTRS(const TRS & trs);
+
   // -> Methods for setting the current matrix as projective transformation.
   // Specify the projection type and the corresponding parameters (limits or aspect).
   void Ortho(      float left, float right, float bottom, float top, float zNear, float zFar);
@@ -136,6 +169,13 @@ public:
 
   void PushAndLoadIdentity();
 
+  // Stack entries beyond the inline capacity are taken from arena (nullptr = heap).
+  // The stack must be balanced before the arena is reset.
+  void SetStackArena(FrameArena* arena) { mStack.SetArena(arena); }
+
+  // Number of matrices currently saved on the stack.
+  size_t GetStackSize() const { return mStack.GetSize(); }
+
   // -> Load/Query methods.
   glm::mat4 GetMatrix() const;     // Returns 4x4 matrix which represents the entire transformation (current).
   void GetMatrix(float* m) const;  // Stores  4x4 matrix which represents the entire transformation into m.
@@ -143,9 +183,22 @@ public:
   glm::mat4 GetInverseMatrix() const;     // Provides the inverse matrix of GetMatrix().
   void GetInverseMatrix(float* m) const;  // Provides the inverse matrix of GetMatrix().
 
+  glm::mat4 GetInverseTransposeMatrix() const;  // Provides (M^-1)', where M = GetMatrix().
+
+  // Returns a counter that changes every time the current matrix is modified (or copied).
+  // Equal versions mean equal matrices (0 is the identity of a new Transform).
+  unsigned GetVersion() const { return mVersion; }
+
+  // Tells if the current matrix is affine (bottom row equal to [0 0 0 1]).
+  bool IsAffine() const { return Transform::IsAffine(mCurrent); }
+
   void LoadIdentity();                   // Sets the current matrix to be identity 4x4.
   void LoadMatrix(const glm::mat4 & m);  // Sets the current matrix to be m.
   void LoadMatrix(const float* m);       // Sets the current matrix to be m (column-major).
+  void LoadTRS(const TRS & trs);         // Sets the current matrix to be T * R * S.
+
+  // Decomposes the current matrix (see TRS::Decompose). Returns false if it is not affine.
+  bool GetTRS(TRS* trs) const;
 
   // -> Utilities/Log.
 
@@ -164,10 +217,75 @@ public:
   static std::string MatrixToStr(const glm::mat4 & m, int precision = 6, 
                                  int width = 12, bool fixed = true);
 
+  // -> Matrix helpers (they use the affine fast path whenever possible).
+  static bool IsAffine(const glm::mat4 & m);
+  static glm::mat4 ComputeInverse(const glm::mat4 & m);
+  static glm::mat4 ComputeInverseTranspose(const glm::mat4 & m);
+
 private:
-  std::vector<glm::mat4> mStack;  // Stack of transforms.
+  // Must be called whenever mCurrent changes -- drops cached data.
+  void Invalidate();
+
+  // A version no Transform had before (shared by all threads).
+  static unsigned NextVersion();
+
+  MatrixStack mStack;             // Stack of transforms.
   glm::mat4 mCurrent;             // Current matrix.
+
+  // Lazily evaluated data derived from mCurrent.
+  unsigned mVersion { 0 };                       // Renewed whenever mCurrent changes.
+  mutable bool mInverseValid { false };          // Tells if mInverse is up to date.
+  mutable bool mInverseTransposeValid { false }; // Tells if mInverseTranspose is up to date.
+  mutable glm::mat4 mInverse;                    // Cached mCurrent^-1.
+  mutable glm::mat4 mInverseTranspose;           // Cached (mCurrent^-1)'.
+
+  static std::atomic<unsigned> sLastVersion;
+};
+
+// Saves the current matrix of a Transform on construction and restores it on destruction.
+class ScopedMatrixPush
+{
+public:
+  explicit ScopedMatrixPush(Transform & transform)
+  : mTransform(transform)
+  {
+    mTransform.PushMatrix();
+  }
+
+  ~ScopedMatrixPush()
+  {
+    mTransform.PopMatrix();
+  }
+
+private:
+  ScopedMatrixPush(const ScopedMatrixPush &) = delete;
+  ScopedMatrixPush & operator=(const ScopedMatrixPush &) = delete;
+
+  Transform & mTransform;
 };
 
+// =========== IMPLEMENTATION OF INLINE METHODS ===================================================
+
+inline
+unsigned Transform::NextVersion()
+{
+  return sLastVersion.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+inline
+void Transform::Invalidate()
+{
+  mVersion = Transform::NextVersion();
+  mInverseValid = false;
+  mInverseTransposeValid = false;
+}
+
+inline
+bool Transform::IsAffine(const glm::mat4 & m)
+{
+  // Column-major: m[c][3] is the bottom row.
+  return (m[0][3] == 0.0f) && (m[1][3] == 0.0f) && (m[2][3] == 0.0f) && (m[3][3] == 1.0f);
+}
+
 
 }  // namespace gloo.
\ No newline at end of file
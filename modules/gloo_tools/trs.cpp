@@ -0,0 +1,87 @@
+#include "trs.h"
+
+#include <cmath>
+
+#include "transform.h"
+
+namespace gloo
+{
+
+namespace
+{
+
+// Rotation matrix of a unit quaternion, as 3 columns.
+inline void RotationColumns(const glm::quat & q, glm::vec3 & c0, glm::vec3 & c1, glm::vec3 & c2)
+{
+  const float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+  const float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+  const float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+  c0 = glm::vec3(1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy));
+  c1 = glm::vec3(2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx));
+  c2 = glm::vec3(2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy));
+}
+
+}  // namespace.
+
+glm::mat4 TRS::ToMatrix() const
+{
+  glm::vec3 c0, c1, c2;
+  RotationColumns(mRotation, c0, c1, c2);
+
+  return glm::mat4(glm::vec4(c0 * mScale.x, 0.0f),
+                   glm::vec4(c1 * mScale.y, 0.0f),
+                   glm::vec4(c2 * mScale.z, 0.0f),
+                   glm::vec4(mTranslation, 1.0f));
+}
+
+glm::mat4 TRS::ToInverseMatrix() const
+{
+  // The rows of R are the columns of R', and S^-1 scales the rows.
+  glm::vec3 c0, c1, c2;
+  RotationColumns(mRotation, c0, c1, c2);
+
+  const glm::vec3 inverseScale = 1.0f / mScale;
+  const glm::vec3 r0 = c0 * inverseScale.x;
+  const glm::vec3 r1 = c1 * inverseScale.y;
+  const glm::vec3 r2 = c2 * inverseScale.z;
+
+  return glm::mat4(glm::vec4(r0.x, r1.x, r2.x, 0.0f),
+                   glm::vec4(r0.y, r1.y, r2.y, 0.0f),
+                   glm::vec4(r0.z, r1.z, r2.z, 0.0f),
+                   glm::vec4(-glm::dot(r0, mTranslation),
+                             -glm::dot(r1, mTranslation),
+                             -glm::dot(r2, mTranslation), 1.0f));
+}
+
+bool TRS::Decompose(const glm::mat4 & m, TRS* trs)
+{
+  if (!Transform::IsAffine(m))
+    return false;
+
+  glm::vec3 c0(m[0]), c1(m[1]), c2(m[2]);
+  glm::vec3 scale(glm::length(c0), glm::length(c1), glm::length(c2));
+  if ((scale.x == 0.0f) || (scale.y == 0.0f) || (scale.z == 0.0f))
+    return false;
+
+  if (glm::dot(c0, glm::cross(c1, c2)) < 0.0f)  // Reflection.
+    scale.x = -scale.x;
+
+  c0 /= scale.x;
+  c1 /= scale.y;
+  c2 /= scale.z;
+
+  trs->mTranslation = glm::vec3(m[3]);
+  trs->mRotation = glm::normalize(glm::quat_cast(glm::mat3(c0, c1, c2)));
+  trs->mScale = scale;
+  return true;
+}
+
+TRS TRS::Interpolate(const TRS & a, const TRS & b, float t)
+{
+  return TRS(a.mTranslation + t * (b.mTranslation - a.mTranslation),
+             glm::slerp(a.mRotation, b.mRotation, t),
+             a.mScale + t * (b.mScale - a.mScale));
+}
+
+}  // namespace gloo.
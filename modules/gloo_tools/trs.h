@@ -0,0 +1,102 @@
+// + ======================================== +
+// |         gl-oo-interface library          |
+// |            Module: GLOO Tool.            |
+// |        Author: Rodrigo Castiel, 2016.    |
+// + ======================================== +
+//
+// gloo::TRS is a transform stored as a translation, a rotation (unit quaternion) and a scale:
+//   M = T * R * S.
+// It is the cheap representation for scene nodes and animation channels: 10 floats instead of
+// 16, composition and inversion without 4x4 products or general inverses, and interpolation
+// without gimbal lock. Convert to a matrix only when it is needed (e.g. for upload).
+//
+// Usage:
+//   TRS local(glm::vec3(0, 1, 0), glm::angleAxis(angle, glm::vec3(0, 1, 0)), glm::vec3(2));
+//   TRS world = parentWorld * local;             // Composition.
+//   glm::mat4 model = world.ToMatrix();
+//   glm::mat4 inverseModel = world.ToInverseMatrix();  // Exact, even for non-uniform scale.
+//
+//   TRS pose = TRS::Interpolate(key0, key1, 0.25f);  // Lerp/slerp/lerp.
+//
+//   // Many at once (SIMD): see BatchMath::ComposeTRS.
+//   BatchMath::ComposeTRS(poses.data(), matrices.data(), poses.size());
+//
+//   // From/to gloo::Transform.
+//   model.MultTRS(world);                  // model = model * world.
+//   TRS::Decompose(model.GetMatrix(), &world);
+//
+// NOTE: a product of TRS is exactly a TRS only when the scale of the left operand is uniform
+// (otherwise the product has shear, which TRS cannot represent). The same holds for Inverse().
+// Use matrices for those cases.
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+namespace gloo
+{
+
+struct TRS
+{
+  glm::vec3 mTranslation { 0.0f, 0.0f, 0.0f };
+  glm::quat mRotation { 1.0f, 0.0f, 0.0f, 0.0f };  // (w, x, y, z): identity.
+  glm::vec3 mScale { 1.0f, 1.0f, 1.0f };
+
+  TRS() { }
+  TRS(const glm::vec3 & translation, const glm::quat & rotation,
+      const glm::vec3 & scale = glm::vec3(1.0f))
+  : mTranslation(translation), mRotation(rotation), mScale(scale) { }
+
+  // Applies the transform to points (w = 1) and directions (w = 0).
+  glm::vec3 TransformPoint(const glm::vec3 & p) const;
+  glm::vec3 TransformVector(const glm::vec3 & v) const;
+
+  // Inverse transform (see the note on scales above).
+  TRS Inverse() const;
+
+  // M = T * R * S, and M^-1 = S^-1 * R' * T^-1 (always exact).
+  glm::mat4 ToMatrix() const;
+  glm::mat4 ToInverseMatrix() const;
+
+  // Splits an affine matrix into translation, rotation and scale. Shear is dropped and a
+  // reflection is stored as a negative x scale. Returns false (and leaves trs unchanged) if m
+  // is not affine or is singular.
+  static bool Decompose(const glm::mat4 & m, TRS* trs);
+
+  // Linear interpolation of translation and scale, spherical of rotation (shortest path).
+  static TRS Interpolate(const TRS & a, const TRS & b, float t);
+};
+
+// Composition: (a * b).ToMatrix() == a.ToMatrix() * b.ToMatrix() (see the note on scales).
+TRS operator*(const TRS & a, const TRS & b);
+
+// =========== IMPLEMENTATION OF INLINE METHODS ===================================================
+
+inline
+glm::vec3 TRS::TransformPoint(const glm::vec3 & p) const
+{
+  return mTranslation + mRotation * (mScale * p);
+}
+
+inline
+glm::vec3 TRS::TransformVector(const glm::vec3 & v) const
+{
+  return mRotation * (mScale * v);
+}
+
+inline
+TRS TRS::Inverse() const
+{
+  const glm::quat inverseRotation = glm::conjugate(mRotation);
+  const glm::vec3 inverseScale = 1.0f / mScale;
+  return TRS(-(inverseScale * (inverseRotation * mTranslation)), inverseRotation, inverseScale);
+}
+
+inline
+TRS operator*(const TRS & a, const TRS & b)
+{
+  return TRS(a.TransformPoint(b.mTranslation), a.mRotation * b.mRotation, a.mScale * b.mScale);
+}
+
+}  // namespace gloo.
@@ -1,17 +1,32 @@
 #include "useful_meshes.h"
 
+#include <glm/gtx/transform.hpp>
+
 namespace gloo
 {
 
 // ============================================================================================= //
 
-AxisMesh::AxisMesh(GLint positionAttribLoc, GLint colorAttribLoc)
+namespace
+{
+
+// Sets the per-instance color as a constant vertex attribute (the shared VAO does not
+// enable the color array, so the shader reads this value for every vertex).
+void SetInstanceColor(GLint colorAttribLoc, const glm::vec3 & rgb)
+{
+  if (colorAttribLoc != -1)
+  {
+    glVertexAttrib3f(colorAttribLoc, rgb[0], rgb[1], rgb[2]);
+  }
+}
+
+MeshGroup<Batch>* BuildAxisGeometry(const PrimitiveKey & key)
 {
   const int numVertices = 6;
   const int numElements = 6;
   const GLenum drawMode = GL_LINES;
 
-  // Initialize vertices.
+  // Initialize vertices (unit axis, colored per vertex).
   GLfloat positions[] = {0.0f, 0.0f, 0.0f,  1.0f, 0.0f, 0.0f,
                          0.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f,
                          0.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f};
@@ -21,94 +36,277 @@ AxisMesh::AxisMesh(GLint positionAttribLoc, GLint colorAttribLoc)
   const GLuint* indices = nullptr;
 
   // Allocate mesh.
-  mMeshGroup = new MeshGroup<Batch>(numVertices, numElements, drawMode);
+  MeshGroup<Batch>* meshGroup = new MeshGroup<Batch>(numVertices, numElements, drawMode);
 
   // Specify its attributes.
-  mMeshGroup->SetVertexAttribList({3, 3});
+  meshGroup->SetVertexAttribList({3, 3});
 
   // Add rendering pass.
-  mMeshGroup->AddRenderingPass({{positionAttribLoc, true}, {colorAttribLoc, true}});
+  meshGroup->AddRenderingPass({{key.mAttribLocs[0], true}, {key.mAttribLocs[1], true}});
 
   // Load data.
-  mMeshGroup->Load({positions, colors}, indices);
-}
-
-AxisMesh::~AxisMesh()
-{
-  delete mMeshGroup;
-}
-
-void AxisMesh::Update(GLfloat x, GLfloat y, GLfloat z)
-{
-  GLfloat positions[] = {0.0f, 0.0f, 0.0f,     x, 0.0f, 0.0f,
-                         0.0f, 0.0f, 0.0f,  0.0f,    y, 0.0f,
-                         0.0f, 0.0f, 0.0f,  0.0f, 0.0f,    z};
-
-  mMeshGroup->Update({positions, nullptr});
-}
+  meshGroup->Load({positions, colors}, indices);
 
-void AxisMesh::Render() const
-{
-  mMeshGroup->Render();
+  return meshGroup;
 }
 
-// ============================================================================================= //
-
-BoundingBoxMesh::BoundingBoxMesh(GLint positionAttribLoc, GLint colorAttribLoc, 
-                                 const glm::vec3 & rgb)
+MeshGroup<Batch>* BuildBoundingBoxGeometry(const PrimitiveKey & key)
 {
   const int numVertices = 8;
   const int numElements = 12*2;
   const GLenum drawMode = GL_LINES;
 
-  const GLfloat r = rgb[0];
-  const GLfloat g = rgb[1];
-  const GLfloat b = rgb[2];
-
-  // Initialize vertices.
+  // Initialize vertices (unit box centered at the origin).
   GLfloat positions[] = {-0.5f, +0.5f, +0.5f,  +0.5f, +0.5f, +0.5f,
                          -0.5f, +0.5f, -0.5f,  +0.5f, +0.5f, -0.5f,
                          -0.5f, -0.5f, +0.5f,  +0.5f, -0.5f, +0.5f,
                          -0.5f, -0.5f, -0.5f,  +0.5f, -0.5f, -0.5f };
 
-  GLfloat colors [] =   {r, g, b, r, g, b,
-                         r, g, b, r, g, b,
-                         r, g, b, r, g, b,
-                         r, g, b, r, g, b};
   GLuint indices[] = { 0,1, 2,3, 4,5, 6,7,    // x
                        0,2, 1,3, 4,6, 5,7,    // z
                        0,4, 1,5, 2,6, 3,7 };  // z
 
   // Allocate mesh.
-  mMeshGroup = new MeshGroup<Batch>(numVertices, numElements, drawMode);
+  MeshGroup<Batch>* meshGroup = new MeshGroup<Batch>(numVertices, numElements, drawMode);
+
+  // Specify its attributes (colors are per instance).
+  meshGroup->SetVertexAttribList({3});
+
+  // Add rendering pass.
+  meshGroup->AddRenderingPass({{key.mAttribLocs[0], true}});
+
+  // Load data (a single attribute, so the batched buffer is just the positions).
+  meshGroup->Load(positions, indices);
+
+  return meshGroup;
+}
+
+MeshGroup<Batch>* BuildWireframeSphereGeometry(const PrimitiveKey & key)
+{
+  int w = key.mDetail+1;
+  int h = key.mDetail+1;
+
+  const int numVertices = (w * h);
+  const int numElements = (2 * w * h);
+  const GLenum drawMode = GL_LINE_STRIP;
+
+  std::vector<GLfloat> positions;
+  std::vector<GLuint> indices;
+
+  positions.reserve(numVertices * 3);
+  indices.reserve(numElements);
+
+  // Initialize vertices.
+  for (int v = 0; v < h; v++)
+  {
+    for (int u = 0; u < w; u++)
+    {
+      GLfloat theta_u = (2*M_PI * u) / (w-1);
+      GLfloat theta_v =   (M_PI * v) / (h-1);
+      GLfloat position[3];
+
+      position[0] = cos(theta_u) * sin(theta_v);
+      position[2] = sin(theta_u) * sin(theta_v);
+      position[1] = cos(theta_v);
+
+      // Vertex coordinates.
+      positions.push_back(position[0]);
+      positions.push_back(position[1]);
+      positions.push_back(position[2]);
+    }
+  }
+  
+  // Wireframe Element array - indices are written in a zig-zag pattern,
+  // first horizontally and then vertically. It uses GL_LINE_STRIP. 
+  int x = 0, y = 0;
+  int dx = 1, dy = -1;
+
+  for (y = 0; y < h; y++)  // Horizontally.
+  {
+    x = ((dx == 1) ? 0 : w-1);
+    for (int k = 0; k < w; k++, x += dx)
+      indices.push_back(w*y + x);  // INDEX(x, y).
+    dx *= -1;
+  }
+
+  // Start from the last point to allow continuity in GL_LINE_STRIP.
+  x = ((dx == 1) ? 0 : w-1);
+  y = h-1;  
+  dy = -1;
+  for (int i = 0; i < w; i++, x += dx)  // Vertically.
+  {
+    y = ((dy == 1) ? 0 : h-1);
+    for (int j = 0; j < h; j++, y += dy)
+      indices.push_back(w*y + x);  // INDEX(x, y).
+    dy *= -1;
+  }
+
+  // Allocate mesh.
+  MeshGroup<Batch>* meshGroup = new MeshGroup<Batch>(numVertices, numElements, drawMode);
+
+  // Specify its attributes (colors are per instance).
+  meshGroup->SetVertexAttribList({3});
+
+  // Add rendering pass.
+  meshGroup->AddRenderingPass({{key.mAttribLocs[0], true}});
+
+  // Load data (a single attribute, so the batched buffer is just the positions).
+  meshGroup->Load(positions.data(), indices.data());
+
+  return meshGroup;
+}
+
+MeshGroup<Batch>* BuildTexturedSphereGeometry(const PrimitiveKey & key)
+{
+  int w = key.mDetail+1;
+  int h = key.mDetail+1;
+
+  const int numVertices = (w * h);
+  const int numElements = 2*(h-2)*w + 2*w + 2*(h-2);
+  const GLenum drawMode = GL_TRIANGLE_STRIP;
+
+  std::vector<GLfloat> positions;
+  std::vector<GLfloat> normals;
+  std::vector<GLfloat> uvs;
+  std::vector<GLfloat> tangents;
+  std::vector<GLuint> indices;
+
+  positions.reserve(numVertices * 3);
+  normals.reserve(numVertices * 3);
+  uvs.reserve(numVertices * 2);
+  tangents.reserve(numVertices * 3);
+  indices.reserve(numElements);
+
+  // Initialize vertices.
+  for (int v = 0; v < h; v++)
+  {
+    for (int u = 0; u < w; u++)
+    {
+      GLfloat theta_u = (2*M_PI * u) / (w-1);
+      GLfloat theta_v =   (M_PI * v) / (h-1);
+      GLfloat position[3];
+
+      position[0] = cos(theta_u) * sin(theta_v);
+      position[2] = sin(theta_u) * sin(theta_v);
+      position[1] = cos(theta_v);
+
+      // Vertex coordinates.
+      positions.push_back(position[0]);
+      positions.push_back(position[1]);
+      positions.push_back(position[2]);
+
+      // TODO: generate better tangets.
+      glm::vec3 n(2*position[0], 2*position[1], 2*position[2]);
+      n = glm::normalize(n);
+      glm::vec3 t(-n[2], 0.0f, n[0]);
+      t = -glm::normalize(t);
+
+      // Vertex normals.
+      normals.push_back(n[0]);
+      normals.push_back(n[1]);
+      normals.push_back(n[2]);
+
+      // Vertex uvs.
+      uvs.push_back(1.0f - static_cast<float>(u)/(w-1));
+      uvs.push_back(1.0f - static_cast<float>(v)/(h-1));
+
+      tangents.push_back(t[0]);
+      tangents.push_back(t[1]);
+      tangents.push_back(t[2]);
+    }
+  }
+
+  for (int v = 0; v < h-1; v++)
+  {
+    // Zig-zag pattern: alternate between top and bottom.
+    for (int u = 0; u < w; u++)
+    {
+      indices.push_back((v+0)*w + u);
+      indices.push_back((v+1)*w + u);
+    }
+
+    // Triangle row transition: handle discontinuity.
+    if (v < h-2)
+    {
+      // Repeat last vertex and the next row first vertex to generate 
+      // two invalid triangles and get continuity in the mesh.
+      indices.push_back((v+1)*w + (w-1)); //INDEX(this->width-1, y+1);
+      indices.push_back((v+1)*w + 0);     //INDEX(0, y+1);
+    }
+  }
+
+  // Allocate mesh.
+  MeshGroup<Batch>* meshGroup = new MeshGroup<Batch>(numVertices, numElements, drawMode);
 
   // Specify its attributes.
-  mMeshGroup->SetVertexAttribList({3, 3});
+  meshGroup->SetVertexAttribList({3, 3, 2, 3});
 
   // Add rendering pass.
-  mMeshGroup->AddRenderingPass({{positionAttribLoc, true}, {colorAttribLoc, true}});
+  meshGroup->AddRenderingPass({{key.mAttribLocs[0], true},
+                               {key.mAttribLocs[1], true},
+                               {key.mAttribLocs[2], true}, 
+                               {key.mAttribLocs[3], true}
+                              });
 
   // Load data.
-  mMeshGroup->Load({positions, colors}, indices);
+  meshGroup->Load({positions.data(), normals.data(), uvs.data(), tangents.data()}, indices.data());
+
+  return meshGroup;
+}
+
+}  // namespace.
+
+// ============================================================================================= //
+
+AxisMesh::AxisMesh(GLint positionAttribLoc, GLint colorAttribLoc)
+: mKey({kAxisPrimitive, 0, {positionAttribLoc, colorAttribLoc, -1, -1}})
+{
+  mMeshGroup = PrimitiveCache::Acquire(mKey, BuildAxisGeometry);
+}
+
+AxisMesh::~AxisMesh()
+{
+  PrimitiveCache::Release(mKey);
+}
+
+void AxisMesh::Update(GLfloat x, GLfloat y, GLfloat z)
+{
+  mLocal = glm::scale(glm::vec3(x, y, z));
+}
+
+void AxisMesh::Draw() const
+{
+  mMeshGroup->Render();
+}
+
+// ============================================================================================= //
+
+BoundingBoxMesh::BoundingBoxMesh(GLint positionAttribLoc, GLint colorAttribLoc, 
+                                 const glm::vec3 & rgb)
+: mKey({kBoundingBoxPrimitive, 0, {positionAttribLoc, -1, -1, -1}})
+, mColorAttribLoc(colorAttribLoc)
+, mColor(rgb)
+{
+  mMeshGroup = PrimitiveCache::Acquire(mKey, BuildBoundingBoxGeometry);
 }
 
 BoundingBoxMesh::~BoundingBoxMesh()
 {
-  delete mMeshGroup;
+  PrimitiveCache::Release(mKey);
 }
 
 void BoundingBoxMesh::Update(GLfloat xmin, GLfloat xmax, GLfloat ymin, GLfloat ymax, GLfloat zmin, GLfloat zmax)
 {
-  GLfloat positions[] = {xmin, ymax, zmax,  xmax, ymax, zmax,
-                         xmin, ymax, zmin,  xmax, ymax, zmin,
-                         xmin, ymin, zmax,  xmax, ymin, zmax,
-                         xmin, ymin, zmin,  xmax, ymin, zmin };
+  // Maps the unit box [-0.5, +0.5]^3 onto [xmin, xmax] x [ymin, ymax] x [zmin, zmax].
+  glm::vec3 center(0.5f*(xmin + xmax), 0.5f*(ymin + ymax), 0.5f*(zmin + zmax));
+  glm::vec3 extent(xmax - xmin, ymax - ymin, zmax - zmin);
 
-  mMeshGroup->Update({positions, nullptr});
+  mLocal = glm::translate(center) * glm::scale(extent);
 }
 
-void BoundingBoxMesh::Render() const
+void BoundingBoxMesh::Draw() const
 {
+  SetInstanceColor(mColorAttribLoc, mColor);
   mMeshGroup->Render();
 }
 
@@ -294,93 +492,16 @@ void Polygon::Render() const
 
 WireframeSphere::WireframeSphere(GLint positionAttribLoc, GLint colorAttribLoc, 
                                  const glm::vec3 & rgb, int detail) 
+: mKey({kWireframeSpherePrimitive, detail, {positionAttribLoc, -1, -1, -1}})
+, mColorAttribLoc(colorAttribLoc)
+, mColor(rgb)
 {
-  int w = detail+1;
-  int h = detail+1;
-
-  const int numVertices = (w * h);
-  const int numElements = (2 * w * h);
-  const GLenum drawMode = GL_LINE_STRIP;
-
-  std::vector<GLfloat> positions;
-  std::vector<GLfloat> colors;
-  std::vector<GLuint> indices;
-
-  positions.reserve(numVertices * 3);
-  colors.reserve(numVertices * 3);
-  indices.reserve(numElements);
-
-  const GLfloat r = rgb[0];
-  const GLfloat g = rgb[1];
-  const GLfloat b = rgb[2];
-
-  // Initialize vertices.
-  for (int v = 0; v < h; v++)
-  {
-    for (int u = 0; u < w; u++)
-    {
-      GLfloat theta_u = (2*M_PI * u) / (w-1);
-      GLfloat theta_v =   (M_PI * v) / (h-1);
-      GLfloat position[3];
-
-      position[0] = cos(theta_u) * sin(theta_v);
-      position[2] = sin(theta_u) * sin(theta_v);
-      position[1] = cos(theta_v);
-
-      // Vertex coordinates.
-      positions.push_back(position[0]);
-      positions.push_back(position[1]);
-      positions.push_back(position[2]);
-
-      // Vertex colors.
-      colors.push_back(r);
-      colors.push_back(g);
-      colors.push_back(b);
-    }
-  }
-  
-  // Wireframe Element array - indices are written in a zig-zag pattern,
-  // first horizontally and then vertically. It uses GL_LINE_STRIP. 
-  int index = 0;
-  int x = 0, y = 0;
-  int dx = 1, dy = -1;
-
-  for (y = 0; y < h; y++)  // Horizontally.
-  {
-    x = ((dx == 1) ? 0 : w-1);
-    for (int k = 0; k < w; k++, x += dx)
-      indices.push_back(w*y + x);  // INDEX(x, y).
-    dx *= -1;
-  }
-
-  // Start from the last point to allow continuity in GL_LINE_STRIP.
-  x = ((dx == 1) ? 0 : w-1);
-  y = h-1;  
-  dy = -1;
-  for (int i = 0; i < w; i++, x += dx)  // Vertically.
-  {
-    y = ((dy == 1) ? 0 : h-1);
-    for (int j = 0; j < h; j++, y += dy)
-      indices.push_back(w*y + x);  // INDEX(x, y).
-    dy *= -1;
-  }
-
-  // Allocate mesh.
-  mMeshGroup = new MeshGroup<Batch>(numVertices, numElements, drawMode);
-
-  // Specify its attributes.
-  mMeshGroup->SetVertexAttribList({3, 3});
-
-  // Add rendering pass.
-  mMeshGroup->AddRenderingPass({{positionAttribLoc, true}, {colorAttribLoc, true}});
-
-  // Load data.
-  mMeshGroup->Load({positions.data(), colors.data()}, indices.data());
+  mMeshGroup = PrimitiveCache::Acquire(mKey, BuildWireframeSphereGeometry);
 }
 
 WireframeSphere::~WireframeSphere() 
 {
-  delete mMeshGroup;
+  PrimitiveCache::Release(mKey);
 }
 
 void WireframeSphere::Update() 
@@ -388,8 +509,9 @@ void WireframeSphere::Update()
   // Do nothing.
 }
 
-void WireframeSphere::Render() const
+void WireframeSphere::Draw() const
 {
+  SetInstanceColor(mColorAttribLoc, mColor);
   mMeshGroup->Render();
 }
 
@@ -397,106 +519,15 @@ void WireframeSphere::Render() const
 
 TexturedSphere::TexturedSphere(GLint positionAttribLoc, GLint normalAttribLoc, GLint uvAttribLoc,
                                GLint tangentAttribLoc, const Material & material)
+: mKey({kTexturedSpherePrimitive, 64, {positionAttribLoc, normalAttribLoc, uvAttribLoc, tangentAttribLoc}})
+, mMaterial(material)
 {
-  mMaterial = material;
-
-  int w = 65;
-  int h = 65;
-
-  const int numVertices = (w * h);
-  const int numElements = 2*(h-2)*w + 2*w + 2*(h-2);
-  const GLenum drawMode = GL_TRIANGLE_STRIP;
-
-  std::vector<GLfloat> positions;
-  std::vector<GLfloat> normals;
-  std::vector<GLfloat> uvs;
-  std::vector<GLfloat> tangents;
-  std::vector<GLuint> indices;
-
-  positions.reserve(numVertices * 3);
-  normals.reserve(numVertices * 3);
-  uvs.reserve(numVertices * 2);
-  tangents.reserve(numVertices * 3);
-  indices.reserve(numElements);
-
-  // Initialize vertices.
-  for (int v = 0; v < h; v++)
-  {
-    for (int u = 0; u < w; u++)
-    {
-      GLfloat theta_u = (2*M_PI * u) / (w-1);
-      GLfloat theta_v =   (M_PI * v) / (h-1);
-      GLfloat position[3];
-
-      position[0] = cos(theta_u) * sin(theta_v);
-      position[2] = sin(theta_u) * sin(theta_v);
-      position[1] = cos(theta_v);
-
-      // Vertex coordinates.
-      positions.push_back(position[0]);
-      positions.push_back(position[1]);
-      positions.push_back(position[2]);
-
-      // TODO: generate better tangets.
-      glm::vec3 n(2*position[0], 2*position[1], 2*position[2]);
-      n = glm::normalize(n);
-      glm::vec3 t(-n[2], 0.0f, n[0]);
-      t = -glm::normalize(t);
-
-      // Vertex normals.
-      normals.push_back(n[0]);
-      normals.push_back(n[1]);
-      normals.push_back(n[2]);
-
-      // Vertex uvs.
-      uvs.push_back(1.0f - static_cast<float>(u)/(w-1));
-      uvs.push_back(1.0f - static_cast<float>(v)/(h-1));
-
-      tangents.push_back(t[0]);
-      tangents.push_back(t[1]);
-      tangents.push_back(t[2]);
-    }
-  }
-
-  for (int v = 0; v < h-1; v++)
-  {
-    // Zig-zag pattern: alternate between top and bottom.
-    for (int u = 0; u < w; u++)
-    {
-      indices.push_back((v+0)*w + u);
-      indices.push_back((v+1)*w + u);
-    }
-
-    // Triangle row transition: handle discontinuity.
-    if (v < h-2)
-    {
-      // Repeat last vertex and the next row first vertex to generate 
-      // two invalid triangles and get continuity in the mesh.
-      indices.push_back((v+1)*w + (w-1)); //INDEX(this->width-1, y+1);
-      indices.push_back((v+1)*w + 0);     //INDEX(0, y+1);
-    }
-  }
-
-  // Allocate mesh.
-  mMeshGroup = new MeshGroup<Batch>(numVertices, numElements, drawMode);
-
-  // Specify its attributes.
-  mMeshGroup->SetVertexAttribList({3, 3, 2, 3});
-
-  // Add rendering pass.
-  mMeshGroup->AddRenderingPass({{positionAttribLoc, true},
-                                {normalAttribLoc, true},
-                                {uvAttribLoc, true}, 
-                                {tangentAttribLoc, true}
-                              });
-
-  // Load data.
-  mMeshGroup->Load({positions.data(), normals.data(), uvs.data(), tangents.data()}, indices.data());
+  mMeshGroup = PrimitiveCache::Acquire(mKey, BuildTexturedSphereGeometry);
 }
 
 TexturedSphere::~TexturedSphere() 
 {
-  delete mMeshGroup;
+  PrimitiveCache::Release(mKey);
 }
 
 void TexturedSphere::Update() 
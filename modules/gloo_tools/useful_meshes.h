@@ -9,7 +9,9 @@
 #include "gloo/material.h"
 #include "gloo/texture.h"
 #include "gloo/group.h"
+#include "camera.h"
 #include "transform.h"
+#include "primitive_cache.h"
 
 // ============================================================================================= //
 // This file provides a set of useful meshes for genral purpose and debugging, such as
@@ -22,7 +24,7 @@
 //     BoundingBoxMesh* mesh = new BoundingBoxMesh(renderer->GetPositionLoc(), 
 //                                                 renderer->GetColorLoc(), 1, 0, 0);
 //   2. Render whenever you want:
-//     mesh->Render();
+//     mesh->Render(mDebugRenderer, modelTransform, camera);
 // 
 //   3. Update according to its specific Update() method:
 //     mesh->Update(-2, +2, 0, 1, 0, 1);  // BB.
@@ -30,6 +32,17 @@
 //   4. Delete after its use:
 //     delete mesh;
 //
+// AxisMesh, BoundingBoxMesh, WireframeSphere and TexturedSphere share their GPU geometry
+// through gloo::PrimitiveCache (see primitive_cache.h): all instances with the same type,
+// detail and attribute locations use the same VBO/EAB/VAO. Their per-instance data is
+// kept apart from the shared geometry:
+//   -> Color is uploaded as a constant vertex attribute right before drawing (Draw()).
+//   -> Extents/lengths set by Update() are stored in a local matrix (GetLocalMatrix()),
+//      which must be combined with the model transform.
+// Render(renderer, model, camera) does both (through DebugRenderer::RenderPrimitive()). The
+// shared geometry itself (GetUnitMeshGroup()) is the unit primitive: drawing it directly ignores
+// Update() and the instance color.
+//
 // ============================================================================================= //
 
 #pragma once
@@ -43,12 +56,24 @@ public:
   AxisMesh(GLint positionAttribLoc, GLint colorAttribLoc);
   ~AxisMesh();
 
-  void Render() const;
-  void Update(GLfloat x, GLfloat y, GLfloat z);
+  // Draws the instance with renderer (e.g. a DebugRenderer): model * GetLocalMatrix().
+  template <class R>
+  void Render(const R* renderer, Transform & model, Camera* camera) const
+  {
+    renderer->RenderPrimitive(this, model, camera);
+  }
 
-  const MeshGroup<Batch>* GetMeshGroup() const { return mMeshGroup; }
+  // Draws the unit axes (x red, y green, z blue): the model-view-projection matrix of the
+  // shader must already include GetLocalMatrix().
+  void Draw() const;
+  void Update(GLfloat x, GLfloat y, GLfloat z);  // Sets the length of each axis.
+
+  const MeshGroup<Batch>* GetUnitMeshGroup() const { return mMeshGroup; }
+  const glm::mat4 & GetLocalMatrix() const { return mLocal; }
 
 private:
+  PrimitiveKey mKey;
+  glm::mat4 mLocal { glm::mat4(1.0f) };  // Unit axis -> instance.
   MeshGroup<Batch>* mMeshGroup;
 };
 
@@ -59,12 +84,30 @@ public:
                   const glm::vec3 & rgb = {1.0f, 1.0f, 1.0f});
   ~BoundingBoxMesh();
 
-  void Render() const;
+  // Draws the instance with renderer (e.g. a DebugRenderer): model * GetLocalMatrix(), in
+  // the instance color.
+  template <class R>
+  void Render(const R* renderer, Transform & model, Camera* camera) const
+  {
+    renderer->RenderPrimitive(this, model, camera);
+  }
+
+  // Sets the instance color and draws the unit box: the model-view-projection matrix of the
+  // shader must already include GetLocalMatrix().
+  void Draw() const;
   void Update(GLfloat xmin, GLfloat xmax, GLfloat ymin, GLfloat ymax, GLfloat zmin, GLfloat zmax);
 
-  const MeshGroup<Batch>* GetMeshGroup() const { return mMeshGroup; }
+  const MeshGroup<Batch>* GetUnitMeshGroup() const { return mMeshGroup; }
+  const glm::mat4 & GetLocalMatrix() const { return mLocal; }
+
+  glm::vec3 GetColor() const { return mColor; }
+  void SetColor(const glm::vec3 & rgb) { mColor = rgb; }
 
 private:
+  PrimitiveKey mKey;
+  GLint mColorAttribLoc;
+  glm::vec3 mColor;
+  glm::mat4 mLocal { glm::mat4(1.0f) };  // Unit box -> instance.
   MeshGroup<Batch>* mMeshGroup;
 };
 
@@ -106,12 +149,30 @@ public:
                   const glm::vec3 & rgb = {0.8f, 0.8f, 0.8f}, int detail = 16);
   ~WireframeSphere();
 
-  void Render() const;
+  // Draws the instance with renderer (e.g. a DebugRenderer): model * GetLocalMatrix(), in
+  // the instance color.
+  template <class R>
+  void Render(const R* renderer, Transform & model, Camera* camera) const
+  {
+    renderer->RenderPrimitive(this, model, camera);
+  }
+
+  // Sets the instance color and draws the unit sphere: the model-view-projection matrix of the
+  // shader must already include GetLocalMatrix().
+  void Draw() const;
   void Update();
 
-  const MeshGroup<Batch>* GetMeshGroup() const { return mMeshGroup; };
+  const MeshGroup<Batch>* GetUnitMeshGroup() const { return mMeshGroup; }
+  const glm::mat4 & GetLocalMatrix() const { return mLocal; }
+
+  glm::vec3 GetColor() const { return mColor; }
+  void SetColor(const glm::vec3 & rgb) { mColor = rgb; }
 
 private:
+  PrimitiveKey mKey;
+  GLint mColorAttribLoc;
+  glm::vec3 mColor;
+  glm::mat4 mLocal { glm::mat4(1.0f) };  // Unit sphere -> instance.
   MeshGroup<Batch>* mMeshGroup;
 };
 
@@ -131,6 +192,7 @@ public:
   const MeshGroup<Batch>* GetMeshGroup() const { return mMeshGroup; }
 
 private:
+  PrimitiveKey mKey;
   Material mMaterial;
   MeshGroup<Batch>* mMeshGroup;
 };
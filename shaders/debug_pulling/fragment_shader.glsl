@@ -0,0 +1,9 @@
+#version 430
+
+in vec4 f_color;
+out vec4 pixel_color;
+
+void main()
+{
+  pixel_color = f_color;
+}
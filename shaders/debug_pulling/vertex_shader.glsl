@@ -0,0 +1,61 @@
+#version 430
+#extension GL_ARB_shader_draw_parameters : require
+
+// Vertex pulling variant of shaders/debug: there are no vertex attributes. The vertices are
+// fetched from the geometry buffer, as the record of the draw (gl_DrawIDARB) describes
+// (see gloo::GeometryBuffer and gloo::IndirectDrawList).
+
+struct DrawRecord
+{
+  mat4 M;              // Model matrix.
+  mat4 N;              // Normal matrix N = (M^-1)'.
+  vec4 Ka;             // Material (w is not used).
+  vec4 Kd;
+  vec4 Ks;
+  ivec2 attribs[4];    // (offset, stride) of the attribute at each location (offset < 0: none).
+  uint first_float;    // Of the mesh in vertex_data.
+};
+
+layout (std430, binding = 0) readonly buffer DrawRecords
+{
+  DrawRecord draws[];
+};
+
+layout (std430, binding = 1) readonly buffer VertexData
+{
+  float vertex_data[];
+};
+
+out vec4 f_color;
+
+uniform mat4 MVP;  // P*V (the model matrix of each draw is in its record).
+
+// Index of the first component of attribute 'location' of this vertex.
+uint AttribIndex(uint draw, int location)
+{
+  ivec2 attrib = draws[draw].attribs[location];
+  return draws[draw].first_float + uint(attrib.x) + uint(gl_VertexID) * uint(attrib.y);
+}
+
+vec3 FetchVec3(uint draw, int location, vec3 fallback)
+{
+  if (draws[draw].attribs[location].x < 0)
+    return fallback;
+
+  uint i = AttribIndex(draw, location);
+  return vec3(vertex_data[i], vertex_data[i + 1], vertex_data[i + 2]);
+}
+
+void main()
+{
+  uint draw = uint(gl_DrawIDARB);
+
+  vec3 v_position = FetchVec3(draw, 0, vec3(0.0));
+  vec3 v_color    = FetchVec3(draw, 1, draws[draw].Kd.xyz);
+
+  // Transform and project input vertex using model-view-projection matrix.
+  gl_Position = MVP * (draws[draw].M * vec4(v_position, 1.0f));  // P*V*M * vpos.
+
+  // Compute the vertex color (into f_color) to be interpolated.
+  f_color = vec4(v_color, 1.0);
+}
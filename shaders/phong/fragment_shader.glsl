@@ -2,15 +2,16 @@
 
 // === Uniform Structures ===  //
 
+// Members are ordered so that the std140 layout has no holes (see uniform_blocks.h).
 struct LightSource
 {
-  vec3 pos;  // Center coordinates.
-  vec3 dir;  // Direction vector.
+  vec3 pos;     // Center coordinates.
+  float alpha;  // Shininess of specular component.
+  vec3 dir;     // Direction vector.
+  int enabled;  // Light source state (on/off).
 
   vec3 Ld;  // Diffuse component  (in [0, 1]).
   vec3 Ls;  // Specular component (in [0, 1]).
-
-  float alpha;  // Shininess of specular component.
 };
 
 struct Material
@@ -29,44 +30,64 @@ in vec2 f_uv;
 
 out vec4 pixel_color;
 
-// === Light Sources === //
+// === Light Sources (per frame) === //
 const int max_num_lights = 8;
-uniform int lighting = 0;  // Boolean.
 
-uniform int num_lights = 1;                 // Number of light sources.
-uniform int light_switch[max_num_lights];   // Array of light source states (on/off).
-
-uniform vec3 La = vec3(0.1);                // Ambient light component.
-uniform LightSource light[max_num_lights];  // Array of light sources.
+layout (std140) uniform Lights
+{
+  LightSource light[max_num_lights];  // Array of light sources.
+  vec3 La;                            // Ambient light component.
+  int lighting;                       // Boolean (the shader tests LIGHTING instead).
+  int num_lights;                     // Number of light sources (NUM_LIGHTS instead).
+};
 
 // === Texture === //
 uniform sampler2D color_map;
 uniform sampler2D normal_map;
 
-// === Material === //
-uniform Material material;
+// === Object (per draw) === //
+layout (std140) uniform Object
+{
+  mat4 M;             // Model matrix.
+  mat4 N;             // Normal matrix N = (M^-1)'.
+  Material material;  // Material properties (Ka, Kd, Ks).
+};
+
+// === Features === //
+// Defined by PhongRenderer (after #version) for each shader variant:
+// LIGHTING, NUM_LIGHTS, COLOR_MAP.
+// Without them, the unlit surface color is output.
+#ifndef NUM_LIGHTS
+#define NUM_LIGHTS 0
+#endif
 
 // === Code === //
 
 void main()
 {
-  if (lighting == 0)  // off.
+#ifdef COLOR_MAP
+  vec4 color = texture(color_map, f_uv);
+#else
+  vec4 color = vec4(material.Kd, 1.0);
+#endif
+
+#ifndef LIGHTING
   {
-    pixel_color = texture(color_map, f_uv);
+    pixel_color = color;
   }
-  else  // on.
+#else
   {
     vec3 Ka = material.Ka;
-    vec3 Kd = texture(color_map, f_uv).xyz;
+    vec3 Kd = color.xyz;
     vec3 Ks = material.Ks;
 
     // Fragment data and light sources are in camera coordinates.
     vec3 I = Ka*La;
     vec3 n = f_normal.xyz;
 
-    for (int i = 0; i < num_lights; i++)
+    for (int i = 0; i < NUM_LIGHTS; i++)  // Constant: unrolled.
     {
-      if (light_switch[i] == 0)  // Off!
+      if (light[i].enabled == 0)  // Off!
         continue;
 
       vec3 l  = normalize(light[i].pos - f_position.xyz);  // Unit vector from fragment to light source.
@@ -83,4 +104,5 @@ void main()
     
     pixel_color = vec4(I, 1.0);
   }
+#endif
 }
\ No newline at end of file
@@ -11,10 +11,25 @@ out vec2 f_uv;        // Fragment uv coordinates.
 
 // out vec4 f_tangent;   // Fragment tangent vector in camera coordinates.
 
-uniform mat4 M;  // Model matrix.
-uniform mat4 V;  // View  matrix.
-uniform mat4 P;  // Projection matrix.
-uniform mat4 N;  // Normal matrix N = (VM)^-t.
+struct Material
+{
+  vec3 Ka;  // Ambient component (in [0, 1]).
+  vec3 Kd;  // Diffuse component (in [0, 1]).
+  vec3 Ks;  // Specular component (in [0, 1]).
+};
+
+layout (std140) uniform Camera  // Per frame.
+{
+  mat4 V;  // View  matrix.
+  mat4 P;  // Projection matrix.
+};
+
+layout (std140) uniform Object  // Per draw.
+{
+  mat4 M;             // Model matrix.
+  mat4 N;             // Normal matrix N = (M^-1)'.
+  Material material;  // Material properties (Ka, Kd, Ks).
+};
 
 // const float C = 1;
 // const float far = 1000;
@@ -0,0 +1,100 @@
+#version 430
+
+// Vertex pulling variant of shaders/phong: the material comes from the vertex shader (from the
+// record of the draw) instead of the Object block.
+
+// === Uniform Structures ===  //
+
+// Members are ordered so that the std140 layout has no holes (see uniform_blocks.h).
+struct LightSource
+{
+  vec3 pos;     // Center coordinates.
+  float alpha;  // Shininess of specular component.
+  vec3 dir;     // Direction vector.
+  int enabled;  // Light source state (on/off).
+
+  vec3 Ld;  // Diffuse component  (in [0, 1]).
+  vec3 Ls;  // Specular component (in [0, 1]).
+};
+
+// === I/O === //
+
+// Per-fragment data:
+in vec4 f_position;
+in vec4 f_normal;
+in vec2 f_uv;
+
+flat in vec3 f_Ka;  // Material of the draw.
+flat in vec3 f_Kd;
+flat in vec3 f_Ks;
+
+out vec4 pixel_color;
+
+// === Light Sources (per frame) === //
+const int max_num_lights = 8;
+
+layout (std140) uniform Lights
+{
+  LightSource light[max_num_lights];  // Array of light sources.
+  vec3 La;                            // Ambient light component.
+  int lighting;                       // Boolean (the shader tests LIGHTING instead).
+  int num_lights;                     // Number of light sources (NUM_LIGHTS instead).
+};
+
+// === Texture === //
+uniform sampler2D color_map;
+uniform sampler2D normal_map;
+
+// === Features === //
+// Defined by PhongRenderer (after #version) for each shader variant:
+// LIGHTING, NUM_LIGHTS, COLOR_MAP.
+// Without them, the unlit surface color is output.
+#ifndef NUM_LIGHTS
+#define NUM_LIGHTS 0
+#endif
+
+// === Code === //
+
+void main()
+{
+#ifdef COLOR_MAP
+  vec4 color = texture(color_map, f_uv);
+#else
+  vec4 color = vec4(f_Kd, 1.0);
+#endif
+
+#ifndef LIGHTING
+  {
+    pixel_color = color;
+  }
+#else
+  {
+    vec3 Ka = f_Ka;
+    vec3 Kd = color.xyz;
+    vec3 Ks = f_Ks;
+
+    // Fragment data and light sources are in camera coordinates.
+    vec3 I = Ka*La;
+    vec3 n = f_normal.xyz;
+
+    for (int i = 0; i < NUM_LIGHTS; i++)  // Constant: unrolled.
+    {
+      if (light[i].enabled == 0)  // Off!
+        continue;
+
+      vec3 l  = normalize(light[i].pos - f_position.xyz);  // Unit vector from fragment to light source.
+      vec3 r  = -reflect(l, n);                            // Reflection of light ray on fragment.
+      vec3 f = normalize(-f_position.xyz);                 // Unit vector from fragment to camera (origin).
+      float d =    length(light[i].pos - f_position.xyz);  // Distance from fragment to light source.
+      float alpha = light[i].alpha;
+
+      vec3 Id = light[i].Ld * max(dot(n, l), 0);              // Diffuse component.
+      vec3 Is = light[i].Ls * pow(max(dot(r, f), 0), alpha);  // Specular component. TODO: shininess.
+
+      I += (Kd*Id + Ks*Is);
+    }
+    
+    pixel_color = vec4(I, 1.0);
+  }
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+#version 430
+#extension GL_ARB_shader_draw_parameters : require
+
+// Vertex pulling variant of shaders/phong: there are no vertex attributes and no Object block.
+// The vertices, the model/normal matrices and the material are read from the record of the draw
+// (gl_DrawIDARB) and the geometry buffer (see gloo::GeometryBuffer and gloo::IndirectDrawList).
+// Locations: 0 = position, 1 = normal, 2 = uv.
+
+struct DrawRecord
+{
+  mat4 M;              // Model matrix.
+  mat4 N;              // Normal matrix N = (M^-1)'.
+  vec4 Ka;             // Material (w is not used).
+  vec4 Kd;
+  vec4 Ks;
+  ivec2 attribs[4];    // (offset, stride) of the attribute at each location (offset < 0: none).
+  uint first_float;    // Of the mesh in vertex_data.
+};
+
+layout (std430, binding = 0) readonly buffer DrawRecords
+{
+  DrawRecord draws[];
+};
+
+layout (std430, binding = 1) readonly buffer VertexData
+{
+  float vertex_data[];
+};
+
+out vec4 f_position;  // Fragment position in camera coordinates.
+out vec4 f_normal;    // Fragment normal in camera coordinates.
+out vec2 f_uv;        // Fragment uv coordinates.
+
+flat out vec3 f_Ka;   // Material of the draw.
+flat out vec3 f_Kd;
+flat out vec3 f_Ks;
+
+layout (std140) uniform Camera  // Per frame.
+{
+  mat4 V;  // View  matrix.
+  mat4 P;  // Projection matrix.
+};
+
+// Index of the first component of attribute 'location' of this vertex.
+uint AttribIndex(uint draw, int location)
+{
+  ivec2 attrib = draws[draw].attribs[location];
+  return draws[draw].first_float + uint(attrib.x) + uint(gl_VertexID) * uint(attrib.y);
+}
+
+vec3 FetchVec3(uint draw, int location, vec3 fallback)
+{
+  if (draws[draw].attribs[location].x < 0)
+    return fallback;
+
+  uint i = AttribIndex(draw, location);
+  return vec3(vertex_data[i], vertex_data[i + 1], vertex_data[i + 2]);
+}
+
+vec2 FetchVec2(uint draw, int location, vec2 fallback)
+{
+  if (draws[draw].attribs[location].x < 0)
+    return fallback;
+
+  uint i = AttribIndex(draw, location);
+  return vec2(vertex_data[i], vertex_data[i + 1]);
+}
+
+void main()
+{
+  uint draw = uint(gl_DrawIDARB);
+  mat4 M = draws[draw].M;
+  mat4 N = draws[draw].N;
+
+  vec3 v_position = FetchVec3(draw, 0, vec3(0.0));
+  vec3 v_normal   = FetchVec3(draw, 1, vec3(0.0, 0.0, 1.0));
+  vec2 v_uv       = FetchVec2(draw, 2, vec2(0.0));
+
+  // Compute vertex position in camera coordinates.
+  f_position = V * (M * vec4(v_position, 1.0f));
+  f_position = f_position/f_position.w;
+
+  // Then project f_position onto screen and store into gl_Position.
+  gl_Position = P * f_position;
+
+  // Transform the vertex normal vector.
+  f_normal = normalize(V * N * vec4(v_normal, 0.0));
+
+  // Pass uv coordinates to be interpolated, and the material as is.
+  f_uv = v_uv;
+  f_Ka = draws[draw].Ka.xyz;
+  f_Kd = draws[draw].Kd.xyz;
+  f_Ks = draws[draw].Ks.xyz;
+}
@@ -0,0 +1,7 @@
+#version 330
+
+// Depth only: no color output (the framebuffer has no color buffer).
+
+void main()
+{
+}
@@ -0,0 +1,12 @@
+#version 330
+
+// Depth-only pass of gloo::PhongShadowMappingRenderer (one cascade at a time).
+
+layout (location = 0) in vec3 v_position;
+
+uniform mat4 MVP;  // Light view-projection of the cascade * model.
+
+void main()
+{
+  gl_Position = MVP * vec4(v_position, 1.0f);
+}
@@ -0,0 +1,163 @@
+#version 330
+
+// === Uniform Structures ===  //
+
+// Members are ordered so that the std140 layout has no holes (see uniform_blocks.h).
+struct LightSource
+{
+  vec3 pos;     // Center coordinates.
+  float alpha;  // Shininess of specular component.
+  vec3 dir;     // Direction vector.
+  int enabled;  // Light source state (on/off).
+
+  vec3 Ld;  // Diffuse component  (in [0, 1]).
+  vec3 Ls;  // Specular component (in [0, 1]).
+};
+
+struct Material
+{
+  vec3 Ka;  // Ambient component (in [0, 1]).
+  vec3 Kd;  // Diffuse component (in [0, 1]).
+  vec3 Ks;  // Specular component (in [0, 1]).
+};
+
+// === I/O === //
+
+// Per-fragment data:
+in vec4 f_position;
+in vec4 f_normal;
+in vec2 f_uv;
+
+out vec4 pixel_color;
+
+// === Light Sources (per frame) === //
+const int max_num_lights = 8;
+
+layout (std140) uniform Lights
+{
+  LightSource light[max_num_lights];  // Array of light sources.
+  vec3 La;                            // Ambient light component.
+  int lighting;                       // Boolean (the shader tests LIGHTING instead).
+  int num_lights;                     // Number of light sources (NUM_LIGHTS instead).
+};
+
+// === Texture === //
+uniform sampler2D color_map;
+uniform sampler2D normal_map;
+
+// === Shadows (per frame, see gloo::PhongShadowMappingRenderer) === //
+const int max_cascades = 4;
+
+layout (std140) uniform Shadows
+{
+  mat4 shadow_matrix[max_cascades];  // Camera coordinates -> shadow map coordinates ([0, 1]).
+  vec4 cascade_far;                  // Far distance of each cascade (camera space).
+  vec4 light_dir;                    // Towards the shadow light (camera coordinates).
+  int num_cascades;
+  int shadow_light;                  // Light that casts shadows (-1: none).
+  float texel_size;                  // 1 / shadow map size.
+  float bias;                        // Depth bias, in texels.
+};
+
+uniform sampler2DArrayShadow shadow_map;  // One layer per cascade.
+
+// === Object (per draw) === //
+layout (std140) uniform Object
+{
+  mat4 M;             // Model matrix.
+  mat4 N;             // Normal matrix N = (M^-1)'.
+  Material material;  // Material properties (Ka, Kd, Ks).
+};
+
+// === Features === //
+// Defined by PhongRenderer (after #version) for each shader variant:
+// LIGHTING, NUM_LIGHTS, COLOR_MAP.
+// Without them, the unlit surface color is output.
+#ifndef NUM_LIGHTS
+#define NUM_LIGHTS 0
+#endif
+
+// === Code === //
+
+// Fraction of the shadow light that reaches the fragment (0 = in shadow), from the cascade that
+// covers its depth: 3x3 PCF taps, each a bilinear (hardware) 2x2 comparison.
+float ShadowVisibility(vec3 n, vec3 l)
+{
+  float depth = -f_position.z;
+  int cascade = 0;
+  while ((cascade < num_cascades - 1) && (depth > cascade_far[cascade]))
+    cascade++;
+
+  if (depth > cascade_far[cascade])  // Beyond the shadow distance.
+    return 1.0;
+
+  // Slope-scaled bias: grazing surfaces need more.
+  float cosTheta = clamp(dot(n, l), 0.0, 1.0);
+  float slope = sqrt(1.0 - cosTheta * cosTheta);
+  float depthBias = texel_size * bias * (1.0 + 2.0 * slope);
+
+  vec4 p = shadow_matrix[cascade] * vec4(f_position.xyz, 1.0);
+  float visibility = 0.0;
+  for (int x = -1; x <= 1; x++)
+  {
+    for (int y = -1; y <= 1; y++)
+    {
+      vec2 uv = p.xy + vec2(x, y) * texel_size;
+      visibility += texture(shadow_map, vec4(uv, float(cascade), p.z - depthBias));
+    }
+  }
+
+  return visibility / 9.0;
+}
+
+void main()
+{
+#ifdef COLOR_MAP
+  vec4 color = texture(color_map, f_uv);
+#else
+  vec4 color = vec4(material.Kd, 1.0);
+#endif
+
+#ifndef LIGHTING
+  {
+    pixel_color = color;
+  }
+#else
+  {
+    vec3 Ka = material.Ka;
+    vec3 Kd = color.xyz;
+    vec3 Ks = material.Ks;
+
+    // Fragment data and light sources are in camera coordinates.
+    vec3 I = Ka*La;
+    vec3 n = f_normal.xyz;
+
+    for (int i = 0; i < NUM_LIGHTS; i++)  // Constant: unrolled.
+    {
+      if (light[i].enabled == 0)  // Off!
+        continue;
+
+      vec3 l  = normalize(light[i].pos - f_position.xyz);  // Unit vector from fragment to light source.
+      float visibility = 1.0;
+
+      if (i == shadow_light)  // Directional, and shadowed.
+      {
+        l = light_dir.xyz;
+        visibility = ShadowVisibility(n, l);
+      }
+
+      vec3 r  = -reflect(l, n);                            // Reflection of light ray on fragment.
+      vec3 f = normalize(-f_position.xyz);                 // Unit vector from fragment to camera (origin).
+      float d =    length(light[i].pos - f_position.xyz);  // Distance from fragment to light source.
+      float alpha = light[i].alpha;
+
+      vec3 Id = light[i].Ld * max(dot(n, l), 0);              // Diffuse component.
+      vec3 Is = light[i].Ls * pow(max(dot(r, f), 0), alpha);  // Specular component. TODO: shininess.
+
+      I += visibility * (Kd*Id + Ks*Is);
+    }
+    
+    pixel_color = vec4(I, 1.0);
+  }
+#endif
+}
\ No newline at end of file
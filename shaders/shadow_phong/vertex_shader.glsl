@@ -0,0 +1,53 @@
+#version 330
+
+layout (location = 0) in vec3 v_position;
+layout (location = 1) in vec3 v_normal;
+layout (location = 2) in vec2 v_uv;
+// layout (location = 3) in vec3 v_tangent;
+
+out vec4 f_position;  // Fragment position in camera coordinates.
+out vec4 f_normal;    // Fragment normal in camera coordinates.
+out vec2 f_uv;        // Fragment uv coordinates.
+
+// out vec4 f_tangent;   // Fragment tangent vector in camera coordinates.
+
+struct Material
+{
+  vec3 Ka;  // Ambient component (in [0, 1]).
+  vec3 Kd;  // Diffuse component (in [0, 1]).
+  vec3 Ks;  // Specular component (in [0, 1]).
+};
+
+layout (std140) uniform Camera  // Per frame.
+{
+  mat4 V;  // View  matrix.
+  mat4 P;  // Projection matrix.
+};
+
+layout (std140) uniform Object  // Per draw.
+{
+  mat4 M;             // Model matrix.
+  mat4 N;             // Normal matrix N = (M^-1)'.
+  Material material;  // Material properties (Ka, Kd, Ks).
+};
+
+// const float C = 1;
+// const float far = 1000;
+
+void main()
+{
+  // Compute vertex position in world coordinates.
+  f_position = V * (M * vec4(v_position, 1.0f));
+  f_position = f_position/f_position.w;
+
+  // Then project f_position onto screen and store into gl_Position.
+  gl_Position = P * f_position;
+  // gl_Position.z = 2.0*log(gl_Position.w*C + 1)/log(far*C + 1) - 1;
+  // gl_Position.z *= gl_Position.w;
+
+  // Transform the vertex normal vector.
+  f_normal = normalize(V * N * vec4(v_normal, 0.0));
+
+  // Pass uv coordinates to be interpolated.
+  f_uv = v_uv;
+}
\ No newline at end of file